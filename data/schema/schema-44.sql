@@ -0,0 +1,10 @@
+CREATE TABLE scan_journal (
+  subdirs_table TEXT NOT NULL,
+  directory INTEGER NOT NULL,
+  path TEXT NOT NULL,
+  ignores_mtime INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE INDEX idx_scan_journal ON scan_journal (subdirs_table, directory, path);
+
+UPDATE schema_version SET version=44;
@@ -25,6 +25,7 @@
 #include <QFileInfo>
 #include <QNetworkAccessManager>
 #include <QTextCodec>
+#include <QTimerEvent>
 #include <QUrl>
 
 #include <aifffile.h>
@@ -101,10 +102,71 @@ TagReaderWorker::TagReaderWorker(QIODevice* socket, QObject* parent)
   : AbstractMessageHandler<pb::tagreader::Message>(socket, parent),
     factory_(new TagLibFileRefFactory),
     network_(new QNetworkAccessManager),
-    kEmbeddedCover("(embedded)")
+    kEmbeddedCover("(embedded)"),
+    next_shared_memory_id_(0),
+    expire_timer_id_(0)
 {
 }
 
+bool TagReaderWorker::ShareEmbeddedArt(
+    const QByteArray& data, pb::tagreader::LoadEmbeddedArtResponse* response) {
+  ExpireSharedMemory();
+
+  const QString key = QString("clementine-tagreader-%1-%2").arg(
+        QCoreApplication::applicationPid()).arg(next_shared_memory_id_++);
+
+  SharedMemoryPtr memory(new QSharedMemory(key));
+  if (!memory->create(data.size())) {
+    qLog(Warning) << "Couldn't create shared memory for embedded art:"
+                  << memory->errorString();
+    return false;
+  }
+
+  memory->lock();
+  memcpy(memory->data(), data.constData(), data.size());
+  memory->unlock();
+
+  SharedArt art;
+  art.memory_ = memory;
+  art.expiry_time_ = QDateTime::currentMSecsSinceEpoch() +
+                     kSharedMemoryLifetimeMsec;
+  shared_art_.enqueue(art);
+
+  while (shared_art_.count() > kMaxSharedMemorySegments) {
+    shared_art_.dequeue();
+  }
+
+  if (!expire_timer_id_) {
+    expire_timer_id_ = startTimer(kSharedMemoryLifetimeMsec);
+  }
+
+  response->set_shared_memory_key(DataCommaSizeFromQString(key));
+  response->set_shared_memory_size(data.size());
+  return true;
+}
+
+void TagReaderWorker::ExpireSharedMemory() {
+  // Detaching the last reference destroys the segment, so the client must
+  // have attached by the time the entry expires.
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  while (!shared_art_.isEmpty() && shared_art_.head().expiry_time_ <= now) {
+    shared_art_.dequeue();
+  }
+
+  if (shared_art_.isEmpty() && expire_timer_id_) {
+    killTimer(expire_timer_id_);
+    expire_timer_id_ = 0;
+  }
+}
+
+void TagReaderWorker::timerEvent(QTimerEvent* e) {
+  if (e->timerId() == expire_timer_id_) {
+    ExpireSharedMemory();
+  } else {
+    AbstractMessageHandler<pb::tagreader::Message>::timerEvent(e);
+  }
+}
+
 void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
   pb::tagreader::Message reply;
 
@@ -119,6 +181,13 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
   if (message.has_read_file_request()) {
     ReadFile(QStringFromStdString(message.read_file_request().filename()),
              reply.mutable_read_file_response()->mutable_metadata());
+  } else if (message.has_read_files_request()) {
+    const pb::tagreader::ReadFilesRequest& req = message.read_files_request();
+    pb::tagreader::ReadFilesResponse* response =
+        reply.mutable_read_files_response();
+    for (int i=0 ; i<req.filenames_size() ; ++i) {
+      ReadFile(QStringFromStdString(req.filenames(i)), response->add_metadata());
+    }
   } else if (message.has_save_file_request()) {
     reply.mutable_save_file_response()->set_success(
           SaveFile(QStringFromStdString(message.save_file_request().filename()),
@@ -127,10 +196,16 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
     reply.mutable_is_media_file_response()->set_success(
           IsMediaFile(QStringFromStdString(message.is_media_file_request().filename())));
   } else if (message.has_load_embedded_art_request()) {
-    QByteArray data = LoadEmbeddedArt(
-          QStringFromStdString(message.load_embedded_art_request().filename()));
-    reply.mutable_load_embedded_art_response()->set_data(
-          data.constData(), data.size());
+    const pb::tagreader::LoadEmbeddedArtRequest& req =
+        message.load_embedded_art_request();
+    QByteArray data = LoadEmbeddedArt(QStringFromStdString(req.filename()));
+    pb::tagreader::LoadEmbeddedArtResponse* response =
+        reply.mutable_load_embedded_art_response();
+    if (!req.allow_shared_memory() ||
+        data.size() < kSharedMemoryThreshold ||
+        !ShareEmbeddedArt(data, response)) {
+      response->set_data(data.constData(), data.size());
+    }
   } else if (message.has_read_cloud_file_request()) {
 #ifdef HAVE_GOOGLE_DRIVE
     const pb::tagreader::ReadCloudFileRequest& req =
@@ -633,6 +708,7 @@ QByteArray TagReaderWorker::LoadEmbeddedArt(const QString& filename) const {
 void TagReaderWorker::DeviceClosed() {
   AbstractMessageHandler<pb::tagreader::Message>::DeviceClosed();
 
+  shared_art_.clear();
   qApp->exit();
 }
 
@@ -24,8 +24,12 @@
 
 #include <taglib/xiphcomment.h>
 
+#include <QQueue>
+#include <QSharedMemory>
 #include <QUrl>
 
+#include <boost/shared_ptr.hpp>
+
 class QNetworkAccessManager;
 
 
@@ -44,11 +48,28 @@ class TagReaderWorker : public AbstractMessageHandler<pb::tagreader::Message> {
 public:
   TagReaderWorker(QIODevice* socket, QObject* parent = NULL);
 
+  // Pictures at least this big are handed over in shared memory.
+  static const int kSharedMemoryThreshold = 64 * 1024;
+  static const int kSharedMemoryLifetimeMsec = 10000;
+  static const int kMaxSharedMemorySegments = 16;
+
 protected:
   void MessageArrived(const pb::tagreader::Message& message);
   void DeviceClosed();
+  void timerEvent(QTimerEvent* e);
 
 private:
+  typedef boost::shared_ptr<QSharedMemory> SharedMemoryPtr;
+
+  struct SharedArt {
+    SharedMemoryPtr memory_;
+    qint64 expiry_time_;
+  };
+
+  bool ShareEmbeddedArt(const QByteArray& data,
+                        pb::tagreader::LoadEmbeddedArtResponse* response);
+  void ExpireSharedMemory();
+
   void ReadFile(const QString& filename, pb::tagreader::SongMetadata* song) const;
   bool SaveFile(const QString& filename, const pb::tagreader::SongMetadata& song) const;
   bool IsMediaFile(const QString& filename) const;
@@ -86,6 +107,10 @@ private:
   QNetworkAccessManager* network_;
 
   const std::string kEmbeddedCover;
+
+  int next_shared_memory_id_;
+  int expire_timer_id_;
+  QQueue<SharedArt> shared_art_;
 };
 
 #endif // TAGREADERWORKER_H
@@ -46,6 +46,10 @@ signals:
   // worker wasn't found, or couldn't be executed.
   void WorkerFailedToStart();
 
+  // Emitted when a worker crashed or stopped unexpectedly and is being
+  // restarted.
+  void WorkerRestarted();
+
 protected slots:
   virtual void DoStart() {}
   virtual void NewConnection() {}
@@ -76,6 +80,7 @@ public:
   // Sets the number of worker process to use.  Defaults to
   // 1 <= (processors / 2) <= 2.
   void SetWorkerCount(int count);
+  int worker_count() const { return worker_count_; }
 
   // Sets the prefix to use for the local server (on unix this is a named pipe
   // in /tmp).  Defaults to QApplication::applicationName().  A random number
@@ -338,6 +343,7 @@ void WorkerPool<HandlerType>::ProcessError(QProcess::ProcessError error) {
     // On any other error we just restart the process.
     qLog(Debug) << "Worker" << worker << "failed with error" << error << "- restarting";
     StartOneWorker(worker);
+    emit WorkerRestarted();
     break;
   }
 }
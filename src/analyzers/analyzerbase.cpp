@@ -22,10 +22,29 @@
 #include <QEvent>     //event()
 #include <QPainter>
 #include <QPaintEvent>
+#include <QThreadPool>
 #include <QtDebug>
 
+#include <boost/bind.hpp>
+
+#include "core/concurrentrun.h"
 #include "engines/enginebase.h"
 
+namespace {
+
+// One thread is plenty, and means analyzers never compete with each other.
+QThreadPool* AnalysisThreadPool()
+{
+    static QThreadPool* pool = NULL;
+    if (!pool) {
+        pool = new QThreadPool;
+        pool->setMaxThreadCount(1);
+    }
+    return pool;
+}
+
+}
+
 // INSTRUCTIONS Base2D
 // 1. do anything that depends on height() in init(), Base2D will call it before you are shown
 // 2. otherwise you can use the constructor to initialise things
@@ -52,11 +71,22 @@ Analyzer::Base::Base( QWidget *parent, uint scopeSize )
         , m_lastScope(512)
         , new_frame_(false)
         , is_playing_(false)
+        , m_bandsReady(false)
 {
+    connect(this, SIGNAL(frameAnalysed()), SLOT(update()), Qt::QueuedConnection);
+}
+
+Analyzer::Base::~Base()
+{
+    // Subclasses with their own transform() have stopped the worker already,
+    // this is for the ones using ours.
+    waitForAnalysis();
+    delete m_fht;
 }
 
 void Analyzer::Base::hideEvent(QHideEvent *) {
   m_timer.stop();
+  waitForAnalysis();
 }
 
 void Analyzer::Base::showEvent(QShowEvent *) {
@@ -90,30 +120,24 @@ void Analyzer::Base::paintEvent(QPaintEvent * e)
     switch( m_engine->state() )
     {
     case Engine::Playing:
+    case Engine::Paused:
     {
-        const Engine::Scope &thescope = m_engine->scope();
-        int i = 0;
+        is_playing_ = m_engine->state() == Engine::Playing;
 
-        // convert to mono here - our built in analyzers need mono, but we the engines provide interleaved pcm
-        for( uint x = 0; (int)x < m_fht->size(); ++x ) 
         {
-           m_lastScope[x] = double(thescope[i] + thescope[i+1]) / (2*(1<<15));
-           i += 2;
+            QMutexLocker l(&m_bandsMutex);
+            if (m_bandsReady) {
+                m_drawBands.swap(m_readyBands);
+                m_bandsReady = false;
+            }
         }
 
-        is_playing_ = true;
-        transform( m_lastScope );
-        analyze( p, m_lastScope, new_frame_ );
-
-        //scope.resize( m_fht->size() );
+        // Nothing to draw until the worker has analysed the first frame
+        if( !m_drawBands.empty() )
+            analyze( p, m_drawBands, new_frame_ );
 
         break;
     }
-    case Engine::Paused:
-        is_playing_ = false;
-        analyze(p, m_lastScope, new_frame_);
-        break;
-
     default:
         is_playing_ = false;
         demo(p);
@@ -123,6 +147,43 @@ void Analyzer::Base::paintEvent(QPaintEvent * e)
     new_frame_ = false;
 }
 
+void Analyzer::Base::startAnalysis()
+{
+    // Skip this frame if the last one is still being worked on, it'll
+    // repaint when it's done.
+    if( !m_analysis.isFinished() )
+        return;
+
+    // Getting the view is cheap, the samples are only read by the worker
+    const ScopeRingBuffer::View scope = m_engine->scope( m_fht->size() );
+    m_analysis = ConcurrentRun::Run<void>(AnalysisThreadPool(),
+        boost::bind(&Analyzer::Base::analyse, this, scope));
+}
+
+void Analyzer::Base::analyse(ScopeRingBuffer::View scope)
+{
+    // convert to mono here - our built in analyzers need mono, but the engines provide interleaved pcm.
+    // Until the engine has enough audio we keep analysing the last scope we saw
+    if( !scope.is_empty() )
+        scope.MixToMono( &m_lastScope[0] );
+
+    m_workBands.assign( m_lastScope.begin(), m_lastScope.begin() + m_fht->size() );
+    transform( m_workBands );
+
+    {
+        QMutexLocker l(&m_bandsMutex);
+        m_workBands.swap(m_readyBands);
+        m_bandsReady = true;
+    }
+
+    emit frameAnalysed();
+}
+
+void Analyzer::Base::waitForAnalysis()
+{
+    m_analysis.waitForFinished();
+}
+
 int Analyzer::Base::resizeExponent( int exp )
 {
     if ( exp < 3 )
@@ -131,6 +192,7 @@ int Analyzer::Base::resizeExponent( int exp )
         exp = 9;
 
     if ( exp != m_fht->sizeExp() ) {
+        waitForAnalysis();
         delete m_fht;
         m_fht = new FHT( exp );
     }
@@ -228,5 +290,10 @@ void Analyzer::Base::timerEvent(QTimerEvent* e) {
     return;
 
   new_frame_ = true;
-  update();
+
+  // While playing, the worker repaints once it has analysed the new frame
+  if (m_engine && m_engine->state() == Engine::Playing)
+    startAnalysis();
+  else
+    update();
 }
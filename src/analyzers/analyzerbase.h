@@ -11,8 +11,11 @@
 
 #include "core/fht.h"     //stack allocated and convenience
 #include "engines/engine_fwd.h"
+#include "engines/scoperingbuffer.h"
 #include <QPixmap> //stack allocated and convenience
 #include <QBasicTimer>  //stack allocated
+#include <QFuture>
+#include <QMutex>
 #include <QWidget> //baseclass
 #include <vector>    //included for convenience
 
@@ -39,7 +42,7 @@ class Base : public QWidget
   Q_OBJECT
 
 public:
-    ~Base() { delete m_fht; }
+    ~Base();
 
     uint timeout() const { return m_timeout; }
 
@@ -53,6 +56,15 @@ public:
       }
     }
 
+    // The scope is transformed on a worker thread, which calls transform().
+    // Subclasses that reimplement transform() must call this in their
+    // destructor, so the worker isn't left running on a half-destroyed
+    // subclass.
+    void waitForAnalysis();
+
+signals:
+    void frameAnalysed();
+
 protected:
     Base( QWidget*, uint scopeSize = 7 );
 
@@ -79,6 +91,21 @@ protected:
 
     bool new_frame_;
     bool is_playing_;
+
+private:
+    void startAnalysis();
+    void analyse(ScopeRingBuffer::View scope);
+
+    QFuture<void> m_analysis;
+
+    // The worker transforms into m_workBands and swaps it with m_readyBands.
+    // Painting takes m_readyBands if it's newer than what it drew last time,
+    // so the only thing the two threads wait on is the swap.
+    QMutex m_bandsMutex;
+    Scope m_workBands;
+    Scope m_readyBands;
+    Scope m_drawBands;
+    bool m_bandsReady;
 };
 
 
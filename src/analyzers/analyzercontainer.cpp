@@ -123,6 +123,20 @@ void AnalyzerContainer::mouseDoubleClickEvent(QMouseEvent *) {
     visualisation_action_->trigger();
 }
 
+AnalyzerContainer::~AnalyzerContainer() {
+  DeleteAnalyzer();
+}
+
+void AnalyzerContainer::DeleteAnalyzer() {
+  if (!current_analyzer_)
+    return;
+
+  // The analyzer's worker thread might still be inside its transform()
+  current_analyzer_->waitForAnalysis();
+  delete current_analyzer_;
+  current_analyzer_ = NULL;
+}
+
 void AnalyzerContainer::SetEngine(EngineBase *engine) {
   if (current_analyzer_)
     current_analyzer_->set_engine(engine);
@@ -130,8 +144,7 @@ void AnalyzerContainer::SetEngine(EngineBase *engine) {
 }
 
 void AnalyzerContainer::DisableAnalyzer() {
-  delete current_analyzer_;
-  current_analyzer_ = NULL;
+  DeleteAnalyzer();
 
   Save();
 }
@@ -144,7 +157,7 @@ void AnalyzerContainer::ChangeAnalyzer(int id) {
     return;
   }
 
-  delete current_analyzer_;
+  DeleteAnalyzer();
   current_analyzer_ = qobject_cast<Analyzer::Base*>(instance);
   current_analyzer_->set_engine(engine_);
   // Even if it is not supposed to happen, I don't want to get a dbz error
@@ -30,6 +30,7 @@ class AnalyzerContainer : public QWidget {
 
 public:
   AnalyzerContainer(QWidget* parent);
+  ~AnalyzerContainer();
 
   void SetEngine(EngineBase* engine);
   void SetActions(QAction* visualisation);
@@ -55,6 +56,7 @@ private:
 
   void Load();
   void Save();
+  void DeleteAnalyzer();
   void SaveFramerate(int framerate);
   template <typename T>
       void AddAnalyzerType();
@@ -44,6 +44,7 @@ BlockAnalyzer::BlockAnalyzer( QWidget *parent )
 
 BlockAnalyzer::~BlockAnalyzer()
 {
+    waitForAnalysis();
 }
 
 void
@@ -51,6 +52,9 @@ BlockAnalyzer::resizeEvent( QResizeEvent *e )
 {
    QWidget::resizeEvent( e );
 
+   // transform() looks at m_scope's size from the analysis thread
+   waitForAnalysis();
+
    m_background = QPixmap(size());
 
    const uint oldRows = m_rows;
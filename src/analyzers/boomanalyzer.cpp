@@ -19,6 +19,11 @@ BoomAnalyzer::BoomAnalyzer( QWidget *parent )
 {
 }
 
+BoomAnalyzer::~BoomAnalyzer()
+{
+    waitForAnalysis();
+}
+
 void
 BoomAnalyzer::changeK_barHeight( int newValue )
 {
@@ -16,6 +16,7 @@ class BoomAnalyzer : public Analyzer::Base
 Q_OBJECT
 public:
     Q_INVOKABLE BoomAnalyzer( QWidget* );
+    ~BoomAnalyzer();
 
     static const char* kName;
 
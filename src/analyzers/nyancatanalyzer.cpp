@@ -51,6 +51,10 @@ NyanCatAnalyzer::NyanCatAnalyzer(QWidget* parent)
   }
 }
 
+NyanCatAnalyzer::~NyanCatAnalyzer() {
+  waitForAnalysis();
+}
+
 void NyanCatAnalyzer::transform(Scope& s) {
   m_fht->spectrum(&s.front());
 }
@@ -27,6 +27,7 @@ class NyanCatAnalyzer : public Analyzer::Base {
 
 public:
   Q_INVOKABLE NyanCatAnalyzer(QWidget* parent);
+  ~NyanCatAnalyzer();
 
   static const char* kName;
 
@@ -25,6 +25,7 @@ Sonogram::Sonogram(QWidget *parent) :
 
 Sonogram::~Sonogram()
 {
+    waitForAnalysis();
 }
 
 
@@ -69,6 +69,8 @@ Application::Application(QObject* parent)
     network_remote_(NULL),
     network_remote_helper_(NULL)
 {
+  startup_time_.start();
+
   tag_reader_client_ = new TagReaderClient(this);
   MoveToNewThread(tag_reader_client_);
   tag_reader_client_->Start();
@@ -125,6 +127,11 @@ Application::~Application() {
   // thread, including some device library backends.
   delete device_manager_; device_manager_ = NULL;
 
+  // Playlist saves are delayed, so write out any that are still waiting before
+  // the database thread goes away.
+  QMetaObject::invokeMethod(playlist_backend_, "FlushPendingSaves",
+                            Qt::BlockingQueuedConnection);
+
   foreach (QObject* object, objects_in_threads_) {
     object->deleteLater();
   }
@@ -21,6 +21,7 @@
 #include "ui/settingsdialog.h"
 
 #include <QObject>
+#include <QTime>
 
 class AlbumCoverLoader;
 class Appearance;
@@ -81,6 +82,9 @@ public:
   LibraryBackend* library_backend() const;
   LibraryModel* library_model() const;
 
+  // Used to report how long startup milestones took.
+  int msecs_since_startup() const { return startup_time_.elapsed(); }
+
   void MoveToNewThread(QObject* object);
   void MoveToThread(QObject* object, QThread* thread);
 
@@ -120,6 +124,8 @@ private:
 
   QList<QObject*> objects_in_threads_;
   QList<QThread*> threads_;
+
+  QTime startup_time_;
 };
 
 #endif // APPLICATION_H
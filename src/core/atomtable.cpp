@@ -0,0 +1,66 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "atomtable.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+namespace {
+
+// The table is split into shards, each with its own lock, so songs being
+// loaded on several threads at once don't all wait for the same mutex.
+const int kShardCount = 16;
+
+struct Shard {
+  QMutex mutex;
+  QSet<QString> strings;
+};
+
+Shard sShards[kShardCount];
+
+}
+
+QString AtomTable::Intern(const QString& str) {
+  if (str.isEmpty())
+    return str;
+
+  Shard& shard = sShards[qHash(str) % kShardCount];
+  QMutexLocker l(&shard.mutex);
+
+  QSet<QString>::const_iterator it = shard.strings.constFind(str);
+  if (it != shard.strings.constEnd())
+    return *it;
+
+  // Take a tight copy rather than holding on to whatever buffer the caller's
+  // string happened to be built in.
+  QString atom(str);
+  atom.squeeze();
+
+  shard.strings.insert(atom);
+  return atom;
+}
+
+int AtomTable::count() {
+  int ret = 0;
+  for (int i=0 ; i<kShardCount ; ++i) {
+    QMutexLocker l(&sShards[i].mutex);
+    ret += sShards[i].strings.count();
+  }
+  return ret;
+}
@@ -0,0 +1,39 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ATOMTABLE_H
+#define ATOMTABLE_H
+
+#include <QString>
+
+// A process-wide table of shared strings.  Interning a string returns a copy
+// that shares its data with every other interned copy of the same text, so
+// an artist name that appears on thousands of songs is only stored once.
+//
+// Atoms are never removed, so only intern fields that have a limited number
+// of distinct values - artists and albums, not titles or filenames.
+// Thread-safe.
+namespace AtomTable {
+
+  QString Intern(const QString& str);
+
+  // The number of distinct strings in the table.
+  int count();
+
+}
+
+#endif // ATOMTABLE_H
@@ -37,8 +37,9 @@
 #include <QVariant>
 
 const char* Database::kDatabaseFilename = "clementine.db";
-const int Database::kSchemaVersion = 43;
+const int Database::kSchemaVersion = 45;
 const char* Database::kMagicAllSongsTables = "%allsongstables";
+const int Database::kBusyTimeoutMsec = 30000;
 
 int Database::sNextConnectionId = 1;
 QMutex Database::sNextConnectionIdMutex;
@@ -315,7 +316,9 @@ Database::Database(Application* app, QObject* parent, const QString& database_na
   : QObject(parent),
     app_(app),
     mutex_(QMutex::Recursive),
+    connections_lock_(QReadWriteLock::Recursive),
     injected_database_name_(database_name),
+    wal_enabled_(false),
     query_hash_(0),
     startup_schema_version_(-1)
 {
@@ -331,7 +334,45 @@ Database::Database(Application* app, QObject* parent, const QString& database_na
         directory_ + "/jamendo.db", ":/schema/jamendo.sql");
 
   QMutexLocker l(&mutex_);
-  Connect();
+  QSqlDatabase db(Connect());
+
+  // Decide here, before any other thread can use the database, whether readers
+  // need the write mutex.  It never changes after this.
+  wal_enabled_ = db.isOpen() && IsWalEnabled(db);
+}
+
+Database::Locker::Locker(Database* db, bool lock_mutex)
+  : db_(db),
+    locked_(true),
+    holds_mutex_(lock_mutex)
+{
+  db_->connections_lock_.lockForRead();
+  if (holds_mutex_)
+    db_->mutex_.lock();
+}
+
+Database::Locker::~Locker() {
+  unlock();
+}
+
+void Database::Locker::unlock() {
+  if (!locked_)
+    return;
+  locked_ = false;
+
+  if (holds_mutex_)
+    db_->mutex_.unlock();
+  db_->connections_lock_.unlock();
+}
+
+Database::ReadLocker::ReadLocker(Database* db)
+  : Locker(db, !db->wal_enabled_)
+{
+}
+
+Database::WriteLocker::WriteLocker(Database* db)
+  : Locker(db, true)
+{
 }
 
 QSqlDatabase Database::Connect() {
@@ -361,6 +402,12 @@ QSqlDatabase Database::Connect() {
   else
     db.setDatabaseName(directory_ + "/" + kDatabaseFilename);
 
+  // Readers don't hold the write mutex in WAL mode, so a checkpoint or another
+  // connection's commit can briefly lock the database.  Wait for it rather
+  // than failing the query straight away.
+  db.setConnectOptions(
+      QString("QSQLITE_BUSY_TIMEOUT=%1").arg(kBusyTimeoutMsec));
+
   if (!db.open()) {
     app_->AddError("Database: " + db.lastError().text());
     return db;
@@ -387,8 +434,12 @@ QSqlDatabase Database::Connect() {
   foreach (const QString& key, attached_databases_.keys()) {
     QString filename = attached_databases_[key].filename_;
 
-    if (!injected_database_name_.isNull())
+    // An injected database file gets its attached databases alongside it.
+    // Attaching the same file would make them share its tables.
+    if (injected_database_name_ == ":memory:")
       filename = injected_database_name_;
+    else if (!injected_database_name_.isNull())
+      filename = injected_database_name_ + "." + key;
 
     // Attach the db
     QSqlQuery q("ATTACH DATABASE :filename AS :alias", db);
@@ -399,6 +450,10 @@ QSqlDatabase Database::Connect() {
     }
   }
 
+  if (injected_database_name_ != ":memory:") {
+    EnableWal(db);
+  }
+
   if(startup_schema_version_ == -1) {
     UpdateMainSchema(&db);
   }
@@ -440,36 +495,79 @@ void Database::UpdateMainSchema(QSqlDatabase* db) {
   }
 }
 
+void Database::EnableWal(QSqlDatabase& db) {
+  // The journal mode is stored in the database file, but synchronous is per
+  // connection.  NORMAL is safe with WAL - a power cut can lose the last few
+  // commits but never corrupts the database.
+  QStringList schemas = QStringList() << "main" << attached_databases_.keys();
+  foreach (const QString& schema, schemas) {
+    QSqlQuery q(QString("PRAGMA %1.journal_mode = WAL").arg(schema), db);
+    if (!q.exec() || !q.next() ||
+        q.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+      qLog(Warning) << "Couldn't enable WAL journal mode for" << schema;
+    }
+  }
+
+  QSqlQuery q("PRAGMA synchronous = NORMAL", db);
+  q.exec();
+}
+
+bool Database::IsWalEnabled(QSqlDatabase& db) {
+  // In-memory databases report "memory" here.
+  QStringList schemas = QStringList() << "main" << attached_databases_.keys();
+  foreach (const QString& schema, schemas) {
+    QSqlQuery q(QString("PRAGMA %1.journal_mode").arg(schema), db);
+    if (!q.exec() || !q.next() ||
+        q.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Database::RecreateAttachedDb(const QString& database_name) {
   if (!attached_databases_.contains(database_name)) {
     qLog(Warning) << "Attached database does not exist:" << database_name;
     return;
   }
 
-  const QString filename = attached_databases_[database_name].filename_;
-
-  QMutexLocker l(&mutex_);
-  {
-    QSqlDatabase db(Connect());
+  // Keep out readers and writers.  They take connections_lock_ before the
+  // write mutex, so the locks are taken in the same order here.
+  connections_lock_.lockForWrite();
+  mutex_.lock();
 
-    QSqlQuery q("DETACH DATABASE :alias", db);
-    q.bindValue(":alias", database_name);
-    if (!q.exec()) {
-      qLog(Warning) << "Failed to detach database" << database_name;
-      return;
+  if (DetachAndRemove(database_name)) {
+    // We can't just re-attach the database now because it needs to be done for
+    // each thread.  Close all the database connections, so each thread will
+    // re-attach it when they next connect.
+    foreach (const QString& name, QSqlDatabase::connectionNames()) {
+      QSqlDatabase::removeDatabase(name);
     }
+  }
 
-    if (!QFile::remove(filename)) {
-      qLog(Warning) << "Failed to remove file" << filename;
-    }
+  mutex_.unlock();
+  connections_lock_.unlock();
+}
+
+bool Database::DetachAndRemove(const QString& database_name) {
+  const QString filename = attached_databases_[database_name].filename_;
+  QSqlDatabase db(Connect());
+
+  QSqlQuery q("DETACH DATABASE :alias", db);
+  q.bindValue(":alias", database_name);
+  if (!q.exec()) {
+    qLog(Warning) << "Failed to detach database" << database_name;
+    return false;
   }
 
-  // We can't just re-attach the database now because it needs to be done for
-  // each thread.  Close all the database connections, so each thread will
-  // re-attach it when they next connect.
-  foreach (const QString& name, QSqlDatabase::connectionNames()) {
-    QSqlDatabase::removeDatabase(name);
+  if (!QFile::remove(filename)) {
+    qLog(Warning) << "Failed to remove file" << filename;
   }
+
+  // Don't let a stale write-ahead log get replayed into the new database.
+  QFile::remove(filename + "-wal");
+  QFile::remove(filename + "-shm");
+  return true;
 }
 
 void Database::UpdateDatabaseSchema(int version, QSqlDatabase &db) {
@@ -641,7 +739,7 @@ void Database::DoBackup() {
   QSqlDatabase db(this->Connect());
 
   // Before we overwrite anything, make sure the database is not corrupt
-  QMutexLocker l(&mutex_);
+  WriteLocker l(this);
   const bool ok = IntegrityCheck(db);
 
   if (ok) {
@@ -21,6 +21,7 @@
 #include <QMap>
 #include <QMutex>
 #include <QObject>
+#include <QReadWriteLock>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QStringList>
@@ -49,11 +50,50 @@ class Database : public QObject {
   static const int kSchemaVersion;
   static const char* kDatabaseFilename;
   static const char* kMagicAllSongsTables;
+  static const int kBusyTimeoutMsec;
 
   QSqlDatabase Connect();
   bool CheckErrors(const QSqlQuery& query);
-  QMutex* Mutex() { return &mutex_; }
 
+  // Writes must always hold a WriteLocker.  Read-only queries can hold a
+  // ReadLocker instead: in WAL mode every thread's connection reads its own
+  // snapshot of the database without blocking the writer, so readers only
+  // keep RecreateAttachedDb() from closing their connection under them.
+  // In-memory databases can't use WAL so readers take the write mutex too.
+  //
+  // Both take the read side of connections_lock_ before the write mutex, so
+  // they can be nested either way round.
+  class Locker {
+   public:
+    ~Locker();
+
+    // Lets go early, before the destructor.
+    void unlock();
+
+   protected:
+    Locker(Database* db, bool lock_mutex);
+
+   private:
+    Q_DISABLE_COPY(Locker)
+
+    Database* db_;
+    bool locked_;
+    bool holds_mutex_;
+  };
+
+  class ReadLocker : public Locker {
+   public:
+    explicit ReadLocker(Database* db);
+  };
+
+  class WriteLocker : public Locker {
+   public:
+    explicit WriteLocker(Database* db);
+  };
+
+  bool wal_enabled() const { return wal_enabled_; }
+
+  // Must be called without holding a Locker.
   void RecreateAttachedDb(const QString& database_name);
   void ExecFromFile(const QString& filename, QSqlDatabase &db, int schema_version);
   void ExecCommands(const QString& commands, QSqlDatabase &db, int schema_version);
@@ -76,6 +116,9 @@ class Database : public QObject {
   bool IntegrityCheck(QSqlDatabase db);
   void BackupFile(const QString& filename);
   bool OpenDatabase(const QString& filename, sqlite3** connection) const;
+  void EnableWal(QSqlDatabase& db);
+  bool IsWalEnabled(QSqlDatabase& db);
+  bool DetachAndRemove(const QString& database_name);
 
   struct AttachedDatabase {
     AttachedDatabase() {}
@@ -95,6 +138,10 @@ class Database : public QObject {
   QMutex connect_mutex_;
   QMutex mutex_;
 
+  // Lockers hold this for reading.  RecreateAttachedDb() holds it for
+  // writing while it closes every thread's connection.
+  QReadWriteLock connections_lock_;
+
   // This ID makes the QSqlDatabase name unique to the object as well as the
   // thread
   int connection_id_;
@@ -104,6 +151,8 @@ class Database : public QObject {
 
   // Used by tests
   QString injected_database_name_;
+  // Only written by the constructor.
+  bool wal_enabled_;
 
   uint query_hash_;
   QStringList query_cache_;
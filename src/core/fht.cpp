@@ -21,12 +21,16 @@
 #include <math.h>
 #include <string.h>
 #include "fht.h"
+#include "fhtkernels.h"
 
 
-FHT::FHT(int n) :
+FHT::FHT(int n, const FHTKernels::Table *kernels) :
     m_buf(0),
     m_tab(0),
-    m_log(0)
+    m_twiddle(0),
+    m_perm(0),
+    m_log(0),
+    m_kernels(kernels ? kernels : &FHTKernels::Best())
 {
     if (n < 3) {
         m_num = 0;
@@ -39,6 +43,7 @@ FHT::FHT(int n) :
         m_buf = new float[m_num];
         m_tab = new float[m_num * 2];
         makeCasTable();
+        makeButterflyTables();
     }
 }
 
@@ -47,10 +52,18 @@ FHT::~FHT()
 {
     delete[] m_buf;
     delete[] m_tab;
+    delete[] m_twiddle;
+    delete[] m_perm;
     delete[] m_log;
 }
 
 
+const char* FHT::kernelName() const
+{
+    return m_kernels->name;
+}
+
+
 void FHT::makeCasTable(void)
 {
     float d, *costab, *sintab;
@@ -67,6 +80,36 @@ void FHT::makeCasTable(void)
 }
 
 
+void FHT::makeButterflyTables(void)
+{
+    // For a butterfly over n values the cas table is read with a stride of
+    // 2 * m_num / n: cosines at even offsets and sines one after them.
+    int i, n, stride, ndiv2, bits = m_exp2 - 3;
+    float *costab, *sintab;
+
+    m_twiddle = new float[m_num * 2];
+    for (n = 16, costab = m_twiddle; n <= m_num; costab += n, n *= 2) {
+        ndiv2 = n / 2;
+        stride = 2 * m_num / n;
+        for (i = 0, sintab = costab + ndiv2; i < ndiv2; i++) {
+            costab[i] = m_tab[i * stride];
+            sintab[i] = m_tab[i * stride + 1];
+        }
+    }
+
+    // Splitting each block into its even and odd values on the way down, as
+    // the recursive algorithm does, puts value x at the bit-reversed block
+    // of its low bits, offset by its high bits.
+    m_perm = new int[m_num];
+    for (int x = 0; x < m_num; x++) {
+        int block = 0;
+        for (i = 0; i < bits; i++)
+            block |= ((x >> i) & 1) << (bits - 1 - i);
+        m_perm[block * 8 + (x >> bits)] = x;
+    }
+}
+
+
 float* FHT::copy(float *d, float *s)
 {
     return (float *)memcpy(d, s, m_num * sizeof(float));
@@ -81,15 +124,13 @@ float* FHT::clear(float *d)
 
 void FHT::scale(float *p, float d)
 {
-    for (int i = 0; i < (m_num / 2); i++)
-        *p++ *= d;
+    m_kernels->scale(p, d, m_num / 2);
 }
 
 
 void FHT::ewma(float *d, float *s, float w)
 {
-    for (int i = 0; i < (m_num / 2); i++, d++, s++)
-        *d = *d * w + *s * (1 - w);
+    m_kernels->ewma(d, s, w, m_num / 2);
 }
 
 
@@ -125,7 +166,8 @@ void FHT::semiLogSpectrum(float *p)
     float e;
     power2(p);
     for (int i = 0; i < (m_num / 2); i++, p++) {
-        e = 10.0 * log10(sqrt(*p * .5));
+        // 10 * log10(sqrt(x)), without the square root
+        e = 5.0 * log10(*p * .5);
         *p = e < 0 ? 0 : e;
     }
 }
@@ -134,38 +176,27 @@ void FHT::semiLogSpectrum(float *p)
 void FHT::spectrum(float *p)
 {
     power2(p);
-    for (int i = 0; i < (m_num / 2); i++, p++)
-        *p = (float)sqrt(*p * .5);
+    m_kernels->spectrum(p, m_num / 2);
 }
 
 
 void FHT::power(float *p)
 {
     power2(p);
-    for (int i = 0; i < (m_num / 2); i++)
-        *p++ *= .5;
+    m_kernels->scale(p, .5, m_num / 2);
 }
 
 
 void FHT::power2(float *p)
 {
-    int i;
-    float *q;
-    _transform(p, m_num, 0);
-
-    *p = (*p * *p), *p += *p, p++;
-
-    for (i = 1, q = p + m_num - 2; i < (m_num / 2); i++, --q)
-        *p = (*p * *p) + (*q * *q), p++;
+    _transform(p);
+    m_kernels->power2(p, m_num);
 }
 
 
 void FHT::transform(float *p)
 {
-    if (m_num == 8)
-        transform8(p);
-    else
-        _transform(p, m_num, 0);
+    _transform(p);
 }
 
 
@@ -198,45 +229,31 @@ void FHT::transform8(float *p)
 }
 
 
-void FHT::_transform(float *p, int n, int k)
+void FHT::_transform(float *p)
 {
-    if (n == 8) {
-        transform8(p + k);
+    if (m_num == 8) {
+        transform8(p);
         return;
     }
 
-    int i, j, ndiv2 = n / 2;
-    float a, *t1, *t2, *t3, *t4, *ptab, *pp;
-
-    for (i = 0, t1 = m_buf, t2 = m_buf + ndiv2, pp = &p[k]; i < ndiv2; i++)
-        *t1++ = *pp++, *t2++ = *pp++;
-
-    memcpy(p + k, m_buf, sizeof(float) * n);
+    int i, k, n;
+    float *src = m_buf, *dst = p, *tmp;
+    const float *costab = m_twiddle;
 
-    _transform(p, ndiv2, k);
-    _transform(p, ndiv2, k + ndiv2);
+    for (i = 0; i < m_num; i++)
+        m_buf[i] = p[m_perm[i]];
 
-    j = m_num / ndiv2 - 1;
-    t1 = m_buf;
-    t2 = t1 + ndiv2;
-    t3 = p + k + ndiv2;
-    ptab = m_tab;
-    pp = p + k;
+    for (k = 0; k < m_num; k += 8)
+        transform8(m_buf + k);
 
-    a = *ptab++ * *t3++;
-    a += *ptab * *pp;
-    ptab += j;
-
-    *t1++ = *pp + a;
-    *t2++ = *pp++ - a;
-
-    for (i = 1, t4 = p + k + n; i < ndiv2; i++, ptab += j) {
-        a = *ptab++ * *t3++;
-        a += *ptab * *--t4;
-
-        *t1++ = *pp + a;
-        *t2++ = *pp++ - a;
+    // Combine pairs of transforms into ones twice the size, moving between
+    // the two buffers instead of copying back after each pass.
+    for (n = 16; n <= m_num; costab += n, n *= 2) {
+        for (k = 0; k < m_num; k += n)
+            m_kernels->butterfly(src + k, dst + k, costab, costab + n / 2, n);
+        tmp = src, src = dst, dst = tmp;
     }
-    memcpy(p + k, m_buf, sizeof(float) * n);
-}
 
+    if (src != p)
+        memcpy(p, src, sizeof(float) * m_num);
+}
@@ -21,6 +21,10 @@
 #ifndef FHT_H
 #define FHT_H
 
+namespace FHTKernels {
+	struct Table;
+}
+
 /**
  * Implementation of the Hartley Transform after Bracewell's discrete
  * algorithm. The algorithm is subject to US patent No. 4,646,256 (1987)
@@ -35,7 +39,10 @@ class FHT
 	int	m_num;
 	float	*m_buf;
 	float	*m_tab;
+	float	*m_twiddle;
+	int	*m_perm;
 	int	*m_log;
+	const FHTKernels::Table *m_kernels;
 
 	/**
 	 * Create a table of "cas" (cosine and sine) values.
@@ -45,21 +52,31 @@ class FHT
 	void	makeCasTable();
 
 	/**
-	 * Recursive in-place Hartley transform. For internal use only!
+	 * Lay the cas values out once per butterfly size, and work out the
+	 * input order the 8-point transforms need, so the transform can run
+	 * without recursion and the kernels can read the tables linearly.
+	 */
+	void	makeButterflyTables();
+
+	/**
+	 * In-place Hartley transform. For internal use only!
 	 */
-	void	_transform(float *, int, int);
+	void	_transform(float *);
 
    public:
 	/**
 	* Prepare transform for data sets with @f$2^n@f$ numbers, whereby @f$n@f$
 	* should be at least 3. Values of more than 3 need a trigonometry table.
 	* @see makeCasTable()
+	* The inner loops use the fastest FHTKernels the CPU supports, unless
+	* other ones are given.
 	*/
-	FHT(int);
+	FHT(int, const FHTKernels::Table * = 0);
 
 	~FHT();
 	inline int sizeExp() const { return m_exp2; }
 	inline int size() const { return m_num; }
+	const char	*kernelName() const;
 	float	*copy(float *, float *);
 	float	*clear(float *);
 	void	scale(float *, float);
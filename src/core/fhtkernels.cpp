@@ -0,0 +1,114 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "config.h"
+#include "fhtkernels.h"
+
+#include <math.h>
+
+namespace FHTKernels {
+
+namespace {
+
+void Butterfly(const float* src, float* dst, const float* cos_tab,
+               const float* sin_tab, int n) {
+  const int half = n / 2;
+
+  dst[0] = src[0] + src[half];
+  dst[half] = src[0] - src[half];
+
+  for (int i = 1; i < half; ++i) {
+    const float a = cos_tab[i] * src[half + i] + sin_tab[i] * src[n - i];
+    dst[i] = src[i] + a;
+    dst[half + i] = src[i] - a;
+  }
+}
+
+void Power2(float* p, int n) {
+  p[0] = p[0] * p[0];
+  p[0] += p[0];
+
+  for (int i = 1; i < n / 2; ++i) {
+    p[i] = p[i] * p[i] + p[n - i] * p[n - i];
+  }
+}
+
+void Scale(float* p, float d, int count) {
+  for (int i = 0; i < count; ++i) {
+    p[i] *= d;
+  }
+}
+
+void Ewma(float* d, const float* s, float w, int count) {
+  const float inverse = 1 - w;
+  for (int i = 0; i < count; ++i) {
+    d[i] = d[i] * w + s[i] * inverse;
+  }
+}
+
+void Spectrum(float* p, int count) {
+  for (int i = 0; i < count; ++i) {
+    p[i] = sqrtf(p[i] * 0.5f);
+  }
+}
+
+const Table kScalar = {
+  "scalar", Butterfly, Power2, Scale, Ewma, Spectrum
+};
+
+}  // namespace
+
+const Table& Scalar() {
+  return kScalar;
+}
+
+const Table& Best() {
+#if defined(HAVE_BUILTIN_CPU_SUPPORTS) && \
+    (defined(__i386__) || defined(__x86_64__))
+  __builtin_cpu_init();
+  if (Avx2() && __builtin_cpu_supports("avx2"))
+    return *Avx2();
+  if (Sse2() && __builtin_cpu_supports("sse2"))
+    return *Sse2();
+#elif defined(__x86_64__)
+  // Every x86-64 CPU has SSE2, so it's safe without asking.
+  if (Sse2())
+    return *Sse2();
+#endif
+  return kScalar;
+}
+
+int Available(const Table* tables[kMaxTables]) {
+  int count = 0;
+  tables[count++] = &kScalar;
+
+#if defined(HAVE_BUILTIN_CPU_SUPPORTS) && \
+    (defined(__i386__) || defined(__x86_64__))
+  __builtin_cpu_init();
+  if (Sse2() && __builtin_cpu_supports("sse2"))
+    tables[count++] = Sse2();
+  if (Avx2() && __builtin_cpu_supports("avx2"))
+    tables[count++] = Avx2();
+#elif defined(__x86_64__)
+  if (Sse2())
+    tables[count++] = Sse2();
+#endif
+
+  return count;
+}
+
+}  // namespace FHTKernels
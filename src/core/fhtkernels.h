@@ -0,0 +1,65 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FHTKERNELS_H
+#define FHTKERNELS_H
+
+// The inner loops of FHT, with a plain C++ version and SIMD versions that are
+// compiled with their own instruction sets.  Best() picks the fastest one the
+// CPU supports at runtime.  The SIMD versions can round differently from the
+// plain one, so their results only agree to within float tolerance.
+//
+// This header is included by the files built with -msse2 and -mavx2, so it
+// mustn't include anything with inline code.
+namespace FHTKernels {
+
+  struct Table {
+    const char* name;
+
+    // One radix-2 Hartley butterfly over a block of n values, reading two
+    // n/2-point transforms from src and writing the n-point transform to
+    // dst.  cos_tab and sin_tab hold cos(2*pi*i/n) and sin(2*pi*i/n).
+    void (*butterfly)(const float* src, float* dst, const float* cos_tab,
+                      const float* sin_tab, int n);
+
+    // Turns a transform of n values into n/2 doubled power values.
+    void (*power2)(float* p, int n);
+
+    void (*scale)(float* p, float d, int count);
+    void (*ewma)(float* d, const float* s, float w, int count);
+
+    // p[i] = sqrt(p[i] * 0.5), for turning power2 output into magnitudes.
+    void (*spectrum)(float* p, int count);
+  };
+
+  const Table& Scalar();
+
+  // These return NULL if Clementine was built without them.
+  const Table* Sse2();
+  const Table* Avx2();
+
+  const Table& Best();
+
+  const int kMaxTables = 3;
+
+  // Fills tables with everything that can run on this CPU, slowest first, and
+  // returns how many there are.
+  int Available(const Table* tables[kMaxTables]);
+
+}  // namespace FHTKernels
+
+#endif // FHTKERNELS_H
@@ -0,0 +1,145 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// This file is compiled with -mavx2 on x86.  Don't include anything that
+// might define inline functions shared with the rest of Clementine, or they
+// could end up using AVX instructions too.
+
+#include "fhtkernels.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+namespace FHTKernels {
+
+namespace {
+
+inline __m256 Reverse(__m256 v) {
+  return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+void Butterfly(const float* src, float* dst, const float* cos_tab,
+               const float* sin_tab, int n) {
+  const int half = n / 2;
+
+  dst[0] = src[0] + src[half];
+  dst[half] = src[0] - src[half];
+
+  int i = 1;
+  for (; i + 8 <= half; i += 8) {
+    // src[n - i - 7] .. src[n - i], backwards.
+    const __m256 mirror = Reverse(_mm256_loadu_ps(src + n - i - 7));
+    const __m256 a = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(cos_tab + i),
+                      _mm256_loadu_ps(src + half + i)),
+        _mm256_mul_ps(_mm256_loadu_ps(sin_tab + i), mirror));
+    const __m256 even = _mm256_loadu_ps(src + i);
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(even, a));
+    _mm256_storeu_ps(dst + half + i, _mm256_sub_ps(even, a));
+  }
+
+  for (; i < half; ++i) {
+    const float a = cos_tab[i] * src[half + i] + sin_tab[i] * src[n - i];
+    dst[i] = src[i] + a;
+    dst[half + i] = src[i] - a;
+  }
+}
+
+void Power2(float* p, int n) {
+  const int half = n / 2;
+
+  p[0] = p[0] * p[0];
+  p[0] += p[0];
+
+  int i = 1;
+  for (; i + 8 <= half; i += 8) {
+    const __m256 v = _mm256_loadu_ps(p + i);
+    const __m256 mirror = Reverse(_mm256_loadu_ps(p + n - i - 7));
+    _mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_mul_ps(v, v),
+                                          _mm256_mul_ps(mirror, mirror)));
+  }
+
+  for (; i < half; ++i) {
+    p[i] = p[i] * p[i] + p[n - i] * p[n - i];
+  }
+}
+
+void Scale(float* p, float d, int count) {
+  const __m256 factor = _mm256_set1_ps(d);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), factor));
+  }
+  for (; i < count; ++i) {
+    p[i] *= d;
+  }
+}
+
+void Ewma(float* d, const float* s, float w, int count) {
+  const float inverse = 1 - w;
+  const __m256 weight = _mm256_set1_ps(w);
+  const __m256 inverse_weight = _mm256_set1_ps(inverse);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(d + i, _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(d + i), weight),
+        _mm256_mul_ps(_mm256_loadu_ps(s + i), inverse_weight)));
+  }
+  for (; i < count; ++i) {
+    d[i] = d[i] * w + s[i] * inverse;
+  }
+}
+
+void Spectrum(float* p, int count) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(p + i,
+                     _mm256_sqrt_ps(_mm256_mul_ps(_mm256_loadu_ps(p + i), half)));
+  }
+  for (; i < count; ++i) {
+    _mm_store_ss(p + i, _mm_sqrt_ss(_mm_set_ss(p[i] * 0.5f)));
+  }
+}
+
+const Table kAvx2 = {
+  "avx2", Butterfly, Power2, Scale, Ewma, Spectrum
+};
+
+}  // namespace
+
+const Table* Avx2() {
+  return &kAvx2;
+}
+
+}  // namespace FHTKernels
+
+#else  // __AVX2__
+
+namespace FHTKernels {
+
+const Table* Avx2() {
+  return 0;
+}
+
+}  // namespace FHTKernels
+
+#endif  // __AVX2__
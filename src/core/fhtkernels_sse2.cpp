@@ -0,0 +1,143 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// This file is compiled with -msse2 on x86.  Don't include anything that
+// might define inline functions shared with the rest of Clementine, or they
+// could end up using SSE2 instructions too.
+
+#include "fhtkernels.h"
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+namespace FHTKernels {
+
+namespace {
+
+inline __m128 Reverse(__m128 v) {
+  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+void Butterfly(const float* src, float* dst, const float* cos_tab,
+               const float* sin_tab, int n) {
+  const int half = n / 2;
+
+  dst[0] = src[0] + src[half];
+  dst[half] = src[0] - src[half];
+
+  int i = 1;
+  for (; i + 4 <= half; i += 4) {
+    // src[n - i - 3] .. src[n - i], backwards.
+    const __m128 mirror = Reverse(_mm_loadu_ps(src + n - i - 3));
+    const __m128 a = _mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(cos_tab + i), _mm_loadu_ps(src + half + i)),
+        _mm_mul_ps(_mm_loadu_ps(sin_tab + i), mirror));
+    const __m128 even = _mm_loadu_ps(src + i);
+    _mm_storeu_ps(dst + i, _mm_add_ps(even, a));
+    _mm_storeu_ps(dst + half + i, _mm_sub_ps(even, a));
+  }
+
+  for (; i < half; ++i) {
+    const float a = cos_tab[i] * src[half + i] + sin_tab[i] * src[n - i];
+    dst[i] = src[i] + a;
+    dst[half + i] = src[i] - a;
+  }
+}
+
+void Power2(float* p, int n) {
+  const int half = n / 2;
+
+  p[0] = p[0] * p[0];
+  p[0] += p[0];
+
+  int i = 1;
+  for (; i + 4 <= half; i += 4) {
+    const __m128 v = _mm_loadu_ps(p + i);
+    const __m128 mirror = Reverse(_mm_loadu_ps(p + n - i - 3));
+    _mm_storeu_ps(p + i, _mm_add_ps(_mm_mul_ps(v, v),
+                                    _mm_mul_ps(mirror, mirror)));
+  }
+
+  for (; i < half; ++i) {
+    p[i] = p[i] * p[i] + p[n - i] * p[n - i];
+  }
+}
+
+void Scale(float* p, float d, int count) {
+  const __m128 factor = _mm_set1_ps(d);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), factor));
+  }
+  for (; i < count; ++i) {
+    p[i] *= d;
+  }
+}
+
+void Ewma(float* d, const float* s, float w, int count) {
+  const float inverse = 1 - w;
+  const __m128 weight = _mm_set1_ps(w);
+  const __m128 inverse_weight = _mm_set1_ps(inverse);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(d + i, _mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(d + i), weight),
+        _mm_mul_ps(_mm_loadu_ps(s + i), inverse_weight)));
+  }
+  for (; i < count; ++i) {
+    d[i] = d[i] * w + s[i] * inverse;
+  }
+}
+
+void Spectrum(float* p, int count) {
+  const __m128 half = _mm_set1_ps(0.5f);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(p + i, _mm_sqrt_ps(_mm_mul_ps(_mm_loadu_ps(p + i), half)));
+  }
+  for (; i < count; ++i) {
+    _mm_store_ss(p + i, _mm_sqrt_ss(_mm_set_ss(p[i] * 0.5f)));
+  }
+}
+
+const Table kSse2 = {
+  "sse2", Butterfly, Power2, Scale, Ewma, Spectrum
+};
+
+}  // namespace
+
+const Table* Sse2() {
+  return &kSse2;
+}
+
+}  // namespace FHTKernels
+
+#else  // __SSE2__
+
+namespace FHTKernels {
+
+const Table* Sse2() {
+  return 0;
+}
+
+}  // namespace FHTKernels
+
+#endif  // __SSE2__
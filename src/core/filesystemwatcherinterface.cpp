@@ -15,6 +15,7 @@
    along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "config.h"
 #include "filesystemwatcherinterface.h"
 
 #include "qtfslistener.h"
@@ -23,6 +24,10 @@
 #include "macfslistener.h"
 #endif
 
+#ifdef HAVE_INOTIFY
+#include "inotifyfslistener.h"
+#endif
+
 FileSystemWatcherInterface::FileSystemWatcherInterface(QObject* parent)
     : QObject(parent) {
 }
@@ -31,6 +36,14 @@ FileSystemWatcherInterface* FileSystemWatcherInterface::Create(QObject* parent)
   FileSystemWatcherInterface* ret;
 #ifdef Q_OS_DARWIN
   ret = new MacFSListener(parent);
+#elif defined(HAVE_INOTIFY)
+  InotifyFSListener* inotify = new InotifyFSListener(parent);
+  if (inotify->is_valid()) {
+    ret = inotify;
+  } else {
+    delete inotify;
+    ret = new QtFSListener(parent);
+  }
 #else
   ret = new QtFSListener(parent);
 #endif
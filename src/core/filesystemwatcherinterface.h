@@ -29,10 +29,23 @@ class FileSystemWatcherInterface : public QObject {
   virtual void RemovePath(const QString& path) = 0;
   virtual void Clear() = 0;
 
+  // Returns true if this watcher emits FileChanged and FileDeleted for the
+  // files inside the watched directories.  Watchers that don't only emit
+  // PathChanged, and the whole directory has to be rescanned.
+  virtual bool reports_file_events() const { return false; }
+
   static FileSystemWatcherInterface* Create(QObject* parent = 0);
 
  signals:
+  // A watched directory changed, or a subdirectory inside it was created,
+  // removed or moved.
   void PathChanged(const QString& path);
+
+  // A file inside a watched directory was created, written or moved there.
+  void FileChanged(const QString& path);
+
+  // A file inside a watched directory was removed or moved away.
+  void FileDeleted(const QString& path);
 };
 
 #endif
@@ -0,0 +1,219 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inotifyfslistener.h"
+#include "core/logging.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+// Files are reported once they have been closed after writing, rather than on
+// every IN_MODIFY, so a file being copied into the library is only read once.
+const quint32 kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                           IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                           IN_MOVE_SELF | IN_ONLYDIR;
+
+}
+
+const int InotifyFSListener::kPollIntervalMsec = 30000;
+
+InotifyFSListener::InotifyFSListener(QObject* parent)
+  : FileSystemWatcherInterface(parent),
+    fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+    notifier_(NULL),
+    poll_timer_(NULL)
+{
+  if (fd_ == -1) {
+    qLog(Warning) << "Failed to create an inotify instance:" << strerror(errno);
+  }
+}
+
+InotifyFSListener::~InotifyFSListener() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+void InotifyFSListener::EnsureNotifier() {
+  if (notifier_)
+    return;
+
+  notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+  connect(notifier_, SIGNAL(activated(int)), SLOT(ReadEvents()));
+
+  poll_timer_ = new QTimer(this);
+  poll_timer_->setInterval(kPollIntervalMsec);
+  connect(poll_timer_, SIGNAL(timeout()), SLOT(PollPaths()));
+}
+
+void InotifyFSListener::AddPath(const QString& path) {
+  if (watches_by_path_.contains(path) || polled_paths_.contains(path))
+    return;
+
+  EnsureNotifier();
+
+  const int wd = inotify_add_watch(fd_, QFile::encodeName(path).constData(),
+                                   kWatchMask);
+  if (wd == -1) {
+    if (errno == ENOSPC) {
+      if (polled_paths_.isEmpty()) {
+        qLog(Warning) << "The inotify watch limit was reached, so some"
+                      << "directories will be polled instead.  Increase"
+                      << "fs.inotify.max_user_watches to watch them all.";
+        poll_timer_->start();
+      }
+      polled_paths_[path] = ModificationTime(path);
+    } else {
+      qLog(Warning) << "Failed to watch" << path << ":" << strerror(errno);
+    }
+    return;
+  }
+
+  paths_by_watch_[wd] = path;
+  watches_by_path_[path] = wd;
+}
+
+void InotifyFSListener::RemovePath(const QString& path) {
+  if (polled_paths_.remove(path) && polled_paths_.isEmpty())
+    poll_timer_->stop();
+
+  QHash<QString, int>::iterator it = watches_by_path_.find(path);
+  if (it == watches_by_path_.end())
+    return;
+
+  inotify_rm_watch(fd_, *it);
+  paths_by_watch_.remove(*it);
+  watches_by_path_.erase(it);
+}
+
+void InotifyFSListener::Clear() {
+  foreach (int wd, paths_by_watch_.keys()) {
+    inotify_rm_watch(fd_, wd);
+  }
+  paths_by_watch_.clear();
+  watches_by_path_.clear();
+
+  polled_paths_.clear();
+  if (poll_timer_)
+    poll_timer_->stop();
+}
+
+uint InotifyFSListener::ModificationTime(const QString& path) {
+  const QFileInfo info(path);
+  return info.exists() ? info.lastModified().toTime_t() : 0;
+}
+
+void InotifyFSListener::PollPaths() {
+  foreach (const QString& path, polled_paths_.keys()) {
+    PollPath(path);
+  }
+
+  if (polled_paths_.isEmpty())
+    poll_timer_->stop();
+}
+
+void InotifyFSListener::PollPath(const QString& path) {
+  // A directory's mtime changes when files are added, removed or renamed in
+  // it, which is as much as QFileSystemWatcher would tell us.
+  const uint mtime = ModificationTime(path);
+  if (mtime == polled_paths_[path])
+    return;
+
+  if (mtime == 0) {
+    // The directory is gone - its parent will be rescanned and stop watching
+    // it, like after IN_DELETE_SELF.
+    polled_paths_.remove(path);
+  } else {
+    polled_paths_[path] = mtime;
+  }
+  emit PathChanged(path);
+}
+
+void InotifyFSListener::ReadEvents() {
+  // Big enough for a few hundred events with short names.
+  char buffer[64 * 1024]
+      __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  forever {
+    const ssize_t len = read(fd_, buffer, sizeof(buffer));
+    if (len <= 0)
+      break;
+
+    for (char* p = buffer ; p < buffer + len ; ) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + event->len;
+
+      ProcessEvent(event->wd, event->mask,
+                   event->len ? QFile::decodeName(event->name) : QString());
+    }
+  }
+}
+
+void InotifyFSListener::ProcessEvent(int wd, quint32 mask, const QString& name) {
+  if (mask & IN_Q_OVERFLOW) {
+    // Some events were lost, so we don't know which files changed.  Ask for
+    // every directory to be rescanned.
+    qLog(Warning) << "inotify event queue overflowed";
+    foreach (const QString& path, paths_by_watch_.values()) {
+      emit PathChanged(path);
+    }
+    return;
+  }
+
+  QHash<int, QString>::const_iterator it = paths_by_watch_.constFind(wd);
+  if (it == paths_by_watch_.constEnd())
+    return;
+  const QString dir = *it;
+
+  if (mask & IN_IGNORED) {
+    // The watch was removed, either by us or because the directory is gone.
+    watches_by_path_.remove(dir);
+    paths_by_watch_.remove(wd);
+    return;
+  }
+
+  if (mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+    emit PathChanged(dir);
+    return;
+  }
+
+  if (mask & IN_ISDIR) {
+    // Subdirectories are still handled by rescanning their parent.
+    emit PathChanged(dir);
+    return;
+  }
+
+  const QString path = dir + "/" + name;
+
+  if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+    emit FileDeleted(path);
+  } else if (mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+    emit FileChanged(path);
+  }
+  // IN_CREATE on its own is ignored - the IN_CLOSE_WRITE that follows it is
+  // what tells us the file is ready to be read.
+}
@@ -0,0 +1,74 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INOTIFYFSLISTENER_H
+#define INOTIFYFSLISTENER_H
+
+#include "filesystemwatcherinterface.h"
+
+#include <QHash>
+
+class QSocketNotifier;
+class QTimer;
+
+// Watches directories with inotify directly instead of going through
+// QFileSystemWatcher, so changes to individual files are reported with
+// FileChanged and FileDeleted and the LibraryWatcher doesn't have to rescan
+// the whole directory.  Directories that can't be watched because the
+// user's watch limit was reached are polled instead.
+class InotifyFSListener : public FileSystemWatcherInterface {
+  Q_OBJECT
+
+ public:
+  InotifyFSListener(QObject* parent = 0);
+  ~InotifyFSListener();
+
+  // False if the inotify instance couldn't be created, for example because
+  // the user's instance limit was reached.
+  bool is_valid() const { return fd_ != -1; }
+
+  void AddPath(const QString& path);
+  void RemovePath(const QString& path);
+  void Clear();
+
+  bool reports_file_events() const { return true; }
+
+ private slots:
+  void ReadEvents();
+  void PollPaths();
+
+ private:
+  static const int kPollIntervalMsec;
+
+  // The socket notifier and poll timer are created lazily so they belong to
+  // the thread that the listener is used from, not the one it was created in.
+  void EnsureNotifier();
+  void ProcessEvent(int wd, quint32 mask, const QString& name);
+  void PollPath(const QString& path);
+  static uint ModificationTime(const QString& path);
+
+  int fd_;
+  QSocketNotifier* notifier_;
+  QTimer* poll_timer_;
+
+  QHash<int, QString> paths_by_watch_;
+  QHash<QString, int> watches_by_path_;
+
+  // Directories that couldn't be watched, and their mtime when last polled.
+  QHash<QString, uint> polled_paths_;
+};
+
+#endif  // INOTIFYFSLISTENER_H
@@ -53,6 +53,7 @@
 # include <libmtp.h>
 #endif
 
+#include "core/atomtable.h"
 #include "core/logging.h"
 #include "core/messagehandler.h"
 #include "core/mpris_common.h"
@@ -392,15 +393,15 @@ void Song::InitFromProtobuf(const pb::tagreader::SongMetadata& pb) {
   d->init_from_file_ = true;
   d->valid_ = pb.valid();
   d->title_ = QStringFromStdString(pb.title());
-  d->album_ = QStringFromStdString(pb.album());
-  d->artist_ = QStringFromStdString(pb.artist());
-  d->albumartist_ = QStringFromStdString(pb.albumartist());
-  d->composer_ = QStringFromStdString(pb.composer());
+  d->album_ = AtomTable::Intern(QStringFromStdString(pb.album()));
+  d->artist_ = AtomTable::Intern(QStringFromStdString(pb.artist()));
+  d->albumartist_ = AtomTable::Intern(QStringFromStdString(pb.albumartist()));
+  d->composer_ = AtomTable::Intern(QStringFromStdString(pb.composer()));
   d->track_ = pb.track();
   d->disc_ = pb.disc();
   d->bpm_ = pb.bpm();
   d->year_ = pb.year();
-  d->genre_ = QStringFromStdString(pb.genre());
+  d->genre_ = AtomTable::Intern(QStringFromStdString(pb.genre()));
   d->comment_ = QStringFromStdString(pb.comment());
   d->compilation_ = pb.compilation();
   d->playcount_ = pb.playcount();
@@ -420,7 +421,7 @@ void Song::InitFromProtobuf(const pb::tagreader::SongMetadata& pb) {
   d->etag_ = QStringFromStdString(pb.etag());
 
   if (pb.has_art_automatic()) {
-    d->art_automatic_ = QStringFromStdString(pb.art_automatic());
+    d->art_automatic_ = AtomTable::Intern(QStringFromStdString(pb.art_automatic()));
   }
 
   if (pb.has_rating()) {
@@ -467,6 +468,7 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
   d->init_from_file_ = reliable_metadata;
 
   #define tostr(n)      (q.value(n).isNull() ? QString::null : q.value(n).toString())
+  #define toatom(n)     (AtomTable::Intern(tostr(n)))
   #define tobytearray(n)(q.value(n).isNull() ? QByteArray()  : q.value(n).toByteArray())
   #define toint(n)      (q.value(n).isNull() ? -1 : q.value(n).toInt())
   #define tolonglong(n) (q.value(n).isNull() ? -1 : q.value(n).toLongLong())
@@ -474,15 +476,15 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
 
   d->id_ = toint(col + 0);
   d->title_ = tostr(col + 1);
-  d->album_ = tostr(col + 2);
-  d->artist_ = tostr(col + 3);
-  d->albumartist_ = tostr(col + 4);
-  d->composer_ = tostr(col + 5);
+  d->album_ = toatom(col + 2);
+  d->artist_ = toatom(col + 3);
+  d->albumartist_ = toatom(col + 4);
+  d->composer_ = toatom(col + 5);
   d->track_ = toint(col + 6);
   d->disc_ = toint(col + 7);
   d->bpm_ = tofloat(col + 8);
   d->year_ = toint(col + 9);
-  d->genre_ = tostr(col + 10);
+  d->genre_ = toatom(col + 10);
   d->comment_ = tostr(col + 11);
   d->compilation_ = q.value(col + 12).toBool();
 
@@ -498,8 +500,8 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
 
   d->sampler_ = q.value(col + 20).toBool();
 
-  d->art_automatic_ = q.value(col + 21).toString();
-  d->art_manual_ = q.value(col + 22).toString();
+  d->art_automatic_ = AtomTable::Intern(q.value(col + 21).toString());
+  d->art_manual_ = AtomTable::Intern(q.value(col + 22).toString());
 
   d->filetype_ = FileType(q.value(col + 23).toInt());
   d->playcount_ = q.value(col + 24).isNull() ? 0 : q.value(col + 24).toInt();
@@ -519,12 +521,13 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
   d->beginning_ = q.value(col + 32).isNull() ? 0 : q.value(col + 32).toLongLong();
   set_length_nanosec(tolonglong(col + 33));
 
-  d->cue_path_ = tostr(col + 34);
+  d->cue_path_ = toatom(col + 34);
   d->unavailable_ = q.value(col + 35).toBool();
 
   // effective_albumartist = 36
 
   #undef tostr
+  #undef toatom
   #undef toint
   #undef tolonglong
   #undef tofloat
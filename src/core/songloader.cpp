@@ -20,8 +20,9 @@
 #include <boost/bind.hpp>
 
 #include <QBuffer>
-#include <QDirIterator>
+#include <QDir>
 #include <QFileInfo>
+#include <QHash>
 #include <QTimer>
 #include <QUrl>
 #include <QtDebug>
@@ -51,6 +52,8 @@
 
 QSet<QString> SongLoader::sRawUriSchemes;
 const int SongLoader::kDefaultTimeout = 5000;
+const int SongLoader::kDirectoryFirstBatchSize = 50;
+const int SongLoader::kDirectoryBatchSize = 250;
 
 SongLoader::SongLoader(LibraryBackendInterface* library, QObject *parent)
   : QObject(parent),
@@ -104,21 +107,6 @@ SongLoader::Result SongLoader::Load(const QUrl& url) {
   return LoadRemote();
 }
 
-SongLoader::Result SongLoader::LoadLocalPartial(const QString& filename) {
-  qLog(Debug) << "Fast Loading local file" << filename;
-  // First check to see if it's a directory - if so we can load all the songs
-  // inside right away.
-  if (QFileInfo(filename).isDir()) {
-    LoadLocalDirectory(filename);
-    return Success;
-  }
-  Song song;
-  song.InitFromFilePartial(filename);
-  if (song.is_valid())
-    songs_ << song;
-  return Success;
-}
-
 SongLoader::Result SongLoader::LoadAudioCD() {
 #ifdef HAVE_AUDIOCD
   // Create gstreamer cdda element
@@ -343,6 +331,8 @@ void SongLoader::EffectiveSongLoad(Song* song) {
 }
 
 void SongLoader::LoadPlaylistAndEmit(ParserBase* parser, const QString& filename) {
+  connect(parser, SIGNAL(SongsLoaded(SongList)), SIGNAL(SongsLoaded(SongList)),
+          Qt::UniqueConnection);
   LoadPlaylist(parser, filename);
   emit LoadFinished(true);
 }
@@ -353,18 +343,13 @@ void SongLoader::LoadPlaylist(ParserBase* parser, const QString& filename) {
   songs_ = parser->Load(&file, filename, QFileInfo(filename).path());
 }
 
-static bool CompareSongs(const Song& left, const Song& right) {
-  // Order by artist, album, disc, track
-  if (left.artist() < right.artist()) return true;
-  if (left.artist() > right.artist()) return false;
-  if (left.album() < right.album()) return true;
-  if (left.album() > right.album()) return false;
-  if (left.disc() < right.disc()) return true;
-  if (left.disc() > right.disc()) return false;
-  if (left.track() < right.track()) return true;
-  if (left.track() > right.track()) return false;
-  return left.url() < right.url();
-}
+struct SongLoader::PendingTagRead {
+  PendingTagRead() : reply_(NULL) {}
+
+  TagReaderReply* reply_;
+  // Where the songs being read are in songs_
+  QList<int> indexes_;
+};
 
 void SongLoader::LoadLocalDirectoryAndEmit(const QString& filename) {
   LoadLocalDirectory(filename);
@@ -372,21 +357,133 @@ void SongLoader::LoadLocalDirectoryAndEmit(const QString& filename) {
 }
 
 void SongLoader::LoadLocalDirectory(const QString& filename) {
-  QDirIterator it(filename, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable,
-                  QDirIterator::Subdirectories);
+  QList<PendingTagRead> pending;
+  int batch_begin = 0;
 
-  while (it.hasNext()) {
-    LoadLocalPartial(it.next());
+  LoadDirectoryEntries(filename, &pending, &batch_begin);
+  LoadDirectoryBatch(&pending, &batch_begin);
+
+  while (!pending.isEmpty()) {
+    const SongList songs = FinishTagRead(pending.takeFirst());
+    if (!songs.isEmpty())
+      emit EffectiveSongsLoaded(songs);
   }
+}
+
+void SongLoader::LoadDirectoryEntries(const QString& path,
+                                      QList<PendingTagRead>* pending,
+                                      int* batch_begin) {
+  // Go through the directory in order so songs can be shown as soon as they're
+  // found, without having to sort them all at the end.
+  const QFileInfoList entries = QDir(path).entryInfoList(
+      QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Readable,
+      QDir::Name);
+
+  foreach (const QFileInfo& info, entries) {
+    if (info.isDir()) {
+      // Don't follow links to directories, they might make a loop
+      if (!info.isSymLink())
+        LoadDirectoryEntries(info.filePath(), pending, batch_begin);
+      continue;
+    }
 
-  qStableSort(songs_.begin(), songs_.end(), CompareSongs);
+    Song song;
+    song.InitFromFilePartial(info.filePath());
+    if (!song.is_valid())
+      continue;
+    songs_ << song;
+
+    const int batch_size = *batch_begin == 0 ? kDirectoryFirstBatchSize
+                                             : kDirectoryBatchSize;
+    if (songs_.count() - *batch_begin >= batch_size)
+      LoadDirectoryBatch(pending, batch_begin);
+  }
+}
+
+void SongLoader::LoadDirectoryBatch(QList<PendingTagRead>* pending,
+                                    int* batch_begin) {
+  const int begin = *batch_begin;
+  const int end = songs_.count();
+  if (begin == end)
+    return;
+  *batch_begin = end;
+
+  // Use the songs that are in the library already
+  QList<QUrl> urls;
+  for (int i=begin ; i<end ; ++i) {
+    urls << songs_[i].url();
+  }
+
+  QHash<QByteArray, Song> library_songs;
+  foreach (const Song& song, library_->GetSongsByUrls(urls)) {
+    if (song.beginning_nanosec() == 0)
+      library_songs[song.url().toEncoded()] = song;
+  }
+
+  PendingTagRead read;
+  QStringList filenames;
+  for (int i=begin ; i<end ; ++i) {
+    const QByteArray key = songs_[i].url().toEncoded();
+    if (library_songs.contains(key)) {
+      songs_[i] = library_songs[key];
+    } else {
+      read.indexes_ << i;
+      filenames << songs_[i].url().toLocalFile();
+    }
+  }
+
+  if (!filenames.isEmpty())
+    read.reply_ = TagReaderClient::Instance()->ReadFiles(filenames);
+
+  if (begin == 0) {
+    // The first batch is at the top of the playlist and might start playing
+    // straight away, so wait for its tags before showing it.  The user can
+    // then enjoy the first song being played (seek it, have moodbar, etc.)
+    if (read.reply_)
+      FinishTagRead(read);
+    emit SongsLoaded(songs_.mid(begin, end - begin));
+    return;
+  }
+
+  emit SongsLoaded(songs_.mid(begin, end - begin));
+  if (!read.reply_)
+    return;
+
+  // Carry on looking for more songs while this batch is read, but don't give
+  // the tagreader more batches than it has workers to read them.
+  pending->append(read);
+  while (pending->count() > qMax(1, TagReaderClient::Instance()->worker_count())) {
+    const SongList songs = FinishTagRead(pending->takeFirst());
+    if (!songs.isEmpty())
+      emit EffectiveSongsLoaded(songs);
+  }
+}
+
+SongList SongLoader::FinishTagRead(const PendingTagRead& read) {
+  SongList ret;
+
+  int read_count = 0;
+  if (read.reply_->WaitForFinished()) {
+    const pb::tagreader::ReadFilesResponse& response =
+        read.reply_->message().read_files_response();
+    for ( ; read_count<response.metadata_size() &&
+            read_count<read.indexes_.count() ; ++read_count) {
+      Song* song = &songs_[read.indexes_[read_count]];
+      song->InitFromProtobuf(response.metadata(read_count));
+      ret << *song;
+    }
+  }
+  read.reply_->deleteLater();
+
+  // If the tagreader failed then read the rest of the songs one at a time, so
+  // they're never left half loaded.
+  for (int i=read_count ; i<read.indexes_.count() ; ++i) {
+    Song* song = &songs_[read.indexes_[i]];
+    EffectiveSongLoad(song);
+    ret << *song;
+  }
 
-  // Load the first song: all songs will be loaded async, but we want the first
-  // one in our list to be fully loaded, so if the user has the "Start playing
-  // when adding to playlist" preference behaviour set, it can enjoy the first
-  // song being played (seek it, have moodbar, etc.)
-  if (!songs_.isEmpty())
-    EffectiveSongLoad(&(*songs_.begin()));
+  return ret;
 }
 
 void SongLoader::AddAsRawStream() {
@@ -49,6 +49,14 @@ public:
 
   static const int kDefaultTimeout;
 
+  // Songs in a directory are loaded in batches of this size, apart from the
+  // first batch which is smaller so it can be shown sooner.  The loader
+  // doesn't know which rows the playlist view is showing, so it assumes
+  // they're the ones at the top of the directory, where the songs are
+  // inserted, and reads the batches in order from there.
+  static const int kDirectoryFirstBatchSize;
+  static const int kDirectoryBatchSize;
+
   const QUrl& url() const { return url_; }
   const SongList& songs() const { return songs_; }
 
@@ -57,19 +65,29 @@ public:
 
   Result Load(const QUrl& url);
   // To effectively load the songs:
-  // when we call Load() on a directory, it will return WillLoadAsync, load the
-  // files with only filenames and emit LoadFinished(). When LoadFinished() is
-  // received by songloaderinserter, it will insert songs (incompletely loaded)
-  // in playlist, and call EffectiveSongsLoad() in a background thread to
-  // perform the real load of the songs. Next, UpdateItems() will be called on
-  // playlist and replace the partially-loaded items by the new ones, fully
-  // loaded.
+  // when we call Load() on a directory, it will return WillLoadAsync and walk
+  // the directory in a background thread.  Songs are emitted in batches with
+  // SongsLoaded() as they are found, with only their filenames, and
+  // songloaderinserter inserts them in the playlist as soon as the urls before
+  // this one have been inserted, the same as it does for playlist chunks.
+  // Meanwhile their tags are read by the tagreader workers, and each batch is
+  // emitted again with EffectiveSongsLoaded() when it's done, so UpdateItems()
+  // can be called on the playlist to replace the partially-loaded items once
+  // they've been inserted.
+  // EffectiveSongsLoad() loads anything that's still incomplete after that.
   void EffectiveSongsLoad();
   void EffectiveSongLoad(Song* song);
   Result LoadAudioCD();
 
 signals:
   void LoadFinished(bool success);
+  // Emitted during an async playlist or directory load with each chunk of
+  // songs as they are loaded, before LoadFinished.  songs() still returns all
+  // of them afterwards.
+  void SongsLoaded(const SongList& songs);
+  // Emitted during an async directory load with songs from an earlier
+  // SongsLoaded once their tags have been read.
+  void EffectiveSongsLoaded(const SongList& songs);
 
 private slots:
   void Timeout();
@@ -86,8 +104,12 @@ private:
   };
 
   Result LoadLocal(const QString& filename, bool block = false, bool ignore_playlists = false);
-  Result LoadLocalPartial(const QString& filename);
   void LoadLocalDirectory(const QString& filename);
+  struct PendingTagRead;
+  void LoadDirectoryEntries(const QString& path,
+                            QList<PendingTagRead>* pending, int* batch_begin);
+  void LoadDirectoryBatch(QList<PendingTagRead>* pending, int* batch_begin);
+  SongList FinishTagRead(const PendingTagRead& read);
   void LoadPlaylist(ParserBase* parser, const QString& filename);
   void LoadLocalDirectoryAndEmit(const QString& filename);
   void LoadPlaylistAndEmit(ParserBase* parser, const QString& filename);
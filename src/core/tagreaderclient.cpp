@@ -16,16 +16,20 @@
 */
 
 #include "tagreaderclient.h"
+#include "core/logging.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QFile>
 #include <QProcess>
+#include <QSharedMemory>
 #include <QTcpServer>
 #include <QThread>
 #include <QUrl>
 
 
 const char* TagReaderClient::kWorkerExecutableName = "clementine-tagreader";
+const int TagReaderClient::kSharedMemoryKeyLifetimeMsec = 30000;
 TagReaderClient* TagReaderClient::sInstance = NULL;
 
 TagReaderClient::TagReaderClient(QObject* parent)
@@ -37,6 +41,7 @@ TagReaderClient::TagReaderClient(QObject* parent)
   worker_pool_->SetExecutableName(kWorkerExecutableName);
   worker_pool_->SetWorkerCount(QThread::idealThreadCount());
   connect(worker_pool_, SIGNAL(WorkerFailedToStart()), SLOT(WorkerFailedToStart()));
+  connect(worker_pool_, SIGNAL(WorkerRestarted()), SLOT(WorkerRestarted()));
 }
 
 void TagReaderClient::Start() {
@@ -58,6 +63,18 @@ TagReaderReply* TagReaderClient::ReadFile(const QString& filename) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
+TagReaderReply* TagReaderClient::ReadFiles(const QStringList& filenames) {
+  pb::tagreader::Message message;
+  pb::tagreader::ReadFilesRequest* req = message.mutable_read_files_request();
+
+  foreach (const QString& filename, filenames) {
+    const QByteArray filename_utf8 = filename.toUtf8();
+    req->add_filenames(filename_utf8.constData(), filename_utf8.length());
+  }
+
+  return worker_pool_->SendMessageWithReply(&message);
+}
+
 TagReaderReply* TagReaderClient::SaveFile(const QString& filename, const Song& metadata) {
   pb::tagreader::Message message;
   pb::tagreader::SaveFileRequest* req = message.mutable_save_file_request();
@@ -77,11 +94,13 @@ TagReaderReply* TagReaderClient::IsMediaFile(const QString& filename) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
-TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename) {
+TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename,
+                                                 bool allow_shared_memory) {
   pb::tagreader::Message message;
   pb::tagreader::LoadEmbeddedArtRequest* req = message.mutable_load_embedded_art_request();
 
   req->set_filename(DataCommaSizeFromQString(filename));
+  req->set_allow_shared_memory(allow_shared_memory);
 
   return worker_pool_->SendMessageWithReply(&message);
 }
@@ -115,6 +134,26 @@ void TagReaderClient::ReadFileBlocking(const QString& filename, Song* song) {
   reply->deleteLater();
 }
 
+SongList TagReaderClient::ReadFilesBlocking(const QStringList& filenames) {
+  Q_ASSERT(QThread::currentThread() != thread());
+
+  SongList ret;
+
+  TagReaderReply* reply = ReadFiles(filenames);
+  if (reply->WaitForFinished()) {
+    const pb::tagreader::ReadFilesResponse& response =
+        reply->message().read_files_response();
+    for (int i=0 ; i<response.metadata_size() ; ++i) {
+      Song song;
+      song.InitFromProtobuf(response.metadata(i));
+      ret << song;
+    }
+  }
+  reply->deleteLater();
+
+  return ret;
+}
+
 bool TagReaderClient::SaveFileBlocking(const QString& filename, const Song& metadata) {
   Q_ASSERT(QThread::currentThread() != thread());
 
@@ -149,12 +188,73 @@ QImage TagReaderClient::LoadEmbeddedArtBlocking(const QString& filename) {
   QImage ret;
 
   TagReaderReply* reply = LoadEmbeddedArt(filename);
-  if (reply->WaitForFinished()) {
-    const std::string& data_str =
-        reply->message().load_embedded_art_response().data();
-    ret.loadFromData(QByteArray(data_str.data(), data_str.size()));
+  if (reply->WaitForFinished() &&
+      !ImageFromResponse(reply->message().load_embedded_art_response(), &ret)) {
+    // The shared memory segment was gone already - ask for it again, inline
+    // this time.
+    reply->deleteLater();
+    reply = LoadEmbeddedArt(filename, false);
+    if (reply->WaitForFinished()) {
+      ImageFromResponse(reply->message().load_embedded_art_response(), &ret);
+    }
   }
   reply->deleteLater();
 
   return ret;
 }
+
+bool TagReaderClient::ImageFromResponse(
+    const pb::tagreader::LoadEmbeddedArtResponse& response, QImage* image) {
+  if (!response.has_shared_memory_key()) {
+    const std::string& data_str = response.data();
+    image->loadFromData(reinterpret_cast<const uchar*>(data_str.data()),
+                        data_str.size());
+    return true;
+  }
+
+  const QString key = QStringFromStdString(response.shared_memory_key());
+  RememberSharedMemoryKey(key);
+
+  // Decode straight out of the worker's segment.  Detaching the last
+  // reference frees it, so the worker doesn't need to be told we're done.
+  QSharedMemory memory(key);
+  if (!memory.attach(QSharedMemory::ReadOnly)) {
+    qLog(Warning) << "Couldn't attach to embedded art shared memory:"
+                  << memory.errorString();
+    return false;
+  }
+
+  const int size = qMin(response.shared_memory_size(), memory.size());
+  memory.lock();
+  image->loadFromData(static_cast<const uchar*>(memory.constData()), size);
+  memory.unlock();
+  memory.detach();
+
+  return true;
+}
+
+void TagReaderClient::RememberSharedMemoryKey(const QString& key) {
+  QMutexLocker l(&shared_memory_mutex_);
+
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  while (!shared_memory_keys_.isEmpty() &&
+         shared_memory_keys_.head().first + kSharedMemoryKeyLifetimeMsec < now) {
+    shared_memory_keys_.dequeue();
+  }
+
+  shared_memory_keys_.enqueue(qMakePair(now, key));
+}
+
+void TagReaderClient::WorkerRestarted() {
+  // The worker that crashed can't detach from the segments it was keeping
+  // alive for us, and on unix they'd stay around until reboot.  Attaching and
+  // detaching again removes the ones nobody else is using any more.
+  QMutexLocker l(&shared_memory_mutex_);
+
+  while (!shared_memory_keys_.isEmpty()) {
+    QSharedMemory memory(shared_memory_keys_.dequeue().second);
+    if (memory.attach(QSharedMemory::ReadOnly)) {
+      memory.detach();
+    }
+  }
+}
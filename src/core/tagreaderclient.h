@@ -23,6 +23,9 @@
 #include "core/messagehandler.h"
 #include "core/workerpool.h"
 
+#include <QMutex>
+#include <QPair>
+#include <QQueue>
 #include <QStringList>
 
 class QLocalServer;
@@ -41,10 +44,17 @@ public:
 
   void Start();
 
+  // The number of requests that can be processed at the same time.
+  int worker_count() const { return worker_pool_->worker_count(); }
+
   ReplyType* ReadFile(const QString& filename);
+  // Reads the tags of several files with a single request.  The reply
+  // contains one SongMetadata for each filename, in the same order.
+  ReplyType* ReadFiles(const QStringList& filenames);
   ReplyType* SaveFile(const QString& filename, const Song& metadata);
   ReplyType* IsMediaFile(const QString& filename);
-  ReplyType* LoadEmbeddedArt(const QString& filename);
+  ReplyType* LoadEmbeddedArt(const QString& filename,
+                             bool allow_shared_memory = true);
   ReplyType* ReadCloudFile(const QUrl& download_url,
                            const QString& title,
                            int size,
@@ -55,6 +65,7 @@ public:
   // response.  These block the calling thread with a semaphore, and must NOT
   // be called from the TagReaderClient's thread.
   void ReadFileBlocking(const QString& filename, Song* song);
+  SongList ReadFilesBlocking(const QStringList& filenames);
   bool SaveFileBlocking(const QString& filename, const Song& metadata);
   bool IsMediaFileBlocking(const QString& filename);
   QImage LoadEmbeddedArtBlocking(const QString& filename);
@@ -64,12 +75,27 @@ public:
 
 private slots:
   void WorkerFailedToStart();
+  void WorkerRestarted();
 
 private:
+  // How long to remember the shared memory segments we've been given, so they
+  // can be cleaned up if the worker holding them crashes.  Comfortably longer
+  // than the worker keeps them itself.
+  static const int kSharedMemoryKeyLifetimeMsec;
+
+  // Decodes the picture in a LoadEmbeddedArt reply, wherever the worker put
+  // it.  Returns false if the shared memory segment couldn't be read.
+  bool ImageFromResponse(const pb::tagreader::LoadEmbeddedArtResponse& response,
+                         QImage* image);
+  void RememberSharedMemoryKey(const QString& key);
+
   static TagReaderClient* sInstance;
 
   WorkerPool<HandlerType>* worker_pool_;
   QList<pb::tagreader::Message> message_queue_;
+
+  QMutex shared_memory_mutex_;
+  QQueue<QPair<qint64, QString> > shared_memory_keys_;
 };
 
 typedef TagReaderClient::ReplyType TagReaderReply;
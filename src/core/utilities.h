@@ -113,6 +113,7 @@ namespace Utilities {
     Path_LocalSpotifyBlob,
     Path_MoodbarCache,
     Path_CacheRoot,
+    Path_AlbumCoverThumbnails,
   };
   QString GetConfigPath(ConfigPath config);
 
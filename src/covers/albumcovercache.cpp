@@ -0,0 +1,116 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "albumcovercache.h"
+#include "core/song.h"
+
+#include <QMutexLocker>
+
+const int AlbumCoverCache::kDefaultMaxSizeKb = 64 * 1024;
+
+AlbumCoverCache::AlbumCoverCache(int max_size_kb)
+  : cache_(max_size_kb)
+{
+}
+
+bool AlbumCoverCache::Key::operator ==(const Key& other) const {
+  return desired_height_ == other.desired_height_ &&
+         scale_ == other.scale_ &&
+         pad_ == other.pad_ &&
+         art_automatic_ == other.art_automatic_ &&
+         art_manual_ == other.art_manual_ &&
+         song_filename_ == other.song_filename_;
+}
+
+uint qHash(const AlbumCoverCache::Key& key) {
+  return qHash(key.art_automatic_) ^
+         (qHash(key.art_manual_) * 31) ^
+         (qHash(key.song_filename_) * 17) ^
+         uint(key.desired_height_ << 2) ^
+         uint(key.scale_) ^
+         (uint(key.pad_) << 1);
+}
+
+AlbumCoverCache::Key AlbumCoverCache::MakeKey(
+    const AlbumCoverLoaderOptions& options, const QString& art_automatic,
+    const QString& art_manual, const QString& song_filename) {
+  Key key;
+  key.art_automatic_ = art_automatic;
+  key.art_manual_ = art_manual;
+  key.scale_ = options.scale_output_image_;
+  key.pad_ = options.pad_output_image_;
+
+  // The height only matters if the image is going to be changed to fit it.
+  if (key.scale_ || key.pad_)
+    key.desired_height_ = options.desired_height_;
+
+  // The song's filename is only used to find embedded art.
+  if (art_automatic == Song::kEmbeddedCover ||
+      art_manual == Song::kEmbeddedCover)
+    key.song_filename_ = song_filename;
+
+  return key;
+}
+
+bool AlbumCoverCache::Find(const Key& key, QImage* image) {
+  QMutexLocker l(&mutex_);
+  QImage* cached = cache_.object(key);
+  if (!cached)
+    return false;
+
+  *image = *cached;
+  return true;
+}
+
+void AlbumCoverCache::Insert(const Key& key, const QImage& image) {
+  if (image.isNull())
+    return;
+
+  const int cost = image.byteCount() / 1024 + 1;
+
+  QMutexLocker l(&mutex_);
+  cache_.insert(key, new QImage(image), cost);
+}
+
+void AlbumCoverCache::Remove(const QString& filename) {
+  if (filename.isEmpty())
+    return;
+
+  QMutexLocker l(&mutex_);
+  foreach (const Key& key, cache_.keys()) {
+    if (key.art_automatic_ == filename ||
+        key.art_manual_ == filename ||
+        key.song_filename_ == filename) {
+      cache_.remove(key);
+    }
+  }
+}
+
+void AlbumCoverCache::Clear() {
+  QMutexLocker l(&mutex_);
+  cache_.clear();
+}
+
+int AlbumCoverCache::size_kb() {
+  QMutexLocker l(&mutex_);
+  return cache_.totalCost();
+}
+
+int AlbumCoverCache::count() {
+  QMutexLocker l(&mutex_);
+  return cache_.count();
+}
@@ -0,0 +1,73 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ALBUMCOVERCACHE_H
+#define ALBUMCOVERCACHE_H
+
+#include "albumcoverloaderoptions.h"
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+// A size-bounded LRU of decoded and scaled covers, keyed by where the art came
+// from and the size it was scaled to.  It's safe to use from any thread, so
+// the AlbumCoverLoader's workers can share one instance.
+class AlbumCoverCache {
+ public:
+  AlbumCoverCache(int max_size_kb = kDefaultMaxSizeKb);
+
+  static const int kDefaultMaxSizeKb;
+
+  struct Key {
+    Key() : desired_height_(0), scale_(false), pad_(false) {}
+
+    bool operator ==(const Key& other) const;
+
+    QString art_automatic_;
+    QString art_manual_;
+    QString song_filename_;
+    int desired_height_;
+    bool scale_;
+    bool pad_;
+  };
+
+  static Key MakeKey(const AlbumCoverLoaderOptions& options,
+                     const QString& art_automatic,
+                     const QString& art_manual,
+                     const QString& song_filename);
+
+  bool Find(const Key& key, QImage* image);
+  void Insert(const Key& key, const QImage& image);
+
+  // Forgets every entry that was loaded from this file, for when a cover is
+  // overwritten in place.
+  void Remove(const QString& filename);
+  void Clear();
+
+  int size_kb();
+  int count();
+
+ private:
+  QMutex mutex_;
+  QCache<Key, QImage> cache_;
+};
+
+uint qHash(const AlbumCoverCache::Key& key);
+
+#endif // ALBUMCOVERCACHE_H
@@ -17,6 +17,8 @@
 
 #include "albumcoverloader.h"
 
+#include <boost/bind.hpp>
+
 #include <QPainter>
 #include <QDir>
 #include <QCoreApplication>
@@ -25,6 +27,7 @@
 
 #include "config.h"
 #include "core/closure.h"
+#include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/network.h"
 #include "core/tagreaderclient.h"
@@ -39,12 +42,18 @@
 AlbumCoverLoader::AlbumCoverLoader(QObject* parent)
   : QObject(parent),
     stop_requested_(false),
+    running_workers_(0),
     next_id_(1),
     network_(new NetworkAccessManager(this)),
     connected_spotify_(false)
 {
 }
 
+AlbumCoverLoader::~AlbumCoverLoader() {
+  stop_requested_ = true;
+  thread_pool_.waitForDone();
+}
+
 QString AlbumCoverLoader::ImageCacheDir() {
   return Utilities::GetConfigPath(Utilities::Path_AlbumCovers);
 }
@@ -89,22 +98,56 @@ quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions& options,
     tasks_.enqueue(task);
   }
 
-  metaObject()->invokeMethod(this, "ProcessTasks", Qt::QueuedConnection);
+  ProcessTasks();
 
   return task.id;
 }
 
 void AlbumCoverLoader::ProcessTasks() {
-  while (!stop_requested_) {
+  // Start enough workers to get through the queue, up to one per core.  Each
+  // worker keeps taking tasks until the queue is empty, so tasks can still be
+  // cancelled up until the moment they're picked up.
+  QMutexLocker l(&mutex_);
+  while (!stop_requested_ &&
+         running_workers_ < tasks_.count() &&
+         running_workers_ < thread_pool_.maxThreadCount()) {
+    running_workers_ ++;
+    ConcurrentRun::Run<void>(&thread_pool_,
+                             boost::bind(&AlbumCoverLoader::RunWorker, this));
+  }
+}
+
+void AlbumCoverLoader::RunWorker() {
+  forever {
     // Get the next task
     Task task;
     {
       QMutexLocker l(&mutex_);
-      if (tasks_.isEmpty())
+      if (stop_requested_ || tasks_.isEmpty()) {
+        running_workers_ --;
         return;
+      }
       task = tasks_.dequeue();
     }
 
+    if (IsCacheable(task) &&
+        (!task.options.need_original_image_ ||
+         (!task.options.scale_output_image_ && !task.options.pad_output_image_))) {
+      const AlbumCoverCache::Key key = CacheKey(task);
+      QImage cached;
+      bool found = cache_.Find(key, &cached);
+      if (!found && thumbnails_.Load(key, &cached)) {
+        cache_.Insert(key, cached);
+        found = true;
+      }
+
+      if (found) {
+        emit ImageLoaded(task.id, cached);
+        emit ImageLoaded(task.id, cached, cached);
+        continue;
+      }
+    }
+
     ProcessTask(&task);
   }
 }
@@ -118,9 +161,7 @@ void AlbumCoverLoader::ProcessTask(Task *task) {
   }
 
   if (result.loaded_success) {
-    QImage scaled = ScaleAndPad(task->options, result.image);
-    emit ImageLoaded(task->id, scaled);
-    emit ImageLoaded(task->id, scaled, result.image);
+    FinishTask(*task, result.image);
     return;
   }
 
@@ -140,17 +181,46 @@ void AlbumCoverLoader::NextState(Task* task) {
   }
 }
 
+void AlbumCoverLoader::FinishTask(const Task& task, const QImage& image) {
+  QImage scaled = ScaleAndPad(task.options, image);
+  if (IsCacheable(task)) {
+    const AlbumCoverCache::Key key = CacheKey(task);
+    cache_.Insert(key, scaled);
+    thumbnails_.Save(key, scaled);
+  }
+
+  emit ImageLoaded(task.id, scaled);
+  emit ImageLoaded(task.id, scaled, image);
+}
+
+QString AlbumCoverLoader::TaskFilename(const Task& task) {
+  switch (task.state) {
+    case State_TryingAuto:   return task.art_automatic;
+    case State_TryingManual: return task.art_manual;
+  }
+  return QString();
+}
+
+bool AlbumCoverLoader::IsCacheable(const Task& task) {
+  // Images passed in by the caller don't have a source we can key on, and an
+  // unset cover resolves to the caller's own default image.
+  return task.embedded_image.isNull() &&
+         task.art_manual != Song::kManuallyUnsetCover &&
+         !(task.art_automatic.isEmpty() && task.art_manual.isEmpty());
+}
+
+AlbumCoverCache::Key AlbumCoverLoader::CacheKey(const Task& task) {
+  return AlbumCoverCache::MakeKey(task.options, task.art_automatic,
+                                  task.art_manual, task.song_filename);
+}
+
 AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
     const Task& task) {
   // An image embedded in the song itself takes priority
   if (!task.embedded_image.isNull())
     return TryLoadResult(false, true, ScaleAndPad(task.options, task.embedded_image));
 
-  QString filename;
-  switch (task.state) {
-    case State_TryingAuto:   filename = task.art_automatic; break;
-    case State_TryingManual: filename = task.art_manual;    break;
-  }
+  const QString filename = TaskFilename(task);
 
   if (filename == Song::kManuallyUnsetCover)
     return TryLoadResult(false, true, task.options.default_output_image_);
@@ -163,6 +233,40 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
       return TryLoadResult(false, true, ScaleAndPad(task.options, taglib_image));
   }
 
+  if (filename.toLower().startsWith("http://") ||
+      filename.toLower().startsWith("spotify://image/")) {
+    // Network requests have to be started from the loader's own thread, which
+    // is where the NetworkAccessManager lives.
+    {
+      QMutexLocker l(&mutex_);
+      queued_remote_tasks_.enqueue(task);
+    }
+    metaObject()->invokeMethod(this, "StartRemoteTasks", Qt::QueuedConnection);
+    return TryLoadResult(true, false, QImage());
+  }
+
+  QImage image(filename);
+  return TryLoadResult(false, !image.isNull(),
+                       image.isNull() ? task.options.default_output_image_: image);
+}
+
+void AlbumCoverLoader::StartRemoteTasks() {
+  forever {
+    Task task;
+    {
+      QMutexLocker l(&mutex_);
+      if (queued_remote_tasks_.isEmpty())
+        return;
+      task = queued_remote_tasks_.dequeue();
+    }
+
+    StartRemoteTask(task);
+  }
+}
+
+void AlbumCoverLoader::StartRemoteTask(const Task& task) {
+  const QString filename = TaskFilename(task);
+
   if (filename.toLower().startsWith("http://")) {
     QUrl url(filename);
     QNetworkReply* reply = network_->get(QNetworkRequest(url));
@@ -170,7 +274,6 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
                SLOT(RemoteFetchFinished(QNetworkReply*)), reply);
 
     remote_tasks_.insert(reply, task);
-    return TryLoadResult(true, false, QImage());
   } else if (filename.toLower().startsWith("spotify://image/")) {
     // HACK: we should add generic image URL handlers
     #ifdef HAVE_SPOTIFY
@@ -191,15 +294,11 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
       // Need to schedule this in the spotify service's thread
       QMetaObject::invokeMethod(spotify, "LoadImage", Qt::QueuedConnection,
                                 Q_ARG(QString, id));
-      return TryLoadResult(true, false, QImage());
     #else
-      return TryLoadResult(false, false, QImage());
+      Task next_task(task);
+      NextState(&next_task);
     #endif
   }
-
-  QImage image(filename);
-  return TryLoadResult(false, !image.isNull(),
-                       image.isNull() ? task.options.default_output_image_: image);
 }
 
 void AlbumCoverLoader::SpotifyImageLoaded(const QString& id, const QImage& image) {
@@ -207,9 +306,7 @@ void AlbumCoverLoader::SpotifyImageLoaded(const QString& id, const QImage& image
     return;
 
   Task task = remote_spotify_tasks_.take(id);
-  QImage scaled = ScaleAndPad(task.options, image);
-  emit ImageLoaded(task.id, scaled);
-  emit ImageLoaded(task.id, scaled, image);
+  FinishTask(task, image);
 }
 
 void AlbumCoverLoader::RemoteFetchFinished(QNetworkReply* reply) {
@@ -237,9 +334,7 @@ void AlbumCoverLoader::RemoteFetchFinished(QNetworkReply* reply) {
     // Try to load the image
     QImage image;
     if (image.load(reply, 0)) {
-      QImage scaled = ScaleAndPad(task.options, image);
-      emit ImageLoaded(task.id, scaled);
-      emit ImageLoaded(task.id, scaled, image);
+      FinishTask(task, image);
       return;
     }
   }
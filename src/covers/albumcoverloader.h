@@ -18,13 +18,16 @@
 #ifndef ALBUMCOVERLOADER_H
 #define ALBUMCOVERLOADER_H
 
+#include "albumcovercache.h"
 #include "albumcoverloaderoptions.h"
+#include "albumcoverthumbnailcache.h"
 #include "core/song.h"
 
 #include <QImage>
 #include <QMutex>
 #include <QObject>
 #include <QQueue>
+#include <QThreadPool>
 #include <QUrl>
 
 class NetworkAccessManager;
@@ -35,9 +38,17 @@ class AlbumCoverLoader : public QObject {
 
  public:
   AlbumCoverLoader(QObject* parent = 0);
+  ~AlbumCoverLoader();
 
   void Stop() { stop_requested_ = true; }
 
+  // Decoded covers shared by everything that loads art through this loader.
+  AlbumCoverCache* cache() { return &cache_; }
+
+  // Call this after writing a new image over an existing file.  Thumbnails on
+  // disk notice the new modification time by themselves.
+  void InvalidateCover(const QString& filename) { cache_.Remove(filename); }
+
   static QString ImageCacheDir();
 
   quint64 LoadImageAsync(const AlbumCoverLoaderOptions& options, const Song& song);
@@ -61,6 +72,7 @@ class AlbumCoverLoader : public QObject {
 
  protected slots:
   void ProcessTasks();
+  void StartRemoteTasks();
   void RemoteFetchFinished(QNetworkReply* reply);
   void SpotifyImageLoaded(const QString& url, const QImage& image);
 
@@ -93,14 +105,23 @@ class AlbumCoverLoader : public QObject {
     QImage image;
   };
 
+  void RunWorker();
   void ProcessTask(Task* task);
   void NextState(Task* task);
   TryLoadResult TryLoadImage(const Task& task);
+  void StartRemoteTask(const Task& task);
+  void FinishTask(const Task& task, const QImage& image);
+
+  static QString TaskFilename(const Task& task);
+  static bool IsCacheable(const Task& task);
+  static AlbumCoverCache::Key CacheKey(const Task& task);
 
   bool stop_requested_;
 
   QMutex mutex_;
   QQueue<Task> tasks_;
+  QQueue<Task> queued_remote_tasks_;
+  int running_workers_;
   QMap<QNetworkReply*, Task> remote_tasks_;
   QMap<QString, Task> remote_spotify_tasks_;
   quint64 next_id_;
@@ -109,6 +130,10 @@ class AlbumCoverLoader : public QObject {
 
   bool connected_spotify_;
 
+  AlbumCoverCache cache_;
+  AlbumCoverThumbnailCache thumbnails_;
+  QThreadPool thread_pool_;
+
   static const int kMaxRedirects = 3;
 };
 
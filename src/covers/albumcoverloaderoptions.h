@@ -24,12 +24,17 @@ struct AlbumCoverLoaderOptions {
   AlbumCoverLoaderOptions()
     : desired_height_(120),
       scale_output_image_(true),
-      pad_output_image_(true)
+      pad_output_image_(true),
+      need_original_image_(false)
   {}
 
   int desired_height_;
   bool scale_output_image_;
   bool pad_output_image_;
+
+  // The loader's cache only keeps the scaled image, so set this if you need
+  // the real original in ImageLoaded(quint64,QImage,QImage).
+  bool need_original_image_;
   QImage default_output_image_;
 };
 
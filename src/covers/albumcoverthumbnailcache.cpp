@@ -0,0 +1,132 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "albumcoverthumbnailcache.h"
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/utilities.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QStringList>
+#include <QTemporaryFile>
+
+const int AlbumCoverThumbnailCache::kMaxHeight = 256;
+
+AlbumCoverThumbnailCache::AlbumCoverThumbnailCache(const QString& directory)
+  : directory_(directory)
+{
+  if (directory_.isEmpty()) {
+    directory_ = Utilities::GetConfigPath(Utilities::Path_AlbumCoverThumbnails);
+  }
+}
+
+bool AlbumCoverThumbnailCache::IsSupported(const AlbumCoverCache::Key& key) {
+  return key.scale_ &&
+         key.desired_height_ > 0 &&
+         key.desired_height_ <= kMaxHeight;
+}
+
+QString AlbumCoverThumbnailCache::SourceDescription(
+    const AlbumCoverCache::Key& key) {
+  return (QStringList() << key.art_manual_ << key.art_automatic_
+                        << key.song_filename_).join("\n");
+}
+
+QString AlbumCoverThumbnailCache::ThumbnailPath(
+    const AlbumCoverCache::Key& key) const {
+  const QByteArray hash = QCryptographicHash::hash(
+      SourceDescription(key).toUtf8(), QCryptographicHash::Md5).toHex();
+
+  return QString("%1/%2%3/%4.png").arg(
+        directory_, QString::number(key.desired_height_),
+        key.pad_ ? "-padded" : "", QString::fromAscii(hash));
+}
+
+QString AlbumCoverThumbnailCache::SourceMTime(const AlbumCoverCache::Key& key) {
+  // The loader tries the manual cover first and then the automatic one, so
+  // record both - a manual cover being deleted has to invalidate the
+  // thumbnail as well.
+  QStringList ret;
+  foreach (const QString& source,
+           QStringList() << key.art_manual_ << key.art_automatic_) {
+    QString filename;
+    if (source == Song::kEmbeddedCover) {
+      filename = key.song_filename_;
+    } else if (!source.isEmpty() && !source.contains("://") &&
+               source != Song::kManuallyUnsetCover) {
+      filename = source;
+    }
+
+    uint mtime = 0;
+    if (!filename.isEmpty()) {
+      QFileInfo info(filename);
+      if (info.exists())
+        mtime = info.lastModified().toTime_t();
+    }
+    ret << QString::number(mtime);
+  }
+
+  return ret.join(":");
+}
+
+bool AlbumCoverThumbnailCache::Load(const AlbumCoverCache::Key& key,
+                                    QImage* image) const {
+  if (!IsSupported(key))
+    return false;
+
+  // Checking the text chunk only reads the PNG header, so a stale thumbnail
+  // costs a couple of stats and a small read.
+  QImageReader reader(ThumbnailPath(key), "PNG");
+  if (reader.text("Thumb::MTime") != SourceMTime(key))
+    return false;
+
+  return reader.read(image);
+}
+
+void AlbumCoverThumbnailCache::Save(const AlbumCoverCache::Key& key,
+                                    const QImage& image) const {
+  if (image.isNull() || !IsSupported(key))
+    return;
+
+  const QString path = ThumbnailPath(key);
+  if (!QDir().mkpath(QFileInfo(path).path()))
+    return;
+
+  QImage thumbnail(image);
+  thumbnail.setText("Thumb::URI", SourceDescription(key));
+  thumbnail.setText("Thumb::MTime", SourceMTime(key));
+
+  // Write to a temporary file and move it into place, so a reader in another
+  // thread never sees half a PNG.
+  QTemporaryFile file(path + ".XXXXXX");
+  file.setAutoRemove(false);
+  if (!file.open())
+    return;
+
+  const bool saved = thumbnail.save(&file, "PNG");
+  file.close();
+
+  QFile::remove(path);
+  if (!saved || !QFile::rename(file.fileName(), path)) {
+    qLog(Warning) << "Couldn't save album cover thumbnail" << path;
+    QFile::remove(file.fileName());
+  }
+}
@@ -0,0 +1,56 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ALBUMCOVERTHUMBNAILCACHE_H
+#define ALBUMCOVERTHUMBNAILCACHE_H
+
+#include "albumcovercache.h"
+
+#include <QImage>
+#include <QString>
+
+// Keeps scaled covers on disk so they don't have to be decoded from the
+// full-size image every time Clementine starts.  Thumbnails are PNGs named
+// after an MD5 of the art source, in one directory per size, and record the
+// source file's modification time in a "Thumb::MTime" text chunk like the
+// freedesktop.org thumbnail spec.  A thumbnail whose source has changed since
+// is ignored and overwritten by the next load.
+//
+// There's no state other than the directory, so one instance can be used from
+// several threads at once.
+class AlbumCoverThumbnailCache {
+ public:
+  AlbumCoverThumbnailCache(const QString& directory = QString());
+
+  // Bigger images aren't worth keeping a second copy of.
+  static const int kMaxHeight;
+
+  static bool IsSupported(const AlbumCoverCache::Key& key);
+
+  bool Load(const AlbumCoverCache::Key& key, QImage* image) const;
+  void Save(const AlbumCoverCache::Key& key, const QImage& image) const;
+
+  QString ThumbnailPath(const AlbumCoverCache::Key& key) const;
+
+ private:
+  static QString SourceMTime(const AlbumCoverCache::Key& key);
+  static QString SourceDescription(const AlbumCoverCache::Key& key);
+
+  QString directory_;
+};
+
+#endif // ALBUMCOVERTHUMBNAILCACHE_H
@@ -35,7 +35,7 @@ void DeviceDatabaseBackend::Init(Database* db) {
 }
 
 DeviceDatabaseBackend::DeviceList DeviceDatabaseBackend::GetAllDevices() {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   DeviceList ret;
@@ -61,7 +61,7 @@ DeviceDatabaseBackend::DeviceList DeviceDatabaseBackend::GetAllDevices() {
 }
 
 int DeviceDatabaseBackend::AddDevice(const Device& device) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   ScopedTransaction t(&db);
@@ -97,7 +97,7 @@ int DeviceDatabaseBackend::AddDevice(const Device& device) {
 }
 
 void DeviceDatabaseBackend::RemoveDevice(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   ScopedTransaction t(&db);
@@ -120,7 +120,7 @@ void DeviceDatabaseBackend::RemoveDevice(int id) {
 void DeviceDatabaseBackend::SetDeviceOptions(int id,
     const QString &friendly_name, const QString &icon_name,
     MusicStorage::TranscodeMode mode, Song::FileType format) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("UPDATE devices"
@@ -58,6 +58,10 @@ FilesystemDevice::FilesystemDevice(
           backend_, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
   connect(watcher_, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)),
           backend_, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
+  connect(watcher_, SIGNAL(ScanJournalAdded(SubdirectoryList,bool)),
+          backend_, SLOT(AddToScanJournal(SubdirectoryList,bool)));
+  connect(watcher_, SIGNAL(ScanJournalRemoved(SubdirectoryList)),
+          backend_, SLOT(RemoveFromScanJournal(SubdirectoryList)));
   connect(watcher_, SIGNAL(CompilationsNeedUpdating()),
           backend_, SLOT(UpdateCompilations()));
   connect(watcher_, SIGNAL(ScanStarted(int)), SIGNAL(TaskStarted(int)));
@@ -32,7 +32,6 @@ Engine::Base::Base()
   : volume_(50),
     beginning_nanosec_(0),
     end_nanosec_(0),
-    scope_(kScopeSize),
     fadeout_enabled_(true),
     fadeout_duration_nanosec_(2 * kNsecPerSec), // 2s
     crossfade_enabled_(true),
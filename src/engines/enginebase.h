@@ -34,11 +34,10 @@
 #include <QUrl>
 
 #include "engine_fwd.h"
+#include "scoperingbuffer.h"
 
 namespace Engine {
 
-typedef std::vector<int16_t> Scope;
-
 class Base : public QObject, boost::noncopyable {
   Q_OBJECT
 
@@ -87,14 +86,14 @@ class Base : public QObject, boost::noncopyable {
 
   // Simple accessors
   inline uint volume() const { return volume_; }
-  virtual const Scope &scope() { return scope_; }
+  // The most recent |frames| frames of audio that reached the audio device.
+  virtual ScopeRingBuffer::View scope(int) { return ScopeRingBuffer::View(); }
   bool is_fadeout_enabled() const { return fadeout_enabled_; }
   bool is_crossfade_enabled() const { return crossfade_enabled_; }
   bool is_autocrossfade_enabled() const { return autocrossfade_enabled_; }
   bool crossfade_same_album() const { return crossfade_same_album_; }
 
   static const char* kSettingsGroup;
-  static const int kScopeSize = 1024;
 
  public slots:
   virtual void ReloadSettings();
@@ -139,7 +138,6 @@ class Base : public QObject, boost::noncopyable {
   quint64 beginning_nanosec_;
   qint64 end_nanosec_;
   QUrl url_;
-  Scope scope_;
 
   bool fadeout_enabled_;
   qint64 fadeout_duration_nanosec_;
@@ -22,6 +22,7 @@
 #include "config.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
+#include "scoperingbuffer.h"
 #include "core/logging.h"
 #include "core/taskmanager.h"
 #include "core/utilities.h"
@@ -30,10 +31,6 @@
 # include "gst/afcsrc/gstafcsrc.h"
 #endif
 
-#ifdef HAVE_MOODBAR
-# include "gst/moodbar/spectrum.h"
-#endif
-
 #include <math.h>
 #include <unistd.h>
 #include <vector>
@@ -74,8 +71,6 @@ GstEngine::GstEngine(TaskManager* task_manager)
   : Engine::Base(),
     task_manager_(task_manager),
     buffering_task_id_(-1),
-    delayq_(g_queue_new()),
-    current_sample_(0),
     equalizer_enabled_(false),
     rg_enabled_(false),
     rg_mode_(0),
@@ -99,10 +94,6 @@ GstEngine::~GstEngine() {
 
   current_pipeline_.reset();
 
-  // Destroy scope delay queue
-  ClearScopeBuffers();
-  g_queue_free(delayq_);
-
   // Save configuration
   gst_deinit();
 }
@@ -118,10 +109,6 @@ void GstEngine::InitialiseGstreamer() {
 #ifdef HAVE_IMOBILEDEVICE
   afcsrc_register_static();
 #endif
-
-#ifdef HAVE_MOODBAR
-  gstmoodbar_register_static();
-#endif
 }
 
 void GstEngine::ReloadSettings() {
@@ -176,113 +163,12 @@ Engine::State GstEngine::state() const {
   }
 }
 
-void GstEngine::ConsumeBuffer(GstBuffer* buffer, int pipeline_id) {
-  // Schedule this to run in the GUI thread.  The buffer gets added to the
-  // queue and unreffed by UpdateScope.
-  if (!QMetaObject::invokeMethod(this, "AddBufferToScope",
-                                 Q_ARG(GstBuffer*, buffer),
-                                 Q_ARG(int, pipeline_id))) {
-    qLog(Warning) << "Failed to invoke AddBufferToScope on GstEngine";
-  }
-}
-
-void GstEngine::AddBufferToScope(GstBuffer* buf, int pipeline_id) {
-  if (!current_pipeline_ || current_pipeline_->id() != pipeline_id) {
-    gst_buffer_unref(buf);
-    return;
-  }
-
-  g_queue_push_tail(delayq_, buf);
-}
-
-const Engine::Scope& GstEngine::scope() {
-  UpdateScope();
-
-  if (current_sample_ >= kScopeSize) {
-    // ok, we have a full buffer now, so give it to the scope
-    for (int i=0; i< kScopeSize; i++)
-      scope_[i] = current_scope_[i];
-    current_sample_ = 0;
-  }
-
-  return scope_;
-}
-
-void GstEngine::UpdateScope() {
-  typedef int16_t sampletype;
-
-  // prune the scope and get the current pos of the audio device
-  const quint64 pos = PruneScope();
-  const quint64 segment_start = current_pipeline_->segment_start();
-
-  // head of the delay queue is the most delayed, so we work with that one
-  GstBuffer *buf = reinterpret_cast<GstBuffer *>( g_queue_peek_head(delayq_) );
-  if (!buf)
-    return;
-
-  // start time for this buffer
-  quint64 stime = GST_BUFFER_TIMESTAMP(buf) - segment_start;
-  // duration of the buffer...
-  quint64 dur = GST_BUFFER_DURATION(buf);
-  // therefore we can calculate the end time for the buffer
-  quint64 etime = stime + dur;
-
-  // determine the number of channels
-  GstStructure* structure = gst_caps_get_structure ( GST_BUFFER_CAPS( buf ), 0);
-  int channels = 2;
-  gst_structure_get_int (structure, "channels", &channels);
-
-  // scope does not support >2 channels
-  if (channels > 2)
-    return;
-
-  // if the audio device is playing this buffer now
-  if (pos <= stime || pos >= etime)
-    return;
-
-  // calculate the number of samples in the buffer
-  int sz = GST_BUFFER_SIZE(buf) / sizeof(sampletype);
-  // number of frames is the number of samples in each channel (frames like in the alsa sense)
-  int frames = sz / channels;
-
-  // find the offset into the buffer to the sample closest to where the audio device is playing
-  // it is the (time into the buffer cooresponding to the audio device pos) / (the sample rate)
-  // sample rate = duration of the buffer / number of frames in the buffer
-  // then we multiply by the number of channels to find the offset of the left channel sample
-  // of the frame in the buffer
-  int off = channels * (pos - stime) / (dur / frames);
-
-  // note that we are assuming 32 bit samples, but this should probably be generalized...
-  sampletype* data = reinterpret_cast<sampletype *>(GST_BUFFER_DATA(buf));
-  if (off >= sz) // better be...
-    return;
-
-  int i = off; // starting at offset
+ScopeRingBuffer::View GstEngine::scope(int frames) {
+  if (!current_pipeline_)
+    return ScopeRingBuffer::View();
 
-  // loop while we fill the current buffer.  If we need another buffer and one is available,
-  // get it and keep filling.  If there are no more buffers available (not too likely)
-  // then leave everything in this state and wait until the next time the scope updates
-  while (buf && current_sample_ < kScopeSize && i < sz) {
-    for (int j = 0; j < channels && current_sample_ < kScopeSize; j++) {
-      current_scope_[current_sample_ ++] = data[i + j];
-    }
-    i+=channels; // advance to the next frame
-
-    if (i >= sz - 1) {
-      // here we are out of samples in the current buffer, so we get another one
-      buf = reinterpret_cast<GstBuffer *>( g_queue_pop_head(delayq_) );
-      gst_buffer_unref(buf);
-      buf = reinterpret_cast<GstBuffer *>( g_queue_peek_head(delayq_) );
-      if (buf) {
-        stime = GST_BUFFER_TIMESTAMP(buf);
-        dur = GST_BUFFER_DURATION(buf);
-        etime = stime + dur;
-        i = 0;
-        sz = GST_BUFFER_SIZE(buf) / sizeof(sampletype);
-        data = reinterpret_cast<sampletype *>(GST_BUFFER_DATA(buf));
-      }
-    }
-  }
+  return current_pipeline_->scope_buffer()->Read(
+        frames, current_pipeline_->position());
 }
 
 void GstEngine::StartPreloading(const QUrl& url, bool force_stop_at_end,
@@ -361,7 +247,6 @@ void GstEngine::StartFadeout() {
   fadeout_pipeline_ = current_pipeline_;
   disconnect(fadeout_pipeline_.get(), 0, 0, 0);
   fadeout_pipeline_->RemoveAllBufferConsumers();
-  ClearScopeBuffers();
 
   fadeout_pipeline_->StartFader(fadeout_duration_nanosec_, QTimeLine::Backward);
   connect(fadeout_pipeline_.get(), SIGNAL(FaderFinished()), SLOT(FadeoutFinished()));
@@ -413,8 +298,6 @@ void GstEngine::PlayDone() {
 
   StartTimers();
 
-  current_sample_ = 0;
-
   // initial offset
   if(offset_nanosec != 0 || beginning_nanosec_ != 0) {
     Seek(offset_nanosec);
@@ -489,9 +372,7 @@ void GstEngine::SeekNow() {
   if (!current_pipeline_)
     return;
 
-  if (current_pipeline_->Seek(seek_pos_))
-    ClearScopeBuffers();
-  else
+  if (!current_pipeline_->Seek(seek_pos_))
     qLog(Warning) << "Seek failed";
 }
 
@@ -533,11 +414,6 @@ void GstEngine::timerEvent(QTimerEvent* e) {
   if (e->timerId() != timer_id_)
     return;
 
-  // keep the scope from building while we are not visible
-  // this is why the timer must run as long as we are playing, and not just when
-  // we are fading
-  PruneScope();
-
   if (current_pipeline_) {
     const qint64 current_position = position_nanosec();
     const qint64 current_length = length_nanosec();
@@ -592,7 +468,6 @@ void GstEngine::EndOfStreamReached(int pipeline_id, bool has_next_track) {
     current_pipeline_.reset();
     BufferingFinished();
   }
-  ClearScopeBuffers();
   emit TrackEnded();
 }
 
@@ -661,7 +536,6 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
   ret->set_buffer_duration_nanosec(buffer_duration_nanosec_);
   ret->set_mono_playback(mono_playback_);
 
-  ret->AddBufferConsumer(this);
   foreach (BufferConsumer* consumer, buffer_consumers_) {
     ret->AddBufferConsumer(consumer);
   }
@@ -670,7 +544,6 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
   connect(ret.get(), SIGNAL(Error(int, QString,int,int)), SLOT(HandlePipelineError(int, QString,int,int)));
   connect(ret.get(), SIGNAL(MetadataFound(int, Engine::SimpleMetaBundle)),
           SLOT(NewMetaData(int, Engine::SimpleMetaBundle)));
-  connect(ret.get(), SIGNAL(destroyed()), SLOT(ClearScopeBuffers()));
   connect(ret.get(), SIGNAL(BufferingStarted()), SLOT(BufferingStarted()));
   connect(ret.get(), SIGNAL(BufferingProgress(int)), SLOT(BufferingProgress(int)));
   connect(ret.get(), SIGNAL(BufferingFinished()), SLOT(BufferingFinished()));
@@ -698,48 +571,6 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline(const QUrl& url,
   return ret;
 }
 
-qint64 GstEngine::PruneScope() {
-  if (!current_pipeline_)
-    return 0;
-
-  // get the position playing in the audio device
-  const qint64 pos = current_pipeline_->position();
-  const qint64 segment_start = current_pipeline_->segment_start();
-
-  GstBuffer *buf = 0;
-  quint64 etime = 0;
-
-  // free up the buffers that the audio device has advanced past already
-  do {
-    // most delayed buffers are at the head of the queue
-    buf = reinterpret_cast<GstBuffer *>( g_queue_peek_head(delayq_) );
-    if (buf) {
-      // the start time of the buffer
-      quint64 stime = GST_BUFFER_TIMESTAMP(buf) - segment_start;
-      // the duration of the buffer
-      quint64 dur = GST_BUFFER_DURATION(buf);
-      // therefore we can calculate the end time of the buffer
-      etime = stime + dur;
-
-      // purge this buffer if the pos is past the end time of the buffer
-      if (pos > qint64(etime)) {
-        g_queue_pop_head(delayq_);
-        gst_buffer_unref(buf);
-      }
-    }
-  } while (buf && pos > qint64(etime));
-
-  return pos;
-}
-
-void GstEngine::ClearScopeBuffers() {
-  // just free them all
-  while (g_queue_get_length(delayq_)) {
-    GstBuffer* buf = reinterpret_cast<GstBuffer *>( g_queue_pop_head(delayq_) );
-    gst_buffer_unref(buf);
-  }
-}
-
 bool GstEngine::DoesThisSinkSupportChangingTheOutputDeviceToAUserEditableString(const QString &name) {
   return (name == "alsasink" || name == "osssink" || name == "pulsesink");
 }
@@ -48,7 +48,7 @@ class TaskManager;
  * @short GStreamer engine plugin
  * @author Mark Kretschmann <markey@web.de>
  */
-class GstEngine : public Engine::Base, public BufferConsumer {
+class GstEngine : public Engine::Base {
   Q_OBJECT
 
  public:
@@ -77,16 +77,13 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   qint64 position_nanosec() const;
   qint64 length_nanosec() const;
   Engine::State state() const;
-  const Engine::Scope& scope();
+  ScopeRingBuffer::View scope(int frames);
 
   PluginDetailsList GetOutputsList() const { return GetPluginList( "Sink/Audio" ); }
   static bool DoesThisSinkSupportChangingTheOutputDeviceToAUserEditableString(const QString& name);
 
   GstElement* CreateElement(const QString& factoryName, GstElement* bin = 0);
 
-  // BufferConsumer
-  void ConsumeBuffer(GstBuffer *buffer, int pipeline_id);
-
  public slots:
   void StartPreloading(const QUrl& url, bool force_stop_at_end,
                        qint64 beginning_nanosec, qint64 end_nanosec);
@@ -118,8 +115,6 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   void EndOfStreamReached(int pipeline_id, bool has_next_track);
   void HandlePipelineError(int pipeline_id, const QString& message, int domain, int error_code);
   void NewMetaData(int pipeline_id, const Engine::SimpleMetaBundle& bundle);
-  void ClearScopeBuffers();
-  void AddBufferToScope(GstBuffer* buf, int pipeline_id);
   void FadeoutFinished();
   void SeekNow();
   void BackgroundStreamFinished();
@@ -145,9 +140,6 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   boost::shared_ptr<GstEnginePipeline> CreatePipeline();
   boost::shared_ptr<GstEnginePipeline> CreatePipeline(const QUrl& url, qint64 end_nanosec);
 
-  void UpdateScope();
-  qint64 PruneScope();
-
   int AddBackgroundStream(boost::shared_ptr<GstEnginePipeline> pipeline);
 
   static QUrl FixupUrl(const QUrl& url);
@@ -174,10 +166,6 @@ class GstEngine : public Engine::Base, public BufferConsumer {
 
   QList<BufferConsumer*> buffer_consumers_;
 
-  GQueue* delayq_;
-  float current_scope_[kScopeSize];
-  int current_sample_;
-
   bool equalizer_enabled_;
   int equalizer_preamp_;
   QList<int> equalizer_gains_;
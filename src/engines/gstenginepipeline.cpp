@@ -24,6 +24,7 @@
 #include "gstelementdeleter.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
+#include "scoperingbuffer.h"
 #include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/signalchecker.h"
@@ -52,6 +53,7 @@ GstEnginePipeline::GstEnginePipeline(GstEngine* engine)
     id_(sId++),
     valid_(false),
     sink_(GstEngine::kAutoSink),
+    scope_buffer_(new ScopeRingBuffer),
     segment_start_(0),
     segment_start_received_(false),
     emit_track_ended_on_segment_start_(false),
@@ -668,6 +670,23 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad, gpointer self)
 bool GstEnginePipeline::HandoffCallback(GstPad*, GstBuffer* buf, gpointer self) {
   GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
 
+  // Feed the scope first - it doesn't need a reference to the buffer or a trip
+  // through the event loop.
+  GstStructure* structure = gst_caps_get_structure(GST_BUFFER_CAPS(buf), 0);
+  int channels = 2;
+  int rate = 0;
+  gst_structure_get_int(structure, "channels", &channels);
+  gst_structure_get_int(structure, "rate", &rate);
+
+  if (channels > 0) {
+    const int frames = GST_BUFFER_SIZE(buf) / (sizeof(qint16) * channels);
+    const qint64 end_time = GST_BUFFER_TIMESTAMP(buf) - instance->segment_start_
+                          + GST_BUFFER_DURATION(buf);
+    instance->scope_buffer_->Write(
+          reinterpret_cast<const qint16*>(GST_BUFFER_DATA(buf)),
+          frames, channels, rate, end_time);
+  }
+
   QList<BufferConsumer*> consumers;
   {
     QMutexLocker l(&instance->buffer_consumers_mutex_);
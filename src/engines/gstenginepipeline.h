@@ -28,12 +28,14 @@
 
 #include <gst/gst.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "engine_fwd.h"
 
 class GstElementDeleter;
 class GstEngine;
 class BufferConsumer;
+class ScopeRingBuffer;
 
 struct GstQueue;
 struct GstURIDecodeBin;
@@ -63,6 +65,10 @@ class GstEnginePipeline : public QObject {
   void RemoveBufferConsumer(BufferConsumer* consumer);
   void RemoveAllBufferConsumers();
 
+  // Filled with the probe's audio straight from the streaming thread.  Safe to
+  // read from one other thread at a time.
+  boost::shared_ptr<ScopeRingBuffer> scope_buffer() const { return scope_buffer_; }
+
   // Control the music playback
   QFuture<GstStateChangeReturn> SetState(GstState state);
   Q_INVOKABLE bool Seek(qint64 nanosec);
@@ -182,6 +188,7 @@ class GstEnginePipeline : public QObject {
   // These get called when there is a new audio buffer available
   QList<BufferConsumer*> buffer_consumers_;
   QMutex buffer_consumers_mutex_;
+  boost::shared_ptr<ScopeRingBuffer> scope_buffer_;
   qint64 segment_start_;
   bool segment_start_received_;
   bool emit_track_ended_on_segment_start_;
@@ -0,0 +1,129 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "scoperingbuffer.h"
+#include "core/timeconstants.h"
+
+#include <QtAlgorithms>
+
+ScopeRingBuffer::View::View() {
+  data_[0] = data_[1] = NULL;
+  frames_[0] = frames_[1] = 0;
+}
+
+void ScopeRingBuffer::View::MixToMono(float* dest) const {
+  for (int i=0 ; i<2 ; ++i) {
+    const float* src = data_[i];
+    for (int j=0 ; j<frames_[i] ; ++j) {
+      *dest++ = (src[0] + src[1]) * 0.5f;
+      src += kChannels;
+    }
+  }
+}
+
+ScopeRingBuffer::ScopeRingBuffer(int capacity_frames)
+  : capacity_(1),
+    sequence_(0),
+    written_(0),
+    rate_(0),
+    end_nanosec_(0)
+{
+  while (capacity_ < capacity_frames)
+    capacity_ <<= 1;
+  mask_ = capacity_ - 1;
+
+  data_.reset(new float[capacity_ * kChannels]);
+  qFill(data_.get(), data_.get() + capacity_ * kChannels, 0.0f);
+}
+
+void ScopeRingBuffer::Write(const qint16* data, int frames, int channels,
+                            int rate, qint64 end_nanosec) {
+  if (frames <= 0 || channels <= 0)
+    return;
+
+  // Anything older than the capacity would be overwritten straight away.
+  if (frames > capacity_) {
+    data += (frames - capacity_) * channels;
+    frames = capacity_;
+  }
+
+  static const float kScale = 1.0f / 32768.0f;
+
+  // Only this thread ever changes written_, so there's no need to go through
+  // the sequence to read it.
+  const quint32 start = written_;
+  for (int i=0 ; i<frames ; ++i) {
+    float* out = data_.get() + ((start + i) & mask_) * kChannels;
+    const float left = data[0] * kScale;
+    out[0] = left;
+    out[1] = channels == 1 ? left : data[1] * kScale;
+    data += channels;
+  }
+
+  sequence_.fetchAndAddOrdered(1);
+  written_ = start + frames;
+  rate_ = rate;
+  end_nanosec_ = end_nanosec;
+  sequence_.fetchAndAddOrdered(1);
+}
+
+ScopeRingBuffer::View ScopeRingBuffer::Read(int frames,
+                                            qint64 position_nanosec) const {
+  View ret;
+
+  // Readers only look at the older half of the ring, which leaves the producer
+  // the other half to write into while a view is being used.
+  const int history = capacity_ / 2;
+  if (frames <= 0 || frames > history)
+    return ret;
+
+  quint32 written = 0;
+  int rate = 0;
+  qint64 end_nanosec = 0;
+  forever {
+    const int before = sequence_.fetchAndAddOrdered(0);
+    written = written_;
+    rate = rate_;
+    end_nanosec = end_nanosec_;
+    const int after = sequence_.fetchAndAddOrdered(0);
+
+    if (before == after && !(before & 1))
+      break;
+  }
+
+  if (written < quint32(frames))
+    return ret;
+
+  // The probe sink is synchronised to the clock so the newest frames are only
+  // just ahead of the audio device.  Step back by however much hasn't been
+  // played yet.
+  qint64 pending = 0;
+  if (rate > 0 && end_nanosec > position_nanosec)
+    pending = (end_nanosec - position_nanosec) * rate / kNsecPerSec;
+  pending = qMin(pending, qMin(qint64(written) - frames, qint64(history - frames)));
+
+  const quint32 start = written - quint32(pending) - frames;
+  const int offset = start & mask_;
+  const int first = qMin(frames, capacity_ - offset);
+
+  ret.buffer_ = shared_from_this();
+  ret.data_[0] = data_.get() + offset * kChannels;
+  ret.frames_[0] = first;
+  ret.data_[1] = data_.get();
+  ret.frames_[1] = frames - first;
+  return ret;
+}
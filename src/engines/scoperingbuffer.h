@@ -0,0 +1,93 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SCOPERINGBUFFER_H
+#define SCOPERINGBUFFER_H
+
+#include <QAtomicInt>
+#include <QtGlobal>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+
+// A single-producer, single-consumer ring of stereo float frames that sits
+// between the GStreamer streaming thread and the analyzers.  The producer
+// never blocks and never allocates - it converts each buffer straight into the
+// ring and publishes the new write position along with the stream time of the
+// last frame.  Readers get a view onto the frames that are playing right now
+// without copying them or touching the GstBuffers.
+class ScopeRingBuffer : public boost::enable_shared_from_this<ScopeRingBuffer>,
+                        boost::noncopyable {
+ public:
+  // The capacity is rounded up to a power of two.
+  explicit ScopeRingBuffer(int capacity_frames = kDefaultCapacityFrames);
+
+  static const int kChannels = 2;
+  static const int kDefaultCapacityFrames = 32768;
+
+  // A read-only window onto the ring.  The frames can wrap around the end of
+  // the ring, so they're exposed as two spans of interleaved stereo floats.
+  // The view keeps the ring alive but the producer never waits for readers, so
+  // don't hang on to one for longer than it takes to draw a frame.
+  class View {
+   public:
+    View();
+
+    bool is_empty() const { return frames() == 0; }
+    int frames() const { return frames_[0] + frames_[1]; }
+    const float* span(int i) const { return data_[i]; }
+    int span_frames(int i) const { return frames_[i]; }
+
+    // Averages the two channels into dest, which must hold frames() floats.
+    void MixToMono(float* dest) const;
+
+   private:
+    friend class ScopeRingBuffer;
+
+    boost::shared_ptr<const ScopeRingBuffer> buffer_;
+    const float* data_[2];
+    int frames_[2];
+  };
+
+  // Producer side, only call this from the streaming thread.  Appends |frames|
+  // frames of interleaved signed 16-bit samples.  Mono is copied to both
+  // channels and anything past the first two channels is dropped.
+  // end_nanosec is the stream time just after the last frame.
+  void Write(const qint16* data, int frames, int channels, int rate,
+             qint64 end_nanosec);
+
+  // Returns the |frames| frames leading up to |position_nanosec|, or the
+  // newest frames if that position has already been overwritten.  The view is
+  // empty until enough frames have been written.
+  View Read(int frames, qint64 position_nanosec) const;
+
+ private:
+  int capacity_;
+  int mask_;
+  boost::scoped_array<float> data_;
+
+  // Odd while the producer is publishing a write.  Readers retry if they see
+  // an odd value or if it changes while they're reading the fields below.
+  mutable QAtomicInt sequence_;
+  quint32 written_;
+  int rate_;
+  qint64 end_nanosec_;
+};
+
+#endif // SCOPERINGBUFFER_H
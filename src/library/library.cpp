@@ -19,6 +19,7 @@
 
 #include "librarymodel.h"
 #include "librarybackend.h"
+#include "librarycatalogue.h"
 #include "core/application.h"
 #include "core/database.h"
 #include "smartplaylists/generator.h"
@@ -36,6 +37,7 @@ Library::Library(Application* app, QObject *parent)
   : QObject(parent),
     app_(app),
     backend_(NULL),
+    catalogue_(NULL),
     model_(NULL),
     watcher_(NULL),
     watcher_thread_(NULL)
@@ -51,7 +53,10 @@ Library::Library(Application* app, QObject *parent)
   using smart_playlists::Search;
   using smart_playlists::SearchTerm;
 
+  catalogue_ = new LibraryCatalogue(backend_, this);
+
   model_ = new LibraryModel(backend_, app_, this);
+  model_->set_catalogue(catalogue_);
   model_->set_show_smart_playlists(true);
   model_->set_default_smart_playlists(LibraryModel::DefaultGenerators()
     << (LibraryModel::GeneratorList()
@@ -128,6 +133,10 @@ void Library::Init() {
           backend_, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
   connect(watcher_, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)),
           backend_, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
+  connect(watcher_, SIGNAL(ScanJournalAdded(SubdirectoryList,bool)),
+          backend_, SLOT(AddToScanJournal(SubdirectoryList,bool)));
+  connect(watcher_, SIGNAL(ScanJournalRemoved(SubdirectoryList)),
+          backend_, SLOT(RemoveFromScanJournal(SubdirectoryList)));
   connect(watcher_, SIGNAL(CompilationsNeedUpdating()),
           backend_, SLOT(UpdateCompilations()));
 
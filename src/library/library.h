@@ -26,6 +26,7 @@
 class Application;
 class Database;
 class LibraryBackend;
+class LibraryCatalogue;
 class LibraryModel;
 class LibraryWatcher;
 class TaskManager;
@@ -46,6 +47,7 @@ class Library : public QObject {
 
   LibraryBackend* backend() const { return backend_; }
   LibraryModel* model() const { return model_; }
+  LibraryCatalogue* catalogue() const { return catalogue_; }
 
   QString full_rescan_reason(int schema_version) const { return full_rescan_revisions_.value(schema_version, QString()); }
 
@@ -63,6 +65,7 @@ class Library : public QObject {
  private:
   Application* app_;
   LibraryBackend* backend_;
+  LibraryCatalogue* catalogue_;
   LibraryModel* model_;
 
   LibraryWatcher* watcher_;
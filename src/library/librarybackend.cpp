@@ -30,6 +30,8 @@
 #include <QVariant>
 #include <QtDebug>
 
+const int LibraryBackend::kAddOrUpdateSongsChunkSize = 500;
+const int LibraryBackend::kGetSongsByUrlsChunkSize = 500;
 const char* LibraryBackend::kNewScoreSql =
     "case when playcount <= 0 then (%1 * 100 + score) / 2"
     "     else (score * (playcount + skipcount) + %1 * 100) / (playcount + skipcount + 1)"
@@ -81,7 +83,7 @@ void LibraryBackend::UpdateSongRatingAsync(int id, float rating) {
 void LibraryBackend::LoadDirectories() {
   DirectoryList dirs = GetAllDirectories();
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   foreach (const Directory& dir, dirs) {
@@ -91,7 +93,7 @@ void LibraryBackend::LoadDirectories() {
 
 void LibraryBackend::ChangeDirPath(int id, const QString& old_path,
                                    const QString& new_path) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
@@ -127,7 +129,7 @@ void LibraryBackend::ChangeDirPath(int id, const QString& old_path,
 }
 
 DirectoryList LibraryBackend::GetAllDirectories() {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   DirectoryList ret;
@@ -147,7 +149,7 @@ DirectoryList LibraryBackend::GetAllDirectories() {
 }
 
 SubdirectoryList LibraryBackend::SubdirsInDirectory(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db = db_->Connect();
   return SubdirsInDirectory(id, db);
 }
@@ -172,7 +174,7 @@ SubdirectoryList LibraryBackend::SubdirsInDirectory(int id, QSqlDatabase &db) {
 }
 
 void LibraryBackend::UpdateTotalSongCount() {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("SELECT COUNT(*) FROM %1 WHERE unavailable = 0").arg(songs_table_), db);
@@ -186,7 +188,7 @@ void LibraryBackend::UpdateTotalSongCount() {
 void LibraryBackend::AddDirectory(const QString& path) {
   QString canonical_path = QFileInfo(path).canonicalFilePath();
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("INSERT INTO %1 (path, subdirs)"
@@ -203,7 +205,7 @@ void LibraryBackend::AddDirectory(const QString& path) {
 }
 
 void LibraryBackend::RemoveDirectory(const Directory& dir) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   // Remove songs first
@@ -218,6 +220,14 @@ void LibraryBackend::RemoveDirectory(const Directory& dir) {
   q.exec();
   if (db_->CheckErrors(q)) return;
 
+  // And anything a scan still had to do in it
+  q = QSqlQuery("DELETE FROM scan_journal"
+                " WHERE subdirs_table = :table AND directory = :id", db);
+  q.bindValue(":table", subdirs_table_);
+  q.bindValue(":id", dir.id);
+  q.exec();
+  if (db_->CheckErrors(q)) return;
+
   // Now remove the directory itself
   q = QSqlQuery(QString("DELETE FROM %1 WHERE ROWID = :id")
                 .arg(dirs_table_), db);
@@ -231,7 +241,7 @@ void LibraryBackend::RemoveDirectory(const Directory& dir) {
 }
 
 SongList LibraryBackend::FindSongsInDirectory(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("SELECT ROWID, " + Song::kColumnSpec +
@@ -250,8 +260,73 @@ SongList LibraryBackend::FindSongsInDirectory(int id) {
   return ret;
 }
 
+SubdirectoryList LibraryBackend::GetScanJournal(int id, bool* ignores_mtime) {
+  Database::ReadLocker l(db_);
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q("SELECT path, ignores_mtime FROM scan_journal"
+              " WHERE subdirs_table = :table AND directory = :dir", db);
+  q.bindValue(":table", subdirs_table_);
+  q.bindValue(":dir", id);
+  q.exec();
+  if (db_->CheckErrors(q)) return SubdirectoryList();
+
+  *ignores_mtime = false;
+
+  SubdirectoryList subdirs;
+  while (q.next()) {
+    Subdirectory subdir;
+    subdir.directory_id = id;
+    subdir.path = q.value(0).toString();
+    subdirs << subdir;
+
+    if (q.value(1).toBool())
+      *ignores_mtime = true;
+  }
+
+  return subdirs;
+}
+
+void LibraryBackend::AddToScanJournal(const SubdirectoryList& subdirs,
+                                      bool ignores_mtime) {
+  Database::WriteLocker l(db_);
+  QSqlDatabase db(db_->Connect());
+  QSqlQuery add_query("INSERT INTO scan_journal"
+                      " (subdirs_table, directory, path, ignores_mtime)"
+                      " VALUES (:table, :id, :path, :ignores_mtime)", db);
+
+  ScopedTransaction transaction(&db);
+  foreach (const Subdirectory& subdir, subdirs) {
+    add_query.bindValue(":table", subdirs_table_);
+    add_query.bindValue(":id", subdir.directory_id);
+    add_query.bindValue(":path", subdir.path);
+    add_query.bindValue(":ignores_mtime", ignores_mtime ? 1 : 0);
+    add_query.exec();
+    if (db_->CheckErrors(add_query)) return;
+  }
+  transaction.Commit();
+}
+
+void LibraryBackend::RemoveFromScanJournal(const SubdirectoryList& subdirs) {
+  Database::WriteLocker l(db_);
+  QSqlDatabase db(db_->Connect());
+  QSqlQuery delete_query("DELETE FROM scan_journal"
+                         " WHERE subdirs_table = :table AND directory = :id"
+                         " AND path = :path", db);
+
+  ScopedTransaction transaction(&db);
+  foreach (const Subdirectory& subdir, subdirs) {
+    delete_query.bindValue(":table", subdirs_table_);
+    delete_query.bindValue(":id", subdir.directory_id);
+    delete_query.bindValue(":path", subdir.path);
+    delete_query.exec();
+    if (db_->CheckErrors(delete_query)) return;
+  }
+  transaction.Commit();
+}
+
 void LibraryBackend::AddOrUpdateSubdirs(const SubdirectoryList& subdirs) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   QSqlQuery find_query(QString("SELECT ROWID FROM %1"
                                " WHERE directory = :id AND path = :path")
@@ -300,39 +375,76 @@ void LibraryBackend::AddOrUpdateSubdirs(const SubdirectoryList& subdirs) {
 }
 
 void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
-  QMutexLocker l(db_->Mutex());
+  SongList added_songs;
+  SongList deleted_songs;
+
+  for (int i=0 ; i<songs.count() ; i += kAddOrUpdateSongsChunkSize) {
+    AddOrUpdateSongsChunk(songs.mid(i, kAddOrUpdateSongsChunkSize),
+                          &added_songs, &deleted_songs);
+  }
+
+  if (!deleted_songs.isEmpty())
+    emit SongsDeleted(deleted_songs);
+
+  if (!added_songs.isEmpty())
+    emit SongsDiscovered(added_songs);
+
+  UpdateTotalSongCountAsync();
+}
+
+void LibraryBackend::AddOrUpdateSongsChunk(const SongList& songs,
+                                           SongList* added_songs,
+                                           SongList* deleted_songs) {
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery check_dir(QString("SELECT ROWID FROM %1 WHERE ROWID = :id")
-                      .arg(dirs_table_), db);
   QSqlQuery add_song(QString("INSERT INTO %1 (" + Song::kColumnSpec + ")"
                              " VALUES (" + Song::kBindSpec + ")")
                      .arg(songs_table_), db);
   QSqlQuery update_song(QString("UPDATE %1 SET " + Song::kUpdateSpec +
                                 " WHERE ROWID = :id").arg(songs_table_), db);
-  QSqlQuery add_song_fts(QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec + ")"
-                                 " VALUES (:id, " + Song::kFtsBindSpec + ")")
-                         .arg(fts_table_), db);
-  QSqlQuery update_song_fts(QString("UPDATE %1 SET " + Song::kFtsUpdateSpec +
-                                    " WHERE ROWID = :id").arg(fts_table_), db);
 
   ScopedTransaction transaction(&db);
 
-  SongList added_songs;
-  SongList deleted_songs;
+  // Do a sanity check first - make sure the songs' directories still exist.
+  // This is to fix a possible race condition when a directory is removed
+  // while LibraryWatcher is scanning it.
+  QSet<int> directory_ids;
+  if (!dirs_table_.isEmpty()) {
+    QSqlQuery q(QString("SELECT ROWID FROM %1").arg(dirs_table_), db);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+    while (q.next()) {
+      directory_ids.insert(q.value(0).toInt());
+    }
+  }
 
+  // Get the previous song data of the songs being updated in one go.
+  QStringList update_ids;
   foreach (const Song& song, songs) {
-    // Do a sanity check first - make sure the song's directory still exists
-    // This is to fix a possible race condition when a directory is removed
-    // while LibraryWatcher is scanning it.
-    if (!dirs_table_.isEmpty()) {
-      check_dir.bindValue(":id", song.directory_id());
-      check_dir.exec();
-      if (db_->CheckErrors(check_dir)) continue;
-
-      if (!check_dir.next())
-        continue; // Directory didn't exist
+    if (song.id() != -1)
+      update_ids << QString::number(song.id());
+  }
+
+  QHash<int, Song> old_songs;
+  if (!update_ids.isEmpty()) {
+    foreach (const Song& old_song, GetSongsById(update_ids, db)) {
+      old_songs[old_song.id()] = old_song;
     }
+  }
+
+  // The FTS index is populated from the songs table once all the rows in this
+  // chunk have been written, rather than with a query per song.
+  QStringList fts_ids;
+  QStringList updated_fts_ids;
+
+  // Only reported to the caller once the transaction has been committed.
+  SongList chunk_added_songs;
+  SongList chunk_deleted_songs;
+
+  foreach (const Song& song, songs) {
+    if (!dirs_table_.isEmpty() && !directory_ids.contains(song.directory_id()))
+      continue; // Directory didn't exist
 
     if (song.id() == -1) {
       // Create
@@ -344,19 +456,14 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
 
       // Get the new ID
       const int id = add_song.lastInsertId().toInt();
-
-      // Add to the FTS index
-      add_song_fts.bindValue(":id", id);
-      song.BindToFtsQuery(&add_song_fts);
-      add_song_fts.exec();
-      if (db_->CheckErrors(add_song_fts)) continue;
+      fts_ids << QString::number(id);
 
       Song copy(song);
       copy.set_id(id);
-      added_songs << copy;
+      chunk_added_songs << copy;
     } else {
       // Get the previous song data first
-      Song old_song(GetSongById(song.id()));
+      const Song old_song(old_songs.value(song.id()));
       if (!old_song.is_valid())
         continue;
 
@@ -366,29 +473,44 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
       update_song.exec();
       if (db_->CheckErrors(update_song)) continue;
 
-      song.BindToFtsQuery(&update_song_fts);
-      update_song_fts.bindValue(":id", song.id());
-      update_song_fts.exec();
-      if (db_->CheckErrors(update_song_fts)) continue;
+      fts_ids << QString::number(song.id());
+      updated_fts_ids << QString::number(song.id());
 
-      deleted_songs << old_song;
-      added_songs << song;
+      chunk_deleted_songs << old_song;
+      chunk_added_songs << song;
     }
   }
 
-  transaction.Commit();
+  if (!updated_fts_ids.isEmpty()) {
+    QSqlQuery delete_fts(QString("DELETE FROM %1 WHERE ROWID IN (%2)")
+                         .arg(fts_table_, updated_fts_ids.join(",")), db);
+    delete_fts.exec();
+    if (db_->CheckErrors(delete_fts)) return;
+  }
 
-  if (!deleted_songs.isEmpty())
-    emit SongsDeleted(deleted_songs);
+  if (!fts_ids.isEmpty()) {
+    // The FTS columns are named after the songs columns they index.
+    QStringList source_columns;
+    foreach (const QString& column, Song::kFtsColumns) {
+      source_columns << column.mid(3);
+    }
 
-  if (!added_songs.isEmpty())
-    emit SongsDiscovered(added_songs);
+    QSqlQuery add_fts(QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec + ")"
+                              " SELECT ROWID, %2 FROM %3 WHERE ROWID IN (%4)")
+                      .arg(fts_table_, source_columns.join(", "),
+                           songs_table_, fts_ids.join(",")), db);
+    add_fts.exec();
+    if (db_->CheckErrors(add_fts)) return;
+  }
 
-  UpdateTotalSongCountAsync();
+  transaction.Commit();
+
+  *added_songs << chunk_added_songs;
+  *deleted_songs << chunk_deleted_songs;
 }
 
 void LibraryBackend::UpdateMTimesOnly(const SongList& songs) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("UPDATE %1 SET mtime = :mtime WHERE ROWID = :id")
@@ -405,7 +527,7 @@ void LibraryBackend::UpdateMTimesOnly(const SongList& songs) {
 }
 
 void LibraryBackend::DeleteSongs(const SongList &songs) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery remove(QString("DELETE FROM %1 WHERE ROWID = :id")
@@ -431,7 +553,7 @@ void LibraryBackend::DeleteSongs(const SongList &songs) {
 }
 
 void LibraryBackend::MarkSongsUnavailable(const SongList &songs) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery remove(QString("UPDATE %1 SET unavailable = 1 WHERE ROWID = :id")
@@ -454,7 +576,7 @@ QStringList LibraryBackend::GetAll(const QString& column, const QueryOptions& op
   query.SetColumnSpec("DISTINCT " + column);
   query.AddCompilationRequirement(false);
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(&query)) return QStringList();
 
   QStringList ret;
@@ -474,7 +596,7 @@ QStringList LibraryBackend::GetAllArtistsWithAlbums(const QueryOptions& opt) {
   query.AddCompilationRequirement(false);
   query.AddWhere("album", "", "!=");
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(&query)) return QStringList();
 
   QStringList ret;
@@ -511,7 +633,7 @@ SongList LibraryBackend::GetSongs(const QString& artist, const QString& album, c
 
 SongList LibraryBackend::ExecLibraryQuery(LibraryQuery* query) {
   query->SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(query)) return SongList();
 
   SongList ret;
@@ -524,13 +646,13 @@ SongList LibraryBackend::ExecLibraryQuery(LibraryQuery* query) {
 }
 
 Song LibraryBackend::GetSongById(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
   return GetSongById(id, db);
 }
 
 SongList LibraryBackend::GetSongsById(const QList<int>& ids) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QStringList str_ids;
@@ -542,7 +664,7 @@ SongList LibraryBackend::GetSongsById(const QList<int>& ids) {
 }
 
 SongList LibraryBackend::GetSongsById(const QStringList& ids) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   return GetSongsById(ids, db);
@@ -550,7 +672,7 @@ SongList LibraryBackend::GetSongsById(const QStringList& ids) {
 
 SongList LibraryBackend::GetSongsByForeignId(
     const QStringList& ids, const QString& table, const QString& column) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QString in = ids.join(",");
@@ -628,6 +750,41 @@ SongList LibraryBackend::GetSongsByUrl(const QUrl& url) {
   return songlist;
 }
 
+SongList LibraryBackend::GetSongsByUrls(const QList<QUrl>& urls) {
+  Database::ReadLocker l(db_);
+  QSqlDatabase db(db_->Connect());
+
+  SongList ret;
+  for (int i=0 ; i<urls.count() ; i += kGetSongsByUrlsChunkSize) {
+    const QList<QUrl> chunk = urls.mid(i, kGetSongsByUrlsChunkSize);
+
+    QStringList placeholders;
+    for (int j=0 ; j<chunk.count() ; ++j) {
+      placeholders << "?";
+    }
+
+    // Filenames are stored as blobs, so they have to be bound as byte arrays
+    // rather than going through LibraryQuery.  The unavailable check is the
+    // one LibraryQuery adds by default, so this finds the same songs as
+    // GetSongByUrl and GetSongsByUrl.
+    QSqlQuery q(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1"
+                        " WHERE filename IN (%2) AND unavailable = 0")
+                .arg(songs_table_, placeholders.join(",")), db);
+    foreach (const QUrl& url, chunk) {
+      q.addBindValue(url.toEncoded());
+    }
+    q.exec();
+    if (db_->CheckErrors(q)) return ret;
+
+    while (q.next()) {
+      Song song;
+      song.InitFromQuery(q, true);
+      ret << song;
+    }
+  }
+  return ret;
+}
+
 LibraryBackend::AlbumList LibraryBackend::GetCompilationAlbums(const QueryOptions& opt) {
   return GetAlbums(QString(), true, opt);
 }
@@ -638,7 +795,7 @@ SongList LibraryBackend::GetCompilationSongs(const QString& album, const QueryOp
   query.AddCompilationRequirement(true);
   query.AddWhere("album", album);
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(&query)) return SongList();
 
   SongList ret;
@@ -651,7 +808,7 @@ SongList LibraryBackend::GetCompilationSongs(const QString& album, const QueryOp
 }
 
 void LibraryBackend::UpdateCompilations() {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   // Look for albums that have songs by more than one 'effective album artist' in the same
@@ -764,7 +921,7 @@ LibraryBackend::AlbumList LibraryBackend::GetAlbums(const QString& artist,
     query.AddWhere("artist", artist);
   }
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(&query)) return ret;
 
   QString last_album;
@@ -801,7 +958,7 @@ LibraryBackend::Album LibraryBackend::GetAlbumArt(const QString& artist, const Q
   query.AddWhere("artist", artist);
   query.AddWhere("album", album);
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   if (!ExecQuery(&query)) return ret;
 
   if (query.Next()) {
@@ -825,7 +982,7 @@ void LibraryBackend::UpdateManualAlbumArtAsync(const QString &artist,
 void LibraryBackend::UpdateManualAlbumArt(const QString &artist,
                                           const QString &album,
                                           const QString &art) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   // Get the songs before they're updated
@@ -878,7 +1035,7 @@ void LibraryBackend::UpdateManualAlbumArt(const QString &artist,
 }
 
 void LibraryBackend::ForceCompilation(const QString& album, const QList<QString>& artists, bool on) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   SongList deleted_songs, added_songs;
 
@@ -937,7 +1094,7 @@ bool LibraryBackend::ExecQuery(LibraryQuery *q) {
 }
 
 SongList LibraryBackend::FindSongs(const smart_playlists::Search& search) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   // Build the query
@@ -959,11 +1116,27 @@ SongList LibraryBackend::FindSongs(const smart_playlists::Search& search) {
   return ret;
 }
 
+QList<int> LibraryBackend::FindSongIds(const smart_playlists::Search& search) {
+  Database::ReadLocker l(db_);
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery query(search.ToIdSql(songs_table()), db);
+  query.exec();
+  if (db_->CheckErrors(query))
+    return QList<int>();
+
+  QList<int> ret;
+  while (query.next()) {
+    ret << query.value(0).toInt();
+  }
+  return ret;
+}
+
 void LibraryBackend::IncrementPlayCount(int id) {
   if (id == -1)
     return;
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("UPDATE %1 SET playcount = playcount + 1,"
@@ -985,7 +1158,7 @@ void LibraryBackend::IncrementSkipCount(int id, float progress) {
     return;
   progress = qBound(0.0f, progress, 1.0f);
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("UPDATE %1 SET skipcount = skipcount + 1,"
@@ -1004,7 +1177,7 @@ void LibraryBackend::ResetStatistics(int id) {
   if (id == -1)
     return;
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString(
@@ -1024,7 +1197,7 @@ void LibraryBackend::UpdateSongRating(int id, float rating) {
   if (id == -1)
     return;
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q(QString("UPDATE %1 SET rating = :rating"
@@ -1041,7 +1214,7 @@ void LibraryBackend::UpdateSongRating(int id, float rating) {
 
 void LibraryBackend::DeleteAll() {
   {
-    QMutexLocker l(db_->Mutex());
+    Database::WriteLocker l(db_);
     QSqlDatabase db(db_->Connect());
     ScopedTransaction t(&db);
 
@@ -92,6 +92,10 @@ public:
   // is not present in library, returns invalid song.
   // Using default beginning value is suitable when searching for single-section songs.
   virtual Song GetSongByUrl(const QUrl& url, qint64 beginning = 0) = 0;
+  // Returns all sections of all songs with any of the given filenames.  This
+  // is much faster than calling GetSongsByUrl for each one.  Like the other
+  // lookups it leaves out songs that are marked unavailable.
+  virtual SongList GetSongsByUrls(const QList<QUrl>& urls) = 0;
 
   virtual void AddDirectory(const QString& path) = 0;
   virtual void RemoveDirectory(const Directory& dir) = 0;
@@ -122,6 +126,11 @@ class LibraryBackend : public LibraryBackendInterface {
 
   SongList FindSongsInDirectory(int id);
   SubdirectoryList SubdirsInDirectory(int id);
+
+  // The scan journal holds the subdirectories that a LibraryWatcher scan has
+  // yet to finish, so a scan that was interrupted can be resumed.
+  // ignores_mtime is set if that scan was a full rescan.
+  SubdirectoryList GetScanJournal(int id, bool* ignores_mtime);
   DirectoryList GetAllDirectories();
   void ChangeDirPath(int id, const QString& old_path, const QString& new_path);
 
@@ -148,6 +157,7 @@ class LibraryBackend : public LibraryBackendInterface {
 
   SongList GetSongsByUrl(const QUrl& url);
   Song GetSongByUrl(const QUrl& url, qint64 beginning = 0);
+  SongList GetSongsByUrls(const QList<QUrl>& urls);
 
   void AddDirectory(const QString& path);
   void RemoveDirectory(const Directory& dir);
@@ -155,6 +165,7 @@ class LibraryBackend : public LibraryBackendInterface {
   bool ExecQuery(LibraryQuery* q);
   SongList ExecLibraryQuery(LibraryQuery* query);
   SongList FindSongs(const smart_playlists::Search& search);
+  QList<int> FindSongIds(const smart_playlists::Search& search);
 
   void IncrementPlayCountAsync(int id);
   void IncrementSkipCountAsync(int id, float progress);
@@ -171,6 +182,8 @@ class LibraryBackend : public LibraryBackendInterface {
   void DeleteSongs(const SongList& songs);
   void MarkSongsUnavailable(const SongList& songs);
   void AddOrUpdateSubdirs(const SubdirectoryList& subdirs);
+  void AddToScanJournal(const SubdirectoryList& subdirs, bool ignores_mtime);
+  void RemoveFromScanJournal(const SubdirectoryList& subdirs);
   void UpdateCompilations();
   void UpdateManualAlbumArt(const QString& artist, const QString& album, const QString& art);
   void ForceCompilation(const QString& album, const QList<QString>& artists, bool on);
@@ -204,6 +217,14 @@ class LibraryBackend : public LibraryBackendInterface {
 
   static const char* kNewScoreSql;
 
+  // AddOrUpdateSongs writes songs in transactions of this many songs, and
+  // releases the database mutex in between so other queries can run.
+  static const int kAddOrUpdateSongsChunkSize;
+
+  // GetSongsByUrls looks up this many filenames in each query, to stay under
+  // SQLite's limit on the number of bound parameters.
+  static const int kGetSongsByUrlsChunkSize;
+
   void UpdateCompilations(QSqlQuery& find_songs, QSqlQuery& update,
                           SongList& deleted_songs, SongList& added_songs,
                           const QString& album, int sampler);
@@ -211,6 +232,9 @@ class LibraryBackend : public LibraryBackendInterface {
                       const QueryOptions& opt = QueryOptions());
   SubdirectoryList SubdirsInDirectory(int id, QSqlDatabase& db);
 
+  void AddOrUpdateSongsChunk(const SongList& songs, SongList* added_songs,
+                             SongList* deleted_songs);
+
   Song GetSongById(int id, QSqlDatabase& db);
   SongList GetSongsById(const QStringList& ids, QSqlDatabase& db);
 
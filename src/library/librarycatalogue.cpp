@@ -0,0 +1,373 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "librarycatalogue.h"
+#include "librarybackend.h"
+#include "libraryquery.h"
+#include "core/database.h"
+#include "core/logging.h"
+
+#include <QDateTime>
+#include <QSet>
+#include <QTime>
+
+LibraryCatalogue::LibraryCatalogue(LibraryBackend* backend, QObject* parent)
+  : QObject(parent),
+    backend_(backend),
+    state_(State_Empty),
+    generation_(0)
+{
+  // Keep up to date on the backend's thread so nobody has to wait for the GUI
+  // thread to catch up.
+  connect(backend_, SIGNAL(SongsDiscovered(SongList)),
+          SLOT(SongsDiscovered(SongList)), Qt::DirectConnection);
+  connect(backend_, SIGNAL(SongsDeleted(SongList)),
+          SLOT(SongsDeleted(SongList)), Qt::DirectConnection);
+  connect(backend_, SIGNAL(DatabaseReset()),
+          SLOT(DatabaseReset()), Qt::DirectConnection);
+}
+
+bool LibraryCatalogue::IsStringField(Field field) {
+  return field <= Field_Genre;
+}
+
+int LibraryCatalogue::Intern(const QString& str, QVector<QString>* strings,
+                             QHash<QString, int>* string_ids) {
+  QHash<QString, int>::const_iterator it = string_ids->constFind(str);
+  if (it != string_ids->constEnd())
+    return it.value();
+
+  const int id = strings->count();
+  strings->append(str);
+  string_ids->insert(str, id);
+  return id;
+}
+
+void LibraryCatalogue::AppendRow(Columns* columns, int id, int ctime,
+                                 const int fields[FieldCount]) {
+  columns->rows_[id] = columns->ids_.count();
+  columns->ids_.append(id);
+  columns->ctimes_.append(ctime);
+  for (int i=0 ; i<FieldCount ; ++i) {
+    columns->fields_[i].append(fields[i]);
+  }
+}
+
+bool LibraryCatalogue::EnsureLoaded() {
+  int generation = 0;
+  {
+    QMutexLocker l(&mutex_);
+    if (state_ == State_Loaded)
+      return true;
+    if (state_ == State_Loading)
+      return false;
+    state_ = State_Loading;
+    generation = generation_;
+  }
+
+  QTime time;
+  time.start();
+
+  // Read the database without holding our own lock - the backend might be
+  // holding the database lock while it tells us about changes.
+  Columns columns;
+  QVector<QString> strings;
+  QHash<QString, int> string_ids;
+
+  LibraryQuery q;
+  q.SetColumnSpec("%songs_table.ROWID, ctime, artist, album,"
+                  " effective_albumartist, composer, genre, year, filetype,"
+                  " effective_compilation");
+  {
+    Database::ReadLocker db_l(backend_->db());
+    if (backend_->ExecQuery(&q)) {
+      int fields[FieldCount];
+      while (q.Next()) {
+        for (int i=Field_Artist ; i<=Field_Genre ; ++i) {
+          fields[i] = Intern(q.Value(2 + i).toString(), &strings, &string_ids);
+        }
+        fields[Field_Year] = q.Value(7).toInt();
+        fields[Field_FileType] = q.Value(8).toInt();
+        fields[Field_Compilation] = q.Value(9).toInt();
+
+        AppendRow(&columns, q.Value(0).toInt(), q.Value(1).toInt(), fields);
+      }
+    }
+  }
+
+  QMutexLocker l(&mutex_);
+  if (state_ != State_Loading || generation != generation_) {
+    // The database was reset while we were reading it.  Another load might
+    // have started since, so checking the state alone isn't enough.
+    return false;
+  }
+
+  columns_ = columns;
+  strings_ = strings;
+  string_ids_ = string_ids;
+  state_ = State_Loaded;
+
+  // Catch up with anything that changed while we were reading.
+  typedef QPair<bool, SongList> Update;
+  foreach (const Update& update, missed_updates_) {
+    foreach (const Song& song, update.second) {
+      if (update.first)
+        AddSong(song);
+      else
+        RemoveSong(song.id());
+    }
+  }
+  missed_updates_.clear();
+
+  qLog(Debug) << "Loaded" << columns_.ids_.count() << "songs with"
+              << strings_.count() << "distinct strings into the catalogue in"
+              << time.elapsed() << "ms";
+  return true;
+}
+
+int LibraryCatalogue::song_count() const {
+  QMutexLocker l(&mutex_);
+  return columns_.ids_.count();
+}
+
+bool LibraryCatalogue::is_loading() const {
+  QMutexLocker l(&mutex_);
+  return state_ == State_Loading;
+}
+
+void LibraryCatalogue::AddSong(const Song& song) {
+  int fields[FieldCount];
+  fields[Field_Artist] = Intern(song.artist(), &strings_, &string_ids_);
+  fields[Field_Album] = Intern(song.album(), &strings_, &string_ids_);
+  fields[Field_AlbumArtist] =
+      Intern(song.effective_albumartist(), &strings_, &string_ids_);
+  fields[Field_Composer] = Intern(song.composer(), &strings_, &string_ids_);
+  fields[Field_Genre] = Intern(song.genre(), &strings_, &string_ids_);
+  fields[Field_Year] = song.year();
+  fields[Field_FileType] = song.filetype();
+  fields[Field_Compilation] = song.is_compilation() ? 1 : 0;
+
+  // Update the song in place if we've got it already.
+  QHash<int, int>::const_iterator it = columns_.rows_.constFind(song.id());
+  if (it == columns_.rows_.constEnd()) {
+    AppendRow(&columns_, song.id(), song.ctime(), fields);
+    return;
+  }
+
+  const int row = it.value();
+  columns_.ctimes_[row] = song.ctime();
+  for (int i=0 ; i<FieldCount ; ++i) {
+    columns_.fields_[i][row] = fields[i];
+  }
+}
+
+void LibraryCatalogue::RemoveSong(int id) {
+  QHash<int, int>::iterator it = columns_.rows_.find(id);
+  if (it == columns_.rows_.end())
+    return;
+
+  // Move the last row into the gap.
+  const int row = it.value();
+  const int last = columns_.ids_.count() - 1;
+  columns_.rows_.erase(it);
+
+  if (row != last) {
+    const int last_id = columns_.ids_[last];
+    columns_.ids_[row] = last_id;
+    columns_.ctimes_[row] = columns_.ctimes_[last];
+    for (int i=0 ; i<FieldCount ; ++i) {
+      columns_.fields_[i][row] = columns_.fields_[i][last];
+    }
+    columns_.rows_[last_id] = row;
+  }
+
+  columns_.ids_.resize(last);
+  columns_.ctimes_.resize(last);
+  for (int i=0 ; i<FieldCount ; ++i) {
+    columns_.fields_[i].resize(last);
+  }
+}
+
+void LibraryCatalogue::SongsDiscovered(const SongList& songs) {
+  QMutexLocker l(&mutex_);
+  switch (state_) {
+    case State_Empty:
+      break;
+    case State_Loading:
+      missed_updates_ << qMakePair(true, songs);
+      break;
+    case State_Loaded:
+      foreach (const Song& song, songs) {
+        AddSong(song);
+      }
+      break;
+  }
+}
+
+void LibraryCatalogue::SongsDeleted(const SongList& songs) {
+  QMutexLocker l(&mutex_);
+  switch (state_) {
+    case State_Empty:
+      break;
+    case State_Loading:
+      missed_updates_ << qMakePair(false, songs);
+      break;
+    case State_Loaded:
+      foreach (const Song& song, songs) {
+        RemoveSong(song.id());
+      }
+      break;
+  }
+}
+
+void LibraryCatalogue::DatabaseReset() {
+  QMutexLocker l(&mutex_);
+  state_ = State_Empty;
+  generation_ ++;
+  columns_ = Columns();
+  strings_.clear();
+  string_ids_.clear();
+  missed_updates_.clear();
+}
+
+bool LibraryCatalogue::Resolve(const ConstraintList& constraints,
+                               QList<QPair<Field, int> >* resolved) const {
+  foreach (const Constraint& constraint, constraints) {
+    int value = 0;
+    if (IsStringField(constraint.field)) {
+      // A string we've never seen can't match anything.
+      QHash<QString, int>::const_iterator it =
+          string_ids_.constFind(constraint.value.toString());
+      if (it == string_ids_.constEnd())
+        return false;
+      value = it.value();
+    } else {
+      value = constraint.value.toInt();
+    }
+    resolved->append(qMakePair(constraint.field, value));
+  }
+  return true;
+}
+
+bool LibraryCatalogue::Matches(int row,
+                               const QList<QPair<Field, int> >& resolved,
+                               int min_ctime) const {
+  if (min_ctime != -1 && columns_.ctimes_[row] <= min_ctime)
+    return false;
+
+  for (int i=0 ; i<resolved.count() ; ++i) {
+    if (columns_.fields_[resolved[i].first][row] != resolved[i].second)
+      return false;
+  }
+  return true;
+}
+
+QVariant LibraryCatalogue::Value(Field field, int row) const {
+  const int value = columns_.fields_[field][row];
+  if (IsStringField(field))
+    return strings_[value];
+  return value;
+}
+
+bool LibraryCatalogue::Distinct(const FieldList& fields,
+                                const ConstraintList& constraints,
+                                int min_ctime, SqlRowList* rows) {
+  if (fields.isEmpty() || fields.count() > 2) {
+    qLog(Warning) << "Can't select" << fields.count()
+                  << "fields from the catalogue";
+    return false;
+  }
+
+  if (!EnsureLoaded())
+    return false;
+
+  QMutexLocker l(&mutex_);
+
+  QList<QPair<Field, int> > resolved;
+  if (!Resolve(constraints, &resolved))
+    return true;
+
+  const QVector<int>& first = columns_.fields_[fields[0]];
+  const QVector<int>* second =
+      fields.count() > 1 ? &columns_.fields_[fields[1]] : NULL;
+
+  // Pack the selected values into one key to find distinct ones.
+  QSet<quint64> seen;
+  const int count = columns_.ids_.count();
+  for (int row=0 ; row<count ; ++row) {
+    if (!Matches(row, resolved, min_ctime))
+      continue;
+
+    const quint64 key = (quint64(quint32(first[row])) << 32) |
+                        (second ? quint32((*second)[row]) : 0);
+    if (seen.contains(key))
+      continue;
+    seen.insert(key);
+
+    QList<QVariant> values;
+    foreach (Field field, fields) {
+      values << Value(field, row);
+    }
+    rows->append(SqlRow(values));
+  }
+  return true;
+}
+
+bool LibraryCatalogue::Exists(const ConstraintList& constraints, int min_ctime,
+                              bool* exists) {
+  if (!EnsureLoaded())
+    return false;
+
+  QMutexLocker l(&mutex_);
+
+  *exists = false;
+
+  QList<QPair<Field, int> > resolved;
+  if (!Resolve(constraints, &resolved))
+    return true;
+
+  const int count = columns_.ids_.count();
+  for (int row=0 ; row<count ; ++row) {
+    if (Matches(row, resolved, min_ctime)) {
+      *exists = true;
+      break;
+    }
+  }
+  return true;
+}
+
+bool LibraryCatalogue::AllSongs(const FieldList& fields, QList<int>* ids,
+                                SqlRowList* rows) {
+  if (!EnsureLoaded())
+    return false;
+
+  QMutexLocker l(&mutex_);
+
+  const int count = columns_.ids_.count();
+  ids->reserve(ids->count() + count);
+  rows->reserve(rows->count() + count);
+
+  for (int row=0 ; row<count ; ++row) {
+    QList<QVariant> values;
+    foreach (Field field, fields) {
+      values << Value(field, row);
+    }
+    ids->append(columns_.ids_[row]);
+    rows->append(SqlRow(values));
+  }
+  return true;
+}
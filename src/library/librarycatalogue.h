@@ -0,0 +1,148 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARYCATALOGUE_H
+#define LIBRARYCATALOGUE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QVariant>
+#include <QVector>
+
+#include "sqlrow.h"
+#include "core/song.h"
+
+class LibraryBackend;
+
+// An in-memory copy of the columns of the songs table that the library view
+// groups and filters on.  Strings are interned so each distinct artist, album
+// etc. is stored once, and every column is a packed array of ints indexed by
+// row.  It's loaded from the database the first time it's queried and then
+// kept up to date by the backend's signals.
+//
+// This is safe to use from any thread.
+class LibraryCatalogue : public QObject {
+  Q_OBJECT
+
+ public:
+  LibraryCatalogue(LibraryBackend* backend, QObject* parent = 0);
+
+  enum Field {
+    Field_Artist = 0,
+    Field_Album,
+    Field_AlbumArtist,
+    Field_Composer,
+    Field_Genre,
+    Field_Year,
+    Field_FileType,
+    Field_Compilation,
+
+    FieldCount
+  };
+  typedef QList<Field> FieldList;
+
+  struct Constraint {
+    Constraint(Field _field, const QVariant& _value)
+      : field(_field), value(_value) {}
+
+    Field field;
+    QVariant value;
+  };
+  typedef QList<Constraint> ConstraintList;
+
+  // Like SELECT DISTINCT <fields> FROM songs WHERE <constraints>.  At most two
+  // fields can be selected.  If min_ctime is not -1 only songs with a ctime
+  // greater than it are considered.  Returns false if the catalogue isn't
+  // loaded yet and the caller should ask the database instead.
+  bool Distinct(const FieldList& fields, const ConstraintList& constraints,
+                int min_ctime, SqlRowList* rows);
+
+  // Whether any song matches the constraints.  Returns false if the catalogue
+  // isn't loaded yet.
+  bool Exists(const ConstraintList& constraints, int min_ctime, bool* exists);
+
+  // Like SELECT ROWID, <fields> FROM songs, with any number of fields.
+  // Returns false if the catalogue isn't loaded yet.
+  bool AllSongs(const FieldList& fields, QList<int>* ids, SqlRowList* rows);
+
+  int song_count() const;
+
+  // True while another thread is loading the catalogue.  Until it's done the
+  // queries above return false.
+  bool is_loading() const;
+
+ public slots:
+  void SongsDiscovered(const SongList& songs);
+  void SongsDeleted(const SongList& songs);
+  void DatabaseReset();
+
+ private:
+  enum State {
+    State_Empty,
+    State_Loading,
+    State_Loaded
+  };
+
+  struct Columns {
+    QVector<int> ids_;
+    QVector<int> ctimes_;
+    QVector<int> fields_[FieldCount];
+
+    // Keyed on database ID
+    QHash<int, int> rows_;
+  };
+
+  bool EnsureLoaded();
+
+  // These must be called with mutex_ held.
+  bool Resolve(const ConstraintList& constraints,
+               QList<QPair<Field, int> >* resolved) const;
+  bool Matches(int row, const QList<QPair<Field, int> >& resolved,
+               int min_ctime) const;
+  QVariant Value(Field field, int row) const;
+  void AddSong(const Song& song);
+  void RemoveSong(int id);
+
+  static int Intern(const QString& str, QVector<QString>* strings,
+                    QHash<QString, int>* string_ids);
+  static void AppendRow(Columns* columns, int id, int ctime,
+                        const int fields[FieldCount]);
+  static bool IsStringField(Field field);
+
+ private:
+  LibraryBackend* backend_;
+
+  mutable QMutex mutex_;
+  State state_;
+  Columns columns_;
+
+  // Incremented by DatabaseReset, so a load that started before the reset
+  // doesn't store what it read.
+  int generation_;
+
+  QVector<QString> strings_;
+  QHash<QString, int> string_ids_;
+
+  // Changes from the backend that arrived while the catalogue was loading,
+  // replayed when it's done.
+  QList<QPair<bool, SongList> > missed_updates_;
+};
+
+#endif // LIBRARYCATALOGUE_H
@@ -32,12 +32,14 @@
 #include "smartplaylists/querygenerator.h"
 #include "ui/iconloader.h"
 
+#include <QDateTime>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QMetaEnum>
 #include <QPixmapCache>
 #include <QSettings>
 #include <QStringList>
+#include <QTime>
 #include <QUrl>
 #include <QtConcurrentRun>
 
@@ -52,10 +54,15 @@ const char* LibraryModel::kSmartPlaylistsMimeType = "application/x-clementine-sm
 const char* LibraryModel::kSmartPlaylistsSettingsGroup = "SerialisedSmartPlaylists";
 const int LibraryModel::kSmartPlaylistsVersion = 4;
 const int LibraryModel::kPrettyCoverSize = 32;
+const int LibraryModel::kSlowQueryMsec = 100;
+const int LibraryModel::kVariousArtistsKey = -1;
 
 typedef QFuture<LibraryModel::QueryResult> RootQueryFuture;
 typedef QFutureWatcher<LibraryModel::QueryResult> RootQueryWatcher;
 
+typedef QFuture<LibraryModel::FilterResult> FilterFuture;
+typedef QFutureWatcher<LibraryModel::FilterResult> FilterWatcher;
+
 static bool IsArtistGroupBy(const LibraryModel::GroupBy by) {
   return by == LibraryModel::GroupBy_Artist || by == LibraryModel::GroupBy_AlbumArtist;
 }
@@ -72,6 +79,7 @@ LibraryModel::LibraryModel(LibraryBackend* backend, Application* app,
     dir_model_(new LibraryDirectoryModel(backend, this)),
     show_smart_playlists_(false),
     show_various_artists_(true),
+    catalogue_(NULL),
     total_song_count_(0),
     artist_icon_(":/icons/22x22/x-clementine-artist.png"),
     album_icon_(":/icons/22x22/x-clementine-album.png"),
@@ -79,7 +87,9 @@ LibraryModel::LibraryModel(LibraryBackend* backend, Application* app,
     playlist_icon_(":/icons/22x22/x-clementine-albums.png"),
     init_task_id_(-1),
     use_pretty_covers_(false),
-    show_dividers_(true)
+    show_dividers_(true),
+    filter_generation_(0),
+    pending_index_builds_(0)
 {
   root_->lazy_loaded = true;
 
@@ -91,9 +101,12 @@ LibraryModel::LibraryModel(LibraryBackend* backend, Application* app,
   cover_loader_options_.pad_output_image_ = true;
   cover_loader_options_.scale_output_image_ = true;
 
-  connect(app_->album_cover_loader(),
-          SIGNAL(ImageLoaded(quint64,QImage)),
-          SLOT(AlbumArtLoaded(quint64,QImage)));
+  // Tests create the model without an Application.
+  if (app_) {
+    connect(app_->album_cover_loader(),
+            SIGNAL(ImageLoaded(quint64,QImage)),
+            SLOT(AlbumArtLoaded(quint64,QImage)));
+  }
 
   no_cover_icon_ = QPixmap(":nocover.png").scaled(
         kPrettyCoverSize, kPrettyCoverSize,
@@ -144,6 +157,8 @@ void LibraryModel::Init(bool async) {
 }
 
 void LibraryModel::SongsDiscovered(const SongList& songs) {
+  UpdateIndex(songs, true);
+
   foreach (const Song& song, songs) {
     // Sanity check to make sure we don't add songs that are outside the user's
     // filter
@@ -315,6 +330,8 @@ QString LibraryModel::DividerDisplayText(GroupBy type, const QString& key) const
 }
 
 void LibraryModel::SongsDeleted(const SongList& songs) {
+  UpdateIndex(songs, false);
+
   // Delete the actual song nodes first, keeping track of each parent so we
   // might check to see if they're empty later.
   QSet<LibraryItem*> parents;
@@ -334,14 +351,18 @@ void LibraryModel::SongsDeleted(const SongList& songs) {
       // been lazy-loaded yet.  This is bad, because it would mean that to
       // clean up empty parents we would need to lazy-load them all
       // individually to see if they're empty.  This can take a very long time,
-      // so better to just reset the model and be done with it.
-      Reset();
+      // so better to just reset the model and be done with it - or if we've
+      // got an index of the library, diff the tree against the database.
+      if (song_index_)
+        UpdateFilterAsync();
+      else
+        Reset();
       return;
     }
   }
 
   // Now delete empty parents
-  QSet<QString> divider_keys;
+  bool removed_top_level = false;
   while (!parents.isEmpty()) {
     foreach (LibraryItem* node, parents) {
       parents.remove(node);
@@ -354,45 +375,16 @@ void LibraryModel::SongsDeleted(const SongList& songs) {
 
       // Maybe consider its divider node
       if (node->container_level == 0)
-        divider_keys << DividerKey(group_by_[0], node);
-
-      // Special case the Various Artists node
-      if (IsCompilationArtistNode(node))
-        node->parent->compilation_artist_node_ = NULL;
-      else
-        container_nodes_[node->container_level].remove(node->key);
+        removed_top_level = true;
 
       // It was empty - delete it
-      beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
-      node->parent->Delete(node->row);
-      endRemoveRows();
+      RemoveItem(node);
     }
   }
 
   // Delete empty dividers
-  foreach (const QString& divider_key, divider_keys) {
-    if (!divider_nodes_.contains(divider_key))
-      continue;
-
-    // Look to see if there are any other items still under this divider
-    bool found = false;
-    foreach (LibraryItem* node, container_nodes_[0].values()) {
-      if (DividerKey(group_by_[0], node) == divider_key) {
-        found = true;
-        break;
-      }
-    }
-
-    if (found)
-      continue;
-
-    // Remove the divider
-    int row = divider_nodes_[divider_key]->row;
-    beginRemoveRows(ItemToIndex(root_), row, row);
-    root_->Delete(row);
-    endRemoveRows();
-    divider_nodes_.remove(divider_key);
-  }
+  if (removed_top_level)
+    RemoveEmptyDividers();
 }
 
 QString LibraryModel::AlbumIconPixmapCacheKey(const QModelIndex& index) const {
@@ -564,7 +556,7 @@ bool LibraryModel::HasCompilations(const LibraryQuery& query) {
   q.AddCompilationRequirement(true);
   q.SetLimit(1);
 
-  QMutexLocker l(backend_->db()->Mutex());
+  Database::ReadLocker l(backend_->db());
   if (!backend_->ExecQuery(&q)) return false;
 
   return q.Next();
@@ -577,6 +569,11 @@ LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
   int child_level = parent == root_ ? 0 : parent->container_level + 1;
   GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
 
+  // Containers can usually be found without going to the database at all.
+  if (child_type != GroupBy_None &&
+      RunCatalogueQuery(parent, child_type, &result))
+    return result;
+
   // Initialise the query.  child_type says what type of thing we want (artists,
   // songs, etc.)
   LibraryQuery q(query_options_);
@@ -601,16 +598,81 @@ LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
   }
 
   // Execute the query
-  QMutexLocker l(backend_->db()->Mutex());
+  QTime time;
+  time.start();
+
+  Database::ReadLocker l(backend_->db());
   if (!backend_->ExecQuery(&q))
     return result;
 
   while (q.Next()) {
     result.rows << SqlRow(q);
   }
+
+  // Log slow queries - these are the ones the user sees as the library view
+  // stalling, usually because they were stuck behind a write.
+  const int elapsed = time.elapsed();
+  if (elapsed >= kSlowQueryMsec) {
+    qLog(Debug) << "Library query for" << result.rows.count() << "rows took"
+                << elapsed << "ms";
+  }
   return result;
 }
 
+bool LibraryModel::RunCatalogueQuery(LibraryItem* parent, GroupBy child_type,
+                                     QueryResult* result) {
+  // The catalogue doesn't know about the full text index or the duplicates
+  // and untagged views.
+  if (!catalogue_ || !query_options_.filter().isEmpty() ||
+      query_options_.query_mode() != QueryOptions::QueryMode_All)
+    return false;
+
+  QTime time;
+  time.start();
+
+  int min_ctime = -1;
+  if (query_options_.max_age() != -1) {
+    min_ctime = QDateTime::currentDateTime().toTime_t() -
+                query_options_.max_age();
+  }
+
+  // Walk up through the item's parents adding constraints, like RunQuery.
+  LibraryCatalogue::ConstraintList constraints;
+  LibraryItem* p = parent;
+  while (p && p->type == LibraryItem::Type_Container) {
+    FilterCatalogue(group_by_[p->container_level], p, &constraints);
+    p = p->parent;
+  }
+
+  QueryResult catalogue_result;
+  if (IsArtistGroupBy(child_type)) {
+    if (show_various_artists_) {
+      LibraryCatalogue::ConstraintList va_constraints(constraints);
+      va_constraints << LibraryCatalogue::Constraint(
+                          LibraryCatalogue::Field_Compilation, 1);
+      if (!catalogue_->Exists(va_constraints, min_ctime,
+                              &catalogue_result.create_va))
+        return false;
+    }
+
+    constraints << LibraryCatalogue::Constraint(
+                     LibraryCatalogue::Field_Compilation, 0);
+  }
+
+  if (!catalogue_->Distinct(CatalogueFields(child_type), constraints,
+                            min_ctime, &catalogue_result.rows))
+    return false;
+
+  const int elapsed = time.elapsed();
+  if (elapsed >= kSlowQueryMsec) {
+    qLog(Debug) << "Catalogue query for" << catalogue_result.rows.count()
+                << "rows took" << elapsed << "ms";
+  }
+
+  *result = catalogue_result;
+  return true;
+}
+
 void LibraryModel::PostQuery(LibraryItem* parent,
                              const LibraryModel::QueryResult& result,
                              bool signal) {
@@ -647,6 +709,9 @@ void LibraryModel::LazyPopulate(LibraryItem* parent, bool signal) {
 }
 
 void LibraryModel::ResetAsync() {
+  // Any filter that's still running is out of date now.
+  filter_generation_ ++;
+
   RootQueryFuture future = QtConcurrent::run(
         this, &LibraryModel::RunQuery, root_);
   RootQueryWatcher* watcher = new RootQueryWatcher(this);
@@ -702,37 +767,545 @@ void LibraryModel::Reset() {
   endResetModel();
 }
 
+void LibraryModel::UpdateFilterAsync() {
+  // There's nothing to diff against until the first load has finished.
+  if (init_task_id_ != -1) {
+    ResetAsync();
+    return;
+  }
+
+  const bool build_index = !song_index_ || song_index_->grouping != group_by_;
+
+  // The index is built from the catalogue.  Without one there's nothing to
+  // diff with, so don't run the filter query only to throw it away.
+  if (build_index && (!catalogue_ || catalogue_->is_loading())) {
+    ResetAsync();
+    return;
+  }
+
+  if (build_index)
+    pending_index_builds_ ++;
+
+  FilterFuture future = QtConcurrent::run(
+        this, &LibraryModel::RunFilterQuery, query_options_, group_by_,
+        build_index, ++filter_generation_);
+  FilterWatcher* watcher = new FilterWatcher(this);
+  watcher->setFuture(future);
+
+  connect(watcher, SIGNAL(finished()), SLOT(FilterQueryFinished()));
+}
+
+LibraryModel::FilterResult LibraryModel::RunFilterQuery(
+    const QueryOptions& options, const Grouping& grouping, bool build_index,
+    int generation) {
+  FilterResult result;
+  result.generation = generation;
+
+  QTime time;
+  time.start();
+
+  if (build_index) {
+    result.index_requested = true;
+    result.index = BuildIndex(grouping);
+  }
+
+  // Now find out which songs match the filter.
+  LibraryQuery q(options);
+  q.SetColumnSpec("%songs_table.ROWID");
+  {
+    Database::ReadLocker l(backend_->db());
+    if (backend_->ExecQuery(&q)) {
+      while (q.Next()) {
+        result.song_ids << q.Value(0).toInt();
+      }
+    }
+  }
+
+  qLog(Debug) << "Filter query for" << result.song_ids.count() << "songs took"
+              << time.elapsed() << "ms"
+              << (build_index ? "including the index" : "");
+  return result;
+}
+
+LibraryModel::SongIndexPtr LibraryModel::BuildIndex(
+    const Grouping& grouping) const {
+  // The catalogue already has the grouping columns for every song in the
+  // library.
+  if (!catalogue_)
+    return SongIndexPtr();
+
+  LibraryCatalogue::FieldList fields;
+  fields << LibraryCatalogue::Field_Compilation;
+  for (int i=0 ; i<3 && grouping[i] != GroupBy_None ; ++i) {
+    fields << CatalogueFields(grouping[i]);
+  }
+
+  QList<int> ids;
+  SqlRowList songs;
+  if (!catalogue_->AllSongs(fields, &ids, &songs))
+    return SongIndexPtr();
+
+  SongIndexPtr index(new SongIndex);
+  index->grouping = grouping;
+
+  for (int song=0 ; song<ids.count() ; ++song) {
+    const SqlRow& values = songs[song];
+
+    // Split the columns back up into one row for each level.
+    SqlRowList rows;
+    int column = 1;
+    for (int i=0 ; i<3 && grouping[i] != GroupBy_None ; ++i) {
+      const int count = CatalogueFields(grouping[i]).count();
+
+      QList<QVariant> level_values;
+      for (int j=0 ; j<count ; ++j) {
+        level_values << values.value(column++);
+      }
+      rows << SqlRow(level_values);
+    }
+
+    IndexSong(index.get(), ids[song], values.value(0).toBool(), rows);
+  }
+
+  return index;
+}
+
+void LibraryModel::FilterQueryFinished() {
+  FilterWatcher* watcher = static_cast<FilterWatcher*>(sender());
+  const FilterResult result = watcher->result();
+  watcher->deleteLater();
+
+  if (result.index_requested) {
+    pending_index_builds_ --;
+
+    if (result.index && result.index->grouping == group_by_) {
+      song_index_ = result.index;
+
+      // Catch up with anything that changed while it was being built.
+      typedef QPair<bool, SongList> Update;
+      foreach (const Update& update, missed_index_updates_) {
+        UpdateIndex(song_index_.get(), update.second, update.first);
+      }
+    }
+
+    if (pending_index_builds_ == 0)
+      missed_index_updates_.clear();
+  }
+
+  if (!FilterResultIsCurrent(result))
+    return;
+
+  // Songs that appear under containers that are already expanded have to be
+  // loaded from the database first, and there could be a lot of them.
+  QList<int> missing_ids;
+  FindMissingSongs(root_, 0, result.song_ids, &missing_ids);
+  if (missing_ids.isEmpty()) {
+    ApplyFilterResult(result);
+    return;
+  }
+
+  FilterFuture future = QtConcurrent::run(
+        this, &LibraryModel::LoadFilterSongs, result, missing_ids);
+  FilterWatcher* songs_watcher = new FilterWatcher(this);
+  songs_watcher->setFuture(future);
+
+  connect(songs_watcher, SIGNAL(finished()), SLOT(FilterSongsLoaded()));
+}
+
+LibraryModel::FilterResult LibraryModel::LoadFilterSongs(
+    FilterResult result, const QList<int>& ids) {
+  result.new_songs = backend_->GetSongsById(ids);
+  return result;
+}
+
+void LibraryModel::FilterSongsLoaded() {
+  FilterWatcher* watcher = static_cast<FilterWatcher*>(sender());
+  const FilterResult result = watcher->result();
+  watcher->deleteLater();
+
+  if (FilterResultIsCurrent(result))
+    ApplyFilterResult(result);
+}
+
+bool LibraryModel::FilterResultIsCurrent(const FilterResult& result) {
+  // Don't bother if the user has already changed the filter again.
+  if (result.generation != filter_generation_)
+    return false;
+
+  if (!song_index_ || song_index_->grouping != group_by_) {
+    ResetAsync();
+    return false;
+  }
+  return true;
+}
+
+void LibraryModel::ApplyFilterResult(const FilterResult& result) {
+  QHash<int, Song> new_songs;
+  foreach (const Song& song, result.new_songs) {
+    new_songs[song.id()] = song;
+  }
+
+  ApplyFilter(root_, 0, result.song_ids, new_songs);
+  UpdateSmartPlaylistNode();
+  RemoveEmptyDividers();
+}
+
+QMap<int, QList<int> > LibraryModel::SongsByContainer(
+    int level, const QList<int>& song_ids) const {
+  QMap<int, QList<int> > containers;
+  foreach (int id, song_ids) {
+    QHash<int, SongIndex::Entry>::const_iterator it =
+        song_index_->songs.constFind(id);
+    if (it == song_index_->songs.constEnd())
+      continue;
+
+    const int key = it->keys[level];
+    if (key == kVariousArtistsKey && !show_various_artists_)
+      continue;
+    containers[key] << id;
+  }
+  return containers;
+}
+
+QMap<int, QList<int> >::iterator LibraryModel::FindContainer(
+    LibraryItem* child, int level, QMap<int, QList<int> >* containers) const {
+  if (IsCompilationArtistNode(child))
+    return containers->find(kVariousArtistsKey);
+  if (song_index_->key_ids[level].contains(child->key))
+    return containers->find(song_index_->key_ids[level][child->key]);
+  return containers->end();
+}
+
+void LibraryModel::FindMissingSongs(LibraryItem* parent, int level,
+                                    const QList<int>& song_ids,
+                                    QList<int>* missing_ids) const {
+  // This follows the same path through the tree as ApplyFilter.  New
+  // containers aren't loaded yet so they don't need any songs.
+  if (!parent->lazy_loaded)
+    return;
+
+  const GroupBy type = level >= 3 ? GroupBy_None : group_by_[level];
+  if (type == GroupBy_None) {
+    QSet<int> missing = song_ids.toSet();
+    foreach (LibraryItem* child, parent->children) {
+      if (child->type == LibraryItem::Type_Song)
+        missing.remove(child->metadata.id());
+    }
+    foreach (int id, song_ids) {
+      if (missing.contains(id))
+        *missing_ids << id;
+    }
+    return;
+  }
+
+  QMap<int, QList<int> > containers = SongsByContainer(level, song_ids);
+  foreach (LibraryItem* child, parent->children) {
+    if (child->type != LibraryItem::Type_Container)
+      continue;
+
+    QMap<int, QList<int> >::iterator it =
+        FindContainer(child, level, &containers);
+    if (it != containers.end())
+      FindMissingSongs(child, level + 1, it.value(), missing_ids);
+  }
+}
+
+void LibraryModel::ApplyFilter(LibraryItem* parent, int level,
+                               const QList<int>& song_ids,
+                               const QHash<int, Song>& new_songs) {
+  // Containers that haven't been loaded yet will use the new filter when they
+  // are.
+  if (!parent->lazy_loaded)
+    return;
+
+  const GroupBy type = level >= 3 ? GroupBy_None : group_by_[level];
+  if (type == GroupBy_None) {
+    ApplyFilterToSongs(parent, song_ids, new_songs);
+    return;
+  }
+
+  // Work out which container each song belongs in at this level.
+  QMap<int, QList<int> > containers = SongsByContainer(level, song_ids);
+
+  // Remove the containers that are now empty, and recurse into the others.
+  foreach (LibraryItem* child, QList<LibraryItem*>(parent->children)) {
+    if (child->type != LibraryItem::Type_Container)
+      continue;
+
+    QMap<int, QList<int> >::iterator it =
+        FindContainer(child, level, &containers);
+    if (it == containers.end()) {
+      RemoveItem(child);
+    } else {
+      const QList<int> child_song_ids = it.value();
+      containers.erase(it);
+      ApplyFilter(child, level + 1, child_song_ids, new_songs);
+    }
+  }
+
+  // Anything left over needs a new container.
+  foreach (int key, containers.keys()) {
+    if (key == kVariousArtistsKey) {
+      CreateCompilationArtistNode(true, parent);
+    } else {
+      LibraryItem* item = ItemFromQuery(type, true, level == 0, parent,
+                                        song_index_->rows[level][key], level);
+      container_nodes_[level][item->key] = item;
+    }
+  }
+}
+
+void LibraryModel::ApplyFilterToSongs(LibraryItem* parent,
+                                      const QList<int>& song_ids,
+                                      const QHash<int, Song>& new_songs) {
+  QSet<int> missing = song_ids.toSet();
+
+  foreach (LibraryItem* child, QList<LibraryItem*>(parent->children)) {
+    if (child->type != LibraryItem::Type_Song)
+      continue;
+
+    if (!missing.remove(child->metadata.id()))
+      RemoveItem(child);
+  }
+
+  // Only the songs that FindMissingSongs asked for have been loaded.  A
+  // container expanded since then was populated with the new filter already.
+  foreach (int id, song_ids) {
+    QHash<int, Song>::const_iterator it = new_songs.constFind(id);
+    if (!missing.contains(id) || it == new_songs.constEnd())
+      continue;
+
+    song_nodes_[id] =
+        ItemFromSong(GroupBy_None, true, parent == root_, parent, *it, -1);
+  }
+}
+
+void LibraryModel::UpdateSmartPlaylistNode() {
+  // Smart playlists are hidden while there's a filter, like in BeginReset.
+  const bool show = show_smart_playlists_ && query_options_.filter().isEmpty();
+
+  if (show && !smart_playlist_node_) {
+    const int row = root_->children.count();
+    beginInsertRows(ItemToIndex(root_), row, row);
+    CreateSmartPlaylists();
+    endInsertRows();
+  } else if (!show && smart_playlist_node_) {
+    LibraryItem* node = smart_playlist_node_;
+    smart_playlist_node_ = NULL;
+    RemoveItem(node);
+  }
+}
+
+void LibraryModel::RemoveEmptyDividers() {
+  // FinishItem puts the divider key at the start of every top level item's
+  // sort text, so a divider with no items starting with its key is empty.
+  foreach (const QString& divider_key, divider_nodes_.keys()) {
+    bool found = false;
+    foreach (LibraryItem* node, root_->children) {
+      if (node->type == LibraryItem::Type_Container &&
+          node->sort_text.startsWith(divider_key)) {
+        found = true;
+        break;
+      }
+    }
+
+    if (found)
+      continue;
+
+    // Remove the divider
+    const int row = divider_nodes_.take(divider_key)->row;
+    beginRemoveRows(ItemToIndex(root_), row, row);
+    root_->Delete(row);
+    endRemoveRows();
+  }
+}
+
+void LibraryModel::RemoveItem(LibraryItem* item) {
+  QSet<LibraryItem*> forgotten;
+  ForgetItem(item, &forgotten);
+
+  // Don't let album art that's still loading write to a deleted item.
+  QMap<quint64, ItemAndCacheKey>::iterator it = pending_art_.begin();
+  while (it != pending_art_.end()) {
+    if (forgotten.contains(it->first)) {
+      pending_cache_keys_.remove(it->second);
+      it = pending_art_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Special case the Various Artists node
+  if (item->parent->compilation_artist_node_ == item)
+    item->parent->compilation_artist_node_ = NULL;
+
+  LibraryItem* parent = item->parent;
+  const int row = item->row;
+  beginRemoveRows(ItemToIndex(parent), row, row);
+  parent->Delete(row);
+  endRemoveRows();
+}
+
+void LibraryModel::ForgetItem(LibraryItem* item,
+                              QSet<LibraryItem*>* forgotten) {
+  forgotten->insert(item);
+
+  switch (item->type) {
+    case LibraryItem::Type_Song:
+      if (song_nodes_.value(item->metadata.id()) == item)
+        song_nodes_.remove(item->metadata.id());
+      break;
+
+    case LibraryItem::Type_Container:
+      if (item->container_level >= 0 && item->container_level < 3 &&
+          container_nodes_[item->container_level].value(item->key) == item)
+        container_nodes_[item->container_level].remove(item->key);
+      break;
+
+    default:
+      break;
+  }
+
+  foreach (LibraryItem* child, item->children) {
+    ForgetItem(child, forgotten);
+  }
+}
+
+void LibraryModel::ClearChildrenAtLevel(LibraryItem* parent, int level) {
+  if (!parent->lazy_loaded)
+    return;
+
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  if (child_level < level) {
+    foreach (LibraryItem* child, parent->children) {
+      if (child->type == LibraryItem::Type_Container)
+        ClearChildrenAtLevel(child, level);
+    }
+    return;
+  }
+
+  // Throw the children away - they'll be lazy-loaded again next time the
+  // container is expanded.
+  while (!parent->children.isEmpty()) {
+    RemoveItem(parent->children.last());
+  }
+  parent->lazy_loaded = false;
+}
+
+void LibraryModel::IndexSong(SongIndex* index, int id, bool compilation,
+                             const SqlRowList& rows) const {
+  SongIndex::Entry entry;
+  for (int i=0 ; i<3 ; ++i) {
+    entry.keys[i] = kVariousArtistsKey;
+    if (i >= rows.count())
+      continue;
+
+    // Compilations go under the Various artists node instead.
+    const GroupBy type = index->grouping[i];
+    if (IsArtistGroupBy(type) && compilation)
+      continue;
+
+    const QString key = ContainerKey(type, rows[i]);
+    QHash<QString, int>::const_iterator it = index->key_ids[i].constFind(key);
+    if (it != index->key_ids[i].constEnd()) {
+      entry.keys[i] = it.value();
+    } else {
+      entry.keys[i] = index->rows[i].count();
+      index->key_ids[i].insert(key, entry.keys[i]);
+      index->rows[i] << rows[i];
+    }
+  }
+  index->songs[id] = entry;
+}
+
+void LibraryModel::UpdateIndex(SongIndex* index, const SongList& songs,
+                               bool added) const {
+  foreach (const Song& song, songs) {
+    if (!added) {
+      index->songs.remove(song.id());
+      continue;
+    }
+
+    SqlRowList rows;
+    for (int i=0 ; i<3 && index->grouping[i] != GroupBy_None ; ++i) {
+      rows << GroupByRow(index->grouping[i], song);
+    }
+    IndexSong(index, song.id(), song.is_compilation(), rows);
+  }
+}
+
+void LibraryModel::UpdateIndex(const SongList& songs, bool added) {
+  if (song_index_)
+    UpdateIndex(song_index_.get(), songs, added);
+
+  // An index being built in the background might have missed these.
+  if (pending_index_builds_)
+    missed_index_updates_ << qMakePair(added, songs);
+}
+
 void LibraryModel::InitQuery(GroupBy type, LibraryQuery* q) {
   // Say what type of thing we want to get back from the database.
+  if (type == GroupBy_None)
+    q->SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+  else
+    q->SetColumnSpec("DISTINCT " + GroupByColumns(type));
+}
+
+QString LibraryModel::GroupByColumns(GroupBy type) {
   switch (type) {
-  case GroupBy_Artist:
-    q->SetColumnSpec("DISTINCT artist");
-    break;
-  case GroupBy_Album:
-    q->SetColumnSpec("DISTINCT album");
+  case GroupBy_Artist:      return "artist";
+  case GroupBy_Album:       return "album";
+  case GroupBy_Composer:    return "composer";
+  case GroupBy_YearAlbum:   return "year, album";
+  case GroupBy_Year:        return "year";
+  case GroupBy_Genre:       return "genre";
+  case GroupBy_AlbumArtist: return "effective_albumartist";
+  case GroupBy_FileType:    return "filetype";
+  case GroupBy_None:
     break;
-  case GroupBy_Composer:
-    q->SetColumnSpec("DISTINCT composer");
+  }
+  qLog(Error) << "Unknown GroupBy type" << type << "has no columns";
+  return QString();
+}
+
+SqlRow LibraryModel::GroupByRow(GroupBy type, const Song& song) {
+  // The same columns GroupByColumns would have fetched for this song.
+  QList<QVariant> columns;
+  switch (type) {
+  case GroupBy_Artist:      columns << song.artist(); break;
+  case GroupBy_Album:       columns << song.album(); break;
+  case GroupBy_Composer:    columns << song.composer(); break;
+  case GroupBy_YearAlbum:   columns << song.year() << song.album(); break;
+  case GroupBy_Year:        columns << song.year(); break;
+  case GroupBy_Genre:       columns << song.genre(); break;
+  case GroupBy_AlbumArtist: columns << song.effective_albumartist(); break;
+  case GroupBy_FileType:    columns << int(song.filetype()); break;
+  case GroupBy_None:
     break;
+  }
+  return SqlRow(columns);
+}
+
+QString LibraryModel::ContainerKey(GroupBy type, const SqlRow& row) {
+  // This has to give the same key that ItemFromQuery gives the container.
+  switch (type) {
   case GroupBy_YearAlbum:
-    q->SetColumnSpec("DISTINCT year, album");
-    break;
+    return PrettyYearAlbum(qMax(0, row.value(0).toInt()),
+                           row.value(1).toString());
   case GroupBy_Year:
-    q->SetColumnSpec("DISTINCT year");
-    break;
+    return QString::number(qMax(0, row.value(0).toInt()));
+  case GroupBy_FileType:
+    return Song::TextForFiletype(Song::FileType(row.value(0).toInt()));
+  case GroupBy_Artist:
+  case GroupBy_Album:
+  case GroupBy_Composer:
   case GroupBy_Genre:
-    q->SetColumnSpec("DISTINCT genre");
-    break;
   case GroupBy_AlbumArtist:
-    q->SetColumnSpec("DISTINCT effective_albumartist");
-    break;
+    return row.value(0).toString();
   case GroupBy_None:
-    q->SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-    break;
-  case GroupBy_FileType:
-    q->SetColumnSpec("DISTINCT filetype");
     break;
   }
+  return QString();
 }
 
 void LibraryModel::FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q) {
@@ -783,6 +1356,73 @@ void LibraryModel::FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q)
   }
 }
 
+LibraryCatalogue::FieldList LibraryModel::CatalogueFields(GroupBy type) {
+  LibraryCatalogue::FieldList fields;
+  switch (type) {
+  case GroupBy_Artist:      fields << LibraryCatalogue::Field_Artist; break;
+  case GroupBy_Album:       fields << LibraryCatalogue::Field_Album; break;
+  case GroupBy_Composer:    fields << LibraryCatalogue::Field_Composer; break;
+  case GroupBy_YearAlbum:   fields << LibraryCatalogue::Field_Year
+                                   << LibraryCatalogue::Field_Album; break;
+  case GroupBy_Year:        fields << LibraryCatalogue::Field_Year; break;
+  case GroupBy_Genre:       fields << LibraryCatalogue::Field_Genre; break;
+  case GroupBy_AlbumArtist: fields << LibraryCatalogue::Field_AlbumArtist; break;
+  case GroupBy_FileType:    fields << LibraryCatalogue::Field_FileType; break;
+  case GroupBy_None:
+    break;
+  }
+  return fields;
+}
+
+void LibraryModel::FilterCatalogue(
+    GroupBy type, LibraryItem* item,
+    LibraryCatalogue::ConstraintList* constraints) {
+  typedef LibraryCatalogue::Constraint C;
+
+  // This has to match FilterQuery.
+  switch (type) {
+  case GroupBy_Artist:
+    if (IsCompilationArtistNode(item)) {
+      *constraints << C(LibraryCatalogue::Field_Compilation, 1);
+    } else {
+      *constraints << C(LibraryCatalogue::Field_Compilation, 0)
+                   << C(LibraryCatalogue::Field_Artist, item->key);
+    }
+    break;
+  case GroupBy_Album:
+    *constraints << C(LibraryCatalogue::Field_Album, item->key);
+    break;
+  case GroupBy_YearAlbum:
+    *constraints << C(LibraryCatalogue::Field_Year, item->metadata.year())
+                 << C(LibraryCatalogue::Field_Album, item->metadata.album());
+    break;
+  case GroupBy_Year:
+    *constraints << C(LibraryCatalogue::Field_Year, item->key.toInt());
+    break;
+  case GroupBy_Composer:
+    *constraints << C(LibraryCatalogue::Field_Composer, item->key);
+    break;
+  case GroupBy_Genre:
+    *constraints << C(LibraryCatalogue::Field_Genre, item->key);
+    break;
+  case GroupBy_AlbumArtist:
+    if (IsCompilationArtistNode(item)) {
+      *constraints << C(LibraryCatalogue::Field_Compilation, 1);
+    } else {
+      *constraints << C(LibraryCatalogue::Field_Compilation, 0)
+                   << C(LibraryCatalogue::Field_AlbumArtist, item->key);
+    }
+    break;
+  case GroupBy_FileType:
+    *constraints << C(LibraryCatalogue::Field_FileType,
+                      int(item->metadata.filetype()));
+    break;
+  case GroupBy_None:
+    qLog(Error) << "Unknown GroupBy type" << type << "used in filter";
+    break;
+  }
+}
+
 LibraryItem* LibraryModel::InitItem(GroupBy type, bool signal, LibraryItem *parent,
                                int container_level) {
   LibraryItem::Type item_type =
@@ -1094,17 +1734,17 @@ SongList LibraryModel::GetChildSongs(const QModelIndex &index) const {
 
 void LibraryModel::SetFilterAge(int age) {
   query_options_.set_max_age(age);
-  ResetAsync();
+  UpdateFilterAsync();
 }
 
 void LibraryModel::SetFilterText(const QString& text) {
   query_options_.set_filter(text);
-  ResetAsync();
+  UpdateFilterAsync();
 }
 
 void LibraryModel::SetFilterQueryMode(QueryOptions::QueryMode query_mode) {
   query_options_.set_query_mode(query_mode);
-  ResetAsync();
+  UpdateFilterAsync();
 }
 
 bool LibraryModel::canFetchMore(const QModelIndex &parent) const {
@@ -1116,9 +1756,25 @@ bool LibraryModel::canFetchMore(const QModelIndex &parent) const {
 }
 
 void LibraryModel::SetGroupBy(const Grouping& g) {
+  const Grouping old_group_by = group_by_;
   group_by_ = g;
 
-  ResetAsync();
+  if (old_group_by[0] != g[0]) {
+    // Every top level item is different so there's nothing to diff against.
+    song_index_.reset();
+    ResetAsync();
+  } else {
+    // Keep the top level and throw away anything below the first level that
+    // changed.  The index is rebuilt for the new grouping in the background.
+    int level = 1;
+    while (level < 3 && old_group_by[level] == g[level])
+      level ++;
+    if (level < 3)
+      ClearChildrenAtLevel(root_, level);
+
+    UpdateFilterAsync();
+  }
+
   emit GroupingChanged(g);
 }
 
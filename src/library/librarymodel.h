@@ -19,8 +19,11 @@
 #define LIBRARYMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QIcon>
+#include <QMap>
 
+#include "librarycatalogue.h"
 #include "libraryitem.h"
 #include "libraryquery.h"
 #include "librarywatcher.h"
@@ -33,6 +36,7 @@
 #include "smartplaylists/generator_fwd.h"
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 class Application;
 class AlbumCoverLoader;
@@ -56,6 +60,8 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   static const char* kSmartPlaylistsArray;
   static const int kSmartPlaylistsVersion;
   static const int kPrettyCoverSize;
+  static const int kSlowQueryMsec;
+  static const int kVariousArtistsKey;
 
   enum Role {
     Role_Type = Qt::UserRole + 1,
@@ -111,6 +117,39 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
     bool create_va;
   };
 
+  // Which container every song in the library lives in at each level of a
+  // Grouping, so filter changes can be applied to the tree as a diff instead
+  // of rebuilding it.  Containers are interned per level - a song stores an
+  // index into rows[level], or kVariousArtistsKey.
+  struct SongIndex {
+    struct Entry {
+      int keys[3];
+    };
+
+    Grouping grouping;
+    QHash<int, Entry> songs;
+
+    QHash<QString, int> key_ids[3];
+    SqlRowList rows[3];
+  };
+  typedef boost::shared_ptr<SongIndex> SongIndexPtr;
+
+  struct FilterResult {
+    FilterResult() : generation(0), index_requested(false) {}
+
+    int generation;
+    QList<int> song_ids;
+
+    // Whether the index had to be rebuilt for a new grouping.  index is left
+    // empty if the catalogue wasn't ready to build it from.
+    bool index_requested;
+    SongIndexPtr index;
+
+    // Songs that have to be added under containers that are already
+    // expanded, loaded in the background before the tree is changed.
+    SongList new_songs;
+  };
+
   LibraryBackend* backend() const { return backend_; }
   LibraryDirectoryModel* directory_model() const { return dir_model_; }
 
@@ -121,6 +160,7 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   void set_show_smart_playlists(bool show_smart_playlists) { show_smart_playlists_ = show_smart_playlists; }
   void set_default_smart_playlists(const DefaultGenerators& defaults) { default_smart_playlists_ = defaults; }
   void set_show_various_artists(bool show_various_artists) { show_various_artists_ = show_various_artists; }
+  void set_catalogue(LibraryCatalogue* catalogue) { catalogue_ = catalogue; }
 
   // Get information about the library
   void GetChildSongs(LibraryItem* item, QList<QUrl>* urls, SongList* songs,
@@ -187,6 +227,10 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   // Called after ResetAsync
   void ResetAsyncQueryFinished();
 
+  // Called after UpdateFilterAsync
+  void FilterQueryFinished();
+  void FilterSongsLoaded();
+
   void AlbumArtLoaded(quint64 id, const QImage& image);
 
  private:
@@ -194,20 +238,70 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   // This gets called a lot when filtering the playlist, so it's nice to be
   // able to do it in a background thread.
   QueryResult RunQuery(LibraryItem* parent);
+  bool RunCatalogueQuery(LibraryItem* parent, GroupBy child_type,
+                         QueryResult* result);
   void PostQuery(LibraryItem* parent, const QueryResult& result, bool signal);
 
   bool HasCompilations(const LibraryQuery& query);
 
   void BeginReset();
 
+  // Filter and grouping changes run the filter in a background thread, then
+  // insert and remove just the rows that changed.
+  void UpdateFilterAsync();
+  FilterResult RunFilterQuery(const QueryOptions& options,
+                              const Grouping& grouping, bool build_index,
+                              int generation);
+  SongIndexPtr BuildIndex(const Grouping& grouping) const;
+  FilterResult LoadFilterSongs(FilterResult result, const QList<int>& ids);
+  bool FilterResultIsCurrent(const FilterResult& result);
+  void ApplyFilterResult(const FilterResult& result);
+
+  // Splits song_ids by the container they belong in at this level, and finds
+  // the existing child container for one of those.
+  QMap<int, QList<int> > SongsByContainer(int level,
+                                          const QList<int>& song_ids) const;
+  QMap<int, QList<int> >::iterator FindContainer(
+      LibraryItem* child, int level, QMap<int, QList<int> >* containers) const;
+
+  // Adds the songs that ApplyFilter will need to create under containers that
+  // are already expanded to missing_ids.
+  void FindMissingSongs(LibraryItem* parent, int level,
+                        const QList<int>& song_ids, QList<int>* missing_ids) const;
+  void ApplyFilter(LibraryItem* parent, int level, const QList<int>& song_ids,
+                   const QHash<int, Song>& new_songs);
+  void ApplyFilterToSongs(LibraryItem* parent, const QList<int>& song_ids,
+                          const QHash<int, Song>& new_songs);
+  void UpdateSmartPlaylistNode();
+  void RemoveEmptyDividers();
+
+  // Removes an item and everything under it from the model and the lookups.
+  void RemoveItem(LibraryItem* item);
+  void ForgetItem(LibraryItem* item, QSet<LibraryItem*>* forgotten);
+  void ClearChildrenAtLevel(LibraryItem* parent, int level);
+
+  // Keep song_index_ up to date with changes from the backend.
+  void IndexSong(SongIndex* index, int id, bool compilation,
+                 const SqlRowList& rows) const;
+  void UpdateIndex(SongIndex* index, const SongList& songs, bool added) const;
+  void UpdateIndex(const SongList& songs, bool added);
+
   // Functions for working with queries and creating items.
   // When the model is reset or when a node is lazy-loaded the Library
   // constructs a database query to populate the items.  Filters are added
   // for each parent item, restricting the songs returned to a particular
   // album or artist for example.
   static void InitQuery(GroupBy type, LibraryQuery* q);
+  static QString GroupByColumns(GroupBy type);
+  static SqlRow GroupByRow(GroupBy type, const Song& song);
+  static QString ContainerKey(GroupBy type, const SqlRow& row);
   void FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q);
 
+  // The same again for queries answered by the catalogue.
+  static LibraryCatalogue::FieldList CatalogueFields(GroupBy type);
+  static void FilterCatalogue(GroupBy type, LibraryItem* item,
+                              LibraryCatalogue::ConstraintList* constraints);
+
   // Items can be created either from a query that's been run to populate a
   // node, or by a spontaneous SongsDiscovered emission from the backend.
   LibraryItem* ItemFromQuery(GroupBy type, bool signal, bool create_divider,
@@ -247,6 +341,7 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   bool show_smart_playlists_;
   DefaultGenerators default_smart_playlists_;
   bool show_various_artists_;
+  LibraryCatalogue* catalogue_;
 
   int total_song_count_;
 
@@ -280,6 +375,14 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
 
   AlbumCoverLoaderOptions cover_loader_options_;
 
+  SongIndexPtr song_index_;
+  int filter_generation_;
+
+  // Changes from the backend that arrived while an index was being built in
+  // the background, replayed onto it when it's ready.
+  int pending_index_builds_;
+  QList<QPair<bool, SongList> > missed_index_updates_;
+
   typedef QPair<LibraryItem*, QString> ItemAndCacheKey;
   QMap<quint64, ItemAndCacheKey> pending_art_;
   QSet<QString> pending_cache_keys_;
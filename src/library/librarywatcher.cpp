@@ -46,6 +46,9 @@
 QStringList LibraryWatcher::sValidImages;
 
 const char* LibraryWatcher::kSettingsGroup = "LibraryWatcher";
+const int LibraryWatcher::kReadBatchSize = 16;
+const int LibraryWatcher::kMaxPendingReadsPerWorker = 2;
+const int LibraryWatcher::kCommitBatchSize = 1000;
 
 LibraryWatcher::LibraryWatcher(QObject* parent)
   : QObject(parent),
@@ -83,7 +86,8 @@ LibraryWatcher::ScanTransaction::ScanTransaction(LibraryWatcher* watcher, int di
     ignores_mtime_(ignores_mtime),
     watcher_(watcher),
     cached_songs_dirty_(true),
-    known_subdirs_dirty_(true)
+    known_subdirs_dirty_(true),
+    max_pending_reads_(kMaxPendingReadsPerWorker * QThread::idealThreadCount())
 {
   QString description;
   if (watcher_->device_name_.isEmpty())
@@ -97,24 +101,63 @@ LibraryWatcher::ScanTransaction::ScanTransaction(LibraryWatcher* watcher, int di
 
 LibraryWatcher::ScanTransaction::~ScanTransaction() {
   // If we're stopping then don't commit the transaction
-  if (watcher_->stop_requested_) return;
+  if (watcher_->stop_requested_) {
+    // The replies might still be in flight - delete them when they arrive.
+    foreach (const PendingRead& read, pending_reads_) {
+      QObject::connect(read.reply_, SIGNAL(Finished(bool)),
+                       read.reply_, SLOT(deleteLater()));
+      if (read.reply_->is_finished())
+        read.reply_->deleteLater();
+    }
+    return;
+  }
+
+  CommitScanChanges();
+
+  watcher_->task_manager_->SetTaskFinished(task_id_);
+}
+
+void LibraryWatcher::ScanTransaction::CommitScanChanges() {
+  // Finish reading any outstanding files first, so a subdirectory is never
+  // committed before the songs inside it.
+  WaitForPendingReads();
+
+  // Subdirectories found during this batch are journaled before their
+  // parents are committed, so they're not forgotten if we're interrupted.
+  if (!journal_added_.isEmpty()) {
+    SubdirectoryList added;
+    foreach (const Subdirectory& subdir, journal_added_) {
+      if (unwritten_journal_paths_.remove(subdir.path))
+        added << subdir;
+    }
+    journal_added_.clear();
+
+    if (!added.isEmpty())
+      emit watcher_->ScanJournalAdded(added, ignores_mtime_);
+  }
 
-  if (!new_songs.isEmpty())
+  if (!new_songs.isEmpty()) {
     emit watcher_->NewOrUpdatedSongs(new_songs);
+    new_songs.clear();
+  }
 
-  if (!touched_songs.isEmpty())
+  if (!touched_songs.isEmpty()) {
     emit watcher_->SongsMTimeUpdated(touched_songs);
+    touched_songs.clear();
+  }
 
-  if (!deleted_songs.isEmpty())
+  if (!deleted_songs.isEmpty()) {
     emit watcher_->SongsDeleted(deleted_songs);
+    deleted_songs.clear();
+  }
 
   if (!new_subdirs.isEmpty())
     emit watcher_->SubdirsDiscovered(new_subdirs);
 
-  if (!touched_subdirs.isEmpty())
+  if (!touched_subdirs.isEmpty()) {
     emit watcher_->SubdirsMTimeUpdated(touched_subdirs);
-
-  watcher_->task_manager_->SetTaskFinished(task_id_);
+    touched_subdirs.clear();
+  }
 
   if (watcher_->monitor_) {
     // Watch the new subdirectories
@@ -122,6 +165,128 @@ LibraryWatcher::ScanTransaction::~ScanTransaction() {
       watcher_->AddWatch(watcher_->watched_dirs_[dir_], subdir.path);
     }
   }
+  new_subdirs.clear();
+
+  if (!journal_removed_.isEmpty()) {
+    emit watcher_->ScanJournalRemoved(journal_removed_);
+    journal_removed_.clear();
+  }
+}
+
+void LibraryWatcher::ScanTransaction::AddToJournal(const QString& path) {
+  if (journaled_paths_.contains(path))
+    return;
+  journaled_paths_.insert(path);
+  unwritten_journal_paths_.insert(path);
+
+  Subdirectory subdir;
+  subdir.directory_id = dir_;
+  subdir.path = path;
+  journal_added_ << subdir;
+}
+
+void LibraryWatcher::ScanTransaction::RemoveFromJournal(const QString& path) {
+  // Most subdirectories scanned by a rescan were never journaled - don't
+  // delete rows that aren't there.
+  if (!journaled_paths_.remove(path))
+    return;
+
+  // If it hasn't been written to the database yet then just forget about it.
+  if (unwritten_journal_paths_.remove(path))
+    return;
+
+  Subdirectory subdir;
+  subdir.directory_id = dir_;
+  subdir.path = path;
+  journal_removed_ << subdir;
+}
+
+void LibraryWatcher::ScanTransaction::SetJournaled(
+    const SubdirectoryList& subdirs) {
+  foreach (const Subdirectory& subdir, subdirs) {
+    journaled_paths_.insert(subdir.path);
+  }
+}
+
+void LibraryWatcher::ScanTransaction::CommitScanChangesIfNeeded() {
+  if (new_songs.count() + touched_songs.count() + deleted_songs.count() +
+      unsent_files_.count() + pending_reads_.count() * kReadBatchSize >=
+      kCommitBatchSize) {
+    CommitScanChanges();
+  }
+}
+
+void LibraryWatcher::ScanTransaction::ReadFileAsync(
+    const QString& file, const QString& image, const Song& matching_song) {
+  PendingFile pending_file;
+  pending_file.file_ = file;
+  pending_file.image_ = image;
+  pending_file.matching_song_ = matching_song;
+  unsent_files_ << pending_file;
+
+  if (unsent_files_.count() >= kReadBatchSize) {
+    SendUnsentFiles();
+    WaitForPendingReads(max_pending_reads_);
+  }
+}
+
+void LibraryWatcher::ScanTransaction::SendUnsentFiles() {
+  if (unsent_files_.isEmpty())
+    return;
+
+  QStringList filenames;
+  foreach (const PendingFile& pending_file, unsent_files_) {
+    filenames << pending_file.file_;
+  }
+
+  PendingRead read;
+  read.reply_ = TagReaderClient::Instance()->ReadFiles(filenames);
+  read.files_ = unsent_files_;
+  pending_reads_.enqueue(read);
+
+  unsent_files_.clear();
+}
+
+void LibraryWatcher::ScanTransaction::WaitForPendingReads(int max_pending) {
+  if (max_pending == 0)
+    SendUnsentFiles();
+
+  while (pending_reads_.count() > max_pending) {
+    PendingRead read = pending_reads_.dequeue();
+    if (read.reply_->WaitForFinished()) {
+      ProcessRead(read);
+    }
+    read.reply_->deleteLater();
+  }
+}
+
+void LibraryWatcher::ScanTransaction::ProcessRead(const PendingRead& read) {
+  const pb::tagreader::ReadFilesResponse& response =
+      read.reply_->message().read_files_response();
+
+  for (int i=0 ; i<read.files_.count() && i<response.metadata_size() ; ++i) {
+    ProcessFile(read.files_[i], response.metadata(i));
+  }
+}
+
+void LibraryWatcher::ScanTransaction::ProcessFile(
+    const PendingFile& file, const pb::tagreader::SongMetadata& metadata) {
+  Song song;
+  song.set_directory_id(dir_);
+  song.InitFromProtobuf(metadata);
+
+  if (!song.is_valid())
+    return;
+
+  if (file.matching_song_.is_valid()) {
+    watcher_->PreserveUserSetData(file.file_, file.image_, file.matching_song_,
+                                  &song, this);
+  } else {
+    qLog(Debug) << file.file_ << "created";
+    if (song.art_automatic().isEmpty())
+      song.set_art_automatic(file.image_);
+    new_songs << song;
+  }
 }
 
 void LibraryWatcher::ScanTransaction::AddToProgress(int n) {
@@ -136,48 +301,44 @@ void LibraryWatcher::ScanTransaction::AddToProgressMax(int n) {
 
 SongList LibraryWatcher::ScanTransaction::FindSongsInSubdirectory(const QString &path) {
   if (cached_songs_dirty_) {
-    cached_songs_ = watcher_->backend_->FindSongsInDirectory(dir_);
+    cached_songs_.clear();
+    foreach (const Song& song, watcher_->backend_->FindSongsInDirectory(dir_)) {
+      cached_songs_[song.url().toLocalFile().section('/', 0, -2)] << song;
+    }
     cached_songs_dirty_ = false;
   }
 
-  // TODO: Make this faster
-  SongList ret;
-  foreach (const Song& song, cached_songs_) {
-    if (song.url().toLocalFile().section('/', 0, -2) == path)
-      ret << song;
-  }
-  return ret;
+  return cached_songs_.value(path);
 }
 
 void LibraryWatcher::ScanTransaction::SetKnownSubdirs(const SubdirectoryList &subdirs) {
   known_subdirs_ = subdirs;
   known_subdirs_dirty_ = false;
+
+  known_subdir_paths_.clear();
+  known_subdirs_by_parent_.clear();
+  foreach (const Subdirectory& subdir, known_subdirs_) {
+    if (subdir.mtime == 0)
+      continue;
+
+    known_subdir_paths_.insert(subdir.path);
+    known_subdirs_by_parent_.insert(
+          subdir.path.left(subdir.path.lastIndexOf(QDir::separator())), subdir);
+  }
 }
 
 bool LibraryWatcher::ScanTransaction::HasSeenSubdir(const QString &path) {
   if (known_subdirs_dirty_)
     SetKnownSubdirs(watcher_->backend_->SubdirsInDirectory(dir_));
 
-  foreach (const Subdirectory& subdir, known_subdirs_) {
-    if (subdir.path == path && subdir.mtime != 0)
-      return true;
-  }
-  return false;
+  return known_subdir_paths_.contains(path);
 }
 
 SubdirectoryList LibraryWatcher::ScanTransaction::GetImmediateSubdirs(const QString &path) {
   if (known_subdirs_dirty_)
     SetKnownSubdirs(watcher_->backend_->SubdirsInDirectory(dir_));
 
-  SubdirectoryList ret;
-  foreach (const Subdirectory& subdir, known_subdirs_) {
-    if (subdir.path.left(subdir.path.lastIndexOf(QDir::separator())) == path &&
-        subdir.mtime != 0) {
-      ret << subdir;
-    }
-  }
-
-  return ret;
+  return known_subdirs_by_parent_.values(path);
 }
 
 SubdirectoryList LibraryWatcher::ScanTransaction::GetAllSubdirs() {
@@ -189,12 +350,47 @@ SubdirectoryList LibraryWatcher::ScanTransaction::GetAllSubdirs() {
 void LibraryWatcher::AddDirectory(const Directory& dir, const SubdirectoryList& subdirs) {
   watched_dirs_[dir.id] = dir;
 
+  // Finish any scan of this directory that was interrupted last time.
+  QSet<QString> resumed_paths;
+  bool resume_ignores_mtime = false;
+  const SubdirectoryList unfinished =
+      backend_->GetScanJournal(dir.id, &resume_ignores_mtime);
+  if (!unfinished.isEmpty()) {
+    qLog(Info) << "Resuming interrupted scan of" << dir.path << "-"
+               << unfinished.count() << "subdirectories left";
+
+    QHash<QString, Subdirectory> known_subdirs;
+    foreach (const Subdirectory& subdir, subdirs) {
+      known_subdirs[subdir.path] = subdir;
+    }
+
+    // Subdirectories are only committed after the songs in them, so the ones
+    // whose mtime is up to date were finished before we were interrupted.
+    // The others, and the ones that were never committed, are scanned again.
+    ScanTransaction transaction(this, dir.id, true, resume_ignores_mtime);
+    transaction.SetKnownSubdirs(subdirs);
+    transaction.SetJournaled(unfinished);
+    transaction.AddToProgressMax(unfinished.count());
+    foreach (const Subdirectory& subdir, unfinished) {
+      if (stop_requested_) return;
+      if (resumed_paths.contains(subdir.path)) {
+        transaction.AddToProgress(1);
+        continue;
+      }
+      resumed_paths.insert(subdir.path);
+
+      ScanSubdirectory(subdir.path, known_subdirs.value(subdir.path),
+                       &transaction);
+    }
+  }
+
   if (subdirs.isEmpty()) {
     // This is a new directory that we've never seen before.
     // Scan it fully.
     ScanTransaction transaction(this, dir.id, false);
     transaction.SetKnownSubdirs(subdirs);
     transaction.AddToProgressMax(1);
+    transaction.AddToJournal(dir.path);
     ScanSubdirectory(dir.path, Subdirectory(), &transaction);
   } else {
     // We can do an incremental scan - looking at the mtimes of each
@@ -202,10 +398,11 @@ void LibraryWatcher::AddDirectory(const Directory& dir, const SubdirectoryList&
     ScanTransaction transaction(this, dir.id, true);
     transaction.SetKnownSubdirs(subdirs);
     transaction.AddToProgressMax(subdirs.count());
+
     foreach (const Subdirectory& subdir, subdirs) {
       if (stop_requested_) return;
 
-      if (scan_on_startup_)
+      if (scan_on_startup_ && !resumed_paths.contains(subdir.path))
         ScanSubdirectory(subdir.path, subdir, &transaction);
 
       if (monitor_)
@@ -226,6 +423,7 @@ void LibraryWatcher::ScanSubdirectory(
     QString real_path = path_info.symLinkTarget();
     foreach (const Directory& dir, watched_dirs_) {
       if (real_path.startsWith(dir.path)) {
+        t->RemoveFromJournal(path);
         t->AddToProgress(1);
         return;
       }
@@ -235,10 +433,15 @@ void LibraryWatcher::ScanSubdirectory(
   if (!t->ignores_mtime() && !force_noincremental && t->is_incremental() &&
       subdir.mtime == path_info.lastModified().toTime_t()) {
     // The directory hasn't changed since last time
+    t->RemoveFromJournal(path);
     t->AddToProgress(1);
     return;
   }
 
+  // An incremental scan only journals the subdirectories that have changed -
+  // the others will be looked at again anyway if we're interrupted.
+  t->AddToJournal(path);
+
   QMap<QString, QStringList> album_art;
   QStringList files_on_disk;
   SubdirectoryList my_new_subdirs;
@@ -289,6 +492,7 @@ void LibraryWatcher::ScanSubdirectory(
 
   // Ask the database for a list of files in this directory
   SongList songs_in_db = t->FindSongsInSubdirectory(path);
+  QHash<QString, Song> songs_in_db_by_path = SongsByPath(songs_in_db);
 
   QSet<QString> cues_processed;
 
@@ -300,7 +504,7 @@ void LibraryWatcher::ScanSubdirectory(
     QString matching_cue = NoExtensionPart(file) + ".cue";
 
     Song matching_song;
-    if (FindSongByPath(songs_in_db, file, &matching_song)) {
+    if (FindSongByPath(songs_in_db_by_path, file, &matching_song)) {
       uint matching_cue_mtime = GetMtimeForCue(matching_cue);
 
       // The song is in the database and still on disk.
@@ -349,7 +553,13 @@ void LibraryWatcher::ScanSubdirectory(
       }
     } else {
       // The song is on disk but not in the DB
-      SongList song_list = ScanNewFile(file, path, matching_cue, &cues_processed);
+      if (!GetMtimeForCue(matching_cue)) {
+        // A normal media file - its tags are read in the background.
+        t->ReadFileAsync(file, ImageForSong(file, album_art), Song());
+        continue;
+      }
+
+      SongList song_list = ScanNewCueFile(file, path, matching_cue, &cues_processed);
 
       if(song_list.isEmpty()) {
         continue;
@@ -370,8 +580,9 @@ void LibraryWatcher::ScanSubdirectory(
   }
 
   // Look for deleted songs
+  const QSet<QString> files_on_disk_set = files_on_disk.toSet();
   foreach (const Song& song, songs_in_db) {
-    if (!song.is_unavailable() && !files_on_disk.contains(song.url().toLocalFile())) {
+    if (!song.is_unavailable() && !files_on_disk_set.contains(song.url().toLocalFile())) {
       qLog(Debug) << "Song deleted from disk:" << song.url().toLocalFile();
       t->deleted_songs << song;
     }
@@ -389,7 +600,13 @@ void LibraryWatcher::ScanSubdirectory(
   else
     t->touched_subdirs << updated_subdir;
 
+  t->RemoveFromJournal(path);
+  foreach (const Subdirectory& my_new_subdir, my_new_subdirs) {
+    t->AddToJournal(my_new_subdir.path);
+  }
+
   t->AddToProgress(1);
+  t->CommitScanChangesIfNeeded();
 
   // Recurse into the new subdirs that we found
   t->AddToProgressMax(my_new_subdirs.count());
@@ -452,56 +669,82 @@ void LibraryWatcher::UpdateNonCueAssociatedSong(const QString& file, const Song&
     }
   }
 
-  Song song_on_disk;
-  song_on_disk.set_directory_id(t->dir());
-  TagReaderClient::Instance()->ReadFileBlocking(file, &song_on_disk);
-
-  if(song_on_disk.is_valid()) {
-    PreserveUserSetData(file, image, matching_song, &song_on_disk, t);
-  }
+  t->ReadFileAsync(file, image, matching_song);
 }
 
-SongList LibraryWatcher::ScanNewFile(const QString& file, const QString& path,
+SongList LibraryWatcher::ScanNewCueFile(const QString& file, const QString& path,
                                      const QString& matching_cue, QSet<QString>* cues_processed) {
   SongList song_list;
 
-  uint matching_cue_mtime = GetMtimeForCue(matching_cue);
-  // if it's a cue - create virtual tracks
-  if(matching_cue_mtime) {
-    // don't process the same cue many times
-    if(cues_processed->contains(matching_cue))
-      return song_list;
-
-    QFile cue(matching_cue);
-    cue.open(QIODevice::ReadOnly);
-
-    // Ignore FILEs pointing to other media files. Also, watch out for incorrect
-    // media files. Playlist parser for CUEs considers every entry in sheet
-    // valid and we don't want invalid media getting into library!
-    foreach(const Song& cue_song, cue_parser_->Load(&cue, matching_cue, path)) {
-      if (cue_song.url().toLocalFile() == file) {
-        if (TagReaderClient::Instance()->IsMediaFileBlocking(file)) {
-          song_list << cue_song;
-        }
+  // don't process the same cue many times
+  if(cues_processed->contains(matching_cue))
+    return song_list;
+
+  QFile cue(matching_cue);
+  cue.open(QIODevice::ReadOnly);
+
+  // Ignore FILEs pointing to other media files. Also, watch out for incorrect
+  // media files. Playlist parser for CUEs considers every entry in sheet
+  // valid and we don't want invalid media getting into library!
+  foreach(const Song& cue_song, cue_parser_->Load(&cue, matching_cue, path)) {
+    if (cue_song.url().toLocalFile() == file) {
+      if (TagReaderClient::Instance()->IsMediaFileBlocking(file)) {
+        song_list << cue_song;
       }
     }
+  }
 
-    if(!song_list.isEmpty()) {
-      *cues_processed << matching_cue;
-    }
+  if(!song_list.isEmpty()) {
+    *cues_processed << matching_cue;
+  }
 
-  // it's a normal media file
-  } else {
-    Song song;
-    TagReaderClient::Instance()->ReadFileBlocking(file, &song);
+  return song_list;
+}
+
+bool LibraryWatcher::ScanFile(const QString& file, const SongList& songs_in_db,
+                              QMap<QString, QStringList>* album_art,
+                              ScanTransaction* t) {
+  const QString ext_part(ExtensionPart(file));
+  const QString dir_part(DirectoryPart(file));
+
+  // Album art and CUE sheets affect the other songs in the directory.
+  if (sValidImages.contains(ext_part) || ext_part == "cue" ||
+      GetMtimeForCue(NoExtensionPart(file) + ".cue")) {
+    return false;
+  }
 
-    if (song.is_valid()) {
-      song_list << song;
+  foreach (const Song& song, songs_in_db) {
+    if (song.has_cue())
+      return false;
+  }
+  const Song matching_song = songs_in_db.isEmpty() ? Song() : songs_in_db.first();
+
+  QFileInfo file_info(file);
+  if (!file_info.exists()) {
+    if (matching_song.is_valid() && !matching_song.is_unavailable()) {
+      qLog(Debug) << "Song deleted from disk:" << file;
+      t->deleted_songs << matching_song;
     }
+    return true;
+  }
 
+  if (file_info.isHidden())
+    return true;
+
+  // Find the album art in this directory, unless another file in it has
+  // already done so.
+  if (!album_art->contains(dir_part)) {
+    QStringList& images = (*album_art)[dir_part];
+    QDirIterator it(dir_part, QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+      QString child(it.next());
+      if (sValidImages.contains(ExtensionPart(child)))
+        images << child;
+    }
   }
 
-  return song_list;
+  t->ReadFileAsync(file, ImageForSong(file, *album_art), matching_song);
+  return true;
 }
 
 void LibraryWatcher::PreserveUserSetData(const QString& file, const QString& image,
@@ -557,12 +800,21 @@ void LibraryWatcher::AddWatch(const Directory& dir, const QString& path) {
 
   connect(fs_watcher_, SIGNAL(PathChanged(const QString&)), this,
       SLOT(DirectoryChanged(const QString&)), Qt::UniqueConnection);
+  if (fs_watcher_->reports_file_events()) {
+    // Changed files can be rescanned one at a time instead of rescanning the
+    // whole subdirectory.
+    connect(fs_watcher_, SIGNAL(FileChanged(const QString&)), this,
+        SLOT(FileChanged(const QString&)), Qt::UniqueConnection);
+    connect(fs_watcher_, SIGNAL(FileDeleted(const QString&)), this,
+        SLOT(FileChanged(const QString&)), Qt::UniqueConnection);
+  }
   fs_watcher_->AddPath(path);
   subdir_mapping_[path] = dir;
 }
 
 void LibraryWatcher::RemoveDirectory(const Directory& dir) {
   rescan_queue_.remove(dir.id);
+  file_rescan_queue_.remove(dir.id);
   watched_dirs_.remove(dir.id);
 
   // Stop watching the directory's subdirectories
@@ -572,15 +824,25 @@ void LibraryWatcher::RemoveDirectory(const Directory& dir) {
   }
 }
 
-bool LibraryWatcher::FindSongByPath(const SongList& list, const QString& path, Song* out) {
-  // TODO: Make this faster
+QHash<QString, Song> LibraryWatcher::SongsByPath(const SongList& list) {
+  QHash<QString, Song> ret;
   foreach (const Song& song, list) {
-    if (song.url().toLocalFile() == path) {
-      *out = song;
-      return true;
-    }
+    // Keep the first song if a file has several CUE sections.
+    const QString path = song.url().toLocalFile();
+    if (!ret.contains(path))
+      ret[path] = song;
   }
-  return false;
+  return ret;
+}
+
+bool LibraryWatcher::FindSongByPath(const QHash<QString, Song>& songs,
+                                    const QString& path, Song* out) {
+  QHash<QString, Song>::const_iterator it = songs.constFind(path);
+  if (it == songs.constEnd())
+    return false;
+
+  *out = *it;
+  return true;
 }
 
 void LibraryWatcher::DirectoryChanged(const QString &subdir) {
@@ -601,6 +863,24 @@ void LibraryWatcher::DirectoryChanged(const QString &subdir) {
     rescan_timer_->start();
 }
 
+void LibraryWatcher::FileChanged(const QString& file) {
+  // Find what dir it was in
+  QHash<QString, Directory>::const_iterator it =
+      subdir_mapping_.constFind(DirectoryPart(file));
+  if (it == subdir_mapping_.constEnd()) {
+    return;
+  }
+  Directory dir = *it;
+
+  qLog(Debug) << "File" << file << "changed under directory" << dir.path << "id" << dir.id;
+
+  // Queue the file for rescanning
+  file_rescan_queue_[dir.id] << file;
+
+  if (!rescan_paused_)
+    rescan_timer_->start();
+}
+
 void LibraryWatcher::RescanPathsNow() {
   foreach (int dir, rescan_queue_.keys()) {
     if (stop_requested_) return;
@@ -617,7 +897,69 @@ void LibraryWatcher::RescanPathsNow() {
     }
   }
 
+  foreach (int dir, file_rescan_queue_.keys()) {
+    if (stop_requested_) return;
+    ScanTransaction transaction(this, dir, false);
+    transaction.AddToProgressMax(file_rescan_queue_[dir].count());
+
+    // Look all the files up in the database at once, skipping files in
+    // subdirectories that have just been rescanned anyway.
+    const QSet<QString> subdirs_rescanned = rescan_queue_.value(dir).toSet();
+    QList<QUrl> urls;
+    foreach (const QString& file, file_rescan_queue_[dir]) {
+      if (!subdirs_rescanned.contains(DirectoryPart(file)))
+        urls << QUrl::fromLocalFile(file);
+    }
+    QHash<QString, SongList> songs_in_db;
+    foreach (const Song& song, backend_->GetSongsByUrls(urls)) {
+      songs_in_db[song.url().toLocalFile()] << song;
+    }
+
+    QMap<QString, QStringList> album_art;
+    QSet<QString> subdirs_to_rescan;
+    QSet<QString> subdirs_touched;
+    foreach (const QString& file, file_rescan_queue_[dir]) {
+      if (stop_requested_) return;
+
+      const QString path = DirectoryPart(file);
+      if (!subdirs_rescanned.contains(path) &&
+          !subdirs_to_rescan.contains(path)) {
+        if (!ScanFile(file, songs_in_db.value(file), &album_art, &transaction)) {
+          subdirs_to_rescan << path;
+        } else {
+          subdirs_touched << path;
+        }
+      }
+      transaction.AddToProgress(1);
+    }
+
+    // File events don't go through ScanSubdirectory, so store the new mtime of
+    // their subdirectories here or the next incremental scan would redo them.
+    foreach (const QString& path, subdirs_touched) {
+      if (subdirs_to_rescan.contains(path))
+        continue;
+
+      const QFileInfo path_info(path);
+      Subdirectory subdir;
+      subdir.directory_id = dir;
+      subdir.mtime = path_info.exists() ? path_info.lastModified().toTime_t() : 0;
+      subdir.path = path;
+      transaction.touched_subdirs << subdir;
+    }
+
+    transaction.AddToProgressMax(subdirs_to_rescan.count());
+    foreach (const QString& path, subdirs_to_rescan) {
+      if (stop_requested_) return;
+      Subdirectory subdir;
+      subdir.directory_id = dir;
+      subdir.mtime = 0;
+      subdir.path = path;
+      ScanSubdirectory(path, subdir, &transaction);
+    }
+  }
+
   rescan_queue_.clear();
+  file_rescan_queue_.clear();
 
   emit CompilationsNeedUpdating();
 }
@@ -725,7 +1067,8 @@ void LibraryWatcher::SetRescanPausedAsync(bool pause) {
 
 void LibraryWatcher::SetRescanPaused(bool pause) {
   rescan_paused_ = pause;
-  if (!rescan_paused_ && !rescan_queue_.isEmpty())
+  if (!rescan_paused_ &&
+      (!rescan_queue_.isEmpty() || !file_rescan_queue_.isEmpty()))
     RescanPathsNow();
 }
 
@@ -752,6 +1095,15 @@ void LibraryWatcher::PerformScan(bool incremental, bool ignore_mtimes) {
     SubdirectoryList subdirs(transaction.GetAllSubdirs());
     transaction.AddToProgressMax(subdirs.count());
 
+    // A full scan has to look at every subdirectory again, so they're all
+    // journaled up front - if it's interrupted the next startup scan would
+    // only look at the ones that have changed.
+    if (ignore_mtimes) {
+      foreach (const Subdirectory& subdir, subdirs) {
+        transaction.AddToJournal(subdir.path);
+      }
+    }
+
     foreach (const Subdirectory& subdir, subdirs) {
       if (stop_requested_) return;
 
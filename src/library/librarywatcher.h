@@ -20,9 +20,12 @@
 
 #include "directory.h"
 #include "core/song.h"
+#include "core/tagreaderclient.h"
 
 #include <QHash>
 #include <QObject>
+#include <QQueue>
+#include <QSet>
 #include <QStringList>
 #include <QMap>
 
@@ -42,6 +45,16 @@ class LibraryWatcher : public QObject {
 
   static const char* kSettingsGroup;
 
+  // Files are sent to the tagreader in ReadFiles requests of this size.
+  static const int kReadBatchSize;
+
+  // How many ReadFiles requests a scan keeps in flight per tagreader worker.
+  static const int kMaxPendingReadsPerWorker;
+
+  // A scan transaction commits its changes to the backend once this many
+  // songs have accumulated, instead of holding everything until the end.
+  static const int kCommitBatchSize;
+
   void set_backend(LibraryBackend* backend) { backend_ = backend; }
   void set_task_manager(TaskManager* task_manager) { task_manager_ = task_manager; }
   void set_device_name(const QString& device_name) { device_name_ = device_name; }
@@ -59,6 +72,8 @@ class LibraryWatcher : public QObject {
   void SongsDeleted(const SongList& songs);
   void SubdirsDiscovered(const SubdirectoryList& subdirs);
   void SubdirsMTimeUpdated(const SubdirectoryList& subdirs);
+  void ScanJournalAdded(const SubdirectoryList& subdirs, bool ignores_mtime);
+  void ScanJournalRemoved(const SubdirectoryList& subdirs);
   void CompilationsNeedUpdating();
 
   void ScanStarted(int task_id);
@@ -79,6 +94,11 @@ class LibraryWatcher : public QObject {
   // to the library.  Multiple calls to FindSongsInSubdirectory during one
   // transaction will only result in one call to
   // LibraryBackend::FindSongsInDirectory.
+  // Tags are read asynchronously: ReadFileAsync groups files into batches
+  // that are sent to the tagreader WorkerPool as soon as they are full, and
+  // the results are only collected when the queue of pending reads gets too
+  // long, so walking the directory tree and reading tags happen at the same
+  // time.
   class ScanTransaction {
    public:
     ScanTransaction(LibraryWatcher* watcher, int dir,
@@ -94,6 +114,35 @@ class LibraryWatcher : public QObject {
     void AddToProgress(int n = 1);
     void AddToProgressMax(int n);
 
+    // Starts reading the tags of a file that is either new (matching_song is
+    // invalid) or has changed since it was added to the library.
+    void ReadFileAsync(const QString& file, const QString& image,
+                       const Song& matching_song);
+
+    // Sends any files that don't fill a whole batch yet and processes the
+    // results of pending ReadFiles requests, blocking until at most
+    // max_pending requests are still in flight.
+    void WaitForPendingReads(int max_pending = 0);
+
+    // Sends everything found so far to the backend.  Called automatically
+    // when the transaction is destroyed.
+    void CommitScanChanges();
+
+    // Calls CommitScanChanges if enough songs have accumulated.
+    void CommitScanChangesIfNeeded();
+
+    // The scan journal records which subdirectories still have to be scanned,
+    // so a scan that is interrupted before it commits everything can be
+    // resumed the next time the directory is added.  Both changes are written
+    // to the database along with the rest of the transaction.
+    // RemoveFromJournal does nothing for paths that aren't in the journal, and
+    // a path that's removed before its addition was written is never written.
+    void AddToJournal(const QString& path);
+    void RemoveFromJournal(const QString& path);
+
+    // Tells the transaction about paths an earlier scan left in the journal.
+    void SetJournaled(const SubdirectoryList& subdirs);
+
     int dir() const { return dir_; }
     bool is_incremental() const { return incremental_; }
     bool ignores_mtime() const { return ignores_mtime_; }
@@ -108,6 +157,22 @@ class LibraryWatcher : public QObject {
     ScanTransaction(const ScanTransaction&) {}
     ScanTransaction& operator =(const ScanTransaction&) { return *this; }
 
+    struct PendingFile {
+      QString file_;
+      QString image_;
+      Song matching_song_;
+    };
+
+    struct PendingRead {
+      TagReaderReply* reply_;
+      QList<PendingFile> files_;
+    };
+
+    void SendUnsentFiles();
+    void ProcessRead(const PendingRead& read);
+    void ProcessFile(const PendingFile& file,
+                     const pb::tagreader::SongMetadata& metadata);
+
     int task_id_;
     int progress_;
     int progress_max_;
@@ -124,15 +189,32 @@ class LibraryWatcher : public QObject {
 
     LibraryWatcher* watcher_;
 
-    SongList cached_songs_;
+    // Songs in this directory, keyed on the path of their parent subdirectory.
+    // Each list is in the order the database returned them.
+    QHash<QString, SongList> cached_songs_;
     bool cached_songs_dirty_;
 
     SubdirectoryList known_subdirs_;
+    // Indexes into known_subdirs_.  Only subdirectories with a non-zero mtime
+    // are included.
+    QSet<QString> known_subdir_paths_;
+    QMultiHash<QString, Subdirectory> known_subdirs_by_parent_;
     bool known_subdirs_dirty_;
+
+    SubdirectoryList journal_added_;
+    SubdirectoryList journal_removed_;
+    QSet<QString> journaled_paths_;
+    // Paths in journal_added_ that haven't been removed again.
+    QSet<QString> unwritten_journal_paths_;
+
+    QList<PendingFile> unsent_files_;
+    QQueue<PendingRead> pending_reads_;
+    int max_pending_reads_;
   };
 
  private slots:
   void DirectoryChanged(const QString& path);
+  void FileChanged(const QString& path);
   void IncrementalScanNow();
   void FullScanNow();
   void RescanPathsNow();
@@ -140,7 +222,9 @@ class LibraryWatcher : public QObject {
                         ScanTransaction* t, bool force_noincremental = false);
 
  private:
-  static bool FindSongByPath(const SongList& list, const QString& path, Song* out);
+  static QHash<QString, Song> SongsByPath(const SongList& list);
+  static bool FindSongByPath(const QHash<QString, Song>& songs,
+                             const QString& path, Song* out);
   inline static QString NoExtensionPart( const QString &fileName );
   inline static QString ExtensionPart( const QString &fileName );
   inline static QString DirectoryPart( const QString &fileName );
@@ -164,11 +248,20 @@ class LibraryWatcher : public QObject {
   // song (for example rating and score).
   void PreserveUserSetData(const QString& file, const QString& image,
                            const Song& matching_song, Song* out, ScanTransaction* t);
-  // Scans a single media file that's present on the disk but not yet in the library.
-  // It may result in a multiple files added to the library when the media file
-  // has many sections (like a CUE related media file).
-  SongList ScanNewFile(const QString& file, const QString& path,
-                       const QString& matching_cue, QSet<QString>* cues_processed);
+  // Scans a single CUE related media file that's present on the disk but not
+  // yet in the library.  It may result in a multiple files added to the
+  // library when the media file has many sections.  Media files without a
+  // CUE sheet go through ScanTransaction::ReadFileAsync instead.
+  SongList ScanNewCueFile(const QString& file, const QString& path,
+                          const QString& matching_cue, QSet<QString>* cues_processed);
+  // Updates a single file that the filesystem watcher reported as changed or
+  // deleted.  Returns false if the file can't be handled on its own (album
+  // art, CUE sheets and their media files) and its whole directory needs to
+  // be rescanned instead.  songs_in_db are the file's sections in the
+  // database, and album_art caches the images found in each directory so
+  // several files in one directory only list it once.
+  bool ScanFile(const QString& file, const SongList& songs_in_db,
+                QMap<QString, QStringList>* album_art, ScanTransaction* t);
 
  private:
   LibraryBackend* backend_;
@@ -192,6 +285,7 @@ class LibraryWatcher : public QObject {
   QMap<int, Directory> watched_dirs_;
   QTimer* rescan_timer_;
   QMap<int, QStringList> rescan_queue_; // dir id -> list of subdirs to be scanned
+  QMap<int, QSet<QString> > file_rescan_queue_; // dir id -> files to be scanned
   bool rescan_paused_;
 
   int total_watches_;
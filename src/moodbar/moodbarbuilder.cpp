@@ -0,0 +1,240 @@
+/* This file is part of Clementine.
+   Copyright 2006, Joseph Rabinoff <bobqwatson@yahoo.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "moodbarbuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/fht.h"
+
+namespace {
+
+static const int sBarkBands[] = {
+    100,  200,  300,  400,  510,  630,  770,  920,
+    1080, 1270, 1480, 1720, 2000, 2320, 2700, 3150,
+    3700, 4400, 5300, 6400, 7700, 9500, 12000, 15500 };
+
+static const int sBarkBandCount = sizeof(sBarkBands) / sizeof(sBarkBands[0]);
+
+}  // namespace
+
+const int MoodbarBuilder::kWindowSizeExp2 = 11;
+const int MoodbarBuilder::kWindowSize = 1 << kWindowSizeExp2;
+const int MoodbarBuilder::kWindowStep = kWindowSize / 2;
+
+// A failsafe so we don't eat up all the memory on an endless stream.
+const int MoodbarBuilder::kMaxFrames = 1024 * 1024 * 4;
+
+MoodbarBuilder::MoodbarBuilder()
+  : fht_(new FHT(kWindowSizeExp2)),
+    rate_(0)
+{
+  window_.resize(kWindowSize);
+}
+
+MoodbarBuilder::~MoodbarBuilder() {
+}
+
+int MoodbarBuilder::BandFrequency(int band) const {
+  return int(float(band) * float(rate_) / float(kWindowSize));
+}
+
+void MoodbarBuilder::Init(int rate) {
+  rate_ = rate;
+
+  // Work out which bark band each frequency bin belongs in.
+  barkband_table_.resize(kWindowSize / 2 + 1);
+
+  int barkband = 0;
+  for (int i = 0; i < barkband_table_.count(); ++i) {
+    if (barkband < sBarkBandCount - 1 &&
+        BandFrequency(i) >= sBarkBands[barkband]) {
+      barkband++;
+    }
+
+    barkband_table_[i] = barkband;
+  }
+
+  pending_.clear();
+  frames_.clear();
+}
+
+void MoodbarBuilder::AddFrames(const float* samples, int count) {
+  if (barkband_table_.isEmpty() || frames_.count() >= kMaxFrames)
+    return;
+
+  const int old_count = pending_.count();
+  pending_.resize(old_count + count);
+  std::copy(samples, samples + count, pending_.data() + old_count);
+
+  // Analyse every whole window, then keep the samples the next one will
+  // overlap with.
+  int offset = 0;
+  for (; offset + kWindowSize <= pending_.count(); offset += kWindowStep) {
+    AnalyseWindow(pending_.constData() + offset);
+  }
+
+  if (offset != 0) {
+    pending_.remove(0, qMin(offset, pending_.count()));
+  }
+}
+
+void MoodbarBuilder::AnalyseWindow(const float* samples) {
+  if (frames_.count() >= kMaxFrames)
+    return;
+
+  float* const data = window_.data();
+  std::copy(samples, samples + kWindowSize, data);
+
+  // spectrum() only writes the first half of the window, so the Nyquist
+  // coefficient of the transform is still in data[kWindowSize / 2] afterwards.
+  // The magnitudes are normalised the same way fftw output was in the old
+  // plugin.
+  fht_->spectrum(data);
+  const float root = sqrtf(kWindowSize);
+  const float nyquist = fabs(data[kWindowSize / 2]);
+
+  double amplitudes[sBarkBandCount];
+  std::fill(amplitudes, amplitudes + sBarkBandCount, 0.0);
+
+  for (int i = 0; i < kWindowSize / 2; ++i) {
+    amplitudes[barkband_table_[i]] += data[i] / root;
+  }
+  amplitudes[barkband_table_[kWindowSize / 2]] += nyquist / root;
+
+  // Red, green and blue are each made from a third of the bark bands.
+  double rgb[3] = { 0.0, 0.0, 0.0 };
+  for (int i = 0; i < sBarkBandCount; ++i) {
+    rgb[i * 3 / sBarkBandCount] += amplitudes[i] * amplitudes[i];
+  }
+
+  frames_.append(Rgb(sqrt(rgb[0]), sqrt(rgb[1]), sqrt(rgb[2])));
+}
+
+// The normalisation code was copied from Gav Wood's Exscalibar library,
+// normalise.cpp, by way of the moodbar gstreamer plugin.
+void MoodbarBuilder::Normalize(QVector<Rgb>* vals, double Rgb::*member) {
+  const int numvals = vals->count();
+  if (numvals == 0)
+    return;
+
+  double mini = (*vals)[0].*member;
+  double maxi = mini;
+  for (int i = 1; i < numvals; ++i) {
+    const double value = (*vals)[i].*member;
+    if (value > maxi)
+      maxi = value;
+    else if (value < mini)
+      mini = value;
+  }
+
+  double avg = 0;
+  for (int i = 0; i < numvals; ++i) {
+    const double value = (*vals)[i].*member;
+    if (value != mini && value != maxi) {
+      avg += value / numvals;
+    }
+  }
+
+  double tu = 0, tb = 0;
+  double avgu = 0, avgb = 0;
+  for (int i = 0; i < numvals; ++i) {
+    const double value = (*vals)[i].*member;
+    if (value != mini && value != maxi) {
+      if (value > avg) {
+        avgu += value;
+        tu++;
+      } else {
+        avgb += value;
+        tb++;
+      }
+    }
+  }
+  avgu /= tu;
+  avgb /= tb;
+
+  tu = 0;
+  tb = 0;
+  double avguu = 0, avgbb = 0;
+  for (int i = 0; i < numvals; ++i) {
+    const double value = (*vals)[i].*member;
+    if (value != mini && value != maxi) {
+      if (value > avgu) {
+        avguu += value;
+        tu++;
+      } else if (value < avgb) {
+        avgbb += value;
+        tb++;
+      }
+    }
+  }
+  avguu /= tu;
+  avgbb /= tb;
+
+  mini = qMax(avg + (avgb - avg) * 2, avgbb);
+  maxi = qMin(avg + (avgu - avg) * 2, avguu);
+  double delta = maxi - mini;
+  if (delta == 0)
+    delta = 1;
+
+  for (int i = 0; i < numvals; ++i) {
+    double& value = (*vals)[i].*member;
+    value = std::isfinite(value) ? qBound(0.0, (value - mini) / delta, 1.0)
+                                 : 0;
+  }
+}
+
+QByteArray MoodbarBuilder::Finish(int max_width) {
+  const int numframes = frames_.count();
+
+  QByteArray ret;
+  if (numframes == 0)
+    return ret;
+
+  const int width = (max_width <= 0 || numframes <= max_width)
+                    ? numframes : max_width;
+  ret.resize(width * 3);
+  char* data = ret.data();
+
+  Normalize(&frames_, &Rgb::r);
+  Normalize(&frames_, &Rgb::g);
+  Normalize(&frames_, &Rgb::b);
+
+  for (int i = 0; i < width; ++i) {
+    Rgb rgb;
+    const int start = qint64(i) * numframes / width;
+    int end = qint64(i + 1) * numframes / width;
+    if (start == end)
+      end = start + 1;
+
+    for (int j = start; j < end; ++j) {
+      const Rgb& frame = frames_[j];
+      rgb.r += frame.r * 255;
+      rgb.g += frame.g * 255;
+      rgb.b += frame.b * 255;
+    }
+
+    const int n = end - start;
+
+    *(data++) = char(quint8(rgb.r / n));
+    *(data++) = char(quint8(rgb.g / n));
+    *(data++) = char(quint8(rgb.b / n));
+  }
+
+  return ret;
+}
@@ -0,0 +1,83 @@
+/* This file is part of Clementine.
+   Copyright 2006, Joseph Rabinoff <bobqwatson@yahoo.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOODBARBUILDER_H
+#define MOODBARBUILDER_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <boost/scoped_ptr.hpp>
+
+class FHT;
+
+// Turns a stream of mono float samples into moodbar data: one RGB triple per
+// column, where red, green and blue are the loudness of the low, middle and
+// high bark bands.  This is the same analysis the old moodbar gstreamer
+// plugin did, but with the FHT's vectorised kernels instead of fftw, so it
+// doesn't need an external library and can run on any thread.
+class MoodbarBuilder {
+ public:
+  MoodbarBuilder();
+  ~MoodbarBuilder();
+
+  static const int kWindowSizeExp2;
+  static const int kWindowSize;
+  static const int kWindowStep;
+  static const int kMaxFrames;
+
+  // Must be called before any samples are added.
+  void Init(int rate);
+
+  // Adds some more samples.  They don't need to be aligned to the window
+  // size - anything left over is kept until the next call.
+  void AddFrames(const float* samples, int count);
+
+  // Normalises the analysed frames and scales them down to at most max_width
+  // columns.  Returns three bytes per column.
+  QByteArray Finish(int max_width);
+
+  int rate() const { return rate_; }
+  int frame_count() const { return frames_.count(); }
+
+ private:
+  struct Rgb {
+    Rgb() : r(0), g(0), b(0) {}
+    Rgb(double r_, double g_, double b_) : r(r_), g(g_), b(b_) {}
+
+    double r, g, b;
+  };
+
+  int BandFrequency(int band) const;
+  void AnalyseWindow(const float* samples);
+
+  static void Normalize(QVector<Rgb>* vals, double Rgb::*member);
+
+ private:
+  boost::scoped_ptr<FHT> fht_;
+
+  int rate_;
+  QVector<int> barkband_table_;
+
+  // Samples that didn't fill a whole window yet.
+  QVector<float> pending_;
+  QVector<float> window_;
+
+  QVector<Rgb> frames_;
+};
+
+#endif // MOODBARBUILDER_H
@@ -21,15 +21,34 @@
 #include "moodbarrenderer.h"
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/concurrentrun.h"
 #include "core/qhash_qurl.h"
 #include "playlist/playlist.h"
 #include "playlist/playlistview.h"
 
+#include <boost/bind.hpp>
+
 #include <QApplication>
 #include <QPainter>
 #include <QSettings>
 #include <QSortFilterProxyModel>
-#include <QtConcurrentRun>
+
+const int MoodbarItemDelegate::kMaxStripCacheKb = 16 * 1024; // 16MB
+
+namespace {
+
+QImage RenderStrip(const QByteArray& bytes, MoodbarRenderer::MoodbarStyle style,
+                   const QPalette& palette, const QSize& size) {
+  return MoodbarRenderer::RenderToImage(
+      MoodbarRenderer::Colors(bytes, style, palette), size);
+}
+
+}  // namespace
+
+uint qHash(const MoodbarItemDelegate::StripKey& key) {
+  return qHash(key.url_) ^ qHash(key.size_.width()) ^
+         qHash(key.size_.height() << 16) ^ qHash(key.style_ << 28);
+}
 
 MoodbarItemDelegate::Data::Data()
   : state_(State_None)
@@ -41,8 +60,14 @@ MoodbarItemDelegate::MoodbarItemDelegate(Application* app, PlaylistView* view,
   : QItemDelegate(parent),
     app_(app),
     view_(view),
+    strips_(kMaxStripCacheKb),
+    active_renders_(0),
     style_(MoodbarRenderer::Style_Normal)
 {
+  // Rendering a strip is quick, one worker keeps up with scrolling and leaves
+  // the other cores alone.
+  render_pool_.setMaxThreadCount(1);
+
   connect(app_, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
   ReloadSettings();
 }
@@ -56,7 +81,9 @@ void MoodbarItemDelegate::ReloadSettings() {
 
   if (new_style != style_) {
     style_ = new_style;
-    ReloadAllColors();
+
+    // The old strips stay as placeholders until the new ones are rendered.
+    view_->viewport()->update();
   }
 }
 
@@ -87,31 +114,24 @@ QPixmap MoodbarItemDelegate::PixmapForIndex(
   }
 
   data->indexes_.insert(index);
-  data->desired_size_ = size;
-
-  switch (data->state_) {
-  case Data::State_CannotLoad:
-  case Data::State_LoadingData:
-  case Data::State_LoadingColors:
-  case Data::State_LoadingImage:
-    return data->pixmap_;
-
-  case Data::State_Loaded:
-    // Is the pixmap the right size?
-    if (data->pixmap_.size() != size) {
-      StartLoadingImage(url, data);
-    }
 
-    return data->pixmap_;
+  if (data->state_ == Data::State_None) {
+    // We have to start loading the data from scratch.
+    StartLoadingData(url, data);
+  }
 
-  case Data::State_None:
-    break;
+  if (data->state_ != Data::State_Loaded) {
+    return QPixmap();
   }
 
-  // We have to start loading the data from scratch.
-  StartLoadingData(url, data);
+  const StripKey key(url, size, style_);
+  if (QPixmap* strip = strips_.object(key)) {
+    data->placeholder_ = *strip;
+    return *strip;
+  }
 
-  return QPixmap();
+  QueueRender(key);
+  return data->placeholder_;
 }
 
 void MoodbarItemDelegate::StartLoadingData(const QUrl& url, Data* data) {
@@ -127,7 +147,8 @@ void MoodbarItemDelegate::StartLoadingData(const QUrl& url, Data* data) {
 
   case MoodbarLoader::Loaded:
     // We got the data immediately.
-    StartLoadingColors(url, bytes, data);
+    data->bytes_ = bytes;
+    data->state_ = Data::State_Loaded;
     break;
 
   case MoodbarLoader::WillLoadAsync:
@@ -150,17 +171,7 @@ bool MoodbarItemDelegate::RemoveFromCacheIfIndexesInvalid(const QUrl& url, Data*
   return true;
 }
 
-void MoodbarItemDelegate::ReloadAllColors() {
-  foreach (const QUrl& url, data_.keys()) {
-    Data* data = data_[url];
-
-    if (data->state_ == Data::State_Loaded) {
-      StartLoadingData(url, data);
-    }
-  }
-}
-
-void MoodbarItemDelegate::DataLoaded( const QUrl& url, MoodbarPipeline* pipeline) {
+void MoodbarItemDelegate::DataLoaded(const QUrl& url, MoodbarPipeline* pipeline) {
   Data* data = data_[url];
   if (!data) {
     return;
@@ -175,80 +186,92 @@ void MoodbarItemDelegate::DataLoaded( const QUrl& url, MoodbarPipeline* pipeline
     return;
   }
 
-  // Load the colors next.
-  StartLoadingColors(url, pipeline->data(), data);
+  data->bytes_ = pipeline->data();
+  data->state_ = Data::State_Loaded;
+
+  // Repainting the rows will queue their strips.
+  UpdateIndexes(url, data);
 }
 
-void MoodbarItemDelegate::StartLoadingColors(
-    const QUrl& url, const QByteArray& bytes, Data* data) {
-  data->state_ = Data::State_LoadingColors;
+void MoodbarItemDelegate::QueueRender(const StripKey& key) {
+  if (pending_renders_.contains(key)) {
+    return;
+  }
 
-  QFutureWatcher<ColorVector>* watcher = new QFutureWatcher<ColorVector>();
-  NewClosure(watcher, SIGNAL(finished()),
-             this, SLOT(ColorsLoaded(QUrl,QFutureWatcher<ColorVector>*)),
-             url, watcher);
+  pending_renders_.insert(key);
+  render_queue_.prepend(key);
 
-  QFuture<ColorVector> future = QtConcurrent::run(MoodbarRenderer::Colors,
-      bytes, style_, qApp->palette());
-  watcher->setFuture(future);
+  StartNextRender();
 }
 
-void MoodbarItemDelegate::ColorsLoaded(
-    const QUrl& url, QFutureWatcher<ColorVector>* watcher) {
-  watcher->deleteLater();
-
-  Data* data = data_[url];
+bool MoodbarItemDelegate::IsVisible(const QUrl& url) {
+  Data* data = data_.object(url);
   if (!data) {
-    return;
+    return false;
   }
 
-  if (RemoveFromCacheIfIndexesInvalid(url, data)) {
-    return;
+  const QRect viewport_rect(view_->viewport()->rect());
+  foreach (const QPersistentModelIndex& index, data->indexes_) {
+    if (index.isValid() && index.model() == view_->model() &&
+        view_->visualRect(index).intersects(viewport_rect)) {
+      return true;
+    }
   }
-
-  data->colors_ = watcher->result();
-
-  // Load the image next.
-  StartLoadingImage(url, data);
+  return false;
 }
 
-void MoodbarItemDelegate::StartLoadingImage(const QUrl& url, Data* data) {
-  data->state_ = Data::State_LoadingImage;
+void MoodbarItemDelegate::StartNextRender() {
+  while (active_renders_ < render_pool_.maxThreadCount() &&
+         !render_queue_.isEmpty()) {
+    const StripKey key = render_queue_.takeFirst();
+
+    // Skip rows that were scrolled past before we got to them, they'll be
+    // queued again if they're painted.
+    Data* data = data_.object(key.url_);
+    if (!data || data->state_ != Data::State_Loaded ||
+        key.style_ != style_ || !IsVisible(key.url_)) {
+      pending_renders_.remove(key);
+      continue;
+    }
+
+    active_renders_++;
 
-  QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>();
-  NewClosure(watcher, SIGNAL(finished()),
-             this, SLOT(ImageLoaded(QUrl,QFutureWatcher<QImage>*)),
-             url, watcher);
+    QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+    NewClosure(watcher, SIGNAL(finished()),
+               this, SLOT(StripRendered(QUrl,QSize,int,QFutureWatcher<QImage>*)),
+               key.url_, key.size_, key.style_, watcher);
 
-  QFuture<QImage> future = QtConcurrent::run(MoodbarRenderer::RenderToImage,
-      data->colors_, data->desired_size_);
-  watcher->setFuture(future);
+    QFuture<QImage> future = ConcurrentRun::Run<QImage>(&render_pool_,
+        boost::bind(&RenderStrip, data->bytes_,
+                    MoodbarRenderer::MoodbarStyle(key.style_),
+                    qApp->palette(), key.size_));
+    watcher->setFuture(future);
+  }
 }
 
-void MoodbarItemDelegate::ImageLoaded(const QUrl& url, QFutureWatcher<QImage>* watcher) {
+void MoodbarItemDelegate::StripRendered(const QUrl& url, const QSize& size,
+                                        int style, QFutureWatcher<QImage>* watcher) {
   watcher->deleteLater();
 
-  Data* data = data_[url];
-  if (!data) {
-    return;
-  }
-
-  if (RemoveFromCacheIfIndexesInvalid(url, data)) {
-    return;
-  }
+  const StripKey key(url, size, style);
+  pending_renders_.remove(key);
+  active_renders_--;
 
-  QImage image(watcher->result());
+  const QImage image(watcher->result());
+  if (!image.isNull()) {
+    const int cost_kb = qMax(1, image.byteCount() / 1024);
+    strips_.insert(key, new QPixmap(QPixmap::fromImage(image)), cost_kb);
 
-  // If the desired size changed then don't even bother converting the image
-  // to a pixmap, just reload it at the new size.
-  if (!image.isNull() && data->desired_size_ != image.size()) {
-    StartLoadingImage(url, data);
-    return;
+    Data* data = data_.object(url);
+    if (data && style == style_) {
+      UpdateIndexes(url, data);
+    }
   }
 
-  data->pixmap_ = QPixmap::fromImage(image);
-  data->state_ = Data::State_Loaded;
-  
+  StartNextRender();
+}
+
+void MoodbarItemDelegate::UpdateIndexes(const QUrl& url, Data* data) {
   Playlist* playlist = view_->playlist();
   const QSortFilterProxyModel* filter = playlist->proxy();
 
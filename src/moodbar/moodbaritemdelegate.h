@@ -23,6 +23,7 @@
 #include <QCache>
 #include <QItemDelegate>
 #include <QFutureWatcher>
+#include <QThreadPool>
 #include <QUrl>
 
 class Application;
@@ -37,6 +38,8 @@ class MoodbarItemDelegate : public QItemDelegate {
 public:
   MoodbarItemDelegate(Application* app, PlaylistView* view, QObject* parent = 0);
 
+  static const int kMaxStripCacheKb;
+
   void paint(QPainter* painter, const QStyleOptionViewItem& option,
              const QModelIndex& index) const;
 
@@ -44,8 +47,8 @@ private slots:
   void ReloadSettings();
 
   void DataLoaded(const QUrl& url, MoodbarPipeline* pipeline);
-  void ColorsLoaded(const QUrl& url, QFutureWatcher<ColorVector>* watcher);
-  void ImageLoaded(const QUrl& url, QFutureWatcher<QImage>* watcher);
+  void StripRendered(const QUrl& url, const QSize& size, int style,
+                     QFutureWatcher<QImage>* watcher);
 
 private:
   struct Data {
@@ -55,35 +58,63 @@ private:
       State_None,
       State_CannotLoad,
       State_LoadingData,
-      State_LoadingColors,
-      State_LoadingImage,
       State_Loaded
     };
 
     QSet<QPersistentModelIndex> indexes_;
 
     State state_;
-    ColorVector colors_;
-    QSize desired_size_;
-    QPixmap pixmap_;
+    QByteArray bytes_;
+
+    // The last strip drawn for this song, shown stretched while one of the
+    // right size or style is being rendered.
+    QPixmap placeholder_;
+  };
+
+  // Rendered strips are kept for each size and style they've been drawn at,
+  // so resizing the column or switching styles back and forth is free.
+  struct StripKey {
+    StripKey() : style_(0) {}
+    StripKey(const QUrl& url, const QSize& size, int style)
+      : url_(url), size_(size), style_(style) {}
+
+    bool operator ==(const StripKey& other) const {
+      return url_ == other.url_ && size_ == other.size_ &&
+             style_ == other.style_;
+    }
+
+    QUrl url_;
+    QSize size_;
+    int style_;
   };
+  friend uint qHash(const StripKey& key);
 
 private:
   QPixmap PixmapForIndex(const QModelIndex& index, const QSize& size);
   void StartLoadingData(const QUrl& url, Data* data);
-  void StartLoadingColors(const QUrl& url, const QByteArray& bytes, Data* data);
-  void StartLoadingImage(const QUrl& url, Data* data);
 
-  bool RemoveFromCacheIfIndexesInvalid(const QUrl& url, Data* data);
+  void QueueRender(const StripKey& key);
+  void StartNextRender();
+  bool IsVisible(const QUrl& url);
 
-  void ReloadAllColors();
+  void UpdateIndexes(const QUrl& url, Data* data);
+  bool RemoveFromCacheIfIndexesInvalid(const QUrl& url, Data* data);
 
 private:
   Application* app_;
   PlaylistView* view_;
   QCache<QUrl, Data> data_;
+  QCache<StripKey, QPixmap> strips_;
+
+  // Strips waiting to be rendered, most recently painted first.  Ones that
+  // have scrolled out of view by the time a worker is free are dropped.
+  QList<StripKey> render_queue_;
+  QSet<StripKey> pending_renders_;
+  int active_renders_;
 
   MoodbarRenderer::MoodbarStyle style_;
+
+  QThreadPool render_pool_;
 };
 
 #endif // MOODBARITEMDELEGATE_H
@@ -17,6 +17,7 @@
 
 #include "moodbarloader.h"
 
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <QCoreApplication>
@@ -26,32 +27,44 @@
 #include <QTimer>
 #include <QThread>
 #include <QUrl>
+#include <QtConcurrentRun>
 
 #include "moodbarpipeline.h"
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/concurrentrun.h"
+#include "core/database.h"
 #include "core/logging.h"
 #include "core/qhash_qurl.h"
+#include "core/taskmanager.h"
 #include "core/utilities.h"
+#include "library/librarybackend.h"
+#include "library/libraryquery.h"
 
 MoodbarLoader::MoodbarLoader(Application* app, QObject* parent)
   : QObject(parent),
+    app_(app),
     cache_(new QNetworkDiskCache(this)),
-    thread_(new QThread(this)),
-    kMaxActiveRequests(qMax(1, QThread::idealThreadCount() / 2)),
+    bulk_task_id_(-1),
+    bulk_total_(0),
     save_alongside_originals_(false),
     disable_moodbar_calculation_(false)
 {
   cache_->setCacheDirectory(Utilities::GetConfigPath(Utilities::Path_MoodbarCache));
   cache_->setMaximumCacheSize(60 * 1024 * 1024); // 60MB - enough for 20,000 moodbars
 
+  thread_pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
   connect(app, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
   ReloadSettings();
 }
 
 MoodbarLoader::~MoodbarLoader() {
-  thread_->quit();
-  thread_->wait(1000);
+  foreach (const QUrl& url, active_requests_) {
+    requests_[url]->Abort();
+  }
+  thread_pool_.waitForDone();
+  qDeleteAll(requests_);
 }
 
 void MoodbarLoader::ReloadSettings() {
@@ -110,39 +123,64 @@ MoodbarLoader::Result MoodbarLoader::Load(
     }
   }
 
-  if (!thread_->isRunning())
-    thread_->start();
-
   // There was no existing file, analyze the audio file and create one.
-  MoodbarPipeline* pipeline = new MoodbarPipeline(url);
-  pipeline->moveToThread(thread_);
-  NewClosure(pipeline, SIGNAL(Finished(bool)),
-     this, SLOT(RequestFinished(MoodbarPipeline*,QUrl)),
-     pipeline, url);
-
-  requests_[url] = pipeline;
+  MoodbarPipeline* pipeline = CreatePipeline(url);
   queued_requests_ << url;
 
+  // If it was waiting in the bulk queue it goes ahead now instead.
+  if (!disable_moodbar_calculation_) {
+    queued_bulk_requests_.removeOne(url);
+  }
+
   MaybeTakeNextRequest();
 
   *async_pipeline = pipeline;
   return WillLoadAsync;
 }
 
+MoodbarPipeline* MoodbarLoader::CreatePipeline(const QUrl& url) {
+  MoodbarPipeline* pipeline = new MoodbarPipeline(url);
+  NewClosure(pipeline, SIGNAL(Finished(bool)),
+     this, SLOT(RequestFinished(MoodbarPipeline*,QUrl)),
+     pipeline, url);
+
+  requests_[url] = pipeline;
+  return pipeline;
+}
+
 void MoodbarLoader::MaybeTakeNextRequest() {
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-  if (active_requests_.count() >= kMaxActiveRequests ||
-      queued_requests_.isEmpty() || disable_moodbar_calculation_) {
-    return;
+  while (active_requests_.count() < thread_pool_.maxThreadCount()) {
+    if (!queued_requests_.isEmpty() && !disable_moodbar_calculation_) {
+      StartRequest(queued_requests_.takeFirst());
+    } else if (!queued_bulk_requests_.isEmpty()) {
+      // The user asked for these explicitly, so they're made even if
+      // automatic calculation is turned off.
+      const QUrl url = queued_bulk_requests_.takeFirst();
+      if (active_requests_.contains(url)) {
+        continue;
+      }
+
+      if (requests_.contains(url)) {
+        // The UI asked for this one while calculation was turned off.
+        queued_requests_.removeOne(url);
+      } else {
+        CreatePipeline(url);
+      }
+      StartRequest(url);
+    } else {
+      break;
+    }
   }
+}
 
-  const QUrl url = queued_requests_.takeFirst();
+void MoodbarLoader::StartRequest(const QUrl& url) {
   active_requests_ << url;
 
-
   qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
-  QMetaObject::invokeMethod(requests_[url], "Start", Qt::QueuedConnection);
+  ConcurrentRun::Run<void>(&thread_pool_,
+      boost::bind(&MoodbarPipeline::Run, requests_[url]));
 }
 
 void MoodbarLoader::RequestFinished(MoodbarPipeline* request, const QUrl& url) {
@@ -177,5 +215,102 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline* request, const QUrl& url) {
 
   QTimer::singleShot(1000, request, SLOT(deleteLater()));
 
+  if (bulk_requests_.remove(url)) {
+    UpdateBulkProgress();
+  }
+
   MaybeTakeNextRequest();
 }
+
+void MoodbarLoader::GenerateLibraryMoodbars() {
+  if (bulk_task_id_ != -1) {
+    return;
+  }
+
+  bulk_task_id_ = app_->task_manager()->StartTask(tr("Generating moodbars"));
+
+  // Looking through the whole library touches a lot of files, so do it off
+  // the GUI thread.
+  QFuture<QList<QUrl> > future = QtConcurrent::run(
+      &MoodbarLoader::FindSongsWithoutMoodbars,
+      app_->library_backend(), cache_->cacheDirectory());
+  UrlListFutureWatcher* watcher = new UrlListFutureWatcher(this);
+  watcher->setFuture(future);
+
+  connect(watcher, SIGNAL(finished()), SLOT(LibrarySongsFound()));
+}
+
+QList<QUrl> MoodbarLoader::FindSongsWithoutMoodbars(LibraryBackend* backend,
+                                                    const QString& cache_dir) {
+  QList<QUrl> urls;
+
+  {
+    LibraryQuery query;
+    query.SetColumnSpec("filename");
+
+    Database::ReadLocker l(backend->db());
+    if (!backend->ExecQuery(&query))
+      return urls;
+
+    while (query.Next()) {
+      urls << QUrl::fromEncoded(query.Value(0).toByteArray());
+    }
+  }
+
+  // QNetworkDiskCache isn't thread-safe, so look in the cache directory
+  // through a separate instance.
+  QNetworkDiskCache cache;
+  cache.setCacheDirectory(cache_dir);
+
+  QList<QUrl> ret;
+  foreach (const QUrl& url, urls) {
+    if (url.scheme() != "file")
+      continue;
+
+    bool has_mood_file = false;
+    foreach (const QString& mood_file, MoodFilenames(url.toLocalFile())) {
+      if (QFile::exists(mood_file)) {
+        has_mood_file = true;
+        break;
+      }
+    }
+
+    if (!has_mood_file && !cache.metaData(url).isValid()) {
+      ret << url;
+    }
+  }
+
+  return ret;
+}
+
+void MoodbarLoader::LibrarySongsFound() {
+  UrlListFutureWatcher* watcher = static_cast<UrlListFutureWatcher*>(sender());
+  watcher->deleteLater();
+
+  foreach (const QUrl& url, watcher->result()) {
+    // Skip anything that's already being made for the UI.
+    if (requests_.contains(url))
+      continue;
+
+    bulk_requests_ << url;
+    queued_bulk_requests_ << url;
+  }
+
+  bulk_total_ = bulk_requests_.count();
+  qLog(Info) << "Generating moodbars for" << bulk_total_ << "songs";
+
+  UpdateBulkProgress();
+  MaybeTakeNextRequest();
+}
+
+void MoodbarLoader::UpdateBulkProgress() {
+  if (bulk_requests_.isEmpty()) {
+    app_->task_manager()->SetTaskFinished(bulk_task_id_);
+    bulk_task_id_ = -1;
+    bulk_total_ = 0;
+    return;
+  }
+
+  app_->task_manager()->SetTaskProgress(
+      bulk_task_id_, bulk_total_ - bulk_requests_.count(), bulk_total_);
+}
@@ -18,14 +18,17 @@
 #ifndef MOODBARLOADER_H
 #define MOODBARLOADER_H
 
+#include <QFutureWatcher>
 #include <QMap>
 #include <QObject>
 #include <QSet>
+#include <QThreadPool>
+#include <QUrl>
 
 class QNetworkDiskCache;
-class QUrl;
 
 class Application;
+class LibraryBackend;
 class MoodbarPipeline;
 
 class MoodbarLoader : public QObject {
@@ -50,27 +53,50 @@ public:
 
   Result Load(const QUrl& url, QByteArray* data, MoodbarPipeline** async_pipeline);
 
+public slots:
+  // Creates moodbar data in the background for every local file in the
+  // library that doesn't have any yet.  Songs the user is looking at still
+  // get theirs first.
+  void GenerateLibraryMoodbars();
+
 private slots:
   void ReloadSettings();
 
+  void LibrarySongsFound();
   void RequestFinished(MoodbarPipeline* request, const QUrl& filename);
   void MaybeTakeNextRequest();
 
 private:
+  typedef QFutureWatcher<QList<QUrl> > UrlListFutureWatcher;
+
   static QStringList MoodFilenames(const QString& song_filename);
+  static QList<QUrl> FindSongsWithoutMoodbars(LibraryBackend* backend,
+                                              const QString& cache_dir);
+
+  MoodbarPipeline* CreatePipeline(const QUrl& url);
+  void StartRequest(const QUrl& url);
+  void UpdateBulkProgress();
 
 private:
+  Application* app_;
   QNetworkDiskCache* cache_;
-  QThread* thread_;
-
-  const int kMaxActiveRequests;
 
   QMap<QUrl, MoodbarPipeline*> requests_;
   QList<QUrl> queued_requests_;
   QSet<QUrl> active_requests_;
 
+  // Songs from GenerateLibraryMoodbars.  They are only started when there are
+  // no requests from the UI waiting.
+  QList<QUrl> queued_bulk_requests_;
+  QSet<QUrl> bulk_requests_;
+  int bulk_task_id_;
+  int bulk_total_;
+
   bool save_alongside_originals_;
   bool disable_moodbar_calculation_;
+
+  // Sized to the number of cores.
+  QThreadPool thread_pool_;
 };
 
 #endif // MOODBARLOADER_H
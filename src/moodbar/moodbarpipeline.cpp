@@ -21,16 +21,20 @@
 #include <QThread>
 #include <QUrl>
 
+#include "moodbarbuilder.h"
 #include "core/logging.h"
 #include "core/signalchecker.h"
 
 bool MoodbarPipeline::sIsAvailable = false;
+const int MoodbarPipeline::kMaxWidth = 1000;
 
 MoodbarPipeline::MoodbarPipeline(const QUrl& local_filename)
   : QObject(NULL),
     local_filename_(local_filename),
     pipeline_(NULL),
     convert_element_(NULL),
+    builder_(new MoodbarBuilder),
+    finished_(false),
     success_(false)
 {
 }
@@ -41,17 +45,16 @@ MoodbarPipeline::~MoodbarPipeline() {
 
 bool MoodbarPipeline::IsAvailable() {
   if (!sIsAvailable) {
-    GstElementFactory* factory = gst_element_factory_find("fftwspectrum");
-    if (!factory) {
-      return false;
-    }
-    gst_object_unref(factory);
-
-    factory = gst_element_factory_find("moodbar");
-    if (!factory) {
-      return false;
+    const char* const kElements[] = {
+      "uridecodebin", "audioconvert", "appsink", NULL };
+
+    for (const char* const* name = kElements ; *name ; ++name) {
+      GstElementFactory* factory = gst_element_factory_find(*name);
+      if (!factory) {
+        return false;
+      }
+      gst_object_unref(factory);
     }
-    gst_object_unref(factory);
 
     sIsAvailable = true;
   }
@@ -71,37 +74,64 @@ GstElement* MoodbarPipeline::CreateElement(const QString& factory_name) {
   return ret;
 }
 
-void MoodbarPipeline::Start() {
+void MoodbarPipeline::Run() {
   Q_ASSERT(QThread::currentThread() != qApp->thread());
 
-  if (pipeline_) {
-    return;
+  if (Start()) {
+    // Wait for the end of the stream, an error or for someone to abort us.
+    stopped_.acquire();
+  }
+
+  // Stopping the pipeline waits for the streaming threads, so after this the
+  // builder is ours.
+  Cleanup();
+
+  if (success_) {
+    data_ = builder_->Finish(kMaxWidth);
+    success_ = !data_.isEmpty();
+  }
+  builder_.reset();
+
+  emit Finished(success_);
+}
+
+void MoodbarPipeline::Abort() {
+  Stop(false);
+}
+
+bool MoodbarPipeline::Start() {
+  {
+    QMutexLocker l(&mutex_);
+    if (finished_ || pipeline_) {
+      return false;
+    }
   }
 
   pipeline_ = gst_pipeline_new("moodbar-pipeline");
 
-  GstElement* decodebin    = CreateElement("uridecodebin");
-  convert_element_         = CreateElement("audioconvert");
-  GstElement* fftwspectrum = CreateElement("fftwspectrum");
-  GstElement* moodbar      = CreateElement("moodbar");
-  GstElement* appsink      = CreateElement("appsink");
+  GstElement* decodebin  = CreateElement("uridecodebin");
+  convert_element_       = CreateElement("audioconvert");
+  GstElement* capsfilter = CreateElement("capsfilter");
+  GstElement* appsink    = CreateElement("appsink");
 
-  if (!decodebin || !convert_element_ || !fftwspectrum || !moodbar || !appsink) {
-    pipeline_ = NULL;
-    emit Finished(false);
-    return;
+  if (!decodebin || !convert_element_ || !capsfilter || !appsink) {
+    return false;
   }
 
   // Join them together
-  gst_element_link_many(convert_element_, fftwspectrum, moodbar, appsink, NULL);
+  gst_element_link_many(convert_element_, capsfilter, appsink, NULL);
+
+  // Set properties.  The builder wants mono floats in native byte order.
+  GstCaps* caps = gst_caps_new_simple("audio/x-raw-float",
+      "width", G_TYPE_INT, 32,
+      "endianness", G_TYPE_INT, G_BYTE_ORDER,
+      "channels", G_TYPE_INT, 1,
+      NULL);
+  g_object_set(capsfilter, "caps", caps, NULL);
+  gst_caps_unref(caps);
 
-  // Set properties
   g_object_set(decodebin, "uri", local_filename_.toEncoded().constData(), NULL);
-  g_object_set(fftwspectrum, "def-size", 2048,
-                             "def-step", 1024,
-                             "hiquality", true, NULL);
-  g_object_set(moodbar, "height", 1,
-                        "max-width", 1000, NULL);
+  g_object_set(appsink, "sync", FALSE, NULL);
 
   // Connect signals
   CHECKED_GCONNECT(decodebin, "pad-added", &NewPadCallback, this);
@@ -116,6 +146,7 @@ void MoodbarPipeline::Start() {
 
   // Start playing
   gst_element_set_state(pipeline_, GST_STATE_PLAYING);
+  return true;
 }
 
 void MoodbarPipeline::ReportError(GstMessage* msg) {
@@ -149,7 +180,21 @@ GstFlowReturn MoodbarPipeline::NewBufferCallback(GstAppSink* app_sink, gpointer
   MoodbarPipeline* self = reinterpret_cast<MoodbarPipeline*>(data);
 
   GstBuffer* buffer = gst_app_sink_pull_buffer(app_sink);
-  self->data_.append(reinterpret_cast<const char*>(buffer->data), buffer->size);
+
+  if (self->builder_->rate() == 0) {
+    int rate = 0;
+    GstCaps* caps = GST_BUFFER_CAPS(buffer);
+    if (!caps || !gst_structure_get_int(gst_caps_get_structure(caps, 0),
+                                        "rate", &rate) || rate <= 0) {
+      qLog(Warning) << "Unknown sample rate for" << self->local_filename_;
+      gst_buffer_unref(buffer);
+      return GST_FLOW_ERROR;
+    }
+    self->builder_->Init(rate);
+  }
+
+  self->builder_->AddFrames(reinterpret_cast<const float*>(buffer->data),
+                            buffer->size / sizeof(float));
   gst_buffer_unref(buffer);
 
   return GST_FLOW_OK;
@@ -175,16 +220,22 @@ GstBusSyncReply MoodbarPipeline::BusCallbackSync(GstBus*, GstMessage* msg, gpoin
 }
 
 void MoodbarPipeline::Stop(bool success) {
+  QMutexLocker l(&mutex_);
+  if (finished_) {
+    return;
+  }
+
+  finished_ = true;
   success_ = success;
-  emit Finished(success);
+  stopped_.release();
 }
 
 void MoodbarPipeline::Cleanup() {
-  Q_ASSERT(QThread::currentThread() == thread());
-  Q_ASSERT(QThread::currentThread() != qApp->thread());
-
   if (pipeline_) {
-    gst_bus_set_sync_handler(gst_pipeline_get_bus(GST_PIPELINE(pipeline_)), NULL, NULL);
+    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+    gst_bus_set_sync_handler(bus, NULL, NULL);
+    gst_object_unref(bus);
+
     gst_element_set_state(pipeline_, GST_STATE_NULL);
     gst_object_unref(pipeline_);
     pipeline_ = NULL;
@@ -18,13 +18,20 @@
 #ifndef MOODBARPIPELINE_H
 #define MOODBARPIPELINE_H
 
+#include <QMutex>
 #include <QObject>
+#include <QSemaphore>
 #include <QUrl>
 
+#include <boost/scoped_ptr.hpp>
+
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
 
-// Creates moodbar data for a single local music file.
+class MoodbarBuilder;
+
+// Creates moodbar data for a single local music file.  The file is decoded by
+// gstreamer and the samples are analysed by a MoodbarBuilder as they arrive.
 class MoodbarPipeline : public QObject {
   Q_OBJECT
 
@@ -32,13 +39,20 @@ public:
   MoodbarPipeline(const QUrl& local_filename);
   ~MoodbarPipeline();
 
+  static const int kMaxWidth;
+
   static bool IsAvailable();
 
   bool success() const { return success_; }
   const QByteArray& data() const { return data_; }
 
-public slots:
-  void Start();
+  // Decodes and analyses the whole file, blocking until it's done, then emits
+  // Finished().  Meant to be run on a worker thread.
+  void Run();
+
+  // Makes Run() give up as soon as possible.  Can be called from any thread,
+  // even before Run() has started.
+  void Abort();
 
 signals:
   void Finished(bool success);
@@ -46,6 +60,7 @@ signals:
 private:
   GstElement* CreateElement(const QString& factory_name);
 
+  bool Start();
   void ReportError(GstMessage* message);
   void Stop(bool success);
   void Cleanup();
@@ -62,6 +77,12 @@ private:
   GstElement* pipeline_;
   GstElement* convert_element_;
 
+  boost::scoped_ptr<MoodbarBuilder> builder_;
+
+  QMutex mutex_;
+  QSemaphore stopped_;
+  bool finished_;
+
   bool success_;
   QByteArray data_;
 };
@@ -97,15 +97,31 @@ ColorVector MoodbarRenderer::Colors(
 }
 
 void MoodbarRenderer::Render(const ColorVector& colors, QPainter* p, const QRect& rect) {
+  p->drawImage(rect.topLeft(), RenderToImage(colors, rect.size()));
+}
+
+QImage MoodbarRenderer::RenderToImage(const ColorVector& colors, const QSize& size) {
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  if (image.isNull())
+    return image;
+
+  if (colors.isEmpty()) {
+    image.fill(0);
+    return image;
+  }
+
+  const int width = size.width();
+  const int height = size.height();
+
   // Sample the colors and map them to screen pixels.
-  ColorVector screen_colors;
-  for (int x=0; x<rect.width(); ++x) {
+  QVector<int> hues(width), sats(width), vals(width);
+  for (int x=0; x<width; ++x) {
     int r = 0;
     int g = 0;
     int b = 0;
 
-    uint start = x       * colors.size() / rect.width();
-    uint end   = (x + 1) * colors.size() / rect.width();
+    uint start = x       * colors.size() / width;
+    uint end   = (x + 1) * colors.size() / width;
 
     if (start == end)
       end = start + 1;
@@ -117,36 +133,32 @@ void MoodbarRenderer::Render(const ColorVector& colors, QPainter* p, const QRect
     }
 
     const uint n = end - start;
-    screen_colors.append(QColor(r/n, g/n, b/n));
+    QColor(r/n, g/n, b/n).getHsv(&hues[x], &sats[x], &vals[x]);
   }
 
-  // Draw the actual moodbar.
-  for (int x=0; x<rect.width(); x++) {
-    int h, s, v;
-    screen_colors[x].getHsv( &h, &s, &v );
-
-    for (int y=0; y<=rect.height()/2; y++) {
-      float coeff = float(y) / float(rect.height()/2);
-      float coeff2 = 1.0f - ((1.0f - coeff) * (1.0f - coeff));
-      coeff = 1.0f - (1.0f - coeff) / 2.0f;
-      coeff2 = 1.f - (1.f - coeff2) / 2.0f;
-
-      p->setPen(QColor::fromHsv(
-          h,
-          qBound(0, int(float(s) * coeff), 255),
-          qBound(0, int(255.f - (255.f - float(v)) * coeff2), 255)));
-
-      p->drawPoint(rect.left() + x, rect.top() + y);
-      p->drawPoint(rect.left() + x, rect.top() + rect.height() - 1 - y);
+  // Draw the actual moodbar straight into the image, a pair of rows at a time
+  // from the edges in to the middle.
+  const int half_height = height / 2;
+  for (int y=0; y<=half_height; y++) {
+    float coeff = half_height ? float(y) / float(half_height) : 1.0f;
+    float coeff2 = 1.0f - ((1.0f - coeff) * (1.0f - coeff));
+    coeff = 1.0f - (1.0f - coeff) / 2.0f;
+    coeff2 = 1.f - (1.f - coeff2) / 2.0f;
+
+    QRgb* top = reinterpret_cast<QRgb*>(image.scanLine(y));
+    QRgb* bottom = reinterpret_cast<QRgb*>(image.scanLine(height - 1 - y));
+
+    for (int x=0; x<width; x++) {
+      const QRgb color = QColor::fromHsv(
+          hues[x],
+          qBound(0, int(float(sats[x]) * coeff), 255),
+          qBound(0, int(255.f - (255.f - float(vals[x])) * coeff2), 255)).rgb();
+
+      top[x] = color;
+      bottom[x] = color;
     }
   }
-}
 
-QImage MoodbarRenderer::RenderToImage(const ColorVector& colors, const QSize& size) {
-  QImage image(size, QImage::Format_ARGB32_Premultiplied);
-  QPainter p(&image);
-  Render(colors, &p, image.rect());
-  p.end();
   return image;
 }
 
@@ -16,6 +16,7 @@
 */
 
 #include "incomingdataparser.h"
+#include "remoteclient.h"
 #include "core/logging.h"
 #include "engines/enginebase.h"
 #include "playlist/playlistmanager.h"
@@ -78,6 +79,8 @@ void IncomingDataParser::Parse(const pb::remote::Message& msg) {
                                               break;
     case pb::remote::REQUEST_PLAYLIST_SONGS:  GetPlaylistSongs(msg);
                                               break;
+    case pb::remote::REQUEST_ART: GetArt(msg);
+                                  break;
     case pb::remote::SET_VOLUME:  emit SetVolume(msg.request_set_volume().volume());
                                   break;
     case pb::remote::PLAY:        emit Play();
@@ -108,7 +111,17 @@ void IncomingDataParser::Parse(const pb::remote::Message& msg) {
 }
 
 void IncomingDataParser::GetPlaylistSongs(const pb::remote::Message& msg) {
-  emit SendPlaylistSongs(msg.request_playlist_songs().id());
+  const pb::remote::RequestPlaylistSongs& request = msg.request_playlist_songs();
+
+  // Only send the songs to the client that asked for them
+  emit SendPlaylistSongs(request.id(), request.offset(), request.limit(),
+                         qobject_cast<RemoteClient*>(sender()));
+}
+
+void IncomingDataParser::GetArt(const pb::remote::Message& msg) {
+  const pb::remote::RequestArt& request = msg.request_art();
+  emit SendArt(QString::fromAscii(request.art_hash().c_str()), request.size(),
+               qobject_cast<RemoteClient*>(sender()));
 }
 
 void IncomingDataParser::ChangeSong(const pb::remote::Message& msg) {
@@ -5,6 +5,8 @@
 #include "core/application.h"
 #include "remotecontrolmessages.pb.h"
 
+class RemoteClient;
+
 class IncomingDataParser : public QObject {
   Q_OBJECT
 public:
@@ -20,7 +22,8 @@ signals:
   void SendClementineInfo();
   void SendFirstData();
   void SendAllPlaylists();
-  void SendPlaylistSongs(int id);
+  void SendPlaylistSongs(int id, int offset, int count, RemoteClient* client);
+  void SendArt(const QString& hash, int size, RemoteClient* client);
 
   void Play();
   void PlayPause();
@@ -42,6 +45,7 @@ private:
   bool close_connection_;
 
   void GetPlaylistSongs(const pb::remote::Message& msg);
+  void GetArt(const pb::remote::Message& msg);
   void ChangeSong(const pb::remote::Message& msg);
   void SetRepeatMode(const pb::remote::Repeat& repeat);
   void SetShuffleMode(const pb::remote::Shuffle& shuffle);
@@ -121,13 +121,19 @@ void NetworkRemote::AcceptConnection() {
             outgoing_data_creator_.get(), SLOT(SendFirstData()));
     connect(incoming_data_parser_.get(), SIGNAL(SendAllPlaylists()),
             outgoing_data_creator_.get(), SLOT(SendAllPlaylists()));
-    connect(incoming_data_parser_.get(), SIGNAL(SendPlaylistSongs(int)),
-            outgoing_data_creator_.get(), SLOT(SendPlaylistSongs(int)));
+    connect(incoming_data_parser_.get(), SIGNAL(SendPlaylistSongs(int,int,int,RemoteClient*)),
+            outgoing_data_creator_.get(), SLOT(SendPlaylistSongs(int,int,int,RemoteClient*)));
+    connect(incoming_data_parser_.get(), SIGNAL(SendArt(QString,int,RemoteClient*)),
+            outgoing_data_creator_.get(), SLOT(SendArt(QString,int,RemoteClient*)));
 
     connect(app_->playlist_manager(), SIGNAL(ActiveChanged(Playlist*)),
             outgoing_data_creator_.get(), SLOT(ActiveChanged(Playlist*)));
     connect(app_->playlist_manager(), SIGNAL(PlaylistChanged(Playlist*)),
             outgoing_data_creator_.get(), SLOT(PlaylistChanged(Playlist*)));
+    connect(app_->playlist_manager(), SIGNAL(PlaylistClosed(int)),
+            outgoing_data_creator_.get(), SLOT(PlaylistClosed(int)));
+    connect(app_->playlist_manager(), SIGNAL(PlaylistDeleted(int)),
+            outgoing_data_creator_.get(), SLOT(PlaylistClosed(int)));
 
     connect(app_->player(), SIGNAL(VolumeChanged(int)), outgoing_data_creator_.get(),
             SLOT(VolumeChanged(int)));
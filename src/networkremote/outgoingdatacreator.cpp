@@ -19,12 +19,23 @@
 
 #include <cmath>
 
+#include <boost/bind.hpp>
+
 #include "networkremote.h"
+#include "remoteartcache.h"
+#include "remoteplaylistsync.h"
+#include "core/closure.h"
+#include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/timeconstants.h"
 
+const int OutgoingDataCreator::kPlaylistChangedDelayMsec = 100;
+
 OutgoingDataCreator::OutgoingDataCreator(Application* app)
-  : app_(app)
+  : app_(app),
+    current_song_generation_(0),
+    playlist_sync_(new RemotePlaylistSync),
+    art_cache_(new RemoteArtCache)
 {
   // Create Keep Alive Timer
   keep_alive_timer_ = new QTimer(this);
@@ -34,9 +45,22 @@ OutgoingDataCreator::OutgoingDataCreator(Application* app)
   // Create the song position timer
   track_position_timer_ = new QTimer(this);
   connect(track_position_timer_, SIGNAL(timeout()), this, SLOT(UpdateTrackPosition()));
+
+  // Changed playlists are sent a little while after they change
+  playlist_changed_timer_ = new QTimer(this);
+  playlist_changed_timer_->setSingleShot(true);
+  playlist_changed_timer_->setInterval(kPlaylistChangedDelayMsec);
+  connect(playlist_changed_timer_, SIGNAL(timeout()), SLOT(SendChangedPlaylists()));
+
+  // The playlist sync isn't thread safe, so everything that uses it runs on
+  // this one thread, in the order it was queued.
+  sync_pool_.setMaxThreadCount(1);
+  art_pool_.setMaxThreadCount(1);
 }
 
 OutgoingDataCreator::~OutgoingDataCreator() {
+  sync_pool_.waitForDone();
+  art_pool_.waitForDone();
 }
 
 void OutgoingDataCreator::SetClients(QList<RemoteClient*>* clients) {
@@ -52,11 +76,19 @@ void OutgoingDataCreator::SendDataToClients(pb::remote::Message* msg) {
     return;
   }
 
+  // Serialise the message once, not once for each client
+  SendRawDataToClients(SerialiseMessage(*msg), AllClients);
+}
+
+void OutgoingDataCreator::SendRawDataToClients(const QByteArray& data,
+                                               Recipients recipients) {
   RemoteClient* client;
   foreach(client, *clients_) {
     // Check if the client is still active
     if (client->State() == QTcpSocket::ConnectedState) {
-      client->SendData(msg);
+      if (IsRecipient(client, recipients)) {
+        client->SendRawData(data);
+      }
     } else {
       clients_->removeAt(clients_->indexOf(client));
       delete client;
@@ -64,6 +96,31 @@ void OutgoingDataCreator::SendDataToClients(pb::remote::Message* msg) {
   }
 }
 
+bool OutgoingDataCreator::IsRecipient(RemoteClient* client,
+                                      Recipients recipients) {
+  switch (recipients) {
+    case DeltaClients:     return client->send_playlist_deltas();
+    case FullListClients:  return !client->send_playlist_deltas();
+    case ArtHashClients:   return client->send_art_by_hash();
+    case InlineArtClients: return !client->send_art_by_hash();
+    case AllClients:
+    default:               return true;
+  }
+}
+
+bool OutgoingDataCreator::HasClients(Recipients recipients) const {
+  foreach (RemoteClient* client, *clients_) {
+    if (IsRecipient(client, recipients))
+      return true;
+  }
+  return false;
+}
+
+QByteArray OutgoingDataCreator::SerialiseMessage(const pb::remote::Message& msg) {
+  const std::string data = msg.SerializeAsString();
+  return QByteArray(data.data(), data.size());
+}
+
 void OutgoingDataCreator::SendClementineInfo() {
   // Create the general message and set the message type
   pb::remote::Message msg;
@@ -153,25 +210,73 @@ void OutgoingDataCreator::CurrentSongChanged(const Song& song, const QString& ur
   current_song_  = song;
   current_uri_   = uri;
   current_image_ = img;
+  current_song_generation_ ++;
 
   if (!clients_->empty()) {
-    // Create the message
+    int i = app_->playlist_manager()->active()->current_row();
+
+    // Send the song straight away, so it arrives before the messages that
+    // follow it.  The art comes afterwards.
     pb::remote::Message msg;
     msg.set_type(pb::remote::CURRENT_METAINFO);
-
-    // If there is no song, create an empty node, otherwise fill it with data
-    int i = app_->playlist_manager()->active()->current_row();
-    CreateSong(
-        current_song_, img, i,
+    CreateSong(song, i,
         msg.mutable_response_current_metadata()->mutable_song_metadata());
-
     SendDataToClients(&msg);
+
+    if (song.is_valid() && !img.isNull()) {
+      // Clients that fetch the art themselves only need its hash, the others
+      // still get it in the message.
+      if (HasClients(ArtHashClients)) {
+        SendCurrentSongArt(i, false, ArtHashClients);
+      }
+      if (HasClients(InlineArtClients)) {
+        SendCurrentSongArt(i, true, InlineArtClients);
+      }
+    }
+  }
+}
+
+void OutgoingDataCreator::SendCurrentSongArt(int index, bool inline_art,
+                                             Recipients recipients) {
+  QFuture<QByteArray> future = ConcurrentRun::Run<QByteArray>(
+      &art_pool_,
+      boost::bind(&OutgoingDataCreator::CreateCurrentSong, this,
+                  current_song_, current_image_, index, inline_art));
+  QFutureWatcher<QByteArray>* watcher = new QFutureWatcher<QByteArray>(this);
+  watcher->setFuture(future);
+  NewClosure(watcher, SIGNAL(finished()),
+             this, SLOT(SendSerialisedCurrentSong(QFutureWatcher<QByteArray>*, int, int)),
+             watcher, int(recipients), current_song_generation_);
+}
+
+QByteArray OutgoingDataCreator::CreateCurrentSong(
+    const Song& song, const QImage& art, int index, bool inline_art) {
+  pb::remote::Message msg;
+  msg.set_type(pb::remote::CURRENT_METAINFO);
+
+  // If there is no song, create an empty node, otherwise fill it with data
+  pb::remote::SongMetadata* song_metadata =
+      msg.mutable_response_current_metadata()->mutable_song_metadata();
+  CreateSong(song, index, song_metadata);
+
+  if (song.is_valid() && !art.isNull()) {
+    // The hash and the encoded art are cached, so this is only slow the
+    // first time we see each image.
+    const QString hash = art_cache_->Add(art);
+    song_metadata->set_art_hash(DataCommaSizeFromQString(hash));
+
+    if (inline_art) {
+      const QByteArray data =
+          art_cache_->Encoded(hash, RemoteArtCache::kMaxSize);
+      song_metadata->set_art(data.constData(), data.size());
+    }
   }
+
+  return SerialiseMessage(msg);
 }
 
 void OutgoingDataCreator::CreateSong(
     const Song& song,
-    const QImage& art,
     const int index,
     pb::remote::SongMetadata* song_metadata) {
   if (song.is_valid()) {
@@ -188,29 +293,39 @@ void OutgoingDataCreator::CreateSong(
     song_metadata->set_track(song.track());
     song_metadata->set_disc(song.disc());
     song_metadata->set_playcount(song.playcount());
+  }
+}
 
-    // Append coverart
-    if (!art.isNull()) {
-      QImage small;
-      // Check if we resize the image
-      if (art.width() > 1000) {
-        small = art.scaled(1000, 1000, Qt::KeepAspectRatio);
-      } else {
-        small = art;
-      }
-
-      // Read the image in a buffer and compress it
-      QByteArray data;
-      QBuffer buf(&data);
-      buf.open(QIODevice::WriteOnly);
-      small.save(&buf, "JPG");
+void OutgoingDataCreator::SendArt(const QString& hash, int size,
+                                  RemoteClient* client) {
+  if (!client)
+    return;
 
-      // Append the Data in the protocol buffer
-      song_metadata->set_art(data.constData(), data.size());
-    }
-  }
+  QFuture<QByteArray> future = ConcurrentRun::Run<QByteArray>(
+      &art_pool_,
+      boost::bind(&OutgoingDataCreator::CreateArt, this, hash, size));
+  QFutureWatcher<QByteArray>* watcher = new QFutureWatcher<QByteArray>(this);
+  watcher->setFuture(future);
+  NewClosure(watcher, SIGNAL(finished()),
+             this, SLOT(SendSerialisedMessageToClient(QFutureWatcher<QByteArray>*, RemoteClient*)),
+             watcher, client);
 }
 
+QByteArray OutgoingDataCreator::CreateArt(const QString& hash, int size) {
+  pb::remote::Message msg;
+  msg.set_type(pb::remote::ART);
+
+  // If we've forgotten about the art the client gets an empty reply, so it
+  // isn't left waiting.
+  const QByteArray data = art_cache_->Encoded(hash, size);
+
+  pb::remote::ResponseArt* response = msg.mutable_response_art();
+  response->set_art_hash(DataCommaSizeFromQString(hash));
+  response->set_size(size);
+  response->set_data(data.constData(), data.size());
+
+  return SerialiseMessage(msg);
+}
 
 void OutgoingDataCreator::VolumeChanged(int volume) {
   // Create the message
@@ -220,44 +335,150 @@ void OutgoingDataCreator::VolumeChanged(int volume) {
   SendDataToClients(&msg);
 }
 
-void OutgoingDataCreator::SendPlaylistSongs(int id) {
-  // Get the PlaylistQByteArray(data.data(), data.size()
+void OutgoingDataCreator::SendPlaylistSongs(int id, int offset, int count,
+                                            RemoteClient* client) {
   Playlist* playlist = app_->playlist_manager()->playlist(id);
   if(!playlist) {
     qLog(Info) << "Could not find playlist with id = " << id;
     return;
   }
 
-  // Create the message and the playlist
+  // Bring the sync up to date first, so the songs we send are the version
+  // the other clients are being told about.  If the playlist was waiting to
+  // be sent anyway, send it now.
+  const bool changed = changed_playlists_.remove(id);
+  SyncPlaylist(playlist, changed);
+
+  QFuture<QByteArray> future = ConcurrentRun::Run<QByteArray>(
+      &sync_pool_,
+      boost::bind(&OutgoingDataCreator::CreatePlaylistSongs, this,
+                  id, offset, count));
+  QFutureWatcher<QByteArray>* watcher = new QFutureWatcher<QByteArray>(this);
+  watcher->setFuture(future);
+
+  if (client) {
+    NewClosure(watcher, SIGNAL(finished()),
+               this, SLOT(SendSerialisedMessageToClient(QFutureWatcher<QByteArray>*, RemoteClient*)),
+               watcher, client);
+  } else {
+    NewClosure(watcher, SIGNAL(finished()),
+               this, SLOT(SendSerialisedMessage(QFutureWatcher<QByteArray>*, int)),
+               watcher, int(AllClients));
+  }
+}
+
+void OutgoingDataCreator::PlaylistChanged(Playlist* playlist) {
+  if (clients_->empty()) {
+    return;
+  }
+
+  // Wait for the playlist to settle before sending anything
+  changed_playlists_.insert(playlist->id());
+  playlist_changed_timer_->start();
+}
+
+void OutgoingDataCreator::PlaylistClosed(int id) {
+  changed_playlists_.remove(id);
+  ConcurrentRun::Run<void>(
+      &sync_pool_,
+      boost::bind(&RemotePlaylistSync::Remove, playlist_sync_.get(), id));
+}
+
+void OutgoingDataCreator::SendChangedPlaylists() {
+  foreach (int id, changed_playlists_) {
+    Playlist* playlist = app_->playlist_manager()->playlist(id);
+    if (playlist) {
+      SyncPlaylist(playlist, true);
+    }
+  }
+  changed_playlists_.clear();
+}
+
+void OutgoingDataCreator::SyncPlaylist(Playlist* playlist, bool send_full_list) {
+  const int id = playlist->id();
+
+  // The items and songs are copied here in the GUI thread, and the slow part
+  // - serialising every song and comparing it with what the clients already
+  // have - happens in the sync thread.
+  QFuture<QByteArray> future = ConcurrentRun::Run<QByteArray>(
+      &sync_pool_,
+      boost::bind(&OutgoingDataCreator::CreatePlaylistDelta, this,
+                  id, playlist->GetAllItems(), playlist->GetAllSongs()));
+  QFutureWatcher<QByteArray>* watcher = new QFutureWatcher<QByteArray>(this);
+  watcher->setFuture(future);
+  NewClosure(watcher, SIGNAL(finished()),
+             this, SLOT(SendSerialisedMessage(QFutureWatcher<QByteArray>*, int)),
+             watcher, int(DeltaClients));
+
+  // Older clients don't know about deltas, so they get the whole playlist
+  // again like they always have.
+  if (send_full_list && HasClients(FullListClients)) {
+    future = ConcurrentRun::Run<QByteArray>(
+        &sync_pool_,
+        boost::bind(&OutgoingDataCreator::CreatePlaylistSongs, this, id, 0, 0));
+    watcher = new QFutureWatcher<QByteArray>(this);
+    watcher->setFuture(future);
+    NewClosure(watcher, SIGNAL(finished()),
+               this, SLOT(SendSerialisedMessage(QFutureWatcher<QByteArray>*, int)),
+               watcher, int(FullListClients));
+  }
+}
+
+QByteArray OutgoingDataCreator::CreatePlaylistDelta(
+    int id, const PlaylistItemList& items, const SongList& songs) {
+  pb::remote::Message msg;
+  msg.set_type(pb::remote::PLAYLIST_DELTA);
+
+  if (!playlist_sync_->Update(id, items, songs,
+                              msg.mutable_response_playlist_delta())) {
+    return QByteArray();
+  }
+  return SerialiseMessage(msg);
+}
+
+QByteArray OutgoingDataCreator::CreatePlaylistSongs(int id, int offset, int count) {
   pb::remote::Message msg;
   msg.set_type(pb::remote::PLAYLIST_SONGS);
 
-  // Create the Response message
-  pb::remote::ResponsePlaylistSongs* pb_response_playlist_songs =
-                                     msg.mutable_response_playlist_songs();
+  pb::remote::ResponsePlaylistSongs* response =
+      msg.mutable_response_playlist_songs();
+  playlist_sync_->GetSongs(id, offset, count, response);
+  if (!response->has_requested_playlist()) {
+    return QByteArray();
+  }
+  return SerialiseMessage(msg);
+}
+
+void OutgoingDataCreator::SendSerialisedMessage(
+    QFutureWatcher<QByteArray>* watcher, int recipients) {
+  watcher->deleteLater();
 
-  // Create a new playlist
-  pb::remote::Playlist* pb_playlist =
-      pb_response_playlist_songs->mutable_requested_playlist();
-  pb_playlist->set_id(id);
+  const QByteArray data = watcher->result();
+  if (!data.isEmpty() && !clients_->empty()) {
+    SendRawDataToClients(data, Recipients(recipients));
+  }
+}
 
-  // Send all songs
-  int index = 0;
-  SongList song_list = playlist->GetAllSongs();
-  QListIterator<Song> it(song_list);
-  QImage null_img;
-  while(it.hasNext()) {
-    Song song   = it.next();
-    pb::remote::SongMetadata* pb_song = pb_response_playlist_songs->add_songs();
-    CreateSong(song, null_img, index, pb_song);
-    ++index;
+void OutgoingDataCreator::SendSerialisedCurrentSong(
+    QFutureWatcher<QByteArray>* watcher, int recipients, int song_generation) {
+  // Don't let the art for the previous song replace the new one.
+  if (song_generation != current_song_generation_) {
+    watcher->deleteLater();
+    return;
   }
-  SendDataToClients(&msg);
+
+  SendSerialisedMessage(watcher, recipients);
 }
 
-void OutgoingDataCreator::PlaylistChanged(Playlist* playlist) {
-  // If a playlist changed, then send the new songs to the client
-  SendPlaylistSongs(playlist->id());
+void OutgoingDataCreator::SendSerialisedMessageToClient(
+    QFutureWatcher<QByteArray>* watcher, RemoteClient* client) {
+  watcher->deleteLater();
+
+  // The client might have gone away while we were busy
+  const QByteArray data = watcher->result();
+  if (!data.isEmpty() && clients_->contains(client)) {
+    client->SendRawData(data);
+  }
 }
 
 void OutgoingDataCreator::StateChanged(Engine::State state) {
@@ -2,10 +2,15 @@
 #define OUTGOINGDATACREATOR_H
 
 #include <QTcpSocket>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QList>
+#include <QSet>
+#include <QThreadPool>
 #include <QTimer>
 
+#include <boost/scoped_ptr.hpp>
+
 #include "core/player.h"
 #include "core/application.h"
 #include "engines/enginebase.h"
@@ -15,20 +20,36 @@
 #include "remotecontrolmessages.pb.h"
 #include "remoteclient.h"
 
+class RemoteArtCache;
+class RemotePlaylistSync;
+
 class OutgoingDataCreator : public QObject {
     Q_OBJECT
 public:
   OutgoingDataCreator(Application* app);
   ~OutgoingDataCreator();
 
+  // How long to wait after a playlist changes before telling the clients, so
+  // that a burst of changes is sent as one.
+  static const int kPlaylistChangedDelayMsec;
+
   void SetClients(QList<RemoteClient*>* clients);
 
+  // Fills in everything but the art, which is sent separately.
+  static void CreateSong(
+      const Song& song,
+      const int index,
+      pb::remote::SongMetadata* song_metadata);
+
 public slots:
   void SendClementineInfo();
   void SendAllPlaylists();
   void SendFirstData();
-  void SendPlaylistSongs(int id);
+  void SendPlaylistSongs(int id, int offset = 0, int count = 0,
+                         RemoteClient* client = NULL);
+  void SendArt(const QString& hash, int size, RemoteClient* client);
   void PlaylistChanged(Playlist*);
+  void PlaylistClosed(int id);
   void VolumeChanged(int volume);
   void ActiveChanged(Playlist*);
   void CurrentSongChanged(const Song& song, const QString& uri, const QImage& img);
@@ -39,24 +60,69 @@ public slots:
   void UpdateTrackPosition();
   void DisconnectAllClients();
 
+private slots:
+  void SendChangedPlaylists();
+  void SendSerialisedMessage(QFutureWatcher<QByteArray>* watcher,
+                             int recipients);
+  void SendSerialisedMessageToClient(QFutureWatcher<QByteArray>* watcher,
+                                     RemoteClient* client);
+  void SendSerialisedCurrentSong(QFutureWatcher<QByteArray>* watcher,
+                                 int recipients, int song_generation);
+
 private:
+  enum Recipients {
+    AllClients,
+    DeltaClients,     // Clients that understand PLAYLIST_DELTA
+    FullListClients,  // Clients that want the whole playlist every time
+    ArtHashClients,   // Clients that fetch album art with REQUEST_ART
+    InlineArtClients  // Clients that want the art in CURRENT_METAINFO
+  };
+
   Application* app_;
   QList<RemoteClient*>* clients_;
   Song current_song_;
   QString current_uri_;
   QImage current_image_;
+  // Goes up every time the current song changes, so art that's still being
+  // encoded for an old song isn't sent.
+  int current_song_generation_;
   Engine::State last_state_;
   QTimer* keep_alive_timer_;
   QTimer* track_position_timer_;
   int keep_alive_timeout_;
 
+  QTimer* playlist_changed_timer_;
+  QSet<int> changed_playlists_;
+
+  // Only touched from sync_pool_, which has just the one thread.
+  boost::scoped_ptr<RemotePlaylistSync> playlist_sync_;
+  QThreadPool sync_pool_;
+
+  // Hashing, scaling and encoding album art is done in art_pool_, which
+  // also has just the one thread so the art is sent in order.
+  boost::scoped_ptr<RemoteArtCache> art_cache_;
+  QThreadPool art_pool_;
+
   void SendDataToClients(pb::remote::Message* msg);
+  void SendRawDataToClients(const QByteArray& data, Recipients recipients);
+  bool HasClients(Recipients recipients) const;
+  static bool IsRecipient(RemoteClient* client, Recipients recipients);
   void SetEngineState(pb::remote::ResponseClementineInfo* msg);
-  void CreateSong(
-      const Song& song,
-      const QImage& art,
-      const int index,
-      pb::remote::SongMetadata* song_metadata);
+
+  void SyncPlaylist(Playlist* playlist, bool send_full_list);
+  // Sends CURRENT_METAINFO again with the art once it's been hashed, and
+  // encoded for clients that want it inline.
+  void SendCurrentSongArt(int index, bool inline_art, Recipients recipients);
+
+  // These run in sync_pool_ and return serialised messages, or an empty
+  // QByteArray if there's nothing to send.
+  QByteArray CreatePlaylistDelta(int id, const PlaylistItemList& items,
+                                 const SongList& songs);
+  QByteArray CreatePlaylistSongs(int id, int offset, int count);
+  QByteArray CreateCurrentSong(const Song& song, const QImage& art,
+                               int index, bool inline_art);
+  QByteArray CreateArt(const QString& hash, int size);
+  static QByteArray SerialiseMessage(const pb::remote::Message& msg);
 };
 
 #endif // OUTGOINGDATACREATOR_H
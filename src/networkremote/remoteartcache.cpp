@@ -0,0 +1,116 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "remoteartcache.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+
+const int RemoteArtCache::kMaxSize = 1000;
+const int RemoteArtCache::kMaxImages = 4;
+const int RemoteArtCache::kMaxEncodedKb = 2 * 1024;  // 2MB
+
+RemoteArtCache::RemoteArtCache()
+  : encoded_(kMaxEncodedKb)
+{
+}
+
+QString RemoteArtCache::Add(const QImage& image) {
+  if (image.isNull())
+    return QString();
+
+  // Most of the time this is the same QImage we were given last time
+  for (int i=0 ; i<images_.count() ; ++i) {
+    if (images_[i].cache_key_ == image.cacheKey()) {
+      images_.move(i, 0);
+      return images_[0].hash_;
+    }
+  }
+
+  Image entry;
+  entry.cache_key_ = image.cacheKey();
+  entry.hash_ = HashImage(image);
+  entry.image_ = image;
+
+  // It might be the same art in a different QImage, the next song on an
+  // album for example.
+  for (int i=0 ; i<images_.count() ; ++i) {
+    if (images_[i].hash_ == entry.hash_) {
+      images_.removeAt(i);
+      break;
+    }
+  }
+
+  images_.prepend(entry);
+  while (images_.count() > kMaxImages) {
+    images_.removeLast();
+  }
+
+  return entry.hash_;
+}
+
+QString RemoteArtCache::HashImage(const QImage& image) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray::number(image.width()) + "x" +
+               QByteArray::number(image.height()) + "x" +
+               QByteArray::number(image.format()));
+
+  for (int y=0 ; y<image.height() ; ++y) {
+    hash.addData(reinterpret_cast<const char*>(image.constScanLine(y)),
+                 image.bytesPerLine());
+  }
+
+  return hash.result().toHex();
+}
+
+QByteArray RemoteArtCache::Encoded(const QString& hash, int size) {
+  QImage image;
+  for (int i=0 ; i<images_.count() ; ++i) {
+    if (images_[i].hash_ == hash) {
+      image = images_[i].image_;
+      break;
+    }
+  }
+  if (image.isNull())
+    return QByteArray();
+
+  // Art is never made bigger, so all the sizes bigger than the image are the
+  // same thing.
+  if (size <= 0 || size > kMaxSize)
+    size = kMaxSize;
+  size = qMin(size, qMax(image.width(), image.height()));
+
+  const QPair<QString, int> key(hash, size);
+  if (QByteArray* data = encoded_.object(key))
+    return *data;
+
+  QImage scaled(image);
+  if (image.width() > size || image.height() > size) {
+    scaled = image.scaled(size, size, Qt::KeepAspectRatio,
+                          Qt::SmoothTransformation);
+  }
+
+  QByteArray* data = new QByteArray;
+  QBuffer buf(data);
+  buf.open(QIODevice::WriteOnly);
+  scaled.save(&buf, "JPG");
+  buf.close();
+
+  const QByteArray ret(*data);
+  encoded_.insert(key, data, qMax(1, data->size() / 1024));
+  return ret;
+}
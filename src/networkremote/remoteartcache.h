@@ -0,0 +1,68 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef REMOTEARTCACHE_H
+#define REMOTEARTCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Gives album art a hash that remote clients can refer to it by, and keeps
+// the JPEG encoded versions of it at the sizes they've asked for so each one
+// is only encoded once however many clients want it.
+// Like RemotePlaylistSync this does no locking, and is meant to be used from
+// one worker thread at a time.
+class RemoteArtCache {
+ public:
+  RemoteArtCache();
+
+  // The biggest art that's sent, and the size used when a client doesn't
+  // ask for one.
+  static const int kMaxSize;
+
+  // How many images are remembered after they stop being current, so
+  // clients that are slow to ask for art still get it.
+  static const int kMaxImages;
+
+  static const int kMaxEncodedKb;
+
+  // Remembers the image and returns its hash.  Adding the same image again
+  // is cheap.
+  QString Add(const QImage& image);
+
+  // Returns the image with this hash scaled to fit in a size x size square
+  // and JPEG encoded, or an empty QByteArray if we don't know the hash.
+  QByteArray Encoded(const QString& hash, int size);
+
+ private:
+  struct Image {
+    qint64 cache_key_;
+    QString hash_;
+    QImage image_;
+  };
+
+  static QString HashImage(const QImage& image);
+
+  QList<Image> images_;
+  QCache<QPair<QString, int>, QByteArray> encoded_;
+};
+
+#endif // REMOTEARTCACHE_H
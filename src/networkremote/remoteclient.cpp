@@ -25,6 +25,8 @@
 
 RemoteClient::RemoteClient(Application* app, QTcpSocket* client)
   : app_(app),
+    send_playlist_deltas_(false),
+    send_art_by_hash_(false),
     client_(client)
 {
   // Open the buffer
@@ -83,11 +85,14 @@ void RemoteClient::ParseMessage(const QByteArray &data) {
     return;
   }
 
-  if (msg.type() == pb::remote::CONNECT && use_auth_code_) {
-    if (msg.request_connect().auth_code() != auth_code_) {
+  if (msg.type() == pb::remote::CONNECT) {
+    if (use_auth_code_ && msg.request_connect().auth_code() != auth_code_) {
       DisconnectClientWrongAuthCode();
       return;
     }
+
+    send_playlist_deltas_ = msg.request_connect().send_playlist_deltas();
+    send_art_by_hash_ = msg.request_connect().send_art_by_hash();
   }
 
   // Now parse the other data
@@ -108,13 +113,16 @@ void RemoteClient::DisconnectClientWrongAuthCode() {
 void RemoteClient::SendData(pb::remote::Message *msg) {
   // Serialize the message
   std::string data = msg->SerializeAsString();
+  SendRawData(QByteArray::fromRawData(data.data(), data.length()));
+}
 
+void RemoteClient::SendRawData(const QByteArray& data) {
   // Check if we are still connected
   if (client_->state() == QTcpSocket::ConnectedState) {
     // write the length of the data first
     QDataStream s(client_);
     s << qint32(data.length());
-    s.writeRawData(data.data(), data.length());
+    s.writeRawData(data.constData(), data.length());
 
     // Do NOT flush data here! If the client is already disconnected, it
     // causes a SIGPIPE termination!!!
@@ -15,8 +15,16 @@ public:
   ~RemoteClient();
 
   void SendData(pb::remote::Message* msg);
+  void SendRawData(const QByteArray& data);
   QAbstractSocket::SocketState State();
 
+  // True if the client asked for playlist changes to be sent as deltas
+  // instead of the whole playlist.
+  bool send_playlist_deltas() const { return send_playlist_deltas_; }
+
+  // True if the client fetches album art itself with REQUEST_ART.
+  bool send_art_by_hash() const { return send_art_by_hash_; }
+
 private slots:
   void IncomingData();
 
@@ -31,6 +39,8 @@ private:
 
   bool use_auth_code_;
   int auth_code_;
+  bool send_playlist_deltas_;
+  bool send_art_by_hash_;
 
   QTcpSocket* client_;
   bool reading_protobuf_;
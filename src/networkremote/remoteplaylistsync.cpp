@@ -0,0 +1,256 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "remoteplaylistsync.h"
+
+#include <QHash>
+
+#include "outgoingdatacreator.h"
+
+const int RemotePlaylistSync::kMaxOperations = 100;
+
+namespace {
+
+pb::remote::PlaylistOperation* AddOperation(
+    pb::remote::ResponsePlaylistDelta* delta,
+    pb::remote::PlaylistOperation::Type type, int index, int count) {
+  pb::remote::PlaylistOperation* operation = delta->add_operations();
+  operation->set_type(type);
+  operation->set_index(index);
+  operation->set_count(count);
+  return operation;
+}
+
+bool Reset(pb::remote::ResponsePlaylistDelta* delta) {
+  delta->clear_operations();
+  delta->set_reset(true);
+  return true;
+}
+
+}  // namespace
+
+RemotePlaylistSync::RemotePlaylistSync() {
+}
+
+bool RemotePlaylistSync::Update(int playlist_id, const PlaylistItemList& items,
+                                const SongList& songs,
+                                pb::remote::ResponsePlaylistDelta* delta) {
+  Q_ASSERT(items.count() == songs.count());
+
+  Snapshot snapshot;
+  snapshot.items_ = items;
+  snapshot.songs_.reserve(songs.count());
+
+  pb::remote::SongMetadata metadata;
+  foreach (const Song& song, songs) {
+    metadata.Clear();
+    OutgoingDataCreator::CreateSong(song, 0, &metadata);
+    metadata.clear_index();
+    snapshot.songs_.push_back(metadata.SerializeAsString());
+  }
+
+  QMap<int, Snapshot>::iterator it = playlists_.find(playlist_id);
+  if (it == playlists_.end()) {
+    // Nobody has seen this playlist yet, so there's nothing to compare with.
+    snapshot.version_ = 1;
+    playlists_.insert(playlist_id, snapshot);
+    return false;
+  }
+
+  const bool changed = Diff(*it, snapshot, delta);
+  if (changed) {
+    delta->set_playlist_id(playlist_id);
+    delta->set_from_version(it->version_);
+    delta->set_to_version(it->version_ + 1);
+    delta->set_item_count(items.count());
+    it->version_ ++;
+  }
+
+  it->items_ = snapshot.items_;
+  it->songs_.swap(snapshot.songs_);
+  return changed;
+}
+
+bool RemotePlaylistSync::Diff(const Snapshot& old_snapshot,
+                              const Snapshot& new_snapshot,
+                              pb::remote::ResponsePlaylistDelta* delta) {
+  typedef const PlaylistItem* Item;
+
+  const int old_count = old_snapshot.items_.count();
+  const int new_count = new_snapshot.items_.count();
+
+  QHash<Item, int> old_indexes;
+  QHash<Item, int> new_indexes;
+  old_indexes.reserve(old_count);
+  new_indexes.reserve(new_count);
+
+  for (int i = 0 ; i < old_count ; ++i) {
+    old_indexes[old_snapshot.items_[i].get()] = i;
+  }
+  for (int i = 0 ; i < new_count ; ++i) {
+    new_indexes[new_snapshot.items_[i].get()] = i;
+  }
+
+  if (old_indexes.count() != old_count || new_indexes.count() != new_count) {
+    // The same item is in there twice, so we can't tell which one moved.
+    return Reset(delta);
+  }
+
+  // The items as the client will have them after each operation so far.
+  QList<Item> items;
+  items.reserve(old_count);
+  foreach (const PlaylistItemPtr& item, old_snapshot.items_) {
+    items << item.get();
+  }
+
+  // Removals go last to first, so the indexes of the ones still to come
+  // aren't affected.
+  for (int i = items.count() - 1 ; i >= 0 ; --i) {
+    if (new_indexes.contains(items[i]))
+      continue;
+
+    int start = i;
+    while (start > 0 && !new_indexes.contains(items[start - 1])) {
+      start --;
+    }
+
+    AddOperation(delta, pb::remote::PlaylistOperation::REMOVE,
+                 start, i - start + 1);
+    if (delta->operations_size() > kMaxOperations)
+      return Reset(delta);
+
+    items.erase(items.begin() + start, items.begin() + i + 1);
+    i = start;
+  }
+
+  // Now the items that were kept need to end up in their new order.  Walk
+  // through it and pull each one that's out of place forward, along with any
+  // that follow it in both lists.
+  QList<Item> kept;
+  kept.reserve(items.count());
+  foreach (const PlaylistItemPtr& item, new_snapshot.items_) {
+    if (old_indexes.contains(item.get())) {
+      kept << item.get();
+    }
+  }
+
+  for (int i = 0 ; i < kept.count() ; ++i) {
+    if (items[i] == kept[i])
+      continue;
+
+    const int from = items.indexOf(kept[i], i + 1);
+    int count = 1;
+    while (from + count < items.count() && i + count < kept.count() &&
+           items[from + count] == kept[i + count]) {
+      count ++;
+    }
+
+    pb::remote::PlaylistOperation* operation = AddOperation(
+        delta, pb::remote::PlaylistOperation::MOVE, from, count);
+    operation->set_destination(i);
+    if (delta->operations_size() > kMaxOperations)
+      return Reset(delta);
+
+    const QList<Item> moved(items.mid(from, count));
+    items.erase(items.begin() + from, items.begin() + from + count);
+    for (int j = 0 ; j < count ; ++j) {
+      items.insert(i + j, moved[j]);
+    }
+    i += count - 1;
+  }
+
+  // Insert the new items first to last, so everything before each one is
+  // already where it should be.
+  for (int i = 0 ; i < new_count ; ++i) {
+    if (old_indexes.contains(new_snapshot.items_[i].get()))
+      continue;
+
+    int end = i + 1;
+    while (end < new_count &&
+           !old_indexes.contains(new_snapshot.items_[end].get())) {
+      end ++;
+    }
+
+    pb::remote::PlaylistOperation* operation = AddOperation(
+        delta, pb::remote::PlaylistOperation::INSERT, i, end - i);
+    if (delta->operations_size() > kMaxOperations)
+      return Reset(delta);
+
+    AddSongs(new_snapshot, i, end - i, operation->mutable_songs());
+    i = end - 1;
+  }
+
+  // Finally any songs whose metadata changed.
+  for (int i = 0 ; i < new_count ; ++i) {
+    int end = i;
+    while (end < new_count) {
+      const Item item = new_snapshot.items_[end].get();
+      if (!old_indexes.contains(item) ||
+          old_snapshot.songs_[old_indexes[item]] == new_snapshot.songs_[end]) {
+        break;
+      }
+      end ++;
+    }
+
+    if (end == i)
+      continue;
+
+    pb::remote::PlaylistOperation* operation = AddOperation(
+        delta, pb::remote::PlaylistOperation::UPDATE, i, end - i);
+    if (delta->operations_size() > kMaxOperations)
+      return Reset(delta);
+
+    AddSongs(new_snapshot, i, end - i, operation->mutable_songs());
+    i = end - 1;
+  }
+
+  return delta->operations_size() > 0;
+}
+
+void RemotePlaylistSync::AddSongs(
+    const Snapshot& snapshot, int index, int count,
+    google::protobuf::RepeatedPtrField<pb::remote::SongMetadata>* songs) {
+  songs->Reserve(songs->size() + count);
+  for (int i = index ; i < index + count ; ++i) {
+    pb::remote::SongMetadata* song = songs->Add();
+    song->ParseFromString(snapshot.songs_[i]);
+    song->set_index(i);
+  }
+}
+
+void RemotePlaylistSync::GetSongs(int playlist_id, int offset, int count,
+                                  pb::remote::ResponsePlaylistSongs* response) const {
+  QMap<int, Snapshot>::const_iterator it = playlists_.find(playlist_id);
+  if (it == playlists_.end())
+    return;
+
+  const int total = it->songs_.size();
+  offset = qBound(0, offset, total);
+  count = count <= 0 ? total - offset : qMin(count, total - offset);
+
+  pb::remote::Playlist* playlist = response->mutable_requested_playlist();
+  playlist->set_id(playlist_id);
+  playlist->set_item_count(total);
+
+  response->set_version(it->version_);
+  response->set_offset(offset);
+  AddSongs(*it, offset, count, response->mutable_songs());
+}
+
+void RemotePlaylistSync::Remove(int playlist_id) {
+  playlists_.remove(playlist_id);
+}
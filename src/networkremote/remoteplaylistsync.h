@@ -0,0 +1,80 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef REMOTEPLAYLISTSYNC_H
+#define REMOTEPLAYLISTSYNC_H
+
+#include <string>
+#include <vector>
+
+#include <QMap>
+
+#include "core/song.h"
+#include "playlist/playlistitem.h"
+#include "remotecontrolmessages.pb.h"
+
+// Remembers what the remote clients were last told about each playlist, so
+// that when one changes they can be sent the rows that were inserted, removed,
+// moved or updated instead of the whole thing again.
+// Working out the changes and serialising the songs is too slow for big
+// playlists to do on the GUI thread, so this is meant to be used from one
+// worker thread at a time.  It doesn't do any locking of its own.
+class RemotePlaylistSync {
+ public:
+  RemotePlaylistSync();
+
+  // Past this many operations a delta isn't worth it, and the clients are
+  // told to fetch the playlist again.
+  static const int kMaxOperations;
+
+  // Brings our copy of the playlist up to date with its current items and
+  // their songs.  If we knew about the playlist before and anything changed,
+  // fills in the delta and returns true.
+  bool Update(int playlist_id, const PlaylistItemList& items,
+              const SongList& songs, pb::remote::ResponsePlaylistDelta* delta);
+
+  // Fills in count songs starting at offset from our copy of the playlist.
+  // A count of 0 or less means all of them.
+  void GetSongs(int playlist_id, int offset, int count,
+                pb::remote::ResponsePlaylistSongs* response) const;
+
+  void Remove(int playlist_id);
+
+ private:
+  struct Snapshot {
+    Snapshot() : version_(0) {}
+
+    int version_;
+
+    // Kept so the items' addresses can't be reused while we remember them.
+    PlaylistItemList items_;
+
+    // The songs' metadata without their index, so moving a song around
+    // doesn't count as changing it.
+    std::vector<std::string> songs_;
+  };
+
+  static bool Diff(const Snapshot& old_snapshot, const Snapshot& new_snapshot,
+                   pb::remote::ResponsePlaylistDelta* delta);
+  static void AddSongs(const Snapshot& snapshot, int index, int count,
+                       google::protobuf::RepeatedPtrField<pb::remote::SongMetadata>* songs);
+
+ private:
+  QMap<int, Snapshot> playlists_;
+};
+
+#endif // REMOTEPLAYLISTSYNC_H
@@ -101,6 +101,10 @@ Playlist::Playlist(PlaylistBackend* backend,
                    QObject *parent)
   : QAbstractListModel(parent),
     is_loading_(false),
+    restore_state_(Restore_NotStarted),
+    restore_watcher_(NULL),
+    restored_rows_(0),
+    save_after_restore_(false),
     proxy_(new PlaylistFilter(this)),
     queue_(new Queue(this)),
     backend_(backend),
@@ -123,8 +127,6 @@ Playlist::Playlist(PlaylistBackend* backend,
   connect(this, SIGNAL(rowsInserted(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
   connect(this, SIGNAL(rowsRemoved(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
 
-  Restore();
-
   proxy_->setSourceModel(this);
   queue_->setSourceModel(this);
 
@@ -141,6 +143,9 @@ Playlist::Playlist(PlaylistBackend* backend,
 }
 
 Playlist::~Playlist() {
+  if (restore_watcher_)
+    restore_watcher_->cancel();
+
   items_.clear();
   library_items_by_id_.clear();
 }
@@ -382,6 +387,9 @@ void Playlist::ItemReloadComplete() {
   watcher->deleteLater();
   const QPersistentModelIndex& index = watcher->index();
   if (index.isValid()) {
+    // The playlist only rewrites the rows it's told have changed.
+    Save(PlaylistItemList() << item_at(index.row()));
+
     emit dataChanged(index, index);
     emit EditingFinished(index);
   }
@@ -1302,11 +1310,21 @@ void Playlist::SetCurrentIsPaused(bool paused) {
                 index(current_item_index_.row(), ColumnCount-1));
 }
 
-void Playlist::Save() const {
+void Playlist::Save(const PlaylistItemList& changed_items) {
   if (!backend_ || is_loading_)
     return;
 
-  backend_->SavePlaylistAsync(id_, items_, last_played_row(), dynamic_playlist_);
+  if (restore_state_ != Restore_Finished) {
+    // Saving now would throw away the items that haven't been restored yet,
+    // so make sure they're on their way and save once they're in.
+    save_after_restore_ = true;
+    changed_during_restore_ << changed_items;
+    Restore();
+    return;
+  }
+
+  backend_->SavePlaylistAsync(id_, items_, last_played_row(), dynamic_playlist_,
+                              changed_items);
 }
 
 namespace {
@@ -1314,40 +1332,57 @@ typedef QFutureWatcher<shared_ptr<PlaylistItem> > PlaylistItemFutureWatcher;
 }
 
 void Playlist::Restore() {
-  if (!backend_)
+  if (!backend_ || restore_state_ != Restore_NotStarted)
     return;
 
-  items_.clear();
-  virtual_items_.clear();
-  library_items_by_id_.clear();
+  restore_state_ = Restore_Running;
+  restored_rows_ = 0;
 
-  PlaylistBackend::PlaylistItemFuture future = backend_->GetPlaylistItems(id_);
-  PlaylistItemFutureWatcher* watcher = new PlaylistItemFutureWatcher(this);
-  watcher->setFuture(future);
-  connect(watcher, SIGNAL(finished()), SLOT(ItemsLoaded()));
+  restore_watcher_ = new PlaylistItemFutureWatcher(this);
+  connect(restore_watcher_, SIGNAL(resultsReadyAt(int,int)), SLOT(ItemsLoadedAt(int,int)));
+  connect(restore_watcher_, SIGNAL(finished()), SLOT(ItemsLoaded()));
+  restore_watcher_->setFuture(backend_->GetPlaylistItems(id_));
 }
 
-void Playlist::ItemsLoaded() {
-  PlaylistItemFutureWatcher* watcher = static_cast<PlaylistItemFutureWatcher*>(sender());
-  watcher->deleteLater();
-
-  PlaylistItemList items = watcher->future().results();
+void Playlist::ItemsLoadedAt(int begin, int end) {
+  PlaylistItemList items;
+  for (int i=begin ; i<end ; ++i) {
+    PlaylistItemPtr item = restore_watcher_->resultAt(i);
 
-  // backend returns empty elements for library items which it couldn't 
-  // match (because they got deleted); we don't need those
-  QMutableListIterator<PlaylistItemPtr> it(items);
-  while (it.hasNext()) {
-    PlaylistItemPtr item = it.next();
+    // backend returns empty elements for library items which it couldn't
+    // match (because they got deleted); we don't need those
+    if (!item || (item->IsLocalLibraryItem() && item->Metadata().url().isEmpty()))
+      continue;
 
-    if (item->IsLocalLibraryItem() && item->Metadata().url().isEmpty()) {
-      it.remove();
-    }
+    items << item;
   }
 
+  if (items.isEmpty())
+    return;
+
+  // The restored items go in before anything that was added while the
+  // restore was running.
+  const bool first_items = restored_rows_ == 0;
+  const int pos = qMin(restored_rows_, items_.count());
+
   is_loading_ = true;
-  InsertItems(items, 0);
+  InsertItemsWithoutUndo(items, pos);
   is_loading_ = false;
 
+  restored_rows_ = pos + items.count();
+
+  if (first_items)
+    emit FirstItemsRestored();
+}
+
+void Playlist::ItemsLoaded() {
+  PlaylistItemList items = restore_watcher_->future().results();
+  backend_->ItemsRestored(id_, items);
+
+  restore_watcher_->deleteLater();
+  restore_watcher_ = NULL;
+  restore_state_ = Restore_Finished;
+
   PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
 
   // the newly loaded list of items might be shorter than it was before so
@@ -1378,6 +1413,12 @@ void Playlist::ItemsLoaded() {
 
   emit RestoreFinished();
 
+  if (save_after_restore_) {
+    save_after_restore_ = false;
+    Save(changed_during_restore_);
+    changed_during_restore_.clear();
+  }
+
   QSettings s;
   s.beginGroup(kSettingsGroup);
 
@@ -1661,10 +1702,13 @@ void Playlist::RemoveItemsNotInQueue() {
 }
 
 void Playlist::ReloadItems(const QList<int>& rows) {
+  PlaylistItemList reloaded_items;
+
   foreach (int row, rows) {
     PlaylistItemPtr item = item_at(row);
 
     item->Reload();
+    reloaded_items << item;
 
     if (row == current_row()) {
       InformOfCurrentSongChange();
@@ -1673,7 +1717,7 @@ void Playlist::ReloadItems(const QList<int>& rows) {
     }
   }
 
-  Save();
+  Save(reloaded_items);
 }
 
 void Playlist::RateSong(const QModelIndex& index, double rating) {
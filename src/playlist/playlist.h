@@ -19,6 +19,7 @@
 #define PLAYLIST_H
 
 #include <QAbstractItemModel>
+#include <QFutureWatcher>
 #include <QList>
 
 #include <boost/shared_ptr.hpp>
@@ -162,8 +163,13 @@ class Playlist : public QAbstractListModel {
   static bool set_column_value(Song& song, Column column, const QVariant& value);
 
   // Persistence
-  void Save() const;
+  // changed_items have been modified in place and need to be written out
+  // again even though they're still in the same rows.
+  void Save(const PlaylistItemList& changed_items = PlaylistItemList());
+  // Starts loading the items from the database in the background, if that
+  // hasn't been done already.  Nothing is saved until it has finished.
   void Restore();
+  bool is_restored() const { return restore_state_ == Restore_Finished; }
 
   // Accessors
   QSortFilterProxyModel* proxy() const;
@@ -294,6 +300,8 @@ class Playlist : public QAbstractListModel {
   void SetColumnAlignment(const ColumnAlignmentMap& alignment);
 
  signals:
+  // Emitted when the first restored items appear in the playlist.
+  void FirstItemsRestored();
   void RestoreFinished();
   void CurrentSongChanged(const Song& metadata);
   void EditingFinished(const QModelIndex& index);
@@ -345,11 +353,26 @@ class Playlist : public QAbstractListModel {
   void QueueLayoutChanged();
   void SongSaveComplete(TagReaderReply* reply, const QPersistentModelIndex& index);
   void ItemReloadComplete();
+  void ItemsLoadedAt(int begin, int end);
   void ItemsLoaded();
   void SongInsertVetoListenerDestroyed();
 
  private:
+  enum RestoreState {
+    Restore_NotStarted,
+    Restore_Running,
+    Restore_Finished
+  };
+
   bool is_loading_;
+  RestoreState restore_state_;
+  QFutureWatcher<PlaylistItemPtr>* restore_watcher_;
+  // Restored items are inserted here, after the ones restored before them.
+  int restored_rows_;
+  // Set if the playlist changed while it was being restored.
+  bool save_after_restore_;
+  PlaylistItemList changed_during_restore_;
+
   PlaylistFilter* proxy_;
   Queue* queue_;
 
@@ -17,7 +17,9 @@
 
 #include "playlistbackend.h"
 #include "core/application.h"
+#include "core/concurrentrun.h"
 #include "core/database.h"
+#include "core/logging.h"
 #include "core/scopedtransaction.h"
 #include "core/song.h"
 #include "library/librarybackend.h"
@@ -28,8 +30,12 @@
 
 #include <QFile>
 #include <QHash>
+#include <QMultiHash>
 #include <QMutexLocker>
+#include <QSet>
 #include <QSqlQuery>
+#include <QTimer>
+#include <QVector>
 #include <QtConcurrentMap>
 #include <QtDebug>
 
@@ -40,12 +46,53 @@ using smart_playlists::GeneratorPtr;
 using boost::shared_ptr;
 
 const int PlaylistBackend::kSongTableJoins = 4;
+const int PlaylistBackend::kSaveDelayMsec = 500;
+const qint64 PlaylistBackend::kPositionGap = 1024;
+const int PlaylistBackend::kRestoreChunkSize = 500;
+
+namespace {
+
+// Lets LoadPlaylistItems report its results a chunk at a time through the
+// future, rather than all at once when it returns.
+class PlaylistItemLoader : public ThreadFunctorBase<PlaylistItemPtr> {
+ public:
+  typedef boost::function<void (QFutureInterface<PlaylistItemPtr>*)> Function;
+
+  PlaylistItemLoader(Function function) : function_(function) {}
+
+  void run() {
+    function_(this);
+    this->reportFinished();
+  }
+
+ private:
+  Function function_;
+};
+
+}
 
 PlaylistBackend::PlaylistBackend(Application* app, QObject* parent)
   : QObject(parent),
     app_(app),
-    db_(app_->database())
+    db_(app_->database()),
+    save_timer_(new QTimer(this))
+{
+  Init();
+}
+
+PlaylistBackend::PlaylistBackend(Database* db, QObject* parent)
+  : QObject(parent),
+    app_(NULL),
+    db_(db),
+    save_timer_(new QTimer(this))
 {
+  Init();
+}
+
+void PlaylistBackend::Init() {
+  save_timer_->setSingleShot(true);
+  save_timer_->setInterval(kSaveDelayMsec);
+  connect(save_timer_, SIGNAL(timeout()), SLOT(FlushPendingSaves()));
 }
 
 PlaylistBackend::PlaylistList PlaylistBackend::GetAllOpenPlaylists() {
@@ -57,7 +104,7 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetAllPlaylists() {
 }
 
 PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(bool open_in_ui) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   PlaylistList ret;
@@ -91,7 +138,7 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(bool open_in_ui) {
 }
 
 PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, name, last_played, dynamic_playlist_type,"
@@ -118,15 +165,22 @@ PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
   return p;
 }
 
-QFuture<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
-  QMutexLocker l(db_->Mutex());
+PlaylistBackend::PlaylistItemFuture PlaylistBackend::GetPlaylistItems(int playlist) {
+  PlaylistItemLoader* loader = new PlaylistItemLoader(
+        boost::bind(&PlaylistBackend::LoadPlaylistItems, this, playlist, _1));
+  return loader->Start(QThreadPool::globalInstance());
+}
+
+void PlaylistBackend::LoadPlaylistItems(int playlist,
+                                        QFutureInterface<PlaylistItemPtr>* future) {
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QString query = "SELECT songs.ROWID, " + Song::JoinSpec("songs") + ","
                   "       magnatune_songs.ROWID, " + Song::JoinSpec("magnatune_songs") + ","
                   "       jamendo_songs.ROWID, " + Song::JoinSpec("jamendo_songs") + ","
                   "       p.ROWID, " + Song::JoinSpec("p") + ","
-                  "       p.type, p.radio_service"
+                  "       p.type, p.radio_service, p.position"
                   " FROM playlist_items AS p"
                   " LEFT JOIN songs"
                   "    ON p.library_id = songs.ROWID"
@@ -134,24 +188,72 @@ QFuture<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
                   "    ON p.library_id = magnatune_songs.ROWID"
                   " LEFT JOIN jamendo.songs AS jamendo_songs"
                   "    ON p.library_id = jamendo_songs.ROWID"
-                  " WHERE p.playlist = :playlist";
-  QSqlQuery q(query, db);
+                  " WHERE p.playlist = :playlist"
+                  " ORDER BY p.position, p.ROWID";
+  QSqlQuery q(db);
+  q.setForwardOnly(true);
+  q.prepare(query);
 
   q.bindValue(":playlist", playlist);
   q.exec();
   if (db_->CheckErrors(q))
-    return QFuture<PlaylistItemPtr>();
+    return;
+
+  // The playlist item's own columns come after the joined song tables.
+  const int row_id_column = (Song::kColumns.count() + 1) * (kSongTableJoins - 1);
+  const int position_column = (Song::kColumns.count() + 1) * kSongTableJoins + 2;
+
+  // it's probable that we'll have a few songs associated with the
+  // same CUE so we're caching results of parsing CUEs
+  boost::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
 
   QList<SqlRow> rows;
+  PersistedItemList persisted;
+  int reported = 0;
 
   while (q.next()) {
+    if (future->isCanceled())
+      return;
+
     rows << SqlRow(q);
+
+    PersistedItem item;
+    item.row_id = q.value(row_id_column).toInt();
+    item.position = q.value(position_column).toLongLong();
+    persisted << item;
+
+    // In WAL mode an open query doesn't get in the way of writers, so hand
+    // items over while we're still reading.  Otherwise read everything first
+    // and let go of the database as soon as possible.
+    if (db_->wal_enabled() && rows.count() == kRestoreChunkSize) {
+      ReportPlaylistItems(rows, state_ptr, future, reported);
+      reported += rows.count();
+      rows.clear();
+    }
   }
 
-  // it's probable that we'll have a few songs associated with the
-  // same CUE so we're caching results of parsing CUEs
-  boost::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
-  return QtConcurrent::mapped(rows, boost::bind(&PlaylistBackend::NewSongFromQuery, this, _1, state_ptr));
+  q.finish();
+  l.unlock();
+
+  for (int i=0 ; i<rows.count() ; i += kRestoreChunkSize) {
+    if (future->isCanceled())
+      return;
+
+    const QList<SqlRow> chunk = rows.mid(i, kRestoreChunkSize);
+    ReportPlaylistItems(chunk, state_ptr, future, reported);
+    reported += chunk.count();
+  }
+
+  QMutexLocker save_locker(&save_mutex_);
+  restoring_items_[playlist] = persisted;
+}
+
+void PlaylistBackend::ReportPlaylistItems(
+    const QList<SqlRow>& rows, boost::shared_ptr<NewSongFromQueryState> state,
+    QFutureInterface<PlaylistItemPtr>* future, int begin) {
+  const PlaylistItemList items = QtConcurrent::blockingMapped(
+        rows, boost::bind(&PlaylistBackend::NewSongFromQuery, this, _1, state));
+  future->reportResults(items.toVector(), begin);
 }
 
 PlaylistItemPtr PlaylistBackend::NewSongFromQuery(const SqlRow& row, boost::shared_ptr<NewSongFromQueryState> state) {
@@ -175,7 +277,7 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, boost::sha
   if(item->type() != "File") {
     return item;
   }
-  CueParser cue_parser(app_->library_backend());
+  CueParser cue_parser(app_ ? app_->library_backend() : NULL);
 
   Song song = item->Metadata();
   // we're only interested in .cue songs here
@@ -219,25 +321,193 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, boost::sha
   return item;
 }
 
+void PlaylistBackend::ItemsRestored(int playlist, const PlaylistItemList& items) {
+  QMutexLocker l(&save_mutex_);
+
+  PersistedItemList persisted = restoring_items_.take(playlist);
+  if (persisted.count() != items.count())
+    return;
+
+  for (int i=0 ; i<items.count() ; ++i) {
+    persisted[i].item = items[i];
+  }
+  persisted_items_[playlist] = persisted;
+}
+
 void PlaylistBackend::SavePlaylistAsync(int playlist, const PlaylistItemList &items,
-                                        int last_played, GeneratorPtr dynamic) {
+                                        int last_played, GeneratorPtr dynamic,
+                                        const PlaylistItemList& changed_items) {
   metaObject()->invokeMethod(this, "SavePlaylist", Qt::QueuedConnection,
                              Q_ARG(int, playlist),
                              Q_ARG(PlaylistItemList, items),
                              Q_ARG(int, last_played),
-                             Q_ARG(smart_playlists::GeneratorPtr, dynamic));
+                             Q_ARG(smart_playlists::GeneratorPtr, dynamic),
+                             Q_ARG(PlaylistItemList, changed_items));
 }
 
 void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList& items,
-                                   int last_played, GeneratorPtr dynamic) {
-  QMutexLocker l(db_->Mutex());
+                                   int last_played, GeneratorPtr dynamic,
+                                   const PlaylistItemList& changed_items) {
+  {
+    QMutexLocker l(&save_mutex_);
+
+    // Only the latest state of the playlist matters, except for items that
+    // changed in place - they have to be written again whenever they changed.
+    PendingSave& save = pending_saves_[playlist];
+    save.items = items;
+    save.changed_items << changed_items;
+    save.last_played = last_played;
+    save.dynamic = dynamic;
+  }
+
+  if (!save_timer_->isActive())
+    save_timer_->start();
+}
+
+void PlaylistBackend::FlushPendingSaves() {
+  save_timer_->stop();
+
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
+  QMap<int, PendingSave> pending;
+  {
+    QMutexLocker save_locker(&save_mutex_);
+    pending = pending_saves_;
+    pending_saves_.clear();
+  }
+
+  for (QMap<int, PendingSave>::const_iterator it = pending.constBegin() ;
+       it != pending.constEnd() ; ++it) {
+    WritePlaylist(db, it.key(), it.value());
+  }
+}
+
+bool PlaylistBackend::WritePlaylist(QSqlDatabase& db, int playlist,
+                                    const PendingSave& save) {
+  // Take the old items out while we work - if anything fails they stay out
+  // and the next save rewrites the whole playlist.
+  bool have_old_items = false;
+  PersistedItemList old_items;
+  {
+    QMutexLocker l(&save_mutex_);
+    have_old_items = persisted_items_.contains(playlist);
+    old_items = persisted_items_.take(playlist);
+  }
+
+  const PlaylistItemList& items = save.items;
+  const int count = items.count();
+
+  // Match each item to the row it was stored in last time, or -1 if it's new.
+  // The same item can appear more than once so rows are matched in order.
+  QVector<int> old_index(count, -1);
+  QMultiHash<PlaylistItem*, int> unmatched;
+  for (int i=old_items.count()-1 ; i>=0 ; --i) {
+    unmatched.insert(old_items[i].item.get(), i);
+  }
+
+  QSet<PlaylistItem*> changed;
+  foreach (PlaylistItemPtr item, save.changed_items) {
+    changed.insert(item.get());
+  }
+
+  for (int i=0 ; i<count ; ++i) {
+    PlaylistItem* item = items[i].get();
+    if (changed.contains(item))
+      continue;
+
+    QMultiHash<PlaylistItem*, int>::iterator it = unmatched.find(item);
+    if (it != unmatched.end()) {
+      old_index[i] = it.value();
+      unmatched.erase(it);
+    }
+  }
+
+  // The matched items whose old rows form the longest increasing sequence can
+  // keep their positions.  Everything else is given a new position between
+  // them.
+  QVector<bool> keep(count, false);
+  {
+    QVector<int> tails;
+    QVector<int> previous(count, -1);
+    for (int i=0 ; i<count ; ++i) {
+      if (old_index[i] == -1)
+        continue;
+
+      int lo = 0;
+      int hi = tails.count();
+      while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (old_index[tails[mid]] < old_index[i])
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+
+      previous[i] = lo > 0 ? tails[lo - 1] : -1;
+      if (lo == tails.count())
+        tails << i;
+      else
+        tails[lo] = i;
+    }
+
+    for (int i = tails.isEmpty() ? -1 : tails.last() ; i != -1 ; i = previous[i]) {
+      keep[i] = true;
+    }
+  }
+
+  QVector<qint64> positions(count);
+  bool renumber = false;
+  bool have_lower = false;
+  qint64 lower = 0;
+  for (int i=0 ; i<count && !renumber ; ) {
+    if (keep[i]) {
+      lower = positions[i] = old_items[old_index[i]].position;
+      have_lower = true;
+      ++i;
+      continue;
+    }
+
+    // Spread this run of items evenly up to the next item that stays put.
+    int end = i;
+    while (end < count && !keep[end])
+      ++end;
+    const int run = end - i;
+
+    const qint64 upper = end < count
+        ? old_items[old_index[end]].position
+        : lower + kPositionGap * (run + 1);
+    if (!have_lower)
+      lower = upper - kPositionGap * (run + 1);
+
+    const qint64 step = (upper - lower) / (run + 1);
+    if (step < 1) {
+      // There's no room left between the neighbours.
+      renumber = true;
+      break;
+    }
+
+    for (int j=0 ; j<run ; ++j) {
+      positions[i + j] = lower + step * (j + 1);
+    }
+    i = end;
+  }
+
+  if (renumber) {
+    qLog(Debug) << "Renumbering playlist" << playlist;
+    for (int i=0 ; i<count ; ++i) {
+      positions[i] = (i + 1) * kPositionGap;
+    }
+  }
+
   QSqlQuery clear("DELETE FROM playlist_items WHERE playlist = :playlist", db);
+  QSqlQuery remove("DELETE FROM playlist_items WHERE ROWID = :id", db);
+  QSqlQuery move("UPDATE playlist_items SET position = :position"
+                 " WHERE ROWID = :id", db);
   QSqlQuery insert("INSERT INTO playlist_items"
-                   " (playlist, type, library_id, radio_service, " +
+                   " (playlist, position, type, library_id, radio_service, " +
                       Song::kColumnSpec + ")"
-                   " VALUES (:playlist, :type, :library_id, :radio_service, " +
+                   " VALUES (:playlist, :position, :type, :library_id, :radio_service, " +
                              Song::kBindSpec + ")", db);
   QSqlQuery update("UPDATE playlists SET "
                    "   last_played=:last_played,"
@@ -248,27 +518,65 @@ void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList& items,
 
   ScopedTransaction transaction(&db);
 
-  // Clear the existing items in the playlist
-  clear.bindValue(":playlist", playlist);
-  clear.exec();
-  if (db_->CheckErrors(clear))
-    return;
+  if (have_old_items && unmatched.count() < old_items.count()) {
+    // Remove the rows that didn't match any item
+    foreach (int i, unmatched.values()) {
+      remove.bindValue(":id", old_items[i].row_id);
+      remove.exec();
+      if (db_->CheckErrors(remove))
+        return false;
+    }
+  } else {
+    // Either we don't know what's in the table or none of it is being kept,
+    // so start again from scratch
+    clear.bindValue(":playlist", playlist);
+    clear.exec();
+    if (db_->CheckErrors(clear))
+      return false;
+  }
 
-  // Save the new ones
-  foreach (PlaylistItemPtr item, items) {
-    insert.bindValue(":playlist", playlist);
-    item->BindToQuery(&insert);
+  PersistedItemList new_items;
+  new_items.reserve(count);
+  int moved = 0;
+  int inserted = 0;
+
+  for (int i=0 ; i<count ; ++i) {
+    PersistedItem persisted;
+    persisted.item = items[i];
+    persisted.position = positions[i];
+
+    if (old_index[i] == -1) {
+      insert.bindValue(":playlist", playlist);
+      insert.bindValue(":position", positions[i]);
+      items[i]->BindToQuery(&insert);
+
+      insert.exec();
+      if (db_->CheckErrors(insert))
+        return false;
+      persisted.row_id = insert.lastInsertId().toInt();
+      ++inserted;
+    } else {
+      persisted.row_id = old_items[old_index[i]].row_id;
+
+      if (positions[i] != old_items[old_index[i]].position) {
+        move.bindValue(":position", positions[i]);
+        move.bindValue(":id", persisted.row_id);
+        move.exec();
+        if (db_->CheckErrors(move))
+          return false;
+        ++moved;
+      }
+    }
 
-    insert.exec();
-    db_->CheckErrors(insert);
+    new_items << persisted;
   }
 
   // Update the last played track number
-  update.bindValue(":last_played", last_played);
-  if (dynamic) {
-    update.bindValue(":dynamic_type", dynamic->type());
-    update.bindValue(":dynamic_data", dynamic->Save());
-    update.bindValue(":dynamic_backend", dynamic->library()->songs_table());
+  update.bindValue(":last_played", save.last_played);
+  if (save.dynamic) {
+    update.bindValue(":dynamic_type", save.dynamic->type());
+    update.bindValue(":dynamic_data", save.dynamic->Save());
+    update.bindValue(":dynamic_backend", save.dynamic->library()->songs_table());
   } else {
     update.bindValue(":dynamic_type", QString());
     update.bindValue(":dynamic_data", QByteArray());
@@ -277,14 +585,21 @@ void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList& items,
   update.bindValue(":playlist", playlist);
   update.exec();
   if (db_->CheckErrors(update))
-    return;
+    return false;
 
   transaction.Commit();
+
+  qLog(Debug) << "Saved playlist" << playlist << "-" << inserted << "inserted,"
+              << moved << "moved," << unmatched.count() << "removed";
+
+  QMutexLocker l(&save_mutex_);
+  persisted_items_[playlist] = new_items;
+  return true;
 }
 
 int PlaylistBackend::CreatePlaylist(const QString &name,
                                     const QString& special_type) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("INSERT INTO playlists (name, special_type)"
@@ -299,8 +614,16 @@ int PlaylistBackend::CreatePlaylist(const QString &name,
 }
 
 void PlaylistBackend::RemovePlaylist(int id) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
+
+  {
+    QMutexLocker save_locker(&save_mutex_);
+    pending_saves_.remove(id);
+    persisted_items_.remove(id);
+    restoring_items_.remove(id);
+  }
+
   QSqlQuery delete_playlist("DELETE FROM playlists WHERE ROWID=:id", db);
   QSqlQuery delete_items("DELETE FROM playlist_items WHERE playlist=:id", db);
 
@@ -321,7 +644,7 @@ void PlaylistBackend::RemovePlaylist(int id) {
 }
 
 void PlaylistBackend::RenamePlaylist(int id, const QString &new_name) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   QSqlQuery q("UPDATE playlists SET name=:name WHERE ROWID=:id", db);
   q.bindValue(":name", new_name);
@@ -332,7 +655,7 @@ void PlaylistBackend::RenamePlaylist(int id, const QString &new_name) {
 }
 
 void PlaylistBackend::SetPlaylistOrder(const QList<int>& ids) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction transaction(&db);
 
@@ -354,7 +677,7 @@ void PlaylistBackend::SetPlaylistOrder(const QList<int>& ids) {
 }
 
 void PlaylistBackend::SetPlaylistUiPath(int id, const QString& path) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   QSqlQuery q("UPDATE playlists SET ui_path=:path WHERE ROWID=:id", db);
 
@@ -19,22 +19,29 @@
 #define PLAYLISTBACKEND_H
 
 #include <QFuture>
+#include <QFutureInterface>
 #include <QHash>
 #include <QList>
+#include <QMap>
 #include <QMutex>
 #include <QObject>
+#include <QSqlDatabase>
 
 #include "playlistitem.h"
 #include "smartplaylists/generator_fwd.h"
 
 class Application;
 class Database;
+class QTimer;
 
 class PlaylistBackend : public QObject {
   Q_OBJECT
 
  public:
   Q_INVOKABLE PlaylistBackend(Application* app, QObject* parent = 0);
+  // Uses the database without an Application, for tests.  Cue sheets aren't
+  // looked up in the library.
+  PlaylistBackend(Database* db, QObject* parent = 0);
 
   struct Playlist {
     Playlist()
@@ -59,37 +66,97 @@ class PlaylistBackend : public QObject {
 
   static const int kSongTableJoins;
 
+  // Saves are collected for this long before being written out, and then only
+  // the rows that were added, removed or moved since the last write are
+  // touched.
+  static const int kSaveDelayMsec;
+
+  // Items are ordered by a sparse position column so that an item can be
+  // moved or inserted by giving it a position between its neighbours.
+  static const qint64 kPositionGap;
+
+  // Restored items are reported in chunks of this many rows.
+  static const int kRestoreChunkSize;
+
   PlaylistList GetAllOpenPlaylists();
   PlaylistList GetAllPlaylists();
   PlaylistBackend::Playlist GetPlaylist(int id);
+  // Loads the items in a background thread.  They're reported through the
+  // future in order, a chunk at a time, so they can be shown before the whole
+  // playlist has been read.
   PlaylistItemFuture GetPlaylistItems(int playlist);
 
+  // Must be called with the results of GetPlaylistItems, before any of them
+  // are dropped, so that later saves know which rows the items were loaded
+  // from.  Otherwise the first save rewrites the whole playlist.
+  void ItemsRestored(int playlist, const PlaylistItemList& items);
+
   void SetPlaylistOrder(const QList<int>& ids);
   void SetPlaylistUiPath(int id, const QString& path);
 
   int CreatePlaylist(const QString& name, const QString& special_type);
+  // changed_items are items whose metadata changed in place and so have to
+  // be written again even if they didn't move.
   void SavePlaylistAsync(int playlist, const PlaylistItemList& items,
-                         int last_played, smart_playlists::GeneratorPtr dynamic);
+                         int last_played, smart_playlists::GeneratorPtr dynamic,
+                         const PlaylistItemList& changed_items = PlaylistItemList());
   void RenamePlaylist(int id, const QString& new_name);
   void RemovePlaylist(int id);
 
  public slots:
   void SavePlaylist(int playlist, const PlaylistItemList& items,
-                    int last_played, smart_playlists::GeneratorPtr dynamic);
+                    int last_played, smart_playlists::GeneratorPtr dynamic,
+                    const PlaylistItemList& changed_items);
+
+  // Writes out any saves that are still waiting for the timer.
+  void FlushPendingSaves();
 
  private:
+  // An item as it's currently stored in the playlist_items table.
+  struct PersistedItem {
+    PlaylistItemPtr item;
+    int row_id;
+    qint64 position;
+  };
+  typedef QList<PersistedItem> PersistedItemList;
+
+  struct PendingSave {
+    PlaylistItemList items;
+    PlaylistItemList changed_items;
+    int last_played;
+    smart_playlists::GeneratorPtr dynamic;
+  };
+
   struct NewSongFromQueryState {
     QHash<QString, SongList> cached_cues_;
     QMutex mutex_;
   };
 
+  void LoadPlaylistItems(int playlist, QFutureInterface<PlaylistItemPtr>* future);
+  void ReportPlaylistItems(const QList<SqlRow>& rows,
+                           boost::shared_ptr<NewSongFromQueryState> state,
+                           QFutureInterface<PlaylistItemPtr>* future, int begin);
+
   PlaylistItemPtr NewSongFromQuery(const SqlRow& row, boost::shared_ptr<NewSongFromQueryState> state);
   PlaylistItemPtr RestoreCueData(PlaylistItemPtr item, boost::shared_ptr<NewSongFromQueryState> state);
 
   PlaylistList GetPlaylists(bool open_in_ui);
 
+  bool WritePlaylist(QSqlDatabase& db, int playlist, const PendingSave& save);
+
+  void Init();
+
   Application* app_;
   Database* db_;
+
+  QTimer* save_timer_;
+
+  // Protects the three members below.  The database mutex is always taken
+  // first if both are needed.
+  QMutex save_mutex_;
+  QMap<int, PendingSave> pending_saves_;
+  QHash<int, PersistedItemList> persisted_items_;
+  QHash<int, PersistedItemList> restoring_items_;
 };
 
 #endif // PLAYLISTBACKEND_H
@@ -43,7 +43,9 @@ PlaylistManager::PlaylistManager(Application* app, QObject *parent)
     sequence_(NULL),
     parser_(NULL),
     current_(-1),
-    active_(-1)
+    active_(-1),
+    lazy_restore_(false),
+    first_track_reported_(false)
 {
   connect(app_->player(), SIGNAL(Paused()), SLOT(SetActivePaused()));
   connect(app_->player(), SIGNAL(Playing()), SLOT(SetActivePlaying()));
@@ -69,14 +71,22 @@ void PlaylistManager::Init(LibraryBackend* library_backend,
   connect(library_backend_, SIGNAL(SongsDiscovered(SongList)), SLOT(SongsDiscovered(SongList)));
   connect(library_backend_, SIGNAL(SongsStatisticsChanged(SongList)), SLOT(SongsDiscovered(SongList)));
 
+  lazy_restore_ = true;
   foreach (const PlaylistBackend::Playlist& p, playlist_backend->GetAllOpenPlaylists()) {
     AddPlaylist(p.id, p.name, p.special_type, p.ui_path);
+    pending_restores_ << p.id;
   }
+  lazy_restore_ = false;
 
   // If no playlist exists then make a new one
   if (playlists_.isEmpty())
     New(tr("Playlist"));
 
+  // Restore the playlists the user can see straight away - the rest wait
+  // until those have finished.
+  active()->Restore();
+  current()->Restore();
+
   emit PlaylistManagerInitialized();
 }
 
@@ -109,6 +119,8 @@ Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
   connect(ret, SIGNAL(EditingFinished(QModelIndex)), SIGNAL(EditingFinished(QModelIndex)));
   connect(ret, SIGNAL(LoadTracksError(QString)), SIGNAL(Error(QString)));
   connect(ret, SIGNAL(PlayRequested(QModelIndex)), SIGNAL(PlayRequested(QModelIndex)));
+  connect(ret, SIGNAL(FirstItemsRestored()), SLOT(FirstItemsRestored()));
+  connect(ret, SIGNAL(RestoreFinished()), SLOT(RestoreNextPlaylist()));
   connect(playlist_container_->view(), SIGNAL(ColumnAlignmentChanged(ColumnAlignmentMap)),
           ret, SLOT(SetColumnAlignment(ColumnAlignmentMap)));
 
@@ -123,9 +135,33 @@ Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
     SetActivePlaylist(id);
   }
 
+  if (!lazy_restore_)
+    ret->Restore();
+
   return ret;
 }
 
+void PlaylistManager::FirstItemsRestored() {
+  if (first_track_reported_ || sender() != active())
+    return;
+
+  first_track_reported_ = true;
+  qLog(Info) << "First playable track restored"
+             << app_->msecs_since_startup() << "ms after startup";
+}
+
+void PlaylistManager::RestoreNextPlaylist() {
+  while (!pending_restores_.isEmpty()) {
+    const int id = pending_restores_.takeFirst();
+    if (!playlists_.contains(id) || playlists_[id].p->is_restored())
+      continue;
+
+    // Its RestoreFinished will bring us back here for the next one.
+    playlists_[id].p->Restore();
+    return;
+  }
+}
+
 void PlaylistManager::New(const QString& name, const SongList& songs,
                           const QString& special_type) {
   if (name.isNull())
@@ -234,6 +270,8 @@ void PlaylistManager::OneOfPlaylistsChanged() {
 void PlaylistManager::SetCurrentPlaylist(int id) {
   Q_ASSERT(playlists_.contains(id));
   current_ = id;
+  if (!lazy_restore_)
+    current()->Restore();
   emit CurrentChanged(current());
   UpdateSummaryText();
 }
@@ -247,6 +285,8 @@ void PlaylistManager::SetActivePlaylist(int id) {
     active()->set_current_row(-1);
 
   active_ = id;
+  if (!lazy_restore_)
+    active()->Restore();
   emit ActiveChanged(active());
 
   sequence_->SetUsingDynamicPlaylist(active()->is_dynamic());
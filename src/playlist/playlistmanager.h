@@ -213,6 +213,9 @@ private slots:
   void SongsDiscovered(const SongList& songs);
   void LoadFinished(bool success);
 
+  void FirstItemsRestored();
+  void RestoreNextPlaylist();
+
 private:
   Playlist* AddPlaylist(int id, const QString& name, const QString& special_type,
                         const QString& ui_path);
@@ -237,6 +240,12 @@ private:
 
   int current_;
   int active_;
+
+  // Playlists opened at startup are restored when they're first shown, or
+  // else one after another in the background once the visible ones are done.
+  bool lazy_restore_;
+  QList<int> pending_restores_;
+  bool first_track_reported_;
 };
 
 #endif // PLAYLISTMANAGER_H
@@ -58,17 +58,26 @@ void SongLoaderInserter::Load(Playlist *destination,
     // we're connecting this before we're even sure if this is an async load
     // to avoid race conditions (signal emission before we're listening to it)
     connect(loader, SIGNAL(LoadFinished(bool)), SLOT(PendingLoadFinished(bool)));
+    connect(loader, SIGNAL(SongsLoaded(SongList)), SLOT(PendingSongsLoaded(SongList)));
+    connect(loader, SIGNAL(EffectiveSongsLoaded(SongList)),
+            SLOT(PendingEffectiveSongsLoaded(SongList)));
     SongLoader::Result ret = loader->Load(url);
 
+    PendingInsert insert;
     if (ret == SongLoader::WillLoadAsync) {
       pending_.insert(loader);
+      insert.loader_ = loader;
+      inserts_ << insert;
       continue;
     }
 
-    if (ret == SongLoader::Success)
-      songs_ << loader->songs();
-    else
+    if (ret == SongLoader::Success) {
+      insert.songs_ = loader->songs();
+      insert.finished_ = true;
+      inserts_ << insert;
+    } else {
       emit Error(tr("Error loading %1").arg(url.toString()));
+    }
     delete loader;
   }
 
@@ -78,6 +87,9 @@ void SongLoaderInserter::Load(Playlist *destination,
     async_progress_ = 0;
     async_load_id_ = task_manager_->StartTask(tr("Loading tracks"));
     task_manager_->SetTaskProgress(async_load_id_, async_progress_, pending_.count());
+
+    // Show the songs before the first async load straight away.
+    InsertReadySongs();
   }
 }
 
@@ -100,8 +112,7 @@ void SongLoaderInserter::LoadAudioCD(Playlist *destination,
     emit Error(tr("Error while loading audio CD"));
     delete loader;
   }
-  songs_ = loader->songs();
-  PartiallyFinished();
+  InsertSongs(loader->songs());
 }
 
 void SongLoaderInserter::DestinationDestroyed() {
@@ -127,10 +138,17 @@ void SongLoaderInserter::PendingLoadFinished(bool success) {
   pending_.remove(loader);
   pending_async_.insert(loader);
 
-  if (success)
-    songs_ << loader->songs();
-  else
+  PendingInsert& insert = inserts_[IndexOfInsert(loader)];
+  insert.finished_ = true;
+
+  if (!success)
     emit Error(tr("Error loading %1").arg(loader->url().toString()));
+  else if (!streamed_.contains(loader))
+    insert.songs_ << loader->songs();
+
+  // Insert songs (that haven't been completelly loaded) to allow user to see
+  // and play them while not loaded completely
+  InsertReadySongs();
 
   task_manager_->SetTaskProgress(async_load_id_, ++async_progress_);
   if (pending_.isEmpty()) {
@@ -138,24 +156,84 @@ void SongLoaderInserter::PendingLoadFinished(bool success) {
     async_progress_ = 0;
     async_load_id_ = task_manager_->StartTask(tr("Loading tracks info"));
     task_manager_->SetTaskProgress(async_load_id_, async_progress_, pending_async_.count());
-    PartiallyFinished();
     QtConcurrent::run(this, &SongLoaderInserter::EffectiveLoad);
   }
 }
 
-void SongLoaderInserter::PartiallyFinished() {
-  // Insert songs (that haven't been completelly loaded) to allow user to see
-  // and play them while not loaded completely
-  if (destination_) {
-    destination_->InsertSongsOrLibraryItems(songs_, row_, play_now_, enqueue_);
+void SongLoaderInserter::PendingSongsLoaded(const SongList& songs) {
+  SongLoader* loader = qobject_cast<SongLoader*>(sender());
+  if (!loader || !pending_.contains(loader))
+    return;
+
+  // Big playlists and directories come in a chunk at a time - show each one
+  // straight away rather than waiting for the whole load, unless it has to
+  // wait for the urls before it.
+  streamed_.insert(loader);
+  inserts_[IndexOfInsert(loader)].songs_ << songs;
+  InsertReadySongs();
+}
+
+void SongLoaderInserter::PendingEffectiveSongsLoaded(const SongList& songs) {
+  SongLoader* loader = qobject_cast<SongLoader*>(sender());
+  if (!loader)
+    return;
+
+  // The songs can only be updated once they're in the playlist.
+  const int index = IndexOfInsert(loader);
+  if (index > 0)
+    inserts_[index].updates_ << songs;
+  else
+    emit EffectiveLoadFinished(songs);
+}
+
+int SongLoaderInserter::IndexOfInsert(SongLoader* loader) const {
+  for (int i=0 ; i<inserts_.count() ; ++i) {
+    if (inserts_[i].loader_ == loader)
+      return i;
+  }
+  return -1;
+}
+
+void SongLoaderInserter::InsertReadySongs() {
+  while (!inserts_.isEmpty()) {
+    PendingInsert& insert = inserts_.first();
+
+    InsertSongs(insert.songs_);
+    insert.songs_.clear();
+
+    if (!insert.updates_.isEmpty()) {
+      emit EffectiveLoadFinished(insert.updates_);
+      insert.updates_.clear();
+    }
+
+    // Anything after a load that hasn't finished has to wait for it.
+    if (!insert.finished_)
+      break;
+    inserts_.removeFirst();
   }
 }
 
+void SongLoaderInserter::InsertSongs(const SongList& songs) {
+  if (!destination_ || songs.isEmpty())
+    return;
+
+  destination_->InsertSongsOrLibraryItems(songs, row_, play_now_, enqueue_);
+
+  // Anything inserted later goes after these songs, and shouldn't start
+  // playing again.
+  if (row_ != -1)
+    row_ += songs.count();
+  play_now_ = false;
+}
+
 void SongLoaderInserter::EffectiveLoad() {
   foreach (SongLoader* loader, pending_async_) {
-    loader->EffectiveSongsLoad();
+    // Songs that were inserted as they were loaded have been updated already
+    if (!streamed_.contains(loader)) {
+      loader->EffectiveSongsLoad();
+      emit EffectiveLoadFinished(loader->songs());
+    }
     task_manager_->SetTaskProgress(async_load_id_, ++async_progress_);
-    emit EffectiveLoadFinished(loader->songs());
   }
   task_manager_->SetTaskFinished(async_load_id_);
 
@@ -163,9 +241,6 @@ void SongLoaderInserter::EffectiveLoad() {
 }
 
 void SongLoaderInserter::Finished() {
-  if (destination_) {
-    destination_->InsertSongsOrLibraryItems(songs_, row_, play_now_, enqueue_);
-  }
-
+  InsertReadySongs();
   deleteLater();
 }
@@ -47,11 +47,28 @@ signals:
 
 private slots:
   void PendingLoadFinished(bool success);
+  void PendingSongsLoaded(const SongList& songs);
+  void PendingEffectiveSongsLoaded(const SongList& songs);
   void DestinationDestroyed();
   void AudioCDTagsLoaded(bool success);
 
 private:
-  void PartiallyFinished();
+  // The songs from one of the urls passed to Load().
+  struct PendingInsert {
+    PendingInsert() : loader_(NULL), finished_(false) {}
+
+    // NULL if the songs were loaded straight away.
+    SongLoader* loader_;
+    // Songs that have been loaded but not inserted yet, and updates to them
+    // that have to wait until they are.
+    SongList songs_;
+    SongList updates_;
+    bool finished_;
+  };
+
+  int IndexOfInsert(SongLoader* loader) const;
+  void InsertReadySongs();
+  void InsertSongs(const SongList& songs);
   void EffectiveLoad();
   void Finished();
 
@@ -63,10 +80,15 @@ private:
   bool play_now_;
   bool enqueue_;
 
-  SongList songs_;
+  // In the same order as the urls.  Songs are only inserted from the front of
+  // the list, so songs from different loaders never get mixed up even if the
+  // loaders finish in a different order.
+  QList<PendingInsert> inserts_;
 
   QSet<SongLoader*> pending_;
   QSet<SongLoader*> pending_async_;
+  // Loaders whose songs were inserted as they were loaded
+  QSet<SongLoader*> streamed_;
   int async_load_id_;
   int async_progress_;
   LibraryBackendInterface* library_;
@@ -31,7 +31,7 @@ bool AsxIniParser::TryMagic(const QByteArray &data) const {
 }
 
 SongList AsxIniParser::Load(QIODevice *device, const QString& playlist_path, const QDir &dir) const {
-  SongList ret;
+  QList<SongLocation> locations;
 
   while (!device->atEnd()) {
     QString line = QString::fromUtf8(device->readLine()).trimmed();
@@ -40,14 +40,11 @@ SongList AsxIniParser::Load(QIODevice *device, const QString& playlist_path, con
     QString value = line.mid(equals + 1);
 
     if (key.startsWith("ref")) {
-      Song song = LoadSong(value, 0, dir);
-      if (song.is_valid()) {
-        ret << song;
-      }
+      locations << SongLocation(value);
     }
   }
 
-  return ret;
+  return LoadSongs(locations, dir, &ParserBase::IsValidSong);
 }
 
 void AsxIniParser::Save(const SongList &songs, QIODevice *device, const QDir &dir) const {
@@ -27,6 +27,8 @@
 #include <QXmlStreamReader>
 #include <QtDebug>
 
+#include <boost/bind.hpp>
+
 ASXParser::ASXParser(LibraryBackendInterface* library, QObject* parent)
     : XMLParser(library, parent)
 {
@@ -64,25 +66,34 @@ SongList ASXParser::Load(QIODevice *device, const QString& playlist_path,
   QBuffer buffer(&data);
   buffer.open(QIODevice::ReadOnly);
 
-  SongList ret;
-
   QXmlStreamReader reader(&buffer);
   if (!Utilities::ParseUntilElement(&reader, "asx")) {
-    return ret;
+    return SongList();
   }
 
+  QList<SongLocation> locations;
+  QList<Song> overrides;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "entry")) {
-    Song song = ParseTrack(&reader, dir);
-    if (song.is_valid()) {
-      ret << song;
-    }
+    QString ref;
+    overrides << ParseTrack(&reader, &ref);
+    locations << SongLocation(ref);
   }
-  return ret;
+
+  return LoadSongs(locations, dir,
+                   boost::bind(&ASXParser::ApplyMetadata, boost::cref(overrides), _1, _2));
 }
 
+bool ASXParser::ApplyMetadata(const QList<Song>& metadata, int index,
+                              Song* song) {
+  // Override metadata with what was in the playlist
+  song->set_title(metadata[index].title());
+  song->set_artist(metadata[index].artist());
+  song->set_album(metadata[index].album());
+  return song->is_valid();
+}
 
-Song ASXParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
-  QString title, artist, album, ref;
+Song ASXParser::ParseTrack(QXmlStreamReader* reader, QString* ref) const {
+  Song ret;
 
   while (!reader->atEnd()) {
     QXmlStreamReader::TokenType type = reader->readNext();
@@ -91,17 +102,17 @@ Song ASXParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
       case QXmlStreamReader::StartElement: {
         QStringRef name = reader->name();
         if (name == "ref") {
-          ref = reader->attributes().value("href").toString();
+          *ref = reader->attributes().value("href").toString();
         } else if (name == "title") {
-          title = reader->readElementText();
+          ret.set_title(reader->readElementText());
         } else if (name == "author") {
-          artist = reader->readElementText();
+          ret.set_artist(reader->readElementText());
         }
         break;
       }
       case QXmlStreamReader::EndElement: {
         if (reader->name() == "entry") {
-          goto return_song;
+          return ret;
         }
         break;
       }
@@ -110,14 +121,7 @@ Song ASXParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
     }
   }
 
-return_song:
-  Song song = LoadSong(ref, 0, dir);
-
-  // Override metadata with what was in the playlist
-  song.set_title(title);
-  song.set_artist(artist);
-  song.set_album(album);
-  return song;
+  return ret;
 }
 
 void ASXParser::Save(const SongList& songs, QIODevice* device, const QDir&) const {
@@ -36,7 +36,9 @@ class ASXParser : public XMLParser {
   void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir()) const;
 
  private:
-  Song ParseTrack(QXmlStreamReader* reader, const QDir& dir) const;
+  // Returns the metadata in the playlist entry, and sets ref to its location.
+  Song ParseTrack(QXmlStreamReader* reader, QString* ref) const;
+  static bool ApplyMetadata(const QList<Song>& metadata, int index, Song* song);
 };
 
 #endif
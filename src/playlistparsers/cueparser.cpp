@@ -28,6 +28,8 @@
 #include <QTextStream>
 #include <QtDebug>
 
+#include <boost/bind.hpp>
+
 const char* CueParser::kFileLineRegExp = "(\\S+)\\s+(?:\"([^\"]+)\"|(\\S+))\\s*(?:\"([^\"]+)\"|(\\S+))?";
 const char* CueParser::kIndexRegExp = "(\\d{2,3}):(\\d{2}):(\\d{2})";
 
@@ -48,8 +50,6 @@ CueParser::CueParser(LibraryBackendInterface* library, QObject* parent)
 }
 
 SongList CueParser::Load(QIODevice* device, const QString& playlist_path, const QDir& dir) const {
-  SongList ret;
-
   QTextStream text_stream(device);
   text_stream.setCodec(QTextCodec::codecForUtfText(device->peek(1024), QTextCodec::codecForName("UTF-8")));
 
@@ -137,7 +137,7 @@ SongList CueParser::Load(QIODevice* device, const QString& playlist_path, const
 
     if(line.isNull()) {
       qLog(Warning) << "the .cue file from " << dir_path << " defines no tracks!";
-      return ret;
+      return SongList();
     }
 
     // if this is a data file, all of it's tracks will be ignored
@@ -224,44 +224,48 @@ SongList CueParser::Load(QIODevice* device, const QString& playlist_path, const
 
   QDateTime cue_mtime = QFileInfo(playlist_path).lastModified();
 
-  // finalize parsing songs
-  for(int i = 0; i < entries.length(); i++) {
-    CueEntry entry = entries.at(i);
-
-    Song song = LoadSong(entry.file, IndexToMarker(entry.index), dir);
+  // load all the media files at once
+  QList<SongLocation> locations;
+  foreach (const CueEntry& entry, entries) {
+    locations << SongLocation(entry.file, IndexToMarker(entry.index));
+  }
 
-    // cue song has mtime equal to qMax(media_file_mtime, cue_sheet_mtime)
-    if(cue_mtime.isValid()) {
-      song.set_mtime(qMax(cue_mtime.toTime_t(), song.mtime()));
-    }
-    song.set_cue_path(playlist_path);
+  // finalize parsing songs
+  return LoadSongs(locations, dir,
+                   boost::bind(&CueParser::FinishSong, this, boost::cref(entries),
+                               boost::cref(cue_mtime), files,
+                               boost::cref(playlist_path), _1, _2));
+}
 
-    // overwrite the stuff, we may have read from the file or library, using
-    // the current .cue metadata
+bool CueParser::FinishSong(const QList<CueEntry>& entries,
+                           const QDateTime& cue_mtime, int files,
+                           const QString& playlist_path, int i,
+                           Song* song) const {
+  const CueEntry& entry = entries.at(i);
 
-    // set track number only in single-file mode
-    if(files == 1) {
-      song.set_track(i + 1);
-    }
+  // cue song has mtime equal to qMax(media_file_mtime, cue_sheet_mtime)
+  if(cue_mtime.isValid()) {
+    song->set_mtime(qMax(cue_mtime.toTime_t(), song->mtime()));
+  }
+  song->set_cue_path(playlist_path);
 
-    // the last TRACK for every FILE gets it's 'end' marker from the media file's
-    // length
-    if(i + 1 < entries.size() && entries.at(i).file == entries.at(i + 1).file) {
-      // incorrect indices?
-      if(!UpdateSong(entry, entries.at(i + 1).index, &song)) {
-        continue;
-      }
-    } else {
-      // incorrect index?
-      if(!UpdateLastSong(entry, &song)) {
-        continue;
-      }
-    }
+  // overwrite the stuff, we may have read from the file or library, using
+  // the current .cue metadata
 
-    ret << song;
+  // set track number only in single-file mode
+  if(files == 1) {
+    song->set_track(i + 1);
   }
 
-  return ret;
+  // the last TRACK for every FILE gets it's 'end' marker from the media file's
+  // length
+  if(i + 1 < entries.size() && entries.at(i).file == entries.at(i + 1).file) {
+    // incorrect indices?
+    return UpdateSong(entry, entries.at(i + 1).index, song);
+  } else {
+    // incorrect index?
+    return UpdateLastSong(entry, song);
+  }
 }
 
 // This and the kFileLineRegExp do most of the "dirty" work, namely: splitting the raw .cue
@@ -22,6 +22,8 @@
 
 #include <QRegExp>
 
+class QDateTime;
+
 // This parser will try to detect the real encoding of a .cue file but there's
 // a great chance it will fail so it's probably best to assume that the parser
 // is UTF compatible only.
@@ -93,6 +95,11 @@ class CueParser : public ParserBase {
 
   bool UpdateSong(const CueEntry& entry, const QString& next_index, Song* song) const;
   bool UpdateLastSong(const CueEntry& entry, Song* song) const;
+  // Fills in the song loaded for the i'th entry.  Returns false if the entry's
+  // indices are wrong and the song should be skipped.
+  bool FinishSong(const QList<CueEntry>& entries, const QDateTime& cue_mtime,
+                  int files, const QString& playlist_path, int i,
+                  Song* song) const;
 
   QStringList SplitCueLine(const QString& line) const;
   qint64 IndexToMarker(const QString& index) const;
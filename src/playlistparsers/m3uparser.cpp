@@ -22,13 +22,16 @@
 #include <QBuffer>
 #include <QtDebug>
 
+#include <boost/bind.hpp>
+
 M3UParser::M3UParser(LibraryBackendInterface* library, QObject* parent)
     : ParserBase(library, parent)
 {
 }
 
 SongList M3UParser::Load(QIODevice* device, const QString& playlist_path, const QDir& dir) const {
-  SongList ret;
+  QList<SongLocation> locations;
+  QList<Metadata> metadata;
 
   M3UType type = STANDARD;
   Metadata current_metadata;
@@ -56,11 +59,8 @@ SongList M3UParser::Load(QIODevice* device, const QString& playlist_path, const
         }
       }
     } else if (!line.isEmpty()) {
-      Song song = LoadSong(line, 0, dir);
-      song.set_title(current_metadata.title);
-      song.set_artist(current_metadata.artist);
-      song.set_length_nanosec(current_metadata.length);
-      ret << song;
+      locations << SongLocation(line);
+      metadata << current_metadata;
 
       current_metadata = Metadata();
     }
@@ -70,7 +70,16 @@ SongList M3UParser::Load(QIODevice* device, const QString& playlist_path, const
     line = QString::fromUtf8(buffer.readLine()).trimmed();
   }
 
-  return ret;
+  return LoadSongs(locations, dir,
+                   boost::bind(&M3UParser::ApplyMetadata, boost::cref(metadata), _1, _2));
+}
+
+bool M3UParser::ApplyMetadata(const QList<Metadata>& metadata, int index,
+                              Song* song) {
+  song->set_title(metadata[index].title);
+  song->set_artist(metadata[index].artist);
+  song->set_length_nanosec(metadata[index].length);
+  return true;
 }
 
 bool M3UParser::ParseMetadata(const QString& line, M3UParser::Metadata* metadata) const {
@@ -54,6 +54,8 @@ class M3UParser : public ParserBase {
   };
 
   bool ParseMetadata(const QString& line, Metadata* metadata) const;
+  static bool ApplyMetadata(const QList<Metadata>& metadata, int index,
+                            Song* song);
 
   FRIEND_TEST(M3UParserTest, ParsesMetadata);
   FRIEND_TEST(M3UParserTest, ParsesTrackLocation);
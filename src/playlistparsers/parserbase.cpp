@@ -21,7 +21,15 @@
 #include "library/libraryquery.h"
 #include "library/sqlrow.h"
 
+#include <QHash>
+#include <QMap>
+#include <QPair>
 #include <QUrl>
+#include <QtConcurrentMap>
+
+#include <boost/bind.hpp>
+
+const int ParserBase::kLoadSongsChunkSize = 500;
 
 ParserBase::ParserBase(LibraryBackendInterface* library, QObject *parent)
   : QObject(parent),
@@ -29,24 +37,23 @@ ParserBase::ParserBase(LibraryBackendInterface* library, QObject *parent)
 {
 }
 
-void ParserBase::LoadSong(const QString& filename_or_url, qint64 beginning,
-                          const QDir& dir, Song* song) const {
-  if (filename_or_url.isEmpty()) {
-    return;
-  }
+bool ParserBase::IsRemoteUrl(const QString& filename_or_url) {
+  return filename_or_url.contains(QRegExp("^[a-z]{2,}:")) &&
+         QUrl(filename_or_url).scheme() != "file";
+}
 
+void ParserBase::LoadRemoteUrl(const QString& url, Song* song) {
+  song->set_url(QUrl::fromUserInput(url));
+  song->set_filetype(Song::Type_Stream);
+  song->set_valid(true);
+}
+
+QString ParserBase::CanonicalFilename(const QString& filename_or_url,
+                                      const QString& dir_path) {
   QString filename = filename_or_url;
 
   if (filename_or_url.contains(QRegExp("^[a-z]{2,}:"))) {
-    QUrl url(filename_or_url);
-    if (url.scheme() == "file") {
-      filename = url.toLocalFile();
-    } else {
-      song->set_url(QUrl::fromUserInput(filename_or_url));
-      song->set_filetype(Song::Type_Stream);
-      song->set_valid(true);
-      return;
-    }
+    filename = QUrl(filename_or_url).toLocalFile();
   }
 
   // Convert native separators for Windows paths
@@ -54,7 +61,7 @@ void ParserBase::LoadSong(const QString& filename_or_url, qint64 beginning,
 
   // Make the path absolute
   if (!QDir::isAbsolutePath(filename)) {
-    filename = dir.absoluteFilePath(filename);
+    filename = QDir(dir_path).absoluteFilePath(filename);
   }
 
   // Use the canonical path
@@ -62,6 +69,21 @@ void ParserBase::LoadSong(const QString& filename_or_url, qint64 beginning,
     filename = QFileInfo(filename).canonicalFilePath();
   }
 
+  return filename;
+}
+
+void ParserBase::LoadSong(const QString& filename_or_url, qint64 beginning,
+                          const QDir& dir, Song* song) const {
+  if (filename_or_url.isEmpty()) {
+    return;
+  }
+
+  if (IsRemoteUrl(filename_or_url)) {
+    LoadRemoteUrl(filename_or_url, song);
+    return;
+  }
+
+  const QString filename = CanonicalFilename(filename_or_url, dir.path());
   const QUrl url = QUrl::fromLocalFile(filename);
 
   // Search in the library
@@ -85,6 +107,109 @@ Song ParserBase::LoadSong(const QString& filename_or_url, qint64 beginning, cons
   return song;
 }
 
+SongList ParserBase::LoadSongs(const QList<SongLocation>& locations,
+                               const QDir& dir, SongCallback callback) const {
+  SongList ret;
+
+  for (int i=0 ; i<locations.count() ; i += kLoadSongsChunkSize) {
+    SongList chunk = LoadSongsChunk(locations.mid(i, kLoadSongsChunkSize), dir);
+
+    SongList loaded;
+    for (int j=0 ; j<chunk.count() ; ++j) {
+      if (!callback || callback(i + j, &chunk[j])) {
+        loaded << chunk[j];
+      }
+    }
+
+    if (!loaded.isEmpty()) {
+      ret << loaded;
+      emit SongsLoaded(loaded);
+    }
+  }
+
+  return ret;
+}
+
+SongList ParserBase::LoadSongsChunk(const QList<SongLocation>& locations,
+                                    const QDir& dir) const {
+  QVector<Song> ret(locations.count());
+
+  // Streams are done straight away, the rest are local files
+  QList<int> local_indexes;
+  QStringList local_names;
+  for (int i=0 ; i<locations.count() ; ++i) {
+    const QString& filename_or_url = locations[i].filename_or_url_;
+    if (filename_or_url.isEmpty()) {
+      continue;
+    }
+
+    if (IsRemoteUrl(filename_or_url)) {
+      LoadRemoteUrl(filename_or_url, &ret[i]);
+    } else {
+      local_indexes << i;
+      local_names << filename_or_url;
+    }
+  }
+
+  if (local_indexes.isEmpty()) {
+    return ret.toList();
+  }
+
+  // Finding the canonical path means a few stat() calls for each file, which
+  // is slow on network filesystems, so do them all in parallel.
+  const QStringList filenames = QtConcurrent::blockingMapped(
+      local_names,
+      boost::bind(&ParserBase::CanonicalFilename, _1, dir.path()));
+
+  QList<QUrl> urls;
+  foreach (const QString& filename, filenames) {
+    urls << QUrl::fromLocalFile(filename);
+  }
+
+  // Look all the files up in the library at once
+  typedef QPair<QByteArray, qint64> SongKey;
+  QHash<SongKey, Song> library_songs;
+  if (library_) {
+    foreach (const Song& song, library_->GetSongsByUrls(urls)) {
+      library_songs[SongKey(song.url().toEncoded(), song.beginning_nanosec())] = song;
+    }
+  }
+
+  // Then read the tags of the ones that weren't there.  Cue sheets often
+  // refer to the same file many times, but it only needs reading once.
+  QMap<int, int> missing_indexes;
+  QHash<QString, int> missing_filename_indexes;
+  QStringList missing_filenames;
+  for (int i=0 ; i<local_indexes.count() ; ++i) {
+    const int index = local_indexes[i];
+    const SongKey key(urls[i].toEncoded(), locations[index].beginning_);
+
+    if (library_songs.contains(key)) {
+      ret[index] = library_songs[key];
+      continue;
+    }
+
+    if (!missing_filename_indexes.contains(filenames[i])) {
+      missing_filename_indexes[filenames[i]] = missing_filenames.count();
+      missing_filenames << filenames[i];
+    }
+    missing_indexes[index] = missing_filename_indexes[filenames[i]];
+  }
+
+  if (!missing_filenames.isEmpty()) {
+    const SongList songs =
+        TagReaderClient::Instance()->ReadFilesBlocking(missing_filenames);
+    for (QMap<int, int>::const_iterator it = missing_indexes.constBegin() ;
+         it != missing_indexes.constEnd() ; ++it) {
+      if (it.value() < songs.count()) {
+        ret[it.key()] = songs[it.value()];
+      }
+    }
+  }
+
+  return ret.toList();
+}
+
 QString ParserBase::URLOrRelativeFilename(const QUrl& url, const QDir& dir) const {
   if (url.scheme() != "file")
     return url.toString();
@@ -21,6 +21,8 @@
 #include <QObject>
 #include <QDir>
 
+#include <boost/function.hpp>
+
 #include "core/song.h"
 
 class LibraryBackendInterface;
@@ -31,6 +33,9 @@ class ParserBase : public QObject {
 public:
   ParserBase(LibraryBackendInterface* library, QObject* parent = 0);
 
+  // LoadSongs loads this many songs at a time.
+  static const int kLoadSongsChunkSize;
+
   virtual QString name() const = 0;
   virtual QStringList file_extensions() const = 0;
   virtual QString mime_type() const { return QString(); }
@@ -47,7 +52,26 @@ public:
   virtual SongList Load(QIODevice* device, const QString& playlist_path = "", const QDir& dir = QDir()) const = 0;
   virtual void Save(const SongList& songs, QIODevice* device, const QDir& dir = QDir()) const = 0;
 
+signals:
+  // Emitted from LoadSongs as each chunk of songs is loaded, so they can be
+  // shown before the rest of a big playlist is ready.
+  void SongsLoaded(const SongList& songs) const;
+
 protected:
+  // One entry in a playlist, for LoadSongs.
+  struct SongLocation {
+    SongLocation(const QString& filename_or_url = QString(), qint64 beginning = 0)
+      : filename_or_url_(filename_or_url), beginning_(beginning) {}
+
+    QString filename_or_url_;
+    qint64 beginning_;
+  };
+
+  // Called by LoadSongs with the index of each location and the song that was
+  // loaded from it, to fill in anything the playlist itself says about the
+  // song.  Returns false to leave the song out.
+  typedef boost::function<bool (int, Song*)> SongCallback;
+
   // Loads a song.  If filename_or_url is a URL (with a scheme other than
   // "file") then it is set on the song and the song marked as a stream.
   // If it is a filename or a file:// URL then it is made absolute and canonical
@@ -57,12 +81,31 @@ protected:
   Song LoadSong(const QString& filename_or_url, qint64 beginning, const QDir& dir) const;
   void LoadSong(const QString& filename_or_url, qint64 beginning, const QDir& dir, Song* song) const;
 
+  // Does the same as LoadSong for every song in a playlist, but much faster
+  // than calling it for each one.  The files are found in parallel, then
+  // looked up in the library together, and any that weren't there have their
+  // tags read with a single request.  Parsers should collect all their
+  // entries and then call this, rather than loading songs one at a time.
+  SongList LoadSongs(const QList<SongLocation>& locations, const QDir& dir,
+                     SongCallback callback = SongCallback()) const;
+
+  // A SongCallback that leaves out songs that couldn't be loaded.
+  static bool IsValidSong(int, Song* song) { return song->is_valid(); }
+
   // If the URL is a file:// URL then returns its path relative to the
   // directory.  Otherwise returns the URL as is.
   // This function should always be used when saving a playlist.
   QString URLOrRelativeFilename(const QUrl& url, const QDir& dir) const;
 
 private:
+  static bool IsRemoteUrl(const QString& filename_or_url);
+  static void LoadRemoteUrl(const QString& url, Song* song);
+  static QString CanonicalFilename(const QString& filename_or_url,
+                                   const QString& dir_path);
+
+  SongList LoadSongsChunk(const QList<SongLocation>& locations,
+                          const QDir& dir) const;
+
   LibraryBackendInterface* library_;
 };
 
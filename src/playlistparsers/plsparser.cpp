@@ -22,13 +22,16 @@
 #include <QTextStream>
 #include <QtDebug>
 
+#include <boost/bind.hpp>
+
 PLSParser::PLSParser(LibraryBackendInterface* library, QObject* parent)
   : ParserBase(library, parent)
 {
 }
 
 SongList PLSParser::Load(QIODevice *device, const QString& playlist_path, const QDir &dir) const {
-  QMap<int, Song> songs;
+  QMap<int, QString> files;
+  QMap<int, Song> metadata;
   QRegExp n_re("\\d+$");
 
   while (!device->atEnd()) {
@@ -41,26 +44,39 @@ SongList PLSParser::Load(QIODevice *device, const QString& playlist_path, const
     int n = n_re.cap(0).toInt();
 
     if (key.startsWith("file")) {
-      Song song = LoadSong(value, 0, dir);
-
-      // Use the title and length we've already loaded if any
-      if (!songs[n].title().isEmpty())
-        song.set_title(songs[n].title());
-      if (!songs[n].length_nanosec() != -1)
-        song.set_length_nanosec(songs[n].length_nanosec());
-
-      songs[n] = song;
+      files[n] = value;
     } else if (key.startsWith("title")) {
-      songs[n].set_title(value);
+      metadata[n].set_title(value);
     } else if (key.startsWith("length")) {
       qint64 seconds = value.toLongLong();
       if (seconds > 0) {
-        songs[n].set_length_nanosec(seconds * kNsecPerSec);
+        metadata[n].set_length_nanosec(seconds * kNsecPerSec);
       }
     }
   }
 
-  return songs.values();
+  // The title and length can come before or after the filename, so wait until
+  // the end to load the songs.
+  QList<SongLocation> locations;
+  QList<Song> overrides;
+  for (QMap<int, QString>::const_iterator it = files.constBegin() ;
+       it != files.constEnd() ; ++it) {
+    locations << SongLocation(it.value());
+    overrides << metadata.value(it.key());
+  }
+
+  return LoadSongs(locations, dir,
+                   boost::bind(&PLSParser::ApplyMetadata, boost::cref(overrides), _1, _2));
+}
+
+bool PLSParser::ApplyMetadata(const QList<Song>& metadata, int index,
+                              Song* song) {
+  // Use the title and length from the playlist if there were any
+  if (!metadata[index].title().isEmpty())
+    song->set_title(metadata[index].title());
+  if (metadata[index].length_nanosec() != -1)
+    song->set_length_nanosec(metadata[index].length_nanosec());
+  return true;
 }
 
 void PLSParser::Save(const SongList &songs, QIODevice *device, const QDir &dir) const {
@@ -33,6 +33,9 @@ public:
 
   SongList Load(QIODevice* device, const QString& playlist_path = "", const QDir& dir = QDir()) const;
   void Save(const SongList& songs, QIODevice* device, const QDir& dir = QDir()) const;
+
+private:
+  static bool ApplyMetadata(const QList<Song>& metadata, int index, Song* song);
 };
 
 #endif // PLSPARSER_H
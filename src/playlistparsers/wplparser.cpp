@@ -32,22 +32,21 @@ bool WplParser::TryMagic(const QByteArray& data) const {
 
 SongList WplParser::Load(QIODevice* device, const QString& playlist_path,
                          const QDir& dir) const {
-  SongList ret;
-
   QXmlStreamReader reader(device);
   if (!Utilities::ParseUntilElement(&reader, "smil") ||
       !Utilities::ParseUntilElement(&reader, "body")) {
-    return ret;
+    return SongList();
   }
 
+  QList<SongLocation> locations;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "seq")) {
-    ParseSeq(dir, &reader, &ret);
+    ParseSeq(&reader, &locations);
   }
-  return ret;
+  return LoadSongs(locations, dir, &ParserBase::IsValidSong);
 }
 
-void WplParser::ParseSeq(const QDir& dir, QXmlStreamReader* reader,
-                         SongList* songs) const {
+void WplParser::ParseSeq(QXmlStreamReader* reader,
+                         QList<SongLocation>* locations) const {
   while (!reader->atEnd()) {
     QXmlStreamReader::TokenType type = reader->readNext();
     switch (type) {
@@ -56,10 +55,7 @@ void WplParser::ParseSeq(const QDir& dir, QXmlStreamReader* reader,
         if (name == "media") {
           QStringRef src = reader->attributes().value("src");
           if (!src.isEmpty()) {
-            Song song = LoadSong(src.toString(), 0, dir);
-            if (song.is_valid()) {
-              songs->append(song);
-            }
+            locations->append(SongLocation(src.toString()));
           }
         } else {
           Utilities::ConsumeCurrentElement(reader);
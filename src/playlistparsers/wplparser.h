@@ -35,8 +35,8 @@ class WplParser : public XMLParser {
   void Save(const SongList& songs, QIODevice* device, const QDir& dir) const;
 
 private:
-  void ParseSeq(const QDir& dir, QXmlStreamReader* reader,
-                SongList* songs) const;
+  void ParseSeq(QXmlStreamReader* reader,
+                QList<SongLocation>* locations) const;
   void WriteMeta(const QString& name, const QString& content,
                  QXmlStreamWriter* writer) const;
 };
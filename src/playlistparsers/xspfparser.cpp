@@ -26,6 +26,8 @@
 #include <QUrl>
 #include <QXmlStreamReader>
 
+#include <boost/bind.hpp>
+
 XSPFParser::XSPFParser(LibraryBackendInterface* library, QObject* parent)
     : XMLParser(library, parent)
 {
@@ -33,26 +35,36 @@ XSPFParser::XSPFParser(LibraryBackendInterface* library, QObject* parent)
 
 SongList XSPFParser::Load(QIODevice *device, const QString& playlist_path,
                           const QDir& dir) const {
-  SongList ret;
-
   QXmlStreamReader reader(device);
   if (!Utilities::ParseUntilElement(&reader, "playlist") ||
       !Utilities::ParseUntilElement(&reader, "trackList")) {
-    return ret;
+    return SongList();
   }
 
+  QList<SongLocation> locations;
+  QList<Song> overrides;
   while (!reader.atEnd() && Utilities::ParseUntilElement(&reader, "track")) {
-    Song song = ParseTrack(&reader, dir);
-    if (song.is_valid()) {
-      ret << song;
-    }
+    QString location;
+    overrides << ParseTrack(&reader, &location);
+    locations << SongLocation(location);
   }
-  return ret;
+
+  return LoadSongs(locations, dir,
+                   boost::bind(&XSPFParser::ApplyMetadata, boost::cref(overrides), _1, _2));
 }
 
-Song XSPFParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
-  QString title, artist, album, location;
-  qint64 nanosec = -1;
+bool XSPFParser::ApplyMetadata(const QList<Song>& metadata, int index,
+                               Song* song) {
+  // Override metadata with what was in the playlist
+  song->set_title(metadata[index].title());
+  song->set_artist(metadata[index].artist());
+  song->set_album(metadata[index].album());
+  song->set_length_nanosec(metadata[index].length_nanosec());
+  return song->is_valid();
+}
+
+Song XSPFParser::ParseTrack(QXmlStreamReader* reader, QString* location) const {
+  Song ret;
 
   while (!reader->atEnd()) {
     QXmlStreamReader::TokenType type = reader->readNext();
@@ -60,20 +72,18 @@ Song XSPFParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
       case QXmlStreamReader::StartElement: {
         QStringRef name = reader->name();
         if (name == "location") {
-          location = reader->readElementText();
+          *location = reader->readElementText();
         } else if (name == "title") {
-          title = reader->readElementText();
+          ret.set_title(reader->readElementText());
         } else if (name == "creator") {
-          artist = reader->readElementText();
+          ret.set_artist(reader->readElementText());
         } else if (name == "album") {
-          album = reader->readElementText();
+          ret.set_album(reader->readElementText());
         } else if (name == "duration") {  // in milliseconds.
           const QString duration = reader->readElementText();
           bool ok = false;
-          nanosec = duration.toInt(&ok) * kNsecPerMsec;
-          if (!ok) {
-            nanosec = -1;
-          }
+          const qint64 nanosec = duration.toInt(&ok) * kNsecPerMsec;
+          ret.set_length_nanosec(ok ? nanosec : -1);
         } else if (name == "image") {
           // TODO: Fetch album covers.
         } else if (name == "info") {
@@ -83,7 +93,7 @@ Song XSPFParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
       }
       case QXmlStreamReader::EndElement: {
         if (reader->name() == "track") {
-          goto return_song;
+          return ret;
         }
       }
       default:
@@ -91,15 +101,7 @@ Song XSPFParser::ParseTrack(QXmlStreamReader* reader, const QDir& dir) const {
     }
   }
 
-return_song:
-  Song song = LoadSong(location, 0, dir);
-
-  // Override metadata with what was in the playlist
-  song.set_title(title);
-  song.set_artist(artist);
-  song.set_album(album);
-  song.set_length_nanosec(nanosec);
-  return song;
+  return ret;
 }
 
 void XSPFParser::Save(const SongList& songs, QIODevice* device, const QDir&) const {
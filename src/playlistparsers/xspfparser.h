@@ -41,7 +41,10 @@ class XSPFParser : public XMLParser {
   void Save(const SongList &songs, QIODevice *device, const QDir &dir = QDir()) const;
 
  private:
-  Song ParseTrack(QXmlStreamReader* reader, const QDir& dir) const;
+  // Returns the metadata in the playlist entry, and sets location to where
+  // the song is.
+  Song ParseTrack(QXmlStreamReader* reader, QString* location) const;
+  static bool ApplyMetadata(const QList<Song>& metadata, int index, Song* song);
 };
 
 #endif
@@ -43,7 +43,7 @@ void PodcastBackend::Subscribe(Podcast* podcast) {
     return;
   }
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
@@ -80,7 +80,7 @@ void PodcastBackend::Unsubscribe(const Podcast& podcast) {
     return;
   }
 
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
@@ -119,7 +119,7 @@ void PodcastBackend::AddEpisodes(PodcastEpisodeList* episodes, QSqlDatabase* db)
 }
 
 void PodcastBackend::AddEpisodes(PodcastEpisodeList* episodes) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
@@ -130,7 +130,7 @@ void PodcastBackend::AddEpisodes(PodcastEpisodeList* episodes) {
 }
 
 void PodcastBackend::UpdateEpisodes(const PodcastEpisodeList& episodes) {
-  QMutexLocker l(db_->Mutex());
+  Database::WriteLocker l(db_);
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
@@ -159,7 +159,7 @@ void PodcastBackend::UpdateEpisodes(const PodcastEpisodeList& episodes) {
 PodcastList PodcastBackend::GetAllSubscriptions() {
   PodcastList ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + Podcast::kColumnSpec + " FROM podcasts", db);
@@ -179,7 +179,7 @@ PodcastList PodcastBackend::GetAllSubscriptions() {
 Podcast PodcastBackend::GetSubscriptionById(int id) {
   Podcast ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + Podcast::kColumnSpec +
@@ -197,7 +197,7 @@ Podcast PodcastBackend::GetSubscriptionById(int id) {
 Podcast PodcastBackend::GetSubscriptionByUrl(const QUrl& url) {
   Podcast ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + Podcast::kColumnSpec +
@@ -215,7 +215,7 @@ Podcast PodcastBackend::GetSubscriptionByUrl(const QUrl& url) {
 PodcastEpisodeList PodcastBackend::GetEpisodes(int podcast_id) {
   PodcastEpisodeList ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
@@ -238,7 +238,7 @@ PodcastEpisodeList PodcastBackend::GetEpisodes(int podcast_id) {
 PodcastEpisode PodcastBackend::GetEpisodeById(int id) {
   PodcastEpisode ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
@@ -256,7 +256,7 @@ PodcastEpisode PodcastBackend::GetEpisodeById(int id) {
 PodcastEpisode PodcastBackend::GetEpisodeByUrl(const QUrl& url) {
   PodcastEpisode ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
@@ -274,7 +274,7 @@ PodcastEpisode PodcastBackend::GetEpisodeByUrl(const QUrl& url) {
 PodcastEpisode PodcastBackend::GetEpisodeByUrlOrLocalUrl(const QUrl& url) {
   PodcastEpisode ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
@@ -293,7 +293,7 @@ PodcastEpisode PodcastBackend::GetEpisodeByUrlOrLocalUrl(const QUrl& url) {
 PodcastEpisodeList PodcastBackend::GetOldDownloadedEpisodes(const QDateTime& max_listened_date) {
   PodcastEpisodeList ret;
 
-  QMutexLocker l(db_->Mutex());
+  Database::ReadLocker l(db_);
   QSqlDatabase db(db_->Connect());
 
   QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
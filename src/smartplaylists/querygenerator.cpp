@@ -22,16 +22,22 @@
 
 namespace smart_playlists {
 
+const int QueryGenerator::kMaxChangedSongs = 1000;
+
 QueryGenerator::QueryGenerator()
   : dynamic_(false),
-    current_pos_(0)
+    current_pos_(0),
+    bag_loaded_(false),
+    library_reset_(false)
 {
 }
 
 QueryGenerator::QueryGenerator(const QString& name, const Search& search, bool dynamic)
   : search_(search),
     dynamic_(dynamic),
-    current_pos_(0)
+    current_pos_(0),
+    bag_loaded_(false),
+    library_reset_(false)
 {
   set_name(name);
 }
@@ -40,12 +46,14 @@ void QueryGenerator::Load(const Search& search) {
   search_ = search;
   dynamic_ = false;
   current_pos_ = 0;
+  bag_loaded_ = false;
 }
 
 void QueryGenerator::Load(const QByteArray& data) {
   QDataStream s(data);
   s >> search_;
   s >> dynamic_;
+  bag_loaded_ = false;
 }
 
 QByteArray QueryGenerator::Save() const {
@@ -57,15 +65,28 @@ QByteArray QueryGenerator::Save() const {
   return ret;
 }
 
+bool QueryGenerator::uses_shuffle_bag() const {
+  return dynamic_ && search_.sort_type_ == Search::Sort_Random;
+}
+
 PlaylistItemList QueryGenerator::Generate() {
-  previous_ids_.clear();
   current_pos_ = 0;
+
+  if (uses_shuffle_bag()) {
+    QMutexLocker l(&bag_mutex_);
+    previous_ids_.clear();
+    LoadShuffleBag();
+  }
+
   return GenerateMore(0);
 }
 
 PlaylistItemList QueryGenerator::GenerateMore(int count) {
+  if (uses_shuffle_bag()) {
+    return TakeFromShuffleBag(count ? count : search_.limit_);
+  }
+
   Search search_copy = search_;
-  search_copy.id_not_in_ = previous_ids_;
   if (count) {
     search_copy.limit_ = count;
   }
@@ -80,12 +101,133 @@ PlaylistItemList QueryGenerator::GenerateMore(int count) {
   foreach (const Song& song, songs) {
     items << PlaylistItemPtr(PlaylistItem::NewFromSongsTable(
                                backend_->songs_table(), song));
-    previous_ids_ << song.id();
+  }
+  return items;
+}
+
+PlaylistItemList QueryGenerator::TakeFromShuffleBag(int count) {
+  QMutexLocker l(&bag_mutex_);
+
+  if (bag_loaded_) {
+    UpdateShuffleBag();
+  } else {
+    LoadShuffleBag();
+  }
+
+  if (count < 0) {
+    count = bag_.count();
+  }
+
+  QList<int> ids;
+  for (int i=0 ; i<count ; ++i) {
+    const int id = bag_.Take();
+    if (id == -1)
+      break;
+
+    // Don't pick it again until it's dropped out of the playlist's history
+    ids << id;
+    bag_.Exclude(id);
+    previous_ids_ << id;
 
     if (previous_ids_.count() > GetDynamicFuture() + GetDynamicHistory())
-      previous_ids_.removeFirst();
+      bag_.Include(previous_ids_.takeFirst());
+  }
+
+  // Load the songs, and keep them in the order they were picked in
+  QHash<int, Song> songs;
+  foreach (const Song& song, backend_->GetSongsById(ids)) {
+    songs[song.id()] = song;
+  }
+
+  PlaylistItemList items;
+  foreach (int id, ids) {
+    if (songs.contains(id)) {
+      items << PlaylistItemPtr(PlaylistItem::NewFromSongsTable(
+                                 backend_->songs_table(), songs[id]));
+    }
   }
   return items;
 }
 
+void QueryGenerator::LoadShuffleBag() {
+  // Start listening before loading, so nothing that changes while we're
+  // loading gets missed.
+  connect(backend_, SIGNAL(SongsDiscovered(SongList)),
+          SLOT(SongsChanged(SongList)), Qt::UniqueConnection);
+  connect(backend_, SIGNAL(SongsDeleted(SongList)),
+          SLOT(SongsChanged(SongList)), Qt::UniqueConnection);
+  connect(backend_, SIGNAL(SongsStatisticsChanged(SongList)),
+          SLOT(SongsChanged(SongList)), Qt::UniqueConnection);
+  connect(backend_, SIGNAL(DatabaseReset()),
+          SLOT(LibraryReset()), Qt::UniqueConnection);
+
+  {
+    QMutexLocker l(&changes_mutex_);
+    changed_ids_.clear();
+    library_reset_ = false;
+  }
+
+  bag_.Reset(backend_->FindSongIds(search_));
+  foreach (int id, previous_ids_) {
+    bag_.Exclude(id);
+  }
+  bag_loaded_ = true;
+}
+
+void QueryGenerator::UpdateShuffleBag() {
+  QSet<int> changed_ids;
+  bool library_reset;
+  {
+    QMutexLocker l(&changes_mutex_);
+    changed_ids = changed_ids_;
+    library_reset = library_reset_;
+    changed_ids_.clear();
+    library_reset_ = false;
+  }
+
+  if (library_reset) {
+    LoadShuffleBag();
+    return;
+  }
+
+  if (changed_ids.isEmpty())
+    return;
+
+  // Ask the database which of the songs that changed match the search now.
+  // The ones that don't might have been deleted, or might just not match any
+  // more - either way they come out of the bag.
+  Search search_copy = search_;
+  search_copy.id_in_ = changed_ids.toList();
+  const QSet<int> matching = backend_->FindSongIds(search_copy).toSet();
+
+  foreach (int id, changed_ids) {
+    if (matching.contains(id)) {
+      bag_.Add(id);
+    } else {
+      bag_.Remove(id);
+    }
+  }
+}
+
+void QueryGenerator::SongsChanged(const SongList& songs) {
+  QMutexLocker l(&changes_mutex_);
+  if (library_reset_)
+    return;
+
+  foreach (const Song& song, songs) {
+    changed_ids_ << song.id();
+  }
+
+  if (changed_ids_.count() > kMaxChangedSongs) {
+    changed_ids_.clear();
+    library_reset_ = true;
+  }
+}
+
+void QueryGenerator::LibraryReset() {
+  QMutexLocker l(&changes_mutex_);
+  changed_ids_.clear();
+  library_reset_ = true;
+}
+
 } // namespace
@@ -20,14 +20,24 @@
 
 #include "generator.h"
 #include "search.h"
+#include "shufflebag.h"
+
+#include <QMutex>
+#include <QSet>
 
 namespace smart_playlists {
 
 class QueryGenerator : public Generator {
+  Q_OBJECT
+
 public:
   QueryGenerator();
   QueryGenerator(const QString& name, const Search& search, bool dynamic = false);
 
+  // If more songs than this change in the library at once it's quicker to
+  // load the shuffle bag again than to check each one.
+  static const int kMaxChangedSongs;
+
   QString type() const { return "Query"; }
 
   void Load(const Search& search);
@@ -42,12 +52,36 @@ public:
   Search search() const { return search_; }
   int GetDynamicFuture () { return search_.limit_; }
 
+private slots:
+  void SongsChanged(const SongList& songs);
+  void LibraryReset();
+
+private:
+  bool uses_shuffle_bag() const;
+  void LoadShuffleBag();
+  void UpdateShuffleBag();
+  PlaylistItemList TakeFromShuffleBag(int count);
+
 private:
   Search search_;
   bool dynamic_;
 
   QList<int> previous_ids_;
   int current_pos_;
+
+  // Random dynamic playlists pick their songs from here rather than asking
+  // the database with ORDER BY random() each time.  The songs in
+  // previous_ids_ are excluded from it.  Guarded by bag_mutex_.
+  QMutex bag_mutex_;
+  ShuffleBag bag_;
+  bool bag_loaded_;
+
+  // Songs that changed in the library since the bag was last updated.  The
+  // library tells us about them in the UI thread, so these are guarded by
+  // changes_mutex_.
+  QMutex changes_mutex_;
+  QSet<int> changed_ids_;
+  bool library_reset_;
 };
 
 } // namespace
@@ -48,9 +48,7 @@ void Search::Reset() {
   first_item_ = 0;
 }
 
-QString Search::ToSql(const QString& songs_table) const {
-  QString sql = "SELECT ROWID," + Song::kColumnSpec + " FROM " + songs_table;
-
+QString Search::WhereClause() const {
   // Add search terms
   QStringList where_clauses;
   QStringList term_where_clauses;
@@ -63,13 +61,14 @@ QString Search::ToSql(const QString& songs_table) const {
     where_clauses << "(" + term_where_clauses.join(boolean_op) + ")";
   }
 
-  // Restrict the IDs of songs if we're making a dynamic playlist
-  if (!id_not_in_.isEmpty()) {
+  // Only look at some songs if we're checking whether they've started or
+  // stopped matching
+  if (!id_in_.isEmpty()) {
     QString numbers;
-    foreach (int id, id_not_in_) {
+    foreach (int id, id_in_) {
       numbers += (numbers.isEmpty() ? "" : ",") + QString::number(id);
     }
-    where_clauses << "(ROWID NOT IN (" + numbers + "))";
+    where_clauses << "(ROWID IN (" + numbers + "))";
   }
 
   // We never want to include songs that have been deleted, but are still kept
@@ -77,9 +76,12 @@ QString Search::ToSql(const QString& songs_table) const {
   // unmounted.
   where_clauses << "unavailable = 0";
 
-  if (!where_clauses.isEmpty()) {
-    sql += " WHERE " + where_clauses.join(" AND ");
-  }
+  return " WHERE " + where_clauses.join(" AND ");
+}
+
+QString Search::ToSql(const QString& songs_table) const {
+  QString sql = "SELECT ROWID," + Song::kColumnSpec + " FROM " + songs_table;
+  sql += WhereClause();
 
   // Add sort by
   if (sort_type_ == Sort_Random) {
@@ -100,6 +102,13 @@ QString Search::ToSql(const QString& songs_table) const {
   return sql;
 }
 
+QString Search::ToIdSql(const QString& songs_table) const {
+  QString sql = "SELECT ROWID FROM " + songs_table + WhereClause();
+  qLog(Debug) << sql;
+
+  return sql;
+}
+
 bool Search::is_valid() const {
   if (search_type_ == Type_All)
     return true;
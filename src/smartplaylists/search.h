@@ -57,11 +57,18 @@ public:
   int limit_;
 
   // Not persisted, used to alter the behaviour of the query
-  QList<int> id_not_in_;
+  QList<int> id_in_;
   int first_item_;
 
   void Reset();
   QString ToSql(const QString& songs_table) const;
+
+  // Selects just the ROWIDs of the matching songs, unsorted and without a
+  // limit.
+  QString ToIdSql(const QString& songs_table) const;
+
+private:
+  QString WhereClause() const;
 };
 
 } // namespace
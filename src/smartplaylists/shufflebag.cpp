@@ -0,0 +1,132 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "shufflebag.h"
+
+#include <ctime>
+
+#include <boost/random/uniform_int.hpp>
+
+namespace smart_playlists {
+
+ShuffleBag::ShuffleBag()
+  : remaining_(0),
+    random_(std::time(0))
+{
+}
+
+void ShuffleBag::Reset(const QList<int>& ids) {
+  ids_.clear();
+  positions_.clear();
+  excluded_.clear();
+  ids_.reserve(ids.count());
+  positions_.reserve(ids.count());
+
+  foreach (int id, ids) {
+    if (positions_.contains(id))
+      continue;
+    positions_[id] = ids_.count();
+    ids_ << id;
+  }
+  remaining_ = ids_.count();
+}
+
+void ShuffleBag::Swap(int a, int b) {
+  if (a == b)
+    return;
+
+  qSwap(ids_[a], ids_[b]);
+  positions_[ids_[a]] = a;
+  positions_[ids_[b]] = b;
+}
+
+void ShuffleBag::Add(int id) {
+  if (positions_.contains(id))
+    return;
+
+  // Append it, then swap it with the first song that's been taken so it
+  // ends up in the bag.
+  positions_[id] = ids_.count();
+  ids_ << id;
+  Swap(remaining_, ids_.count() - 1);
+  remaining_ ++;
+}
+
+void ShuffleBag::Remove(int id) {
+  QHash<int, int>::iterator it = positions_.find(id);
+  if (it == positions_.end())
+    return;
+
+  int position = it.value();
+  if (position < remaining_) {
+    // Move it to the end of the bag first, so the bag stays in one piece
+    Swap(position, remaining_ - 1);
+    position = remaining_ - 1;
+    remaining_ --;
+  }
+
+  Swap(position, ids_.count() - 1);
+  ids_.pop_back();
+  positions_.remove(id);
+}
+
+void ShuffleBag::Exclude(int id) {
+  if (id < 0)
+    return;
+  if (id >= excluded_.size())
+    excluded_.resize(qMax(id + 1, excluded_.size() * 2));
+  excluded_.setBit(id);
+}
+
+void ShuffleBag::Include(int id) {
+  if (id >= 0 && id < excluded_.size())
+    excluded_.clearBit(id);
+}
+
+bool ShuffleBag::IsExcluded(int id) const {
+  return id >= 0 && id < excluded_.size() && excluded_.testBit(id);
+}
+
+int ShuffleBag::Take() {
+  bool refilled = false;
+
+  forever {
+    if (remaining_ == 0) {
+      // Everything's been taken, or was excluded when we looked at it.  Put
+      // it all back, but only once - if there's still nothing we can take
+      // after that then everything is excluded.
+      if (refilled || ids_.isEmpty())
+        return -1;
+      remaining_ = ids_.count();
+      refilled = true;
+    }
+
+    boost::uniform_int<> range(0, remaining_ - 1);
+    const int position = range(random_);
+    const int id = ids_[position];
+
+    // Take it out of the bag whether we can use it or not.  Excluded songs
+    // get another chance when the bag is refilled.
+    Swap(position, remaining_ - 1);
+    remaining_ --;
+
+    if (!IsExcluded(id))
+      return id;
+  }
+}
+
+} // namespace
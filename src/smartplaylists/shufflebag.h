@@ -0,0 +1,79 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SMARTPLAYLISTSHUFFLEBAG_H
+#define SMARTPLAYLISTSHUFFLEBAG_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include <boost/random/mersenne_twister.hpp>
+
+namespace smart_playlists {
+
+// The IDs of the songs a random dynamic playlist can pick from, so more songs
+// can be picked without asking the database again.
+// Songs are taken out of the bag at random until it's empty, then it's
+// refilled, so every song gets played once before any is played twice.
+// Excluded songs - ones that are already in the playlist - are never taken.
+// Apart from Reset everything takes constant time, or constant time on
+// average for Take.
+class ShuffleBag {
+ public:
+  ShuffleBag();
+
+  // Replaces every song in the bag and forgets the exclusions.
+  void Reset(const QList<int>& ids);
+
+  // Adds a song that's started matching the search.  It's put in the bag
+  // straight away.  Does nothing if it's already there.
+  void Add(int id);
+  void Remove(int id);
+  bool Contains(int id) const { return positions_.contains(id); }
+
+  // Total number of songs, whether they're in the bag or have been taken.
+  int count() const { return ids_.count(); }
+
+  void Exclude(int id);
+  void Include(int id);
+  bool IsExcluded(int id) const;
+
+  // Takes a random song that isn't excluded out of the bag, refilling it if
+  // it's empty.  Returns -1 if every song is excluded.
+  int Take();
+
+ private:
+  void Swap(int a, int b);
+
+ private:
+  // ids_[0, remaining_) are still in the bag, the rest have been taken.
+  QVector<int> ids_;
+  int remaining_;
+
+  // Where each ID is in ids_.
+  QHash<int, int> positions_;
+
+  QBitArray excluded_;
+
+  boost::mt19937 random_;
+};
+
+} // namespace
+
+#endif // SMARTPLAYLISTSHUFFLEBAG_H
@@ -233,6 +233,9 @@ QString AlbumCoverChoiceController::SaveCoverInCache(
   // Save the image to disk
   image.save(path, "JPG");
 
+  // The old cover for this album might still be cached under the same name.
+  app_->album_cover_loader()->InvalidateCover(path);
+
   return path;
 }
 
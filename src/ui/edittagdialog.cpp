@@ -60,6 +60,7 @@ EditTagDialog::EditTagDialog(Application* app, QWidget* parent)
     cover_art_is_set_(false),
     results_dialog_(new TrackSelectionDialog(this))
 {
+  cover_options_.need_original_image_ = true;
   cover_options_.default_output_image_ =
       AlbumCoverLoader::ScaleAndPad(cover_options_, QImage(":nocover.png"));
 
@@ -113,6 +113,7 @@
 
 #ifdef HAVE_MOODBAR
 # include "moodbar/moodbarcontroller.h"
+# include "moodbar/moodbarloader.h"
 # include "moodbar/moodbarproxystyle.h"
 #endif
 
@@ -653,6 +654,16 @@ MainWindow::MainWindow(Application* app,
   // Moodbar connections
   connect(app_->moodbar_controller(), SIGNAL(CurrentMoodbarDataChanged(QByteArray)),
           ui_->track_slider->moodbar_style(), SLOT(SetMoodbarData(QByteArray)));
+
+  // Put the bulk moodbar action next to the other library actions.
+  QAction* generate_moodbars = new QAction(
+      tr("Generate moodbars for the whole library"), this);
+  const QList<QAction*> tools_actions = ui_->menu_tools->actions();
+  ui_->menu_tools->insertAction(
+      tools_actions.value(tools_actions.indexOf(ui_->action_full_library_scan) + 1),
+      generate_moodbars);
+  connect(generate_moodbars, SIGNAL(triggered()),
+          app_->moodbar_loader(), SLOT(GenerateLibraryMoodbars()));
 #endif
 
   // Now playing widget
@@ -1434,14 +1445,15 @@ void MainWindow::EditTracks() {
 }
 
 void MainWindow::EditTagDialogAccepted() {
-  foreach (PlaylistItemPtr item, edit_tag_dialog_->playlist_items()) {
+  const PlaylistItemList items = edit_tag_dialog_->playlist_items();
+  foreach (PlaylistItemPtr item, items) {
     item->Reload();
   }
 
   // This is really lame but we don't know what rows have changed
   ui_->playlist->view()->update();
 
-  app_->playlist_manager()->current()->Save();
+  app_->playlist_manager()->current()->Save(items);
 }
 
 void MainWindow::RenumberTracks() {
@@ -2152,6 +2164,8 @@ void MainWindow::AutoCompleteTagsAccepted() {
 
   // This is really lame but we don't know what rows have changed
   ui_->playlist->view()->update();
+
+  app_->playlist_manager()->current()->Save(autocomplete_tag_items_);
 }
 
 QPixmap MainWindow::CreateOverlayedIcon(int position, int scrobble_point) {
@@ -0,0 +1,109 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "covers/albumcovercache.h"
+#include "core/song.h"
+
+namespace {
+
+class AlbumCoverCacheTest : public ::testing::Test {
+ protected:
+  static QImage MakeImage(int size) {
+    QImage image(size, size, QImage::Format_ARGB32);
+    image.fill(0xff336699);
+    return image;
+  }
+
+  AlbumCoverLoaderOptions options_;
+};
+
+TEST_F(AlbumCoverCacheTest, FindsInsertedImage) {
+  AlbumCoverCache cache;
+  const AlbumCoverCache::Key key = AlbumCoverCache::MakeKey(
+        options_, "/covers/a.jpg", QString(), "/music/a.mp3");
+
+  QImage image;
+  EXPECT_FALSE(cache.Find(key, &image));
+
+  cache.Insert(key, MakeImage(120));
+  ASSERT_TRUE(cache.Find(key, &image));
+  EXPECT_EQ(120, image.width());
+}
+
+TEST_F(AlbumCoverCacheTest, KeyIncludesTargetSize) {
+  AlbumCoverCache cache;
+  cache.Insert(AlbumCoverCache::MakeKey(options_, "/covers/a.jpg", QString(),
+                                        QString()),
+               MakeImage(120));
+
+  AlbumCoverLoaderOptions bigger;
+  bigger.desired_height_ = 300;
+
+  QImage image;
+  EXPECT_FALSE(cache.Find(AlbumCoverCache::MakeKey(
+      bigger, "/covers/a.jpg", QString(), QString()), &image));
+}
+
+TEST_F(AlbumCoverCacheTest, SongFilenameOnlyMattersForEmbeddedArt) {
+  EXPECT_TRUE(
+      AlbumCoverCache::MakeKey(options_, "/covers/a.jpg", QString(), "/a.mp3") ==
+      AlbumCoverCache::MakeKey(options_, "/covers/a.jpg", QString(), "/b.mp3"));
+  EXPECT_FALSE(
+      AlbumCoverCache::MakeKey(options_, Song::kEmbeddedCover, QString(), "/a.mp3") ==
+      AlbumCoverCache::MakeKey(options_, Song::kEmbeddedCover, QString(), "/b.mp3"));
+}
+
+TEST_F(AlbumCoverCacheTest, EvictsLeastRecentlyUsed) {
+  // Each 64x64 ARGB image costs 17 KB.
+  AlbumCoverCache cache(40);
+  const AlbumCoverCache::Key a = AlbumCoverCache::MakeKey(options_, "a", QString(), QString());
+  const AlbumCoverCache::Key b = AlbumCoverCache::MakeKey(options_, "b", QString(), QString());
+  const AlbumCoverCache::Key c = AlbumCoverCache::MakeKey(options_, "c", QString(), QString());
+
+  QImage image;
+  cache.Insert(a, MakeImage(64));
+  cache.Insert(b, MakeImage(64));
+  ASSERT_TRUE(cache.Find(a, &image));
+
+  cache.Insert(c, MakeImage(64));
+  EXPECT_TRUE(cache.Find(a, &image));
+  EXPECT_FALSE(cache.Find(b, &image));
+  EXPECT_TRUE(cache.Find(c, &image));
+  EXPECT_LE(cache.size_kb(), 40);
+}
+
+TEST_F(AlbumCoverCacheTest, RemoveForgetsEveryEntryForAFile) {
+  AlbumCoverCache cache;
+  AlbumCoverLoaderOptions bigger;
+  bigger.desired_height_ = 300;
+
+  cache.Insert(AlbumCoverCache::MakeKey(options_, QString(), "/covers/a.jpg", QString()),
+               MakeImage(120));
+  cache.Insert(AlbumCoverCache::MakeKey(bigger, QString(), "/covers/a.jpg", QString()),
+               MakeImage(300));
+  cache.Insert(AlbumCoverCache::MakeKey(options_, QString(), "/covers/b.jpg", QString()),
+               MakeImage(120));
+  ASSERT_EQ(3, cache.count());
+
+  cache.Remove("/covers/a.jpg");
+  EXPECT_EQ(1, cache.count());
+}
+
+}  // namespace
@@ -0,0 +1,107 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "covers/albumcoverthumbnailcache.h"
+#include "core/utilities.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QDir>
+#include <QTemporaryFile>
+
+namespace {
+
+class AlbumCoverThumbnailCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    directory_ = Utilities::MakeTempDir();
+    cache_.reset(new AlbumCoverThumbnailCache(directory_));
+
+    source_.reset(new QTemporaryFile(QDir::tempPath() + "/thumbnailtest-XXXXXX.png"));
+    ASSERT_TRUE(source_->open());
+    MakeImage(500).save(source_.get(), "PNG");
+    source_->close();
+  }
+
+  void TearDown() {
+    Utilities::RemoveRecursive(directory_);
+  }
+
+  static QImage MakeImage(int size) {
+    QImage image(size, size, QImage::Format_ARGB32);
+    image.fill(0xff336699);
+    return image;
+  }
+
+  AlbumCoverCache::Key KeyFor(const QString& art_manual) const {
+    return AlbumCoverCache::MakeKey(options_, QString(), art_manual, QString());
+  }
+
+  QString directory_;
+  AlbumCoverLoaderOptions options_;
+  boost::scoped_ptr<AlbumCoverThumbnailCache> cache_;
+  boost::scoped_ptr<QTemporaryFile> source_;
+};
+
+TEST_F(AlbumCoverThumbnailCacheTest, LoadsSavedThumbnail) {
+  const AlbumCoverCache::Key key = KeyFor(source_->fileName());
+
+  QImage image;
+  EXPECT_FALSE(cache_->Load(key, &image));
+
+  cache_->Save(key, MakeImage(120));
+  ASSERT_TRUE(cache_->Load(key, &image));
+  EXPECT_EQ(120, image.width());
+  EXPECT_EQ(120, image.height());
+}
+
+TEST_F(AlbumCoverThumbnailCacheTest, DifferentSourceMisses) {
+  cache_->Save(KeyFor(source_->fileName()), MakeImage(120));
+
+  QImage image;
+  EXPECT_FALSE(cache_->Load(KeyFor(source_->fileName() + ".other"), &image));
+}
+
+TEST_F(AlbumCoverThumbnailCacheTest, ChangedSourceMisses) {
+  const AlbumCoverCache::Key key = KeyFor(source_->fileName());
+  cache_->Save(key, MakeImage(120));
+
+  source_->remove();
+
+  QImage image;
+  EXPECT_FALSE(cache_->Load(key, &image));
+}
+
+TEST_F(AlbumCoverThumbnailCacheTest, OnlyStoresSmallScaledImages) {
+  AlbumCoverLoaderOptions unscaled;
+  unscaled.scale_output_image_ = false;
+  unscaled.pad_output_image_ = false;
+  EXPECT_FALSE(AlbumCoverThumbnailCache::IsSupported(
+      AlbumCoverCache::MakeKey(unscaled, QString(), "a.jpg", QString())));
+
+  AlbumCoverLoaderOptions huge;
+  huge.desired_height_ = AlbumCoverThumbnailCache::kMaxHeight + 1;
+  EXPECT_FALSE(AlbumCoverThumbnailCache::IsSupported(
+      AlbumCoverCache::MakeKey(huge, QString(), "a.jpg", QString())));
+
+  EXPECT_TRUE(AlbumCoverThumbnailCache::IsSupported(KeyFor("a.jpg")));
+}
+
+}  // namespace
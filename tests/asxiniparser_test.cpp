@@ -23,6 +23,7 @@
 #include "playlistparsers/playlistparser.h"
 
 #include <QBuffer>
+#include <QSignalSpy>
 #include <QUrl>
 
 class AsxIniParserTest : public ::testing::Test {
@@ -44,6 +45,32 @@ TEST_F(AsxIniParserTest, ParsesBasicTrackList) {
   EXPECT_TRUE(songs[1].is_valid());
 }
 
+TEST_F(AsxIniParserTest, LoadsLongTrackListInChunks) {
+  const int count = ParserBase::kLoadSongsChunkSize + 10;
+
+  QByteArray data("[Reference]\n");
+  for (int i=0 ; i<count ; ++i) {
+    data += QString("Ref%1=http://www.example.com/%1.mp3\n").arg(i + 1).toUtf8();
+  }
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::ReadOnly);
+
+  QSignalSpy spy(&parser_, SIGNAL(SongsLoaded(SongList)));
+
+  SongList songs = parser_.Load(&buffer, "", QDir());
+  ASSERT_EQ(count, songs.length());
+  EXPECT_EQ(QUrl("http://www.example.com/1.mp3"), songs.first().url());
+  EXPECT_EQ(QUrl(QString("http://www.example.com/%1.mp3").arg(count)),
+            songs.last().url());
+
+  ASSERT_EQ(2, spy.count());
+  const SongList first = spy[0][0].value<SongList>();
+  const SongList second = spy[1][0].value<SongList>();
+  EXPECT_EQ(ParserBase::kLoadSongsChunkSize, first.length());
+  EXPECT_EQ(10, second.length());
+  EXPECT_EQ(songs.last().url(), second.last().url());
+}
+
 TEST_F(AsxIniParserTest, Magic) {
   QFile file(":/testdata/test.asxini");
   file.open(QIODevice::ReadOnly);
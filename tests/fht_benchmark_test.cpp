@@ -0,0 +1,67 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gtest/gtest.h"
+
+#include "core/fht.h"
+#include "core/fhtkernels.h"
+
+#include <QElapsedTimer>
+
+#include <math.h>
+
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Runs the analyzers' FHT with every set of kernels this CPU supports, for
+// the sizes the analyzers use and a bit either side.
+TEST(FHTBenchmark, TransformsPerSecond) {
+  const FHTKernels::Table* kernels[FHTKernels::kMaxTables];
+  const int kernel_count = FHTKernels::Available(kernels);
+  const qint64 kRunMsec = 250;
+
+  for (int exp2=9 ; exp2<=13 ; ++exp2) {
+    const int size = 1 << exp2;
+    std::vector<float> input(size);
+    for (int i=0 ; i<size ; ++i) {
+      input[i] = sinf(i * 0.1f) + 0.5f * sinf(i * 0.37f);
+    }
+    std::vector<float> buffer(size);
+
+    for (int k=0 ; k<kernel_count ; ++k) {
+      FHT fht(exp2, kernels[k]);
+
+      int transforms = 0;
+      QElapsedTimer timer;
+      timer.start();
+      while (timer.elapsed() < kRunMsec) {
+        fht.copy(&buffer[0], &input[0]);
+        fht.power2(&buffer[0]);
+        ++transforms;
+      }
+
+      std::cout << "FHT 2^" << exp2 << " " << fht.kernelName() << ": "
+                << qint64(transforms * 1000.0 / timer.elapsed())
+                << " transforms/sec" << std::endl;
+      EXPECT_GT(transforms, 0);
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,104 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gtest/gtest.h"
+
+#include "core/fht.h"
+#include "core/fhtkernels.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+namespace {
+
+std::vector<float> RandomSignal(int size) {
+  std::vector<float> ret(size);
+  for (int i=0 ; i<size ; ++i) {
+    ret[i] = float(rand()) / RAND_MAX - 0.5f;
+  }
+  return ret;
+}
+
+TEST(FHTTest, MatchesDiscreteHartleyTransform) {
+  for (int exp2=3 ; exp2<=10 ; ++exp2) {
+    const int size = 1 << exp2;
+    const std::vector<float> input = RandomSignal(size);
+
+    std::vector<float> output(input);
+    FHT fht(exp2);
+    fht.transform(&output[0]);
+
+    for (int k=0 ; k<size ; ++k) {
+      double expected = 0.0;
+      for (int n=0 ; n<size ; ++n) {
+        const double angle = 2 * M_PI * n * k / size;
+        expected += input[n] * (cos(angle) + sin(angle));
+      }
+      ASSERT_NEAR(expected, output[k], 1e-4) << "size " << size << ", bin " << k;
+    }
+  }
+}
+
+TEST(FHTTest, KernelsGiveSameResults) {
+  const FHTKernels::Table* kernels[FHTKernels::kMaxTables];
+  const int kernel_count = FHTKernels::Available(kernels);
+
+  for (int exp2=4 ; exp2<=13 ; ++exp2) {
+    const int size = 1 << exp2;
+    const std::vector<float> input = RandomSignal(size);
+    const std::vector<float> history = RandomSignal(size);
+
+    FHT reference(exp2, &FHTKernels::Scalar());
+    std::vector<float> expected_power(input);
+    std::vector<float> expected_spectrum(input);
+    std::vector<float> expected_ewma(history);
+    reference.power(&expected_power[0]);
+    reference.spectrum(&expected_spectrum[0]);
+    reference.ewma(&expected_ewma[0], &expected_power[0], 0.3f);
+
+    for (int k=0 ; k<kernel_count ; ++k) {
+      FHT fht(exp2, kernels[k]);
+      std::vector<float> power(input);
+      std::vector<float> spectrum(input);
+      std::vector<float> ewma(history);
+      fht.power(&power[0]);
+      fht.spectrum(&spectrum[0]);
+      fht.ewma(&ewma[0], &power[0], 0.3f);
+
+      for (int i=0 ; i<size/2 ; ++i) {
+        ASSERT_FLOAT_EQ(expected_power[i], power[i]) << fht.kernelName();
+        ASSERT_FLOAT_EQ(expected_spectrum[i], spectrum[i]) << fht.kernelName();
+        ASSERT_FLOAT_EQ(expected_ewma[i], ewma[i]) << fht.kernelName();
+      }
+    }
+  }
+}
+
+TEST(FHTTest, SilenceHasFlatLogSpectrum) {
+  FHT fht(9);
+  std::vector<float> input(fht.size(), 0.0f);
+  std::vector<float> output(fht.size(), 1.0f);
+
+  fht.logSpectrum(&output[0], &input[0]);
+  for (int i=0 ; i<fht.size()/2 ; ++i) {
+    EXPECT_EQ(0.0f, output[i]);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,100 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "library/librarybackend.h"
+#include "library/library.h"
+#include "core/database.h"
+#include "core/song.h"
+#include "core/timeconstants.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include <iostream>
+
+namespace {
+
+class LibraryBackendBenchmark : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(NULL));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable,
+                   Library::kDirsTable, Library::kSubdirsTable,
+                   Library::kFtsTable);
+
+    // Add a directory - this will get ID 1
+    backend_->AddDirectory("/tmp");
+  }
+
+  int CountRows(const QString& table) {
+    QSqlQuery q(QString("SELECT COUNT(*) FROM %1").arg(table),
+                database_->Connect());
+    q.exec();
+    if (!q.next())
+      return -1;
+    return q.value(0).toInt();
+  }
+
+  static SongList MakeSongs(int count) {
+    // Songs are spread over a realistic number of artists and albums.
+    SongList ret;
+    for (int i=0 ; i<count ; ++i) {
+      Song song;
+      song.Init(QString("Title %1").arg(i),
+                QString("Artist %1").arg(i / 100),
+                QString("Album %1").arg(i / 10),
+                180 * kNsecPerSec);
+      song.set_directory_id(1);
+      song.set_url(QUrl::fromLocalFile(QString("/tmp/%1/%2.mp3").arg(i / 10).arg(i)));
+      song.set_track(i % 10 + 1);
+      song.set_genre("Genre");
+      song.set_mtime(1);
+      song.set_ctime(1);
+      song.set_filesize(1);
+      ret << song;
+    }
+    return ret;
+  }
+
+  boost::scoped_ptr<Database> database_;
+  boost::scoped_ptr<LibraryBackend> backend_;
+};
+
+TEST_F(LibraryBackendBenchmark, AddOrUpdateSongs100k) {
+  const int kSongCount = 100000;
+  SongList songs = MakeSongs(kSongCount);
+
+  QElapsedTimer timer;
+  timer.start();
+  backend_->AddOrUpdateSongs(songs);
+  const qint64 insert_msec = timer.elapsed();
+
+  EXPECT_EQ(kSongCount, CountRows(Library::kSongsTable));
+  EXPECT_EQ(kSongCount, CountRows(Library::kFtsTable));
+
+  std::cout << "Inserted " << kSongCount << " songs in " << insert_msec
+            << " ms (" << (kSongCount * 1000 / qMax(qint64(1), insert_msec))
+            << " songs/s)" << std::endl;
+}
+
+}  // namespace
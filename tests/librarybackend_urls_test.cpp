@@ -0,0 +1,141 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "library/librarybackend.h"
+#include "library/library.h"
+#include "core/database.h"
+#include "core/song.h"
+#include "core/timeconstants.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QSet>
+#include <QStringList>
+
+namespace {
+
+class LibraryBackendUrlsTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(NULL));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable,
+                   Library::kDirsTable, Library::kSubdirsTable,
+                   Library::kFtsTable);
+
+    // Add a directory - this will get ID 1
+    backend_->AddDirectory("/tmp");
+  }
+
+  static Song MakeSong(const QString& filename) {
+    Song song;
+    song.Init(filename, "Artist", "Album", 180 * kNsecPerSec);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(filename));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+    return song;
+  }
+
+  static QList<QUrl> Urls(const SongList& songs) {
+    QList<QUrl> ret;
+    foreach (const Song& song, songs) {
+      ret << song.url();
+    }
+    return ret;
+  }
+
+  static QSet<QString> Titles(const SongList& songs) {
+    QSet<QString> ret;
+    foreach (const Song& song, songs) {
+      ret << song.title();
+    }
+    return ret;
+  }
+
+  boost::scoped_ptr<Database> database_;
+  boost::scoped_ptr<LibraryBackend> backend_;
+};
+
+TEST_F(LibraryBackendUrlsTest, FindsSongsInEveryChunk) {
+  // More than two chunks' worth of urls.
+  SongList songs;
+  for (int i=0 ; i<1200 ; ++i) {
+    songs << MakeSong(QString("/tmp/%1.mp3").arg(i));
+  }
+  backend_->AddOrUpdateSongs(songs);
+
+  QList<QUrl> urls = Urls(songs);
+  urls << QUrl::fromLocalFile("/tmp/notinlibrary.mp3");
+
+  const SongList found = backend_->GetSongsByUrls(urls);
+  ASSERT_EQ(songs.count(), found.count());
+  EXPECT_EQ(Titles(songs), Titles(found));
+}
+
+TEST_F(LibraryBackendUrlsTest, FindsNonAsciiFilenames) {
+  SongList songs;
+  songs << MakeSong(QString::fromUtf8("/tmp/Bj\xc3\xb6rk/J\xc3\xb3ga.mp3"))
+        << MakeSong(QString::fromUtf8("/tmp/\xe6\x97\xa5\xe6\x9c\xac/\xe6\x9b\xb2.mp3"))
+        << MakeSong("/tmp/100% #1 hits?.mp3");
+  backend_->AddOrUpdateSongs(songs);
+
+  const SongList found = backend_->GetSongsByUrls(Urls(songs));
+  ASSERT_EQ(3, found.count());
+  EXPECT_EQ(Titles(songs), Titles(found));
+
+  // The same songs as looking them up one at a time.
+  foreach (const Song& song, found) {
+    EXPECT_EQ(backend_->GetSongByUrl(song.url()).id(), song.id());
+  }
+}
+
+TEST_F(LibraryBackendUrlsTest, SkipsUnavailableSongs) {
+  SongList songs;
+  songs << MakeSong("/tmp/available.mp3") << MakeSong("/tmp/unavailable.mp3");
+  backend_->AddOrUpdateSongs(songs);
+  backend_->MarkSongsUnavailable(
+      SongList() << backend_->GetSongByUrl(songs[1].url()));
+
+  const SongList found = backend_->GetSongsByUrls(Urls(songs));
+  ASSERT_EQ(1, found.count());
+  EXPECT_EQ("/tmp/available.mp3", found[0].title());
+}
+
+TEST_F(LibraryBackendUrlsTest, FindsEverySectionOfACueFile) {
+  SongList songs;
+  for (int i=0 ; i<2 ; ++i) {
+    Song song(MakeSong("/tmp/album.flac"));
+    song.set_title(QString("Track %1").arg(i + 1));
+    song.set_track(i + 1);
+    song.set_cue_path("/tmp/album.cue");
+    song.set_beginning_nanosec(i * 180 * kNsecPerSec);
+    song.set_end_nanosec((i + 1) * 180 * kNsecPerSec);
+    songs << song;
+  }
+  backend_->AddOrUpdateSongs(songs);
+
+  const SongList found =
+      backend_->GetSongsByUrls(QList<QUrl>() << songs[0].url());
+  ASSERT_EQ(2, found.count());
+  EXPECT_EQ(Titles(songs), Titles(found));
+}
+
+}  // namespace
@@ -0,0 +1,198 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/librarycatalogue.h"
+#include "core/database.h"
+#include "core/song.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QStringList>
+
+namespace {
+
+class LibraryCatalogueTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(NULL));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable,
+                   Library::kDirsTable, Library::kSubdirsTable,
+                   Library::kFtsTable);
+    backend_->AddDirectory("/tmp");
+
+    catalogue_.reset(new LibraryCatalogue(backend_.get()));
+  }
+
+  Song AddSong(const QString& artist, const QString& album, int year,
+               bool compilation = false, int ctime = 1) {
+    static int sNextFile = 0;
+
+    Song song;
+    song.Init("Title", artist, album, 123);
+    song.set_year(year);
+    song.set_compilation(compilation);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(QString("/tmp/%1.mp3").arg(sNextFile++)));
+    song.set_mtime(1);
+    song.set_ctime(ctime);
+    song.set_filesize(1);
+
+    backend_->AddOrUpdateSongs(SongList() << song);
+    return backend_->GetSongByUrl(song.url());
+  }
+
+  QStringList Strings(const SqlRowList& rows, int column = 0) {
+    QStringList ret;
+    foreach (const SqlRow& row, rows) {
+      ret << row.value(column).toString();
+    }
+    ret.sort();
+    return ret;
+  }
+
+  SqlRowList Distinct(LibraryCatalogue::Field field,
+                      const LibraryCatalogue::ConstraintList& constraints =
+                          LibraryCatalogue::ConstraintList(),
+                      int min_ctime = -1) {
+    SqlRowList rows;
+    EXPECT_TRUE(catalogue_->Distinct(LibraryCatalogue::FieldList() << field,
+                                     constraints, min_ctime, &rows));
+    return rows;
+  }
+
+  boost::scoped_ptr<Database> database_;
+  boost::scoped_ptr<LibraryBackend> backend_;
+  boost::scoped_ptr<LibraryCatalogue> catalogue_;
+};
+
+typedef LibraryCatalogue::Constraint Constraint;
+typedef LibraryCatalogue::ConstraintList ConstraintList;
+
+TEST_F(LibraryCatalogueTest, LoadsFromDatabase) {
+  AddSong("Artist 1", "Album 1", 2001);
+  AddSong("Artist 1", "Album 2", 2002);
+  AddSong("Artist 2", "Album 3", 2003);
+
+  EXPECT_EQ(QStringList() << "Artist 1" << "Artist 2",
+            Strings(Distinct(LibraryCatalogue::Field_Artist)));
+  EXPECT_EQ(3, catalogue_->song_count());
+
+  EXPECT_EQ(QStringList() << "Album 1" << "Album 2",
+            Strings(Distinct(LibraryCatalogue::Field_Album, ConstraintList()
+                << Constraint(LibraryCatalogue::Field_Artist, "Artist 1"))));
+}
+
+TEST_F(LibraryCatalogueTest, DistinctPairs) {
+  AddSong("Artist", "Album", 2001);
+  AddSong("Artist", "Album", 2001);
+  AddSong("Artist", "Album", 2002);
+
+  SqlRowList rows;
+  ASSERT_TRUE(catalogue_->Distinct(
+      LibraryCatalogue::FieldList() << LibraryCatalogue::Field_Year
+                                    << LibraryCatalogue::Field_Album,
+      ConstraintList(), -1, &rows));
+  ASSERT_EQ(2, rows.count());
+  EXPECT_EQ("Album", rows[0].value(1).toString());
+  EXPECT_EQ(QStringList() << "2001" << "2002", Strings(rows));
+}
+
+TEST_F(LibraryCatalogueTest, AllSongs) {
+  const Song song1 = AddSong("Artist 1", "Album 1", 2001);
+  const Song song2 = AddSong("Artist 2", "Album 2", 2002, true);
+
+  QList<int> ids;
+  SqlRowList rows;
+  ASSERT_TRUE(catalogue_->AllSongs(
+      LibraryCatalogue::FieldList() << LibraryCatalogue::Field_Compilation
+                                    << LibraryCatalogue::Field_Year
+                                    << LibraryCatalogue::Field_Album,
+      &ids, &rows));
+  ASSERT_EQ(2, ids.count());
+  ASSERT_EQ(2, rows.count());
+
+  const int first = ids.indexOf(song1.id());
+  const int second = ids.indexOf(song2.id());
+  ASSERT_NE(-1, first);
+  ASSERT_NE(-1, second);
+
+  EXPECT_EQ(0, rows[first].value(0).toInt());
+  EXPECT_EQ(2001, rows[first].value(1).toInt());
+  EXPECT_EQ("Album 1", rows[first].value(2).toString());
+  EXPECT_EQ(1, rows[second].value(0).toInt());
+  EXPECT_EQ(2002, rows[second].value(1).toInt());
+  EXPECT_EQ("Album 2", rows[second].value(2).toString());
+}
+
+TEST_F(LibraryCatalogueTest, UnknownStringMatchesNothing) {
+  AddSong("Artist", "Album", 2001);
+
+  EXPECT_TRUE(Distinct(LibraryCatalogue::Field_Album, ConstraintList()
+      << Constraint(LibraryCatalogue::Field_Artist, "Nobody")).isEmpty());
+}
+
+TEST_F(LibraryCatalogueTest, Compilations) {
+  AddSong("Artist", "Album", 2001);
+
+  bool exists = true;
+  ASSERT_TRUE(catalogue_->Exists(ConstraintList()
+      << Constraint(LibraryCatalogue::Field_Compilation, 1), -1, &exists));
+  EXPECT_FALSE(exists);
+
+  AddSong("Various", "Compilation", 2001, true);
+  ASSERT_TRUE(catalogue_->Exists(ConstraintList()
+      << Constraint(LibraryCatalogue::Field_Compilation, 1), -1, &exists));
+  EXPECT_TRUE(exists);
+}
+
+TEST_F(LibraryCatalogueTest, MaxAge) {
+  AddSong("Old", "Album", 2001, false, 100);
+  AddSong("New", "Album", 2001, false, 200);
+
+  EXPECT_EQ(QStringList() << "New",
+            Strings(Distinct(LibraryCatalogue::Field_Artist,
+                             ConstraintList(), 150)));
+}
+
+TEST_F(LibraryCatalogueTest, FollowsBackendChanges) {
+  AddSong("Artist 1", "Album", 2001);
+
+  // Load the catalogue, then change the library underneath it.
+  EXPECT_EQ(1, Distinct(LibraryCatalogue::Field_Artist).count());
+
+  Song song = AddSong("Artist 2", "Album", 2001);
+  EXPECT_EQ(QStringList() << "Artist 1" << "Artist 2",
+            Strings(Distinct(LibraryCatalogue::Field_Artist)));
+
+  song.set_artist("Artist 3");
+  backend_->AddOrUpdateSongs(SongList() << song);
+  EXPECT_EQ(QStringList() << "Artist 1" << "Artist 3",
+            Strings(Distinct(LibraryCatalogue::Field_Artist)));
+
+  backend_->DeleteSongs(SongList() << song);
+  EXPECT_EQ(QStringList() << "Artist 1",
+            Strings(Distinct(LibraryCatalogue::Field_Artist)));
+  EXPECT_EQ(1, catalogue_->song_count());
+}
+
+}  // namespace
@@ -0,0 +1,201 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "core/database.h"
+#include "core/song.h"
+#include "core/utilities.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/librarycatalogue.h"
+#include "library/librarymodel.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QCoreApplication>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QThreadPool>
+
+namespace {
+
+class LibraryModelFilterTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    // The filter query runs on other threads, and each thread would get its
+    // own empty :memory: database, so use a file they can all open.
+    directory_ = Utilities::MakeTempDir();
+    database_.reset(new Database(NULL, NULL, directory_ + "/library.db"));
+
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable,
+                   Library::kDirsTable, Library::kSubdirsTable,
+                   Library::kFtsTable);
+    backend_->AddDirectory("/tmp");
+
+    catalogue_.reset(new LibraryCatalogue(backend_.get()));
+    model_.reset(new LibraryModel(backend_.get(), NULL));
+    model_->set_catalogue(catalogue_.get());
+  }
+
+  virtual void TearDown() {
+    QThreadPool::globalInstance()->waitForDone();
+
+    model_.reset();
+    catalogue_.reset();
+    backend_.reset();
+    database_.reset();
+    Utilities::RemoveRecursive(directory_);
+  }
+
+  Song AddSong(const QString& title, const QString& artist,
+               const QString& album, int year) {
+    static int sNextFile = 0;
+
+    Song song;
+    song.Init(title, artist, album, 123);
+    song.set_year(year);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(QString("/tmp/%1.mp3").arg(sNextFile++)));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+
+    backend_->AddOrUpdateSongs(SongList() << song);
+    return backend_->GetSongByUrl(song.url());
+  }
+
+  // Lets the background filter query, and the song lookup that can follow
+  // it, finish and be applied to the model.
+  void WaitForFilter() {
+    for (int i=0 ; i<2 ; ++i) {
+      QThreadPool::globalInstance()->waitForDone();
+      QCoreApplication::processEvents();
+    }
+  }
+
+  // The display text of parent's children, leaving out dividers.
+  QStringList Children(const QModelIndex& parent) {
+    QStringList ret;
+    for (int i=0 ; i<model_->rowCount(parent) ; ++i) {
+      const QModelIndex index = model_->index(i, 0, parent);
+      if (!index.data(LibraryModel::Role_IsDivider).toBool())
+        ret << index.data().toString();
+    }
+    ret.sort();
+    return ret;
+  }
+
+  QModelIndex FindChild(const QModelIndex& parent, const QString& text) {
+    for (int i=0 ; i<model_->rowCount(parent) ; ++i) {
+      const QModelIndex index = model_->index(i, 0, parent);
+      if (index.data().toString() == text)
+        return index;
+    }
+    return QModelIndex();
+  }
+
+  QString directory_;
+  boost::scoped_ptr<Database> database_;
+  boost::scoped_ptr<LibraryBackend> backend_;
+  boost::scoped_ptr<LibraryCatalogue> catalogue_;
+  boost::scoped_ptr<LibraryModel> model_;
+};
+
+TEST_F(LibraryModelFilterTest, NarrowingRemovesRows) {
+  AddSong("Apple", "Artist 1", "Album 1", 2000);
+  AddSong("Banana", "Artist 1", "Album 1", 2000);
+  AddSong("Cherry", "Artist 2", "Album 2", 2000);
+  model_->Init(false);
+
+  QModelIndex artist_index = FindChild(QModelIndex(), "Artist 1");
+  model_->fetchMore(artist_index);
+  QModelIndex album_index = model_->index(0, 0, artist_index);
+  model_->fetchMore(album_index);
+  ASSERT_EQ(2, model_->rowCount(album_index));
+
+  QSignalSpy spy_reset(model_.get(), SIGNAL(modelReset()));
+  model_->SetFilterText("Apple");
+  WaitForFilter();
+
+  // The expanded containers are kept and only the rows that don't match are
+  // removed.
+  EXPECT_EQ(0, spy_reset.count());
+  EXPECT_EQ(QStringList() << "Artist 1", Children(QModelIndex()));
+
+  artist_index = FindChild(QModelIndex(), "Artist 1");
+  ASSERT_EQ(1, model_->rowCount(artist_index));
+  album_index = model_->index(0, 0, artist_index);
+  EXPECT_EQ(QStringList() << "Apple", Children(album_index));
+}
+
+TEST_F(LibraryModelFilterTest, WideningAddsRows) {
+  AddSong("Apple", "Artist 1", "Album 1", 2000);
+  AddSong("Banana", "Artist 1", "Album 1", 2000);
+  AddSong("Cherry", "Artist 2", "Album 2", 2000);
+  model_->Init(false);
+
+  QModelIndex artist_index = FindChild(QModelIndex(), "Artist 1");
+  model_->fetchMore(artist_index);
+  QModelIndex album_index = model_->index(0, 0, artist_index);
+  model_->fetchMore(album_index);
+
+  model_->SetFilterText("Apple");
+  WaitForFilter();
+  ASSERT_EQ(QStringList() << "Artist 1", Children(QModelIndex()));
+
+  QSignalSpy spy_reset(model_.get(), SIGNAL(modelReset()));
+  model_->SetFilterText("");
+  WaitForFilter();
+
+  // The song that came back under the expanded album is loaded, and the
+  // other artist gets a new container that hasn't been loaded yet.
+  EXPECT_EQ(0, spy_reset.count());
+  EXPECT_EQ(QStringList() << "Artist 1" << "Artist 2", Children(QModelIndex()));
+
+  artist_index = FindChild(QModelIndex(), "Artist 1");
+  album_index = model_->index(0, 0, artist_index);
+  EXPECT_EQ(QStringList() << "Apple" << "Banana", Children(album_index));
+
+  QModelIndex other_artist_index = FindChild(QModelIndex(), "Artist 2");
+  EXPECT_TRUE(model_->canFetchMore(other_artist_index));
+}
+
+TEST_F(LibraryModelFilterTest, GroupingChangeKeepsTopLevel) {
+  AddSong("Apple", "Artist 1", "Album 1", 2000);
+  AddSong("Banana", "Artist 1", "Album 2", 2001);
+  model_->Init(false);
+
+  QModelIndex artist_index = FindChild(QModelIndex(), "Artist 1");
+  model_->fetchMore(artist_index);
+  ASSERT_EQ(QStringList() << "Album 1" << "Album 2", Children(artist_index));
+
+  QSignalSpy spy_reset(model_.get(), SIGNAL(modelReset()));
+  model_->SetGroupBy(LibraryModel::Grouping(LibraryModel::GroupBy_Artist,
+                                            LibraryModel::GroupBy_Year));
+  WaitForFilter();
+
+  // Only the level that changed is rebuilt, from the new index.
+  EXPECT_EQ(0, spy_reset.count());
+  artist_index = FindChild(QModelIndex(), "Artist 1");
+  ASSERT_TRUE(artist_index.isValid());
+  model_->fetchMore(artist_index);
+  EXPECT_EQ(QStringList() << "2000" << "2001", Children(artist_index));
+}
+
+} // namespace
@@ -0,0 +1,126 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gtest/gtest.h"
+
+#include "moodbar/moodbarbuilder.h"
+
+#include <math.h>
+
+#include <vector>
+
+namespace {
+
+const int kRate = 44100;
+
+std::vector<float> Sine(float frequency, int count) {
+  std::vector<float> ret(count);
+  for (int i=0 ; i<count ; ++i) {
+    ret[i] = sin(2 * M_PI * frequency * i / kRate);
+  }
+  return ret;
+}
+
+TEST(MoodbarBuilderTest, EmptyStream) {
+  MoodbarBuilder builder;
+  builder.Init(kRate);
+  EXPECT_TRUE(builder.Finish(1000).isEmpty());
+}
+
+TEST(MoodbarBuilderTest, OneFramePerStep) {
+  const std::vector<float> samples = Sine(440, MoodbarBuilder::kWindowSize * 10);
+
+  MoodbarBuilder builder;
+  builder.Init(kRate);
+  builder.AddFrames(&samples[0], samples.size());
+
+  // Overlapping windows: one for the first whole window, then one per step.
+  const int expected =
+      (samples.size() - MoodbarBuilder::kWindowSize) / MoodbarBuilder::kWindowStep + 1;
+  EXPECT_EQ(expected, builder.frame_count());
+}
+
+TEST(MoodbarBuilderTest, BufferBoundariesDontMatter) {
+  const int count = MoodbarBuilder::kWindowSize * 20;
+  std::vector<float> samples(count);
+  for (int i=0 ; i<count ; ++i) {
+    samples[i] = sin(2 * M_PI * (200 + i / 10) * i / kRate);
+  }
+
+  MoodbarBuilder whole;
+  whole.Init(kRate);
+  whole.AddFrames(&samples[0], count);
+
+  // Feed the same samples in odd sized pieces.
+  MoodbarBuilder pieces;
+  pieces.Init(kRate);
+  for (int i=0 ; i<count ; i+=777) {
+    pieces.AddFrames(&samples[i], qMin(777, count - i));
+  }
+
+  EXPECT_EQ(whole.frame_count(), pieces.frame_count());
+  EXPECT_EQ(whole.Finish(1000), pieces.Finish(1000));
+}
+
+TEST(MoodbarBuilderTest, ScalesDownToMaxWidth) {
+  const std::vector<float> samples = Sine(440, MoodbarBuilder::kWindowStep * 3000);
+
+  MoodbarBuilder builder;
+  builder.Init(kRate);
+  builder.AddFrames(&samples[0], samples.size());
+  ASSERT_GT(builder.frame_count(), 1000);
+
+  EXPECT_EQ(1000 * 3, builder.Finish(1000).size());
+}
+
+TEST(MoodbarBuilderTest, FrequenciesPickColours) {
+  // Low, middle and high tones alternate, so each channel is loud a third of
+  // the time and normalisation doesn't wash it out.
+  const float frequencies[] = { 150, 2500, 11000 };
+  const int kSection = MoodbarBuilder::kWindowSize * 16;
+
+  std::vector<float> samples;
+  for (int repeat=0 ; repeat<4 ; ++repeat) {
+    for (int f=0 ; f<3 ; ++f) {
+      const std::vector<float> tone = Sine(frequencies[f], kSection);
+      samples.insert(samples.end(), tone.begin(), tone.end());
+    }
+  }
+
+  MoodbarBuilder builder;
+  builder.Init(kRate);
+  builder.AddFrames(&samples[0], samples.size());
+
+  const int frames = builder.frame_count();
+  const QByteArray data = builder.Finish(0);
+  ASSERT_EQ(frames * 3, data.size());
+
+  // Look at a frame in the middle of each section of the first repeat.
+  const int frames_per_section = kSection / MoodbarBuilder::kWindowStep;
+  for (int f=0 ; f<3 ; ++f) {
+    const int frame = f * frames_per_section + frames_per_section / 2;
+    const quint8 loud = quint8(data[frame * 3 + f]);
+    for (int channel=0 ; channel<3 ; ++channel) {
+      if (channel == f)
+        continue;
+      EXPECT_GT(loud, quint8(data[frame * 3 + channel]))
+          << "tone " << frequencies[f] << "Hz, channel " << channel;
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,287 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "core/database.h"
+#include "core/song.h"
+#include "playlist/playlistbackend.h"
+#include "playlist/playlistitem.h"
+#include "smartplaylists/generator.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QSqlQuery>
+#include <QStringList>
+
+namespace {
+
+// A stream item whose title can be changed in place, like an item whose tags
+// were edited.
+class TestPlaylistItem : public PlaylistItem {
+ public:
+  TestPlaylistItem(const QString& title)
+    : PlaylistItem("Stream") {
+    song_.set_title(title);
+    song_.set_url(QUrl("http://www.example.com/" + title));
+    song_.set_filetype(Song::Type_Stream);
+    song_.set_valid(true);
+  }
+
+  bool InitFromQuery(const SqlRow&) { return false; }
+  Song Metadata() const { return song_; }
+  QUrl Url() const { return song_.url(); }
+
+  void set_title(const QString& title) { song_.set_title(title); }
+
+ protected:
+  Song DatabaseSongMetadata() const { return song_; }
+
+ private:
+  Song song_;
+};
+
+class PlaylistBackendTest : public ::testing::Test {
+ protected:
+  struct Row {
+    int id;
+    qint64 position;
+    QString title;
+  };
+
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(NULL));
+    backend_.reset(new PlaylistBackend(database_.get()));
+    playlist_ = backend_->CreatePlaylist("Test", QString());
+  }
+
+  PlaylistItemList MakeItems(const QStringList& titles) {
+    PlaylistItemList ret;
+    foreach (const QString& title, titles) {
+      ret << PlaylistItemPtr(new TestPlaylistItem(title));
+    }
+    return ret;
+  }
+
+  void Save(const PlaylistItemList& items,
+            const PlaylistItemList& changed = PlaylistItemList()) {
+    backend_->SavePlaylist(playlist_, items, -1,
+                           smart_playlists::GeneratorPtr(), changed);
+    backend_->FlushPendingSaves();
+  }
+
+  QList<Row> Rows() {
+    QSqlQuery q("SELECT ROWID, position, title FROM playlist_items"
+                " WHERE playlist = :playlist ORDER BY position, ROWID",
+                database_->Connect());
+    q.bindValue(":playlist", playlist_);
+    q.exec();
+
+    QList<Row> ret;
+    while (q.next()) {
+      Row row;
+      row.id = q.value(0).toInt();
+      row.position = q.value(1).toLongLong();
+      row.title = q.value(2).toString();
+      ret << row;
+    }
+    return ret;
+  }
+
+  QStringList Titles(const QList<Row>& rows) {
+    QStringList ret;
+    foreach (const Row& row, rows) {
+      ret << row.title;
+    }
+    return ret;
+  }
+
+  PlaylistItemList Load(PlaylistBackend* backend) {
+    PlaylistBackend::PlaylistItemFuture future =
+        backend->GetPlaylistItems(playlist_);
+    future.waitForFinished();
+
+    const PlaylistItemList items = future.results();
+    backend->ItemsRestored(playlist_, items);
+    return items;
+  }
+
+  boost::scoped_ptr<Database> database_;
+  boost::scoped_ptr<PlaylistBackend> backend_;
+  int playlist_;
+};
+
+TEST_F(PlaylistBackendTest, SavesInOrder) {
+  Save(MakeItems(QStringList() << "a" << "b" << "c"));
+
+  const QList<Row> rows = Rows();
+  EXPECT_EQ(QStringList() << "a" << "b" << "c", Titles(rows));
+  ASSERT_EQ(3, rows.count());
+  EXPECT_EQ(PlaylistBackend::kPositionGap, rows[0].position);
+  EXPECT_EQ(PlaylistBackend::kPositionGap * 2, rows[1].position);
+  EXPECT_EQ(PlaylistBackend::kPositionGap * 3, rows[2].position);
+}
+
+TEST_F(PlaylistBackendTest, MovesOnlyTheMovedItem) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b" << "c" << "d");
+  Save(items);
+  const QList<Row> before = Rows();
+
+  // Move d to the top
+  items.prepend(items.takeLast());
+  Save(items);
+  const QList<Row> after = Rows();
+
+  EXPECT_EQ(QStringList() << "d" << "a" << "b" << "c", Titles(after));
+  ASSERT_EQ(4, after.count());
+
+  // a, b and c stay where they were, d keeps its row but gets a new position
+  for (int i=0 ; i<3 ; ++i) {
+    EXPECT_EQ(before[i].id, after[i + 1].id);
+    EXPECT_EQ(before[i].position, after[i + 1].position);
+  }
+  EXPECT_EQ(before[3].id, after[0].id);
+  EXPECT_LT(after[0].position, after[1].position);
+}
+
+TEST_F(PlaylistBackendTest, InsertsBetweenNeighbours) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b");
+  Save(items);
+  const QList<Row> before = Rows();
+
+  items.insert(1, PlaylistItemPtr(new TestPlaylistItem("x")));
+  Save(items);
+  const QList<Row> after = Rows();
+
+  EXPECT_EQ(QStringList() << "a" << "x" << "b", Titles(after));
+  ASSERT_EQ(3, after.count());
+  EXPECT_EQ(before[0].id, after[0].id);
+  EXPECT_EQ(before[0].position, after[0].position);
+  EXPECT_EQ(before[1].id, after[2].id);
+  EXPECT_EQ(before[1].position, after[2].position);
+  EXPECT_GT(after[1].position, after[0].position);
+  EXPECT_LT(after[1].position, after[2].position);
+}
+
+TEST_F(PlaylistBackendTest, RenumbersWhenGapIsFull) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b");
+  Save(items);
+  const QList<Row> before = Rows();
+
+  // There isn't room for this many items between a and b
+  QStringList titles;
+  for (int i=0 ; i<PlaylistBackend::kPositionGap ; ++i) {
+    titles << QString("x%1").arg(i);
+  }
+  PlaylistItemList inserted = MakeItems(titles);
+  for (int i=0 ; i<inserted.count() ; ++i) {
+    items.insert(i + 1, inserted[i]);
+  }
+  Save(items);
+  const QList<Row> after = Rows();
+
+  ASSERT_EQ(items.count(), after.count());
+  EXPECT_EQ(QStringList() << "a" << titles << "b", Titles(after));
+  for (int i=0 ; i<after.count() ; ++i) {
+    EXPECT_EQ(PlaylistBackend::kPositionGap * (i + 1), after[i].position);
+  }
+
+  // The old items were moved, not written again
+  EXPECT_EQ(before[0].id, after.first().id);
+  EXPECT_EQ(before[1].id, after.last().id);
+}
+
+TEST_F(PlaylistBackendTest, RewritesChangedItems) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b" << "c");
+  Save(items);
+  const QList<Row> before = Rows();
+
+  static_cast<TestPlaylistItem*>(items[1].get())->set_title("new b");
+  Save(items, PlaylistItemList() << items[1]);
+  const QList<Row> after = Rows();
+
+  EXPECT_EQ(QStringList() << "a" << "new b" << "c", Titles(after));
+  ASSERT_EQ(3, after.count());
+  EXPECT_EQ(before[0].id, after[0].id);
+  EXPECT_NE(before[1].id, after[1].id);
+  EXPECT_EQ(before[2].id, after[2].id);
+}
+
+TEST_F(PlaylistBackendTest, LoadsEditedItems) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b" << "c");
+  Save(items);
+
+  // What Playlist does once an inline tag edit has been written to the file
+  // and the item reloaded.
+  static_cast<TestPlaylistItem*>(items[1].get())->set_title("new b");
+  Save(items, PlaylistItemList() << items[1]);
+
+  PlaylistBackend backend(database_.get());
+  const PlaylistItemList loaded = Load(&backend);
+
+  QStringList titles;
+  foreach (PlaylistItemPtr item, loaded) {
+    titles << item->Metadata().title();
+  }
+  EXPECT_EQ(QStringList() << "a" << "new b" << "c", titles);
+}
+
+TEST_F(PlaylistBackendTest, IgnoresChangesThatWereNotReported) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b");
+  Save(items);
+
+  // Only items passed as changed are written again
+  static_cast<TestPlaylistItem*>(items[1].get())->set_title("new b");
+  Save(items);
+
+  EXPECT_EQ(QStringList() << "a" << "b", Titles(Rows()));
+}
+
+TEST_F(PlaylistBackendTest, LoadsWhatWasSaved) {
+  PlaylistItemList items = MakeItems(QStringList() << "a" << "b" << "c" << "d");
+  Save(items);
+  items.move(0, 2);
+  items.removeAt(3);
+  items.insert(1, PlaylistItemPtr(new TestPlaylistItem("e")));
+  Save(items);
+
+  // Load it again as if Clementine had been restarted
+  PlaylistBackend backend(database_.get());
+  const PlaylistItemList loaded = Load(&backend);
+
+  QStringList titles;
+  foreach (PlaylistItemPtr item, loaded) {
+    titles << item->Metadata().title();
+  }
+  EXPECT_EQ(QStringList() << "b" << "e" << "c" << "a", titles);
+
+  // Saving what was loaded doesn't need to touch any rows
+  const QList<Row> before = Rows();
+  backend.SavePlaylist(playlist_, loaded, -1, smart_playlists::GeneratorPtr(),
+                       PlaylistItemList());
+  backend.FlushPendingSaves();
+  const QList<Row> after = Rows();
+
+  ASSERT_EQ(before.count(), after.count());
+  for (int i=0 ; i<before.count() ; ++i) {
+    EXPECT_EQ(before[i].id, after[i].id);
+    EXPECT_EQ(before[i].position, after[i].position);
+  }
+}
+
+}  // namespace
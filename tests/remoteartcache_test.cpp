@@ -0,0 +1,85 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "networkremote/remoteartcache.h"
+
+#include <gtest/gtest.h>
+
+#include <QImage>
+
+namespace {
+
+QImage MakeImage(int width, int height, QRgb colour) {
+  QImage image(width, height, QImage::Format_RGB32);
+  image.fill(colour);
+  return image;
+}
+
+TEST(RemoteArtCacheTest, SameArtSameHash) {
+  RemoteArtCache cache;
+  const QImage image(MakeImage(100, 100, qRgb(255, 0, 0)));
+
+  const QString hash = cache.Add(image);
+  EXPECT_FALSE(hash.isEmpty());
+  EXPECT_EQ(hash, cache.Add(image));
+  EXPECT_EQ(hash, cache.Add(MakeImage(100, 100, qRgb(255, 0, 0))));
+  EXPECT_NE(hash, cache.Add(MakeImage(100, 100, qRgb(0, 255, 0))));
+  EXPECT_NE(hash, cache.Add(MakeImage(100, 50, qRgb(255, 0, 0))));
+}
+
+TEST(RemoteArtCacheTest, NullImage) {
+  RemoteArtCache cache;
+  EXPECT_TRUE(cache.Add(QImage()).isEmpty());
+}
+
+TEST(RemoteArtCacheTest, UnknownHash) {
+  RemoteArtCache cache;
+  EXPECT_TRUE(cache.Encoded("foo", 100).isEmpty());
+}
+
+TEST(RemoteArtCacheTest, ScalesToRequestedSize) {
+  RemoteArtCache cache;
+  const QString hash = cache.Add(MakeImage(400, 200, qRgb(0, 0, 255)));
+
+  QImage small;
+  ASSERT_TRUE(small.loadFromData(cache.Encoded(hash, 100), "JPG"));
+  EXPECT_EQ(100, small.width());
+  EXPECT_EQ(50, small.height());
+
+  QImage full;
+  ASSERT_TRUE(full.loadFromData(cache.Encoded(hash, 0), "JPG"));
+  EXPECT_EQ(400, full.width());
+  EXPECT_EQ(200, full.height());
+
+  // Art isn't made any bigger than it is
+  EXPECT_EQ(cache.Encoded(hash, 0), cache.Encoded(hash, 800));
+}
+
+TEST(RemoteArtCacheTest, ForgetsOldImages) {
+  RemoteArtCache cache;
+  const QString first = cache.Add(MakeImage(10, 10, qRgb(0, 0, 0)));
+
+  for (int i=1 ; i<RemoteArtCache::kMaxImages ; ++i) {
+    cache.Add(MakeImage(10, 10, qRgb(i, i, i)));
+  }
+  EXPECT_FALSE(cache.Encoded(first, 0).isEmpty());
+
+  cache.Add(MakeImage(10, 10, qRgb(255, 255, 255)));
+  EXPECT_TRUE(cache.Encoded(first, 0).isEmpty());
+}
+
+}  // namespace
@@ -0,0 +1,221 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "networkremote/remoteplaylistsync.h"
+#include "playlist/songplaylistitem.h"
+
+#include <gtest/gtest.h>
+
+#include <QStringList>
+
+namespace {
+
+class RemotePlaylistSyncTest : public ::testing::Test {
+ protected:
+  static const int kPlaylistId = 1;
+
+  static Song MakeSong(const QString& title) {
+    Song song;
+    song.Init(title, "Artist", "Album", 123);
+    return song;
+  }
+
+  void SetUp() {
+    for (int i=0 ; i<10 ; ++i) {
+      AddItem(QString("Song %1").arg(i));
+    }
+    SyncAndCheck();
+  }
+
+  void AddItem(const QString& title, int index = -1) {
+    const Song song(MakeSong(title));
+    if (index == -1)
+      index = items_.count();
+    items_.insert(index, PlaylistItemPtr(new SongPlaylistItem(song)));
+    songs_.insert(index, song);
+  }
+
+  void MoveItems(int from, int count, int to) {
+    PlaylistItemList moved_items(items_.mid(from, count));
+    SongList moved_songs(songs_.mid(from, count));
+    for (int i=0 ; i<count ; ++i) {
+      items_.removeAt(from);
+      songs_.removeAt(from);
+    }
+    for (int i=0 ; i<count ; ++i) {
+      items_.insert(to + i, moved_items[i]);
+      songs_.insert(to + i, moved_songs[i]);
+    }
+  }
+
+  // Does what a client would do with a delta.
+  static void Apply(const pb::remote::ResponsePlaylistDelta& delta,
+                    QStringList* titles) {
+    for (int i=0 ; i<delta.operations_size() ; ++i) {
+      const pb::remote::PlaylistOperation& op = delta.operations(i);
+      switch (op.type()) {
+        case pb::remote::PlaylistOperation::INSERT:
+          for (int j=0 ; j<op.songs_size() ; ++j) {
+            titles->insert(op.index() + j, QString::fromUtf8(op.songs(j).title().c_str()));
+          }
+          break;
+
+        case pb::remote::PlaylistOperation::REMOVE:
+          for (int j=0 ; j<op.count() ; ++j) {
+            titles->removeAt(op.index());
+          }
+          break;
+
+        case pb::remote::PlaylistOperation::MOVE: {
+          const QStringList moved(titles->mid(op.index(), op.count()));
+          for (int j=0 ; j<op.count() ; ++j) {
+            titles->removeAt(op.index());
+          }
+          for (int j=0 ; j<moved.count() ; ++j) {
+            titles->insert(op.destination() + j, moved[j]);
+          }
+          break;
+        }
+
+        case pb::remote::PlaylistOperation::UPDATE:
+          for (int j=0 ; j<op.songs_size() ; ++j) {
+            (*titles)[op.index() + j] = QString::fromUtf8(op.songs(j).title().c_str());
+          }
+          break;
+      }
+    }
+  }
+
+  // Sends the current playlist through the sync, applies the delta to what
+  // the client had and checks the client ends up with the same thing.
+  pb::remote::ResponsePlaylistDelta SyncAndCheck() {
+    pb::remote::ResponsePlaylistDelta delta;
+    const bool changed = sync_.Update(kPlaylistId, items_, songs_, &delta);
+
+    QStringList expected;
+    foreach (const Song& song, songs_) {
+      expected << song.title();
+    }
+
+    if (changed && !delta.reset()) {
+      Apply(delta, &client_titles_);
+      EXPECT_EQ(expected, client_titles_);
+      EXPECT_EQ(songs_.count(), delta.item_count());
+    } else {
+      client_titles_ = expected;
+    }
+    return delta;
+  }
+
+  RemotePlaylistSync sync_;
+  PlaylistItemList items_;
+  SongList songs_;
+  QStringList client_titles_;
+};
+
+TEST_F(RemotePlaylistSyncTest, NothingChanged) {
+  pb::remote::ResponsePlaylistDelta delta;
+  EXPECT_FALSE(sync_.Update(kPlaylistId, items_, songs_, &delta));
+}
+
+TEST_F(RemotePlaylistSyncTest, Insert) {
+  AddItem("New 1", 3);
+  AddItem("New 2", 4);
+  AddItem("New 3", 0);
+
+  const pb::remote::ResponsePlaylistDelta delta = SyncAndCheck();
+  ASSERT_EQ(2, delta.operations_size());
+  EXPECT_EQ(pb::remote::PlaylistOperation::INSERT, delta.operations(0).type());
+  EXPECT_EQ(1, delta.from_version());
+  EXPECT_EQ(2, delta.to_version());
+}
+
+TEST_F(RemotePlaylistSyncTest, Remove) {
+  items_.removeAt(7); songs_.removeAt(7);
+  items_.removeAt(2); songs_.removeAt(2);
+  items_.removeAt(2); songs_.removeAt(2);
+
+  const pb::remote::ResponsePlaylistDelta delta = SyncAndCheck();
+  ASSERT_EQ(2, delta.operations_size());
+  EXPECT_EQ(pb::remote::PlaylistOperation::REMOVE, delta.operations(0).type());
+  EXPECT_EQ(0, delta.operations(0).songs_size());
+}
+
+TEST_F(RemotePlaylistSyncTest, Move) {
+  MoveItems(6, 3, 1);
+  const pb::remote::ResponsePlaylistDelta delta = SyncAndCheck();
+  ASSERT_EQ(1, delta.operations_size());
+  EXPECT_EQ(pb::remote::PlaylistOperation::MOVE, delta.operations(0).type());
+
+  MoveItems(0, 1, 9);
+  SyncAndCheck();
+}
+
+TEST_F(RemotePlaylistSyncTest, Update) {
+  songs_[4] = MakeSong("Renamed 4");
+  songs_[5] = MakeSong("Renamed 5");
+
+  const pb::remote::ResponsePlaylistDelta delta = SyncAndCheck();
+  ASSERT_EQ(1, delta.operations_size());
+  EXPECT_EQ(pb::remote::PlaylistOperation::UPDATE, delta.operations(0).type());
+  EXPECT_EQ(4, delta.operations(0).index());
+  EXPECT_EQ(2, delta.operations(0).songs_size());
+}
+
+TEST_F(RemotePlaylistSyncTest, Everything) {
+  items_.removeAt(1); songs_.removeAt(1);
+  MoveItems(5, 2, 0);
+  AddItem("New", 3);
+  songs_[8] = MakeSong("Renamed");
+  items_.removeAt(9); songs_.removeAt(9);
+
+  SyncAndCheck();
+}
+
+TEST_F(RemotePlaylistSyncTest, ResetsAfterTooManyOperations) {
+  for (int i=0 ; i<RemotePlaylistSync::kMaxOperations * 2 ; ++i) {
+    AddItem(QString("More %1").arg(i));
+  }
+  SyncAndCheck();
+
+  // Every other song changing makes one update per song.
+  for (int i=0 ; i<songs_.count() ; i+=2) {
+    songs_[i] = MakeSong(QString("Renamed %1").arg(i));
+  }
+
+  const pb::remote::ResponsePlaylistDelta delta = SyncAndCheck();
+  EXPECT_TRUE(delta.reset());
+  EXPECT_EQ(0, delta.operations_size());
+  EXPECT_EQ(3, delta.to_version());
+}
+
+TEST_F(RemotePlaylistSyncTest, GetSongsPages) {
+  AddItem("New", 0);
+  SyncAndCheck();
+
+  pb::remote::ResponsePlaylistSongs response;
+  sync_.GetSongs(kPlaylistId, 8, 5, &response);
+
+  EXPECT_EQ(2, response.version());
+  EXPECT_EQ(8, response.offset());
+  EXPECT_EQ(11, response.requested_playlist().item_count());
+  ASSERT_EQ(3, response.songs_size());
+  EXPECT_EQ("Song 7", response.songs(0).title());
+  EXPECT_EQ(8, response.songs(0).index());
+}
+
+}  // namespace
@@ -0,0 +1,116 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "smartplaylists/shufflebag.h"
+
+#include <gtest/gtest.h>
+
+#include <QSet>
+
+using smart_playlists::ShuffleBag;
+
+namespace {
+
+QList<int> Range(int first, int count) {
+  QList<int> ret;
+  for (int i=first ; i<first + count ; ++i) {
+    ret << i;
+  }
+  return ret;
+}
+
+TEST(ShuffleBagTest, Empty) {
+  ShuffleBag bag;
+  EXPECT_EQ(-1, bag.Take());
+}
+
+TEST(ShuffleBagTest, TakesEverythingOnceBeforeRepeating) {
+  ShuffleBag bag;
+  bag.Reset(Range(1, 50));
+
+  for (int round=0 ; round<3 ; ++round) {
+    QSet<int> taken;
+    for (int i=0 ; i<50 ; ++i) {
+      const int id = bag.Take();
+      EXPECT_FALSE(taken.contains(id));
+      taken << id;
+    }
+    EXPECT_EQ(Range(1, 50).toSet(), taken);
+  }
+}
+
+TEST(ShuffleBagTest, Exclusions) {
+  ShuffleBag bag;
+  bag.Reset(Range(1, 10));
+  for (int i=1 ; i<=9 ; ++i) {
+    bag.Exclude(i);
+  }
+
+  for (int i=0 ; i<20 ; ++i) {
+    EXPECT_EQ(10, bag.Take());
+  }
+
+  bag.Exclude(10);
+  EXPECT_EQ(-1, bag.Take());
+
+  bag.Include(4);
+  EXPECT_EQ(4, bag.Take());
+}
+
+TEST(ShuffleBagTest, AddAndRemove) {
+  ShuffleBag bag;
+  bag.Reset(Range(1, 10));
+
+  // Take some so the songs are split between the bag and the taken ones
+  for (int i=0 ; i<5 ; ++i) {
+    bag.Take();
+  }
+
+  bag.Add(100);
+  bag.Add(100);
+  EXPECT_EQ(11, bag.count());
+  EXPECT_TRUE(bag.Contains(100));
+
+  for (int i=1 ; i<=10 ; i+=2) {
+    bag.Remove(i);
+  }
+  bag.Remove(1000);
+  EXPECT_EQ(6, bag.count());
+  EXPECT_FALSE(bag.Contains(1));
+  EXPECT_TRUE(bag.Contains(2));
+
+  // The new song comes out, and the removed ones never do.  Twice as many
+  // as there are is enough to empty the bag and go all the way through it
+  // again.
+  QSet<int> taken;
+  for (int i=0 ; i<12 ; ++i) {
+    taken << bag.Take();
+  }
+  EXPECT_EQ((QSet<int>() << 2 << 4 << 6 << 8 << 10 << 100), taken);
+}
+
+TEST(ShuffleBagTest, ResetForgetsExclusions) {
+  ShuffleBag bag;
+  bag.Reset(Range(1, 1));
+  bag.Exclude(1);
+  EXPECT_EQ(-1, bag.Take());
+
+  bag.Reset(Range(1, 1));
+  EXPECT_EQ(1, bag.Take());
+}
+
+}  // namespace
@@ -0,0 +1,153 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gtest/gtest.h"
+
+#include "core/atomtable.h"
+#include "core/song.h"
+#include "core/timeconstants.h"
+#include "library/sqlrow.h"
+
+#include <QtGlobal>
+
+#include <iostream>
+
+#ifdef Q_OS_LINUX
+# include <sys/wait.h>
+# include <unistd.h>
+# include <QFile>
+#endif
+
+namespace {
+
+// Metadata is spread over a realistic number of artists and albums, and every
+// string is allocated separately, the way it comes back from the database.
+QList<QVariant> MakeColumns(int i) {
+  QList<QVariant> columns;
+  for (int c=0 ; c<Song::kColumns.count() ; ++c) {
+    columns << QVariant();
+  }
+
+  columns[0] = i;
+  columns[1] = QString("Title %1").arg(i);
+  columns[2] = QString("Album %1").arg(i / 10);
+  columns[3] = QString("Artist %1").arg(i / 100);
+  columns[4] = QString("Album artist %1").arg(i / 100);
+  columns[10] = QString("Genre %1").arg(i % 20);
+  columns[16] = QString("file:///music/%1/%2.mp3").arg(i / 10).arg(i).toUtf8();
+  columns[21] = QString("/music/%1/cover.jpg").arg(i / 10);
+  columns[33] = 180 * kNsecPerSec;
+  return columns;
+}
+
+// What InitFromQuery used to do - every song keeps its own copy of every
+// string.
+SongList MakeSongsWithoutInterning(int count) {
+  SongList ret;
+  for (int i=0 ; i<count ; ++i) {
+    const QList<QVariant> columns = MakeColumns(i);
+
+    Song song;
+    song.set_id(i);
+    song.set_title(columns[1].toString());
+    song.set_album(columns[2].toString());
+    song.set_artist(columns[3].toString());
+    song.set_albumartist(columns[4].toString());
+    song.set_genre(columns[10].toString());
+    song.set_url(QUrl::fromEncoded(columns[16].toByteArray()));
+    song.set_art_automatic(columns[21].toString());
+    song.set_length_nanosec(columns[33].toLongLong());
+    ret << song;
+  }
+  return ret;
+}
+
+SongList MakeSongsFromQuery(int count) {
+  SongList ret;
+  for (int i=0 ; i<count ; ++i) {
+    Song song;
+    song.InitFromQuery(SqlRow(MakeColumns(i)), true);
+    ret << song;
+  }
+  return ret;
+}
+
+#ifdef Q_OS_LINUX
+qint64 ResidentBytes() {
+  QFile statm("/proc/self/statm");
+  if (!statm.open(QIODevice::ReadOnly))
+    return -1;
+
+  const QList<QByteArray> fields = statm.readAll().split(' ');
+  if (fields.count() < 2)
+    return -1;
+  return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+// Builds the songs in a child process, so each measurement starts from the
+// same heap, and returns how much the resident set grew.
+qint64 ResidentGrowth(SongList (*factory)(int), int count) {
+  int fds[2];
+  if (pipe(fds) != 0)
+    return -1;
+
+  const pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    const qint64 before = ResidentBytes();
+    const SongList songs = factory(count);
+    const qint64 growth = ResidentBytes() - before;
+    ssize_t written = write(fds[1], &growth, sizeof(growth));
+    Q_UNUSED(written);
+    _exit(songs.count() == count ? 0 : 1);
+  }
+
+  close(fds[1]);
+  qint64 growth = -1;
+  if (read(fds[0], &growth, sizeof(growth)) != sizeof(growth))
+    growth = -1;
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  return growth;
+}
+
+TEST(SongBenchmark, MemoryPerSong500k) {
+  const int kSongCount = 500000;
+
+  const qint64 before = ResidentGrowth(&MakeSongsWithoutInterning, kSongCount);
+  const qint64 after = ResidentGrowth(&MakeSongsFromQuery, kSongCount);
+
+  ASSERT_GT(before, 0);
+  ASSERT_GT(after, 0);
+  EXPECT_LT(after, before);
+
+  std::cout << "Resident bytes per song for " << kSongCount << " songs: "
+            << before / kSongCount << " without interning, "
+            << after / kSongCount << " with interning" << std::endl;
+}
+#endif // Q_OS_LINUX
+
+TEST(SongBenchmark, InternsRepeatedMetadata) {
+  const int count_before = AtomTable::count();
+  const SongList songs = MakeSongsFromQuery(1000);
+
+  // 10 artists, 10 album artists, 100 albums, 20 genres and 100 covers
+  EXPECT_EQ(240, AtomTable::count() - count_before);
+  EXPECT_EQ(songs[0].artist().constData(), songs[99].artist().constData());
+}
+
+}  // namespace
@@ -17,6 +17,7 @@
 
 #include "config.h"
 #include "core/song.h"
+#include "library/sqlrow.h"
 #ifdef HAVE_LIBLASTFM
   #include "internet/lastfmcompat.h"
 #endif
@@ -59,6 +60,37 @@ TEST_F(SongTest, InitsFromLastFM) {
 }
 #endif // HAVE_LIBLASTFM
 
+TEST_F(SongTest, InitFromQuerySharesRepeatedMetadata) {
+  QList<QVariant> columns;
+  for (int i=0 ; i<Song::kColumns.count() ; ++i) {
+    columns << QVariant();
+  }
+  columns[0] = 1;
+  columns[1] = QString("Title");
+  columns[2] = QString("Album");
+  columns[3] = QString("Artist");
+
+  Song first;
+  first.InitFromQuery(SqlRow(columns), true);
+
+  // The second row gets its own copies of the same text, like rows coming
+  // back from the database do.
+  columns[0] = 2;
+  columns[1] = QString("Tit") + "le";
+  columns[3] = QString("Art") + "ist";
+
+  Song second;
+  second.InitFromQuery(SqlRow(columns), true);
+
+  EXPECT_EQ("Artist", second.artist());
+  EXPECT_EQ(first.artist().constData(), second.artist().constData());
+  EXPECT_EQ(first.album().constData(), second.album().constData());
+
+  // Titles aren't interned
+  EXPECT_EQ("Title", second.title());
+  EXPECT_NE(first.title().constData(), second.title().constData());
+}
+
 /*TEST_F(SongTest, InitsFromFile) {
   QTemporaryFile temp;
   temp.open();
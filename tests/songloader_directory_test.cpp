@@ -0,0 +1,249 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test_utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "mock_librarybackend.h"
+
+#include "core/songloader.h"
+#include "core/tagreaderclient.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+
+#include <boost/scoped_ptr.hpp>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace {
+
+// Pretends that the files with an even number in their name are in the
+// library already.
+SongList EvenSongsInLibrary(const QList<QUrl>& urls) {
+  SongList ret;
+  foreach (const QUrl& url, urls) {
+    const int number = QFileInfo(url.toLocalFile()).baseName().toInt();
+    if (number % 2 != 0)
+      continue;
+
+    Song song;
+    song.Init("From the library", "Artist", "Album", 123);
+    song.set_url(url);
+    song.set_filetype(Song::Type_Mpeg);
+    ret << song;
+  }
+  return ret;
+}
+
+class SongLoaderDirectoryTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    // The tagreader is built in the directory above the tests.
+    qputenv("PATH", QFile::encodeName(
+        QCoreApplication::applicationDirPath() + "/..") + ":" + qgetenv("PATH"));
+
+    sTagReader = new TagReaderClient;
+    sTagReader->Start();
+  }
+
+  static void TearDownTestCase() {
+    delete sTagReader;
+    sTagReader = NULL;
+  }
+
+ protected:
+  void SetUp() {
+    library_.reset(new MockLibraryBackend);
+    loader_.reset(new SongLoader(library_.get()));
+
+    EXPECT_CALL(*library_.get(), GetSongByUrl(_, _))
+        .WillRepeatedly(Return(Song()));
+
+    {
+      QTemporaryFile temp;
+      temp.open();
+      dir_ = temp.fileName();
+    }
+    ASSERT_TRUE(QDir().mkdir(dir_));
+  }
+
+  void TearDown() {
+    loader_.reset();
+
+    QDir dir(dir_);
+    foreach (const QString& filename, dir.entryList(QDir::Files)) {
+      dir.remove(filename);
+    }
+    QDir().rmdir(dir_);
+  }
+
+  // Writes count copies of beep.mp3 into the directory, named so they sort
+  // in order.
+  void WriteFiles(int count) {
+    QFile resource(":/testdata/beep.mp3");
+    resource.open(QIODevice::ReadOnly);
+    const QByteArray data(resource.readAll());
+
+    for (int i=0 ; i<count ; ++i) {
+      QFile mp3(QString("%1/%2.mp3").arg(dir_).arg(i, 3, 10, QChar('0')));
+      mp3.open(QIODevice::WriteOnly);
+      mp3.write(data);
+    }
+  }
+
+  void LoadDirectory() {
+    ASSERT_EQ(SongLoader::WillLoadAsync,
+              loader_->Load(QUrl::fromLocalFile(dir_)));
+
+    // Wait for the whole directory to be read.
+    QEventLoop loop;
+    QObject::connect(loader_.get(), SIGNAL(LoadFinished(bool)),
+                     &loop, SLOT(quit()));
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+  }
+
+  static QList<int> Counts(const QSignalSpy& spy) {
+    QList<int> ret;
+    for (int i=0 ; i<spy.count() ; ++i) {
+      ret << spy[i][0].value<SongList>().count();
+    }
+    return ret;
+  }
+
+  static SongList Songs(const QSignalSpy& spy) {
+    SongList ret;
+    for (int i=0 ; i<spy.count() ; ++i) {
+      ret << spy[i][0].value<SongList>();
+    }
+    return ret;
+  }
+
+  static QStringList Filenames(const SongList& songs) {
+    QStringList ret;
+    foreach (const Song& song, songs) {
+      ret << song.basefilename();
+    }
+    return ret;
+  }
+
+  static TagReaderClient* sTagReader;
+
+  QString dir_;
+  boost::scoped_ptr<MockLibraryBackend> library_;
+  boost::scoped_ptr<SongLoader> loader_;
+};
+
+TagReaderClient* SongLoaderDirectoryTest::sTagReader = NULL;
+
+
+TEST_F(SongLoaderDirectoryTest, EmitsSmallFirstBatch) {
+  WriteFiles(SongLoader::kDirectoryFirstBatchSize +
+             SongLoader::kDirectoryBatchSize + 10);
+  EXPECT_CALL(*library_.get(), GetSongsByUrls(_))
+      .Times(3)
+      .WillRepeatedly(Return(SongList()));
+
+  QSignalSpy loaded(loader_.get(), SIGNAL(SongsLoaded(SongList)));
+  LoadDirectory();
+
+  QList<int> expected;
+  expected << SongLoader::kDirectoryFirstBatchSize
+           << SongLoader::kDirectoryBatchSize << 10;
+  EXPECT_EQ(expected, Counts(loaded));
+
+  // The batches are in the same order as the files, and make up the whole
+  // directory between them.
+  const SongList songs = Songs(loaded);
+  EXPECT_EQ(Filenames(loader_->songs()), Filenames(songs));
+  for (int i=0 ; i<songs.count() ; ++i) {
+    EXPECT_EQ(QString("%1.mp3").arg(i, 3, 10, QChar('0')),
+              songs[i].basefilename());
+  }
+}
+
+TEST_F(SongLoaderDirectoryTest, ReadsTagsOfFirstBatchBeforeEmittingIt) {
+  WriteFiles(10);
+  EXPECT_CALL(*library_.get(), GetSongsByUrls(_))
+      .WillOnce(Return(SongList()));
+
+  QSignalSpy loaded(loader_.get(), SIGNAL(SongsLoaded(SongList)));
+  QSignalSpy effective(loader_.get(), SIGNAL(EffectiveSongsLoaded(SongList)));
+  LoadDirectory();
+
+  ASSERT_EQ(1, loaded.count());
+  EXPECT_EQ(0, effective.count());
+  foreach (const Song& song, Songs(loaded)) {
+    EXPECT_EQ("Beep mp3", song.title());
+  }
+}
+
+TEST_F(SongLoaderDirectoryTest, EmitsEffectiveSongsInOrder) {
+  WriteFiles(SongLoader::kDirectoryFirstBatchSize +
+             SongLoader::kDirectoryBatchSize * 3 + 10);
+  EXPECT_CALL(*library_.get(), GetSongsByUrls(_))
+      .WillRepeatedly(Return(SongList()));
+
+  QSignalSpy effective(loader_.get(), SIGNAL(EffectiveSongsLoaded(SongList)));
+  LoadDirectory();
+
+  // Everything after the first batch is emitted again once it's been read,
+  // in the same order.
+  QList<int> expected;
+  expected << SongLoader::kDirectoryBatchSize << SongLoader::kDirectoryBatchSize
+           << SongLoader::kDirectoryBatchSize << 10;
+  EXPECT_EQ(expected, Counts(effective));
+
+  const SongList songs = Songs(effective);
+  EXPECT_EQ(Filenames(loader_->songs().mid(SongLoader::kDirectoryFirstBatchSize)),
+            Filenames(songs));
+  foreach (const Song& song, songs) {
+    EXPECT_EQ("Beep mp3", song.title());
+  }
+}
+
+TEST_F(SongLoaderDirectoryTest, DoesNotReadSongsInLibrary) {
+  WriteFiles(SongLoader::kDirectoryFirstBatchSize + 10);
+  EXPECT_CALL(*library_.get(), GetSongsByUrls(_))
+      .Times(2)
+      .WillRepeatedly(Invoke(EvenSongsInLibrary));
+
+  QSignalSpy effective(loader_.get(), SIGNAL(EffectiveSongsLoaded(SongList)));
+  LoadDirectory();
+
+  const SongList songs = loader_->songs();
+  ASSERT_EQ(SongLoader::kDirectoryFirstBatchSize + 10, songs.count());
+  for (int i=0 ; i<songs.count() ; ++i) {
+    EXPECT_EQ(QString(i % 2 == 0 ? "From the library" : "Beep mp3"),
+              songs[i].title());
+  }
+
+  // Only the songs that had to be read are emitted again.
+  const SongList read = Songs(effective);
+  ASSERT_EQ(5, read.count());
+  foreach (const Song& song, read) {
+    EXPECT_EQ("Beep mp3", song.title());
+  }
+}
+
+}  // namespace